@@ -104,6 +104,39 @@ unsigned int fifo_in(fifo_t * fifo, const uint8_t * buf, unsigned long n);
  * writer, you don't need extra locking to use these macro.
  */
 unsigned int fifo_out(fifo_t * fifo, uint8_t * buf, unsigned long n);
+
+/**
+ * fifo_peek - describe data in the fifo without removing it
+ * @fifo: address of the fifo to be used
+ * @offset: number of elements to skip from the read position
+ * @n: number of elements to describe
+ * @span: descriptor filled with the (at most two) contiguous segments
+ *
+ * This function lets the reader process data in place in the fifo buffer.
+ * It returns the number of elements described, which is less than @n when
+ * the fifo does not hold enough data. The described elements stay valid
+ * until they are released with fifo_commit().
+ */
+unsigned int fifo_peek(fifo_t * fifo, unsigned int offset, unsigned int n, fifo_span_t * span);
+
+/**
+ * fifo_commit - release elements read in place
+ * @fifo: address of the fifo to be used
+ * @n: number of elements to release from the read position
+ *
+ * Only the reader may call this function.
+ */
+void fifo_commit(fifo_t * fifo, unsigned int n);
+
+/**
+ * fifo_wait_for - wait until the fifo holds enough data
+ * @fifo: address of the fifo to be used
+ * @count: minimum number of elements
+ * @timeout_ms: maximum waiting time in milliseconds
+ *
+ * Polls fifo_len() without masking interrupts. Returns FIFO_OK when @count
+ * elements are available, FIFO_ERROR on timeout.
+ */
 int fifo_wait_for(fifo_t *fifo, unsigned int count, unsigned int timeout_ms);
 
 #endif // _FIFO_H_
@@ -0,0 +1,65 @@
+/**
+ * @file    crc.h
+ * @brief   Calcul incrémental des CRC16-CCITT (XMODEM) et CRC32 (IEEE 802.3).
+ *
+ * Usage : crc = crcXX_init() ; crc = crcXX_update(crc, ...) autant de fois que
+ * nécessaire ; résultat = crcXX_final(crc).
+ *
+ * Deux moteurs :
+ *   - l'unité CRC du STM32G4 sur la cible (CRC_HW_BACKEND = 1, par défaut avec la HAL) ;
+ *   - un calcul logiciel par tranches de 8 octets (slice-by-8) ailleurs (outils PC,
+ *     simulation), avec des tables construites au premier appel.
+ * Les variantes bit à bit sont toujours disponibles comme référence et pour le
+ * banc de mesure (Tools/crc_bench.c).
+ */
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Moteur matériel : unité CRC du STM32G4. */
+#ifndef CRC_HW_BACKEND
+#ifdef USE_HAL_DRIVER
+#define CRC_HW_BACKEND      1
+#else
+#define CRC_HW_BACKEND      0
+#endif
+#endif
+
+/** Moteur logiciel slice-by-8 : 12 ko de tables en RAM, réservé aux builds PC par défaut. */
+#ifndef CRC_SLICE8_BACKEND
+#define CRC_SLICE8_BACKEND  (!CRC_HW_BACKEND)
+#endif
+
+#define CRC16_POLY          (0x1021U)       /**< CRC16-CCITT, valeur initiale 0 (XMODEM) */
+#define CRC32_POLY          (0xEDB88320UL)  /**< CRC32 IEEE 802.3, forme réfléchie */
+
+uint16_t crc16_init(void);
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t length);
+uint16_t crc16_final(uint16_t crc);
+uint32_t crc32_init(void);
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t length);
+uint32_t crc32_final(uint32_t crc);
+
+/* Moteurs individuels, pour le banc de mesure */
+uint16_t crc16_update_bitwise(uint16_t crc, const uint8_t *data, uint32_t length);
+uint32_t crc32_update_bitwise(uint32_t crc, const uint8_t *data, uint32_t length);
+#if CRC_SLICE8_BACKEND
+uint16_t crc16_update_slice8(uint16_t crc, const uint8_t *data, uint32_t length);
+uint32_t crc32_update_slice8(uint32_t crc, const uint8_t *data, uint32_t length);
+#endif
+#if CRC_HW_BACKEND
+uint16_t crc16_update_hw(uint16_t crc, const uint8_t *data, uint32_t length);
+uint32_t crc32_update_hw(uint32_t crc, const uint8_t *data, uint32_t length);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC_H_ */
@@ -20,16 +20,74 @@ extern "C" {
  * @brief Adresse de démarrage de l’application.
  *
  * La plage d’écriture pour la mise à jour se situe de APPLICATION_ADDRESS jusqu’à
- * APP_CONFIG_ADDRESS - 1.
+ * IMAGE_INFO_ADDRESS - 1.
  */
 #define APPLICATION_ADDRESS  (0x08010000U)
 
+/**
+ * @brief Page d'information de l'application (en-tête vérifié et marqueur, voir image.h).
+ *
+ * Organisation de la fin de la flash :
+ *     0x08010000 - 0x0801DFFF : application (56 ko)
+ *     0x0801E000 - 0x0801E7FF : page d'information de l'image
+ *     0x0801E800 - 0x0801F7FF : journal de configuration (deux pages)
+ *     0x0801F800 - 0x0801FFFF : AppConfig_t
+ * Une application installée sans en-tête (page d'information vierge) démarre
+ * toujours, si elle tient dans les 56 ko (voir image.c).
+ */
+#define IMAGE_INFO_ADDRESS   (0x0801E000U)
+
+/**
+ * @brief Pages du journal de configuration (enregistrements clé/valeur, voir kvlog.c).
+ *
+ * Les deux pages se trouvent entre la page d'information de l'image et la page
+ * AppConfig_t (0x0801F800) : une seule est active, l'autre reçoit le compactage.
+ */
+#define KVLOG_PAGE0_ADDRESS  (0x0801E800U)
+#define KVLOG_PAGE1_ADDRESS  (0x0801F000U)
+
+/**
+ * @brief Clés du journal de configuration (champs réglables de AppConfig_t).
+ */
+#define KVLOG_KEY_COEF_ANEMO    (0U)
+#define KVLOG_KEY_COEF_PLUVIO   (1U)
+#define KVLOG_KEY_TEMP_A        (2U)
+#define KVLOG_KEY_TEMP_B        (3U)
+#define KVLOG_KEY_COUNT         (16U)   /**< Nombre maximal de clés (index RAM, 32 au plus) */
+
+/**
+ * @brief Codes de retour du journal de configuration.
+ */
+#define KVLOG_OK             (0)
+#define KVLOG_ERROR          (-1)     /**< Clé absente ou invalide, ou erreur d'écriture flash */
+
+/**
+ * @brief Version de schéma de la page de configuration (champ AppConfig_t.Schema).
+ *
+ * Une page sans CONFIG_SCHEMA_MAGIC est de version 0 : disposition d'origine,
+ * migrée en place par Config_Init().
+ */
+#define CONFIG_SCHEMA_MAGIC     (0x43460000UL)  /**< "CF" + version sur 16 bits */
+#define CONFIG_SCHEMA_MASK      (0xFFFF0000UL)
+#define CONFIG_SCHEMA_VERSION   (1U)
+
+/* Version du bootloader (page de configuration et boîte aux lettres, voir handoff.h) */
+#define L_MAJEUR_VERSION 0L
+#define L_MINEUR_VERSION 0L
+#define L_RELEASE_VERSION 'a'
+
 /* Limites pour les coefficients */
 #define COEF_ANEMO_MIN   (0.0f)
 #define COEF_ANEMO_MAX   (5.0f)
 #define COEF_PLUVIO_MIN  (0.0f)
 #define COEF_PLUVIO_MAX  (2.0f)
 
+/* Limites de l'étalonnage du capteur de température : gain (Temp_A) et décalage en °C (Temp_B) */
+#define TEMP_A_MIN       (0.5f)
+#define TEMP_A_MAX       (1.5f)
+#define TEMP_B_MIN       (-20.0f)
+#define TEMP_B_MAX       (20.0f)
+
 /* Temps d'attente pour entrer en mode bootloader (en millisecondes) */
 #define BOOTLOADER_WAIT_TIME_MS  (10000U)
 
@@ -51,21 +109,153 @@ extern "C" {
 
 
 #define FLASH_APP_START_ADDRESS ((uint32_t)0x08010000u)
-#define FLASH_APP_END_ADDRESS   ((uint32_t)FLASH_BANK1_END-0x800)
+#define FLASH_APP_END_ADDRESS   ((uint32_t)0x0801DFFFu)   /* Dernier octet avant la page d'information de l'image */
 
 #define ANTIREBOND 0.04f /* Temps en secondes éivalent ࠱00 km/h */
 
 /** 
  * @def FIFO_BUFFER_SIZE
  * @brief Taille du tampon du FIFO.
+ *
+ * Puissance de 2 : les indices de lecture et d'écriture sont des compteurs libres,
+ * ramenés dans le tampon par FIFO_MASK.
  */
 #define FIFO_BUFFER_SIZE    (2048U)
+#define FIFO_MASK           (FIFO_BUFFER_SIZE - 1U)
 /** 
  * @brief Codes de retour pour les fonctions du FIFO.
  */
 #define FIFO_OK             (0)
 #define FIFO_ERROR          (-1)
 
+/**
+ * @def UART2_RX_DMA_BUFFER_SIZE
+ * @brief Taille du tampon circulaire DMA de réception de l'USART2.
+ *
+ * Les évènements demi-tampon, tampon complet et ligne inactive publient les octets
+ * reçus dans usart2_fifo par plages. Pendant la programmation d'une ligne de la
+ * flash (1,9 ms, CPU bloqué), jusqu'à un demi-tampon non publié plus 176 octets
+ * à 921600 bauds doivent y tenir : 512 octets laissent une marge de 80 octets.
+ */
+#define UART2_RX_DMA_BUFFER_SIZE    (512U)
+
+/**
+ * @def UART2_TX_TIMEOUT_MS
+ * @brief Attente maximale de place dans la file d'émission de l'USART2 (rou.c).
+ *
+ * La file (usart2_tx_fifo, FIFO_BUFFER_SIZE octets) contient un écran complet du
+ * menu ; elle ne se remplit que si le DMA d'émission est arrêté.
+ */
+#define UART2_TX_TIMEOUT_MS         (1000U)
+
+/**
+ * @def UART2_BAUD_DEFAULT
+ * @brief Débit de l'USART2 au démarrage et après l'échec d'un changement de débit.
+ *
+ * Un outil PC peut proposer un débit plus élevé pendant une session de
+ * provisionnement (PROV_CMD_BAUD, prov.c), ou ouvrir la session à son propre débit
+ * par l'octet UART2_AUTOBAUD_SYNC (détection automatique de l'USART, usart.c).
+ * UART2_BAUD_MAX est la limite du FT232R du câble ; le BRR obtenu avec PCLK1 à
+ * 168 MHz ne doit pas s'écarter de plus de 2 % du débit demandé.
+ */
+#define UART2_BAUD_DEFAULT          (38400U)
+#define UART2_BAUD_MIN              (9600U)
+#define UART2_BAUD_MAX              (3000000U)
+#define UART2_AUTOBAUD_SYNC         (0x7FU)     /**< Premier octet mesuré par la détection automatique */
+
+/**
+ * @def CDC_TX_TIMEOUT_MS
+ * @brief Attente maximale de place dans la file d'émission de l'USB CDC (Rou_cdc.c).
+ *
+ * La file (cdc_tx_fifo, FIFO_BUFFER_SIZE octets) ne se remplit que si le PC ne
+ * lit plus le port ; les octets sont perdus au-delà, comme sur l'USART2.
+ */
+#define CDC_TX_TIMEOUT_MS           (1000U)
+
+/**
+ * @def CDC_RX_PACKET_BUFFERS
+ * @brief Nombre de tampons de réception de l'endpoint OUT de l'USB CDC (usbd_cdc_if.c).
+ *
+ * Les tampons de 64 octets sont armés à tour de rôle : le paquet suivant est
+ * accepté pendant la copie du paquet reçu dans cdc_fifo. L'endpoint n'est laissé
+ * en NAK que si la FIFO ne peut plus recevoir un paquet complet.
+ */
+#define CDC_RX_PACKET_BUFFERS       (2U)
+
+/**
+ * @def USBD_FTDI_EMULATION
+ * @brief Personnalité du port USB : 0 port CDC (usbd_cdc_if.c), 1 émulation FT232R
+ *        (usbd_FTDI.c) pour les outils de terrain prévus pour le câble FTDI.
+ *
+ * Les deux classes utilisent cdc_fifo, cdc_tx_fifo et la liaison transport_cdc.
+ */
+#ifndef USBD_FTDI_EMULATION
+#define USBD_FTDI_EMULATION         (0U)
+#endif
+
+/**
+ * @def FTDI_LATENCY_DEFAULT_MS
+ * @brief Timer de latence de l'émulation FT232R à la configuration (16 ms, comme le circuit).
+ *
+ * Un paquet IN incomplet part à l'échéance ; le PC peut régler le délai de 1 à
+ * 255 ms (FTDI_SIO_SET_LATENCY_TIMER). Un délai court réduit le temps de réponse
+ * du menu, un délai long regroupe davantage d'octets par paquet.
+ */
+#define FTDI_LATENCY_DEFAULT_MS     (16U)
+
+/**
+ * @def FLASH_PIPE_SLOTS
+ * @brief Nombre de tampons de préparation d'une page (2 ko) du pipeline d'écriture flash.
+ */
+#define FLASH_PIPE_SLOTS            (2U)
+
+/**
+ * @def FLASH_PIPE_PROGRAM_CHUNK
+ * @brief Nombre de doubles mots programmés par appel à flash_pipe_poll().
+ *
+ * Borne la durée d'une étape (environ 90 µs par double mot, 1,9 ms par ligne de
+ * 32 doubles mots en mode rapide) pour que la boucle de réception reprenne la main
+ * régulièrement. Multiple de FLASH_ROW_SIZE / 8 pour programmer des lignes entières.
+ */
+#define FLASH_PIPE_PROGRAM_CHUNK    (32U)
+
+/**
+ * @def FLASH_ROW_SIZE
+ * @brief Taille d'une ligne programmée en mode rapide (32 doubles mots).
+ */
+#define FLASH_ROW_SIZE              (256U)
+
+/**
+ * @brief Codes de retour du pipeline d'écriture flash.
+ */
+#define FLASH_PIPE_OK               (0)     /**< Aucune page en attente */
+#define FLASH_PIPE_BUSY             (1)     /**< Pages en cours de traitement */
+#define FLASH_PIPE_ERROR            (-1)
+
+/**
+ * @def SLWIN_WINDOW
+ * @brief Nombre de blocs non acquittés autorisés par le protocole à fenêtre glissante.
+ *
+ * Puissance de 2 comprise entre 2 et 8 (masque d'acquittement sélectif sur 7 bits),
+ * vérifiée à la compilation (slwin.c). Chaque bloc de la fenêtre occupe
+ * SLWIN_BLOCK_SIZE octets de RAM : au-delà de 4, make -C Host ram dépasse le budget.
+ */
+#define SLWIN_WINDOW            (4U)
+#define SLWIN_BLOCK_SIZE        (1024U)     /**< Taille maximale des données d'une trame */
+#define SLWIN_ACK_TIMEOUT_MS    (200U)      /**< Délai sans trame avant répétition de l'ACK (ms) */
+#define SLWIN_MAX_IDLE          (50U)       /**< Nombre de délais consécutifs avant annulation */
+
+/**
+ * @def PROV_PAYLOAD_MAX
+ * @brief Taille maximale des données d'une commande de provisionnement (prov.c).
+ *
+ * Une session commence par l'octet 0x00 (délimiteur COBS) à la place de l'espace
+ * du menu ; elle se termine après PROV_IDLE_TIMEOUT_MS sans commande valide.
+ */
+#define PROV_PAYLOAD_MAX        (128U)
+#define PROV_IDLE_TIMEOUT_MS    (5000U)     /**< Délai sans commande avant retour à l'attente (ms) */
+#define PROV_PROBE_TIMEOUT_MS   (1000U)     /**< Attente de la trame de test après PROV_CMD_BAUD (ms) */
+
 #ifdef __cplusplus
 }
 #endif
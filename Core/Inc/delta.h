@@ -0,0 +1,101 @@
+/**
+ * @file    delta.h
+ * @brief   Reconstruction en place d'une image firmware à partir d'un patch différentiel.
+ *
+ * Le patch décrit la nouvelle image page par page à partir de l'application
+ * installée (image source) : chaque page est une suite de copies depuis l'image
+ * source et de données littérales. Les pages sont reconstruites dans l'ordre du
+ * patch, choisi par l'outil PC (Tools/delta_pack.c) pour qu'aucune page source
+ * encore nécessaire ne soit écrasée avant d'avoir été lue. Le décodeur refuse une
+ * copie depuis une page déjà réécrite.
+ *
+ * Ce module ne dépend ni de la HAL ni de inc.h : il se compile tel quel sur la
+ * cible et sur PC.
+ *
+ * Format (entiers petit-boutistes) :
+ *
+ *     en-tête (24 octets) : "ADL1" | taille de page (2) | nombre de pages (2) |
+ *                           taille source (4) | CRC32 source (4) |
+ *                           taille cible (4) | CRC32 cible (4)
+ *     page                : indice (2) | taille (2) | opérations
+ *     opération           : DELTA_OP_COPY (1) | taille (2) | décalage source (4)
+ *                         | DELTA_OP_DATA (1) | taille (2) | données
+ *
+ * La taille d'une page est DELTA_PAGE_SIZE, sauf pour la dernière page de
+ * l'image ; le reste de cette page est complété par 0xFF. Les pages identiques
+ * dans les deux images sont absentes du patch et ne sont ni effacées ni réécrites. Le CRC32 (IEEE 802.3)
+ * de l'image source est contrôlé avant toute écriture, celui de l'image
+ * reconstruite par delta_finish(). Les octets qui suivent la dernière page
+ * (bourrage XMODEM) sont ignorés.
+ */
+
+#ifndef DELTA_H_
+#define DELTA_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DELTA_PAGE_SIZE         (2048U)     /**< Taille d'une page flash */
+#define DELTA_MAX_PAGES         (64U)       /**< Pages de l'image au plus */
+#define DELTA_HEADER_SIZE       (24U)
+#define DELTA_PAGE_HEADER_SIZE  (4U)
+#define DELTA_OP_HEADER_SIZE    (3U)
+#define DELTA_COPY_HEADER_SIZE  (7U)
+
+#define DELTA_OP_COPY           (0x01U)     /**< Copie depuis l'image source */
+#define DELTA_OP_DATA           (0x02U)     /**< Données littérales */
+
+/**
+ * @brief Codes de retour du décodeur.
+ */
+#define DELTA_OK                (0)     /**< Données consommées, patch incomplet */
+#define DELTA_DONE              (1)     /**< Toutes les pages ont été reconstruites */
+#define DELTA_ERROR             (-1)    /**< Patch invalide, mauvaise image source ou erreur de la sortie */
+
+/**
+ * @brief Fonction de sortie des octets reconstruits.
+ *
+ * @param[in] context Contexte fourni à delta_decode().
+ * @param[in] offset  Position des octets dans l'image cible.
+ * @param[in] data    Octets reconstruits.
+ * @param[in] length  Nombre d'octets.
+ * @return int 0 en cas de succès, une valeur non nulle pour interrompre la reconstruction.
+ */
+typedef int (*delta_sink_t)(void *context, uint32_t offset, const uint8_t *data, uint32_t length);
+
+/**
+ * @brief État du décodeur de patch.
+ */
+typedef struct
+{
+    const uint8_t *source;                  /**< Image source (application installée). */
+    uint32_t source_length;                 /**< Taille de l'image source. */
+    uint32_t target_length;                 /**< Taille de l'image cible. */
+    uint32_t target_crc;                    /**< CRC32 attendu de l'image cible. */
+    uint32_t page_count;                    /**< Nombre de pages présentes dans le patch. */
+    uint32_t pages_done;                    /**< Nombre de pages reconstruites. */
+    uint32_t written[(DELTA_MAX_PAGES + 31U) / 32U];   /**< Pages déjà réécrites. */
+    uint32_t page;                          /**< Page en cours. */
+    uint32_t offset;                        /**< Position d'écriture dans l'image cible. */
+    uint32_t page_remaining;                /**< Octets restant à produire pour la page. */
+    uint32_t data_remaining;                /**< Octets littéraux restant à recevoir. */
+    uint8_t field[DELTA_HEADER_SIZE];       /**< En-tête en cours de réception. */
+    uint32_t field_length;                  /**< Nombre d'octets d'en-tête reçus. */
+    uint32_t state;                         /**< Étape du décodage. */
+    int status;                             /**< DELTA_OK, DELTA_DONE ou DELTA_ERROR. */
+} delta_decoder_t;
+
+int delta_is_patch(const uint8_t *data, uint32_t length);
+void delta_decoder_init(delta_decoder_t *decoder, const uint8_t *source, uint32_t source_limit);
+int delta_decode(delta_decoder_t *decoder, const uint8_t *data, uint32_t length,
+                 delta_sink_t sink, void *context);
+int delta_finish(const delta_decoder_t *decoder, const uint8_t *target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DELTA_H_ */
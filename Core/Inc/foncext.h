@@ -5,22 +5,64 @@
 extern "C" {
 #endif
 void MX_GPIO_Init(void);
-void Flash_Erase(uint32_t start_address, uint32_t end_address);
 
-void Config_Read(AppConfig_t * const config);
+const AppConfig_t *Config_Get(void);
+float Config_Get_Float(uint32_t key);
+void Config_Init(void);
 //void Config_Write(const AppConfig_t * const config);
 void Write_Structure_To_Flash(uint32_t address, void *data, size_t size);
+void Config_Merge(AppConfig_t * const config);
+void Config_Publish(void);
+int Config_Write_Value(uint32_t key, float value);
+void kvlog_init(void);
+int kvlog_get(uint32_t key, uint32_t *value);
+int kvlog_set(uint32_t key, uint32_t value);
 
 float GetTemperatureSensorReading(void);
 int Ymodem_ReceivePacket(uint8_t *p_data, uint16_t *p_length, uint8_t *p_packet_number, uint32_t timeout);
-int YMODEM_Receive(void);
+int YMODEM_Receive(const transport_t *link, uint8_t streamingMode, xmodem_block_callback_t callback);
 void Bootloader_JumpToApplication(void);
 void Bootloader_Menu(void);
 
 void XMODEM_Init(void);
 //void xmodem_receive(void);
-int xmodem_receive_1k_blockwise(fifo_t *fifo, xmodem_block_callback_t callback);
-void flash_write_callback(const uint8_t *block, uint32_t block_number, uint16_t received_crc);
+int xmodem_receive_1k_blockwise(const transport_t *link, xmodem_block_callback_t callback);
+int xmodem_receive_1k_g(const transport_t *link, xmodem_block_callback_t callback);
+uint32_t cobs_encode(const uint8_t *src, uint32_t length, uint8_t *dst);
+int32_t cobs_decode(const uint8_t *src, uint32_t length, uint8_t *dst);
+int slwin_receive(const transport_t *link, xmodem_block_callback_t callback);
+int prov_session(const transport_t *link);
+void flash_write_callback(const fifo_span_t *block, uint32_t block_number, uint16_t received_crc);
+int flash_write_finish(void);
+uint32_t flash_write_resume(void);
+int flash_erase_page(uint32_t address);
+int flash_program_span(uint32_t address, const fifo_span_t *span);
+int flash_erase_pages(uint32_t address, uint32_t count);
+int flash_program_rows(uint32_t address, const uint8_t *data, uint32_t length);
+int flash_fast_program_row(uint32_t address, const uint32_t *row);
+void flash_pipe_init(uint32_t address, uint32_t end_address);
+int flash_pipe_write(const uint8_t *data, uint32_t length);
+int flash_pipe_write_all(const uint8_t *data, uint32_t length);
+int flash_pipe_poll(void);
+int flash_pipe_flush(void);
+int flash_pipe_seek(uint32_t address);
+void flash_pipe_erase_ahead(uint32_t end_address);
+int flash_pipe_prepare(void);
+int flash_pipe_preerase(uint32_t end_address);
+bool flash_pipe_is_erased(uint32_t address);
+void flash_pipe_abort(void);
+int image_header_check(const image_header_t *header);
+int image_invalidate(void);
+int image_commit(const image_header_t *header, uint32_t length);
+int image_check(void);
+int image_verify(void);
+const image_header_t *image_get_header(void);
+int image_journal_begin(const image_header_t *header);
+void handoff_init(void);
+bool handoff_bootloader_requested(void);
+void handoff_set_flags(uint16_t flags);
+void handoff_publish(void);
+void image_journal_page(uint32_t address);
 void MX_TIM2_Init_1us(void);
 uint32_t get_time_us(void);
 void MX_GPIO_EXTI0_Init(void);
@@ -32,9 +74,39 @@ void Error_Handler(void);
 void SendStringFTDI(char *Chaine);
 void SendCharFTDI(char Chaine);
 void UART2_Init(void);
+void UART2_StartReceiveDMA(void);
+void UART2_RxEvent(uint16_t position);
+void UART2_RxError(void);
+uint32_t UART2_CheckBaudRate(uint32_t baud);
+int UART2_SetBaudRate(uint32_t baud);
+void UART2_AutoBaudArm(void);
+uint32_t UART2_AutoBaudResult(void);
+uint32_t UART2_TxWrite(const uint8_t *data, uint32_t length);
+void UART2_Send(const uint8_t *data, uint32_t length);
+int UART2_TxFlush(uint32_t timeout_ms);
+void UART2_TxComplete(void);
+void UART2_TxReset(void);
 void MX_ADC_MultiMode_Init(void);
 void Read_ADC_Values(void);
 bool fifo_is_empy(fifo_t *fifo);
+bool CDC_IsInitialized(void);
+void CDC_Send(const uint8_t *data, uint32_t length);
+uint32_t CDC_TxWrite(const uint8_t *data, uint32_t length);
+int CDC_TxFlush(uint32_t timeout_ms);
+void CDC_TxComplete(void);
+void CDC_TxReset(void);
+bool CDC_SendString(const char *p_str);
+bool CDC_SendMem(const char *p_str, uint16_t length);
+void CDC_PutChar(uint8_t ch);
+void CDC_ReceiveCallback(const uint8_t *Buf, uint32_t Len);
+void FTDI_Send(const uint8_t *data, uint32_t length);
+uint32_t FTDI_TxWrite(const uint8_t *data, uint32_t length);
+int FTDI_TxFlush(uint32_t timeout_ms);
+const transport_t *transport_wait_first(uint32_t timeout_ms, uint8_t *byte);
+void transport_send(const transport_t *link, const uint8_t *data, uint32_t length);
+void transport_send_char(const transport_t *link, uint8_t c);
+void transport_send_string(const transport_t *link, const char *text);
+int transport_flush(const transport_t *link, uint32_t timeout_ms);
 float TMP1075_ReadTemperature(void);
 void MX_I2C1_Init(void);
 void Read_Structure_From_Flash(uint32_t address, void *data, size_t size);
@@ -0,0 +1,75 @@
+/**
+ * @file    handoff.h
+ * @brief   Boîte aux lettres d'échange entre le bootloader et l'application.
+ *
+ * Ce fichier ne dépend que de stdint.h : il est partagé avec l'application.
+ *
+ * La boîte aux lettres occupe les registres de sauvegarde TAMP BKP11R à BKP15R,
+ * conservés par une réinitialisation système (NVIC_SystemReset, chien de garde,
+ * broche NRST) tant que l'alimentation est présente :
+ *
+ *     BKP11R : HANDOFF_MAGIC
+ *     BKP12R : cause de réinitialisation (8 bits) | 0 (8 bits) | indicateurs (16 bits)
+ *     BKP13R : version du bootloader (majeur << 16 | mineur << 8 | révision)
+ *     BKP14R : version de l'application (champ version de image_header_t)
+ *     BKP15R : CRC32 des quatre mots précédents
+ *
+ * Demande d'entrée dans le bootloader depuis l'application : écrire la boîte avec
+ * HANDOFF_FLAG_ENTER_BOOTLOADER puis NVIC_SystemReset(). Le bootloader écrit la
+ * boîte avant chaque saut vers l'application : aucune écriture en flash n'est
+ * nécessaire pour ces échanges.
+ */
+
+#ifndef HANDOFF_H_
+#define HANDOFF_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HANDOFF_MAGIC           (0x46464F48UL)  /**< "HOFF" */
+#define HANDOFF_BKP_FIRST       (11U)           /**< Premier registre de sauvegarde utilisé */
+#define HANDOFF_WORDS           (5U)
+
+/**
+ * @brief Causes de réinitialisation relevées par le bootloader (RCC_CSR).
+ */
+#define HANDOFF_RESET_POWER     (0U)    /**< Mise sous tension ou baisse de tension */
+#define HANDOFF_RESET_PIN       (1U)    /**< Broche NRST */
+#define HANDOFF_RESET_SOFTWARE  (2U)    /**< NVIC_SystemReset() */
+#define HANDOFF_RESET_WATCHDOG  (3U)    /**< IWDG ou WWDG */
+#define HANDOFF_RESET_OTHER     (4U)    /**< Option bytes, bas consommation */
+
+/**
+ * @brief Indicateurs de la boîte aux lettres.
+ */
+#define HANDOFF_FLAG_ENTER_BOOTLOADER   (0x0001U)   /**< Application -> bootloader : rester dans le bootloader */
+#define HANDOFF_FLAG_UPDATED            (0x0002U)   /**< Bootloader -> application : image installée depuis le dernier lancement */
+
+/**
+ * @brief Codes de retour.
+ */
+#define HANDOFF_OK              (0)
+#define HANDOFF_ERROR           (-1)    /**< Boîte absente ou CRC invalide */
+
+/**
+ * @brief Contenu de la boîte aux lettres.
+ */
+typedef struct
+{
+    uint32_t magic;                 /**< HANDOFF_MAGIC. */
+    uint8_t reset_cause;            /**< HANDOFF_RESET_xxx. */
+    uint8_t reserved;               /**< 0. */
+    uint16_t flags;                 /**< HANDOFF_FLAG_xxx. */
+    uint32_t bootloader_version;    /**< Version du bootloader. */
+    uint32_t application_version;   /**< Version de l'application installée, 0 si inconnue. */
+    uint32_t crc32;                 /**< CRC32 des champs précédents. */
+} handoff_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HANDOFF_H_ */
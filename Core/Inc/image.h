@@ -0,0 +1,78 @@
+/**
+ * @file    image.h
+ * @brief   En-tête d'image firmware et marqueur de vérification.
+ *
+ * Une image transférée peut commencer par un en-tête de 32 octets, suivi de
+ * l'image brute, compressée (lzss.h) ou d'un patch (delta.h). L'en-tête décrit
+ * l'image finale telle qu'elle doit se trouver en flash :
+ *
+ *     "ADIM" | adresse de chargement | taille | CRC32 de l'image | version |
+ *     options | réservé (0xFFFFFFFF) | CRC32 des 28 octets précédents
+ *
+ * (mots de 32 bits petit-boutistes). Tools/image_pack.c produit cet en-tête.
+ *
+ * Le bootloader ne le programme pas avec l'application : après l'écriture et la
+ * vérification du CRC32 de l'image en flash, il enregistre l'en-tête suivi d'un
+ * marqueur de vérification dans la page IMAGE_INFO_ADDRESS. Un démarrage normal
+ * ne contrôle que cet en-tête et ce marqueur, en temps constant.
+ *
+ * Reprise d'un transfert (option IMAGE_FLAG_RESUMABLE, image brute, XMODEM-1K
+ * stop-and-wait) : pendant l'écriture, chaque page vérifiée est inscrite dans un
+ * journal avec l'identité de l'image (l'en-tête complet). Si un transfert de la
+ * même image a été interrompu, le bloc 1 est acquitté par XMODEM_RESUME ('R')
+ * suivi de la position de reprise dans le fichier transféré (4 octets,
+ * petit-boutiste, en-tête compris) au lieu d'un ACK : l'émetteur reprend avec le
+ * bloc 2 contenant les octets situés à cette position.
+ */
+
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMAGE_HEADER_MAGIC      (0x4D494441UL)  /**< "ADIM" en petit-boutiste */
+#define IMAGE_VERIFIED_MAGIC    (0x4B4F4D49UL)  /**< "IMOK" en petit-boutiste */
+#define IMAGE_HEADER_SIZE       (32U)
+#define IMAGE_HEADER_CRC_SIZE   (28U)           /**< Octets couverts par header_crc */
+
+#define IMAGE_FLAG_RESUMABLE    (0x00000001UL)  /**< L'émetteur sait reprendre un transfert */
+
+/**
+ * @brief Codes de retour des fonctions de l'image.
+ */
+#define IMAGE_OK                (0)
+#define IMAGE_ERROR             (-1)
+
+/**
+ * @brief En-tête d'image firmware.
+ */
+typedef struct
+{
+    uint32_t magic;         /**< IMAGE_HEADER_MAGIC. */
+    uint32_t load_address;  /**< Adresse de l'image en flash (APPLICATION_ADDRESS). */
+    uint32_t length;        /**< Taille de l'image en octets. */
+    uint32_t crc32;         /**< CRC32 (IEEE 802.3) de l'image. */
+    uint32_t version;       /**< Version : majeur << 16 | mineur << 8 | révision. */
+    uint32_t flags;         /**< Options IMAGE_FLAG_xxx. */
+    uint32_t reserved;      /**< 0xFFFFFFFF. */
+    uint32_t header_crc;    /**< CRC32 des IMAGE_HEADER_CRC_SIZE premiers octets. */
+} image_header_t;
+
+/**
+ * @brief Marqueur programmé après la vérification de l'image en flash.
+ */
+typedef struct
+{
+    uint32_t magic;         /**< IMAGE_VERIFIED_MAGIC. */
+    uint32_t crc32;         /**< Copie du CRC32 de l'en-tête vérifié. */
+} image_marker_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IMAGE_H_ */
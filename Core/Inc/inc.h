@@ -9,6 +9,7 @@ extern "C" {
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include "main.h"
 #include "stm32g4xx_hal.h"
@@ -21,10 +22,15 @@ extern "C" {
 /* Includes ------------------------------------------------------------------*/
 #include "def.h"
 #include "struct.h"
+#include "image.h"
+#include "handoff.h"
 #include "foncext.h"
 #include "ramext.h"
 #include "Fifo.h"
 #include "opamp.h"
+#include "crc.h"
+#include "lzss.h"
+#include "delta.h"
 
 #ifdef __cplusplus
 }
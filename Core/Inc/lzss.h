@@ -0,0 +1,85 @@
+/**
+ * @file    lzss.h
+ * @brief   Décompression LZSS en flux (format de type heatshrink) des images firmware.
+ *
+ * Ce module ne dépend ni de la HAL ni de inc.h : il se compile tel quel sur
+ * la cible et sur PC (outil de compression et banc de mesure, Tools/lzss_pack.c).
+ *
+ * Format d'une image compressée :
+ *
+ *     en-tête (12 octets) | flux de bits LZSS
+ *
+ *     en-tête : "ALZ1" | bits de fenêtre (1) | bits de longueur (1) | 0 (2) |
+ *               taille décompressée (4, petit-boutiste)
+ *
+ * Le flux de bits est lu bit de poids fort en tête. Chaque élément commence par
+ * un bit d'étiquette :
+ *   - 1 : littéral, suivi de 8 bits ;
+ *   - 0 : référence arrière, suivie de l'écart - 1 (LZSS_WINDOW_BITS bits) et de
+ *         la longueur - 1 (LZSS_LOOKAHEAD_BITS bits).
+ *
+ * Les octets qui suivent la taille décompressée (bourrage XMODEM) sont ignorés.
+ */
+
+#ifndef LZSS_H_
+#define LZSS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LZSS_WINDOW_BITS        (10U)                       /**< Fenêtre de 1 ko */
+#define LZSS_LOOKAHEAD_BITS     (6U)                        /**< Répétitions de 64 octets au plus */
+#define LZSS_WINDOW_SIZE        (1UL << LZSS_WINDOW_BITS)
+#define LZSS_MAX_MATCH          (1UL << LZSS_LOOKAHEAD_BITS)
+#define LZSS_HEADER_SIZE        (12U)
+
+/**
+ * @brief Codes de retour du décodeur.
+ */
+#define LZSS_OK                 (0)     /**< Données consommées, image incomplète */
+#define LZSS_DONE               (1)     /**< Image entièrement décompressée */
+#define LZSS_ERROR              (-1)    /**< En-tête ou flux invalide, ou erreur de la sortie */
+
+/**
+ * @brief Fonction de sortie des octets décompressés.
+ *
+ * @param[in] context Contexte fourni à lzss_decode().
+ * @param[in] data    Octets décompressés.
+ * @param[in] length  Nombre d'octets.
+ * @return int 0 en cas de succès, une valeur non nulle pour interrompre la décompression.
+ */
+typedef int (*lzss_sink_t)(void *context, const uint8_t *data, uint32_t length);
+
+/**
+ * @brief État du décodeur LZSS.
+ *
+ * La fenêtre contient l'historique décompressé et sert aussi de tampon de sortie :
+ * la RAM utilisée est bornée à LZSS_WINDOW_SIZE octets plus quelques mots.
+ */
+typedef struct
+{
+    uint8_t window[LZSS_WINDOW_SIZE];   /**< Historique des octets décompressés. */
+    uint32_t position;                  /**< Prochaine position d'écriture dans la fenêtre. */
+    uint32_t flushed;                   /**< Début des octets non encore transmis à la sortie. */
+    uint32_t produced;                  /**< Nombre d'octets décompressés. */
+    uint32_t length;                    /**< Taille décompressée annoncée par l'en-tête. */
+    uint32_t bits;                      /**< Bits en attente de décodage. */
+    uint32_t bit_count;                 /**< Nombre de bits valides dans bits. */
+    uint8_t header[LZSS_HEADER_SIZE];   /**< En-tête en cours de réception. */
+    uint32_t header_length;             /**< Nombre d'octets d'en-tête reçus. */
+    int status;                         /**< LZSS_OK, LZSS_DONE ou LZSS_ERROR. */
+} lzss_decoder_t;
+
+int lzss_is_compressed(const uint8_t *data, uint32_t length);
+void lzss_decoder_init(lzss_decoder_t *decoder);
+int lzss_decode(lzss_decoder_t *decoder, const uint8_t *data, uint32_t length,
+                lzss_sink_t sink, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LZSS_H_ */
@@ -7,10 +7,13 @@ extern "C" {
 extern const uint32_t flash_address_config;
 
 extern float v_temperature_mesuree;
-extern AppConfig_t v_config_system;
-extern AppConfig_t v_AppConfig;
-extern const uint32_t flash_address;
 extern fifo_t usart2_fifo;
+extern fifo_t usart2_tx_fifo;
+extern fifo_t cdc_tx_fifo;
+extern fifo_t cdc_fifo;
+extern const transport_t transport_uart2;
+extern const transport_t transport_cdc;
+extern const transport_t *v_transport;
 //extern BootloaderInfo_t appInfoRAM;
 extern float v_vitesse_vent;
 //extern TIM_HandleTypeDef htim3;
@@ -31,6 +34,16 @@ extern float v_ADC1_IN10;
 extern float v_ADC2_IN10;
 extern UART_HandleTypeDef hUART1;
 extern UART_HandleTypeDef hUART2;
+extern DMA_HandleTypeDef hdma_usart2_rx;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+extern uint8_t uart2_rx_dma_buffer[UART2_RX_DMA_BUFFER_SIZE];
+extern uart_rx_stats_t v_uart2_rx_stats;
+extern uart_tx_stats_t v_uart2_tx_stats;
+extern cdc_rx_stats_t v_cdc_rx_stats;
+extern cdc_tx_stats_t v_cdc_tx_stats;
+extern volatile uint16_t uart2_rx_dma_position;
+extern flash_pipe_stats_t v_flash_pipe_stats;
+extern menu_stats_t v_menu_stats;
 extern I2C_HandleTypeDef hi2c1;
 extern float v_temperture_TM1075;
 
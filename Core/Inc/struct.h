@@ -7,8 +7,12 @@ extern "C" {
 
 /**
  * @brief Structure de configuration de l’application stockée en Flash.
+ *
+ * Occupe le début de la page flash_address_config (le reste de la page est laissé
+ * effacé) et se lit en place par Config_Get() : aucune copie n'est faite en RAM.
+ * Les 160 premiers octets sont identiques à la disposition d'origine (version de
+ * schéma 0, sans champ Schema), lue aussi par l'application.
  */
-// Définition de la structure alignée à 2048 octets
 typedef struct {
     uint32_t uniqueID0;
     uint32_t uniqueID1;
@@ -28,31 +32,187 @@ typedef struct {
     char Heure_Compile[32];
     char Date_Compile[32];
     char Version_Compile[32];
-    char Boot_Bootloader[4];
-    uint8_t Reserved[2048 - (4*3 + 1 + 4*9 + 4*3 + 32 + 32 + 32 + 4)];  // Ajustement final
-} __attribute__((aligned(2048))) AppConfig_t;
+    char Boot_Bootloader[4];    /**< Ancien échange avec l'application, remplacé par handoff.h. */
+    uint32_t Schema;        /**< CONFIG_SCHEMA_MAGIC | CONFIG_SCHEMA_VERSION. */
+    uint32_t Reserved;      /**< Laissé à 0xFFFFFFFF (complète le double mot). */
+} AppConfig_t;
 
 
 /**
  * @brief Structure représentant le FIFO.
+ *
+ * Un seul producteur (head) et un seul consommateur (tail) : chacun n'écrit que
+ * son propre indice. Les indices ne sont pas bornés ; head - tail est le nombre
+ * d'octets présents, même après débordement des compteurs.
  */
 typedef struct
 {
     uint8_t buffer[FIFO_BUFFER_SIZE]; /**< Tableau de stockage des octets. */
-    volatile uint32_t head;           /**< Indice de la tête (position d'écriture). */
-    volatile uint32_t tail;           /**< Indice de la queue (position de lecture). */
+    volatile uint32_t head;           /**< Nombre d'octets écrits (position d'écriture & FIFO_MASK). */
+    volatile uint32_t tail;           /**< Nombre d'octets lus (position de lecture & FIFO_MASK). */
 } fifo_t;
 
 
+/**
+ * @brief Descripteur d'une plage d'octets lue en place dans une FIFO.
+ *
+ * Une plage peut être coupée en deux segments contigus par le rebouclage du tampon
+ * circulaire ; le second segment est vide (length[1] == 0) sinon.
+ */
+typedef struct
+{
+    const uint8_t *data[2];  /**< Adresse de chaque segment dans le tampon de la FIFO. */
+    uint32_t length[2];      /**< Longueur de chaque segment en octets. */
+} fifo_span_t;
+
+
+/**
+ * @brief Liaison avec le PC : FIFO de réception et fonctions d'émission (transport.c).
+ *
+ * Le menu et les récepteurs (XMODEM, YMODEM, fenêtre glissante, provisionnement)
+ * ne connaissent que cette interface : la même session fonctionne sur l'USART2
+ * (transport_uart2) ou sur l'USB CDC (transport_cdc).
+ */
+typedef struct
+{
+    fifo_t *rx;                                             /**< FIFO alimentée par la réception. */
+    void (*send)(const uint8_t *data, uint32_t length);     /**< Émission, attente bornée si la file est pleine. */
+    int (*flush)(uint32_t timeout_ms);                      /**< Attente de la fin de l'émission (FIFO_OK ou FIFO_ERROR). */
+    const char *name;                                       /**< Nom affiché par le menu. */
+    bool flow_control;                                      /**< Réception jamais perdue pendant une opération flash (USB : NAK). */
+} transport_t;
+
+
+/**
+ * @brief Statistiques de la réception DMA de l'USART2.
+ */
+typedef struct
+{
+    volatile uint32_t events;   /**< Nombre d'évènements DMA traités (demi, complet, ligne inactive). */
+    volatile uint32_t bytes;    /**< Nombre d'octets publiés dans la FIFO. */
+    volatile uint32_t dropped;  /**< Nombre d'octets perdus faute de place dans la FIFO. */
+    volatile uint32_t errors;   /**< Nombre d'erreurs UART (overrun, bruit, trame) ayant relancé la réception. */
+} uart_rx_stats_t;
+
+
+/**
+ * @brief Statistiques de la réception USB CDC (endpoint OUT, usbd_cdc_if.c).
+ *
+ * Débit soutenu : bytes / (last_ms - first_ms).
+ */
+typedef struct
+{
+    volatile uint32_t packets;      /**< Paquets OUT reçus. */
+    volatile uint32_t bytes;        /**< Octets publiés dans cdc_fifo. */
+    volatile uint32_t naks;         /**< Suspensions de la réception, FIFO pleine (endpoint en NAK). */
+    volatile uint32_t nak_frames;   /**< Trames de 1 ms passées en NAK. */
+    volatile uint32_t first_ms;     /**< HAL_GetTick() du premier paquet. */
+    volatile uint32_t last_ms;      /**< HAL_GetTick() du dernier paquet. */
+} cdc_rx_stats_t;
+
+
+/**
+ * @brief Statistiques de la file d'émission de l'USB CDC (Rou_cdc.c).
+ */
+typedef struct
+{
+    volatile uint32_t bytes;        /**< Octets émis. */
+    volatile uint32_t transfers;    /**< Transferts IN lancés. */
+    volatile uint32_t zlps;         /**< Transferts multiples de 64 octets, terminés par un paquet vide. */
+    uint32_t high_water;            /**< Occupation maximale de la file, en octets. */
+    uint32_t waits;                 /**< Attentes de place dans la file pleine. */
+    uint32_t dropped;               /**< Octets perdus (port non configuré ou CDC_TX_TIMEOUT_MS écoulé). */
+} cdc_tx_stats_t;
+
+
+/**
+ * @brief Statistiques de la file d'émission de l'USART2 (rou.c).
+ */
+typedef struct
+{
+    volatile uint32_t bytes;        /**< Octets émis par DMA. */
+    volatile uint32_t transfers;    /**< Transferts DMA lancés. */
+    uint32_t high_water;            /**< Occupation maximale de la file, en octets. */
+    uint32_t waits;                 /**< Attentes de place dans la file pleine. */
+    uint32_t dropped;               /**< Octets perdus après UART2_TX_TIMEOUT_MS d'attente. */
+} uart_tx_stats_t;
+
+
+/**
+ * @brief États d'un tampon de préparation du pipeline d'écriture flash.
+ */
+typedef enum
+{
+    FLASH_SLOT_FREE = 0,    /**< Tampon disponible. */
+    FLASH_SLOT_FILLING,     /**< Tampon en cours de remplissage par la réception. */
+    FLASH_SLOT_READY,       /**< Tampon plein, en attente d'écriture. */
+    FLASH_SLOT_BUSY         /**< Page en cours d'effacement, de programmation ou de vérification. */
+} flash_slot_state_t;
+
+/**
+ * @brief Étapes de traitement d'une page par le pipeline d'écriture flash.
+ */
+typedef enum
+{
+    FLASH_STAGE_IDLE = 0,   /**< Aucune page en cours de traitement. */
+    FLASH_STAGE_ERASE,      /**< Effacement de la page. */
+    FLASH_STAGE_PROGRAM,    /**< Programmation par tranches de doubles mots. */
+    FLASH_STAGE_VERIFY      /**< Relecture et comparaison avec le tampon. */
+} flash_stage_t;
+
+/**
+ * @brief Tampon de préparation d'une page flash.
+ */
+typedef struct
+{
+    uint8_t data[FLASH_PAGE_SIZE];      /**< Contenu de la page à écrire. */
+    uint32_t address;                   /**< Adresse de la page en flash. */
+    uint32_t length;                    /**< Nombre d'octets valides dans data. */
+    flash_slot_state_t state;           /**< État du tampon. */
+    bool erased;                        /**< Page déjà effacée (flash_pipe_prepare()). */
+} flash_slot_t;
+
+/**
+ * @brief Statistiques du pipeline d'écriture flash (durées en microsecondes).
+ */
+typedef struct
+{
+    uint32_t pages;         /**< Pages écrites et vérifiées. */
+    uint32_t blank_rows;    /**< Lignes de 256 octets vierges, non programmées. */
+    uint32_t erase_us;      /**< Temps cumulé d'effacement. */
+    uint32_t program_us;    /**< Temps cumulé de programmation. */
+    uint32_t verify_us;     /**< Temps cumulé de vérification. */
+    uint32_t stall_us;      /**< Temps cumulé d'attente de l'appelant, les deux tampons étant occupés. */
+    uint32_t errors;        /**< Erreurs d'effacement, de programmation ou de vérification. */
+} flash_pipe_stats_t;
+
+
+/**
+ * @brief Statistiques d'affichage du menu VT100 (octets émis par rafraîchissement).
+ */
+typedef struct
+{
+    uint32_t redraws;       /**< Rafraîchissements du menu. */
+    uint32_t lines;         /**< Lignes réémises car modifiées. */
+    uint32_t bytes;         /**< Octets émis par l'ensemble des rafraîchissements. */
+    uint32_t last_bytes;    /**< Octets émis par le dernier rafraîchissement. */
+    uint32_t max_bytes;     /**< Plus grand nombre d'octets émis par un rafraîchissement. */
+} menu_stats_t;
+
+
 /**
  * @brief Type de fonction de rappel pour le traitement d'un bloc reçu.
  *
- * Cette fonction sera appelée dès qu'un bloc XMODEM 1K valide est reçu.
+ * Cette fonction sera appelée dès qu'un bloc XMODEM 1K ou YMODEM valide est reçu.
+ * Le bloc n'est pas copié : le descripteur désigne les octets encore présents dans
+ * le tampon de réception, qui ne sont libérés qu'au retour de la fonction.
  *
- * @param[in] block         Pointeur sur le bloc de données (1024 octets).
+ * @param[in] block         Descripteur du bloc de données (1024 octets en XMODEM 1K,
+ *                          longueur variable en YMODEM).
  * @param[in] block_number  Numéro du bloc reçu.
+ * @param[in] received_crc  CRC16 reçu et vérifié pour ce bloc.
  */
-typedef void (*xmodem_block_callback_t)(const uint8_t *block, uint32_t block_number, uint16_t received_crc);
+typedef void (*xmodem_block_callback_t)(const fifo_span_t *block, uint32_t block_number, uint16_t received_crc);
 
 
 
@@ -23,8 +23,10 @@ typedef enum {
 } YMODEM_T;
 
 
-void 		YMODEM_Init(void);
+void 		YMODEM_Init(uint8_t streamingMode, xmodem_block_callback_t callback);
 YMODEM_T 	YMODEM_ReceiveByte(uint8_t c, uint8_t *respBuff, uint8_t *respLen);
 YMODEM_T 	YMODEM_Abort(uint8_t *respBuff, uint8_t *len);
+YMODEM_T 	YMODEM_Timeout(uint8_t *respBuff, uint8_t *respLen);
+YMODEM_T 	YMODEM_Status(void);
 
 #endif // YMODEM_H
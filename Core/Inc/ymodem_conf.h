@@ -11,7 +11,7 @@
  * @brief	Size of flash to save file to  
  * 
  */
-#define YMODEM_FLASH_SIZE				(64 * 1024) // 64kB
+#define YMODEM_FLASH_SIZE				(FLASH_APP_END_ADDRESS - YMODEM_FLASH_START + 1U) // ends before the image information page (IMAGE_INFO_ADDRESS), then the kvlog pages (def.h)
 
 /**
  * @brief  Starting address of flash
@@ -56,7 +56,7 @@ void HAL_LPTIM_AutoReloadMatchCallback(LPTIM_HandleTypeDef *hlptim) {
 
 	// Calcul de la vitesse du vent
 	float vitesse_vent = calculer_vitesse_vent(TVraiInt);
-	v_vitesse_vent = vitesse_vent * v_config_system.CoefAnemo;
+	v_vitesse_vent = vitesse_vent * Config_Get_Float(KVLOG_KEY_COEF_ANEMO);
 //	v_vitesse_vent = (uint16_t)(v_config_system.vitesse_vent * 10.0f);
 //	v_vitesse_vent = (float)VentInt/10.0f;
 }
@@ -6,13 +6,13 @@
  * L'affichage se fait à des positions absolues (définies par des macros),
  * et le menu propose plusieurs options (navigation via flèches, validation par ENTRÉE).
  *
- * Ce fichier utilise les fonctions CDC_SendString, CDC_GetChar,
- * Config_Read, xmodem_receive_1k_blockwise, flash_write_callback,
- * ainsi que la gestion d'un FIFO (fifo_t, fifo_get, etc.),
- * qui doivent être déclarées dans "inc.h".
+ * Le menu fonctionne sur la liaison active v_transport (USART2 ou USB CDC,
+ * voir transport.c) : lecture dans sa FIFO de réception, émission par
+ * transport_send_string(). Il utilise aussi Config_Get, xmodem_receive_1k_blockwise,
+ * flash_write_callback, déclarées dans "inc.h".
  */
 
-#include "inc.h"          /* Déclarations de CDC_SendString, CDC_GetChar, Config_Read, etc. */
+#include "inc.h"          /* Déclarations de transport_t, Config_Get, xmodem_receive_1k_blockwise, etc. */
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -26,26 +26,31 @@
 #define BUFFER_SIZE       (256U)
 
 /* Nombre total d'options du menu */
-#define MENU_OPTIONS      (8U)  /* Augmenté de 7 à 8 */
+#define MENU_OPTIONS      (12U)
 
 /* --- Définition des numéros de ligne pour l'affichage VT100 --- */
 /* Pour éviter les chevauchements, on définit des plages distinctes : */
 /* L'ASCII art sera affiché sur les lignes 1 à 5, */
-/* L'en-tête et le menu à partir de la ligne 7. */
+/* L'en-tête et le menu à partir de la ligne 6, la saisie sous le menu (24 lignes au total). */
 #define ASCII_ART_LINE_1_NUMBER   1
 #define ASCII_ART_LINE_2_NUMBER   2
 #define ASCII_ART_LINE_3_NUMBER   3
 #define ASCII_ART_LINE_4_NUMBER   4
 #define ASCII_ART_LINE_5_NUMBER   5
 
-#define HEADER_LINE_1_NUMBER      7    /**< Ligne pour l'affichage de l'ID */
-#define HEADER_LINE_2_NUMBER      8    /**< Ligne pour l'affichage de la version */
-#define HEADER_LINE_3_NUMBER      9    /**< Ligne vide sous l'en-tête */
-#define MENU_INFO_LINE_NUMBER     10   /**< Ligne pour les instructions du menu */
-#define MENU_START_LINE_NUMBER    11   /**< Ligne de départ pour les options du menu */
-#define INPUT_PROMPT_LINE_NUMBER  20   /**< Ligne d'affichage de l'invite de saisie */
-#define INPUT_LINE_NUMBER         21   /**< Ligne d'affichage de la saisie utilisateur */
-#define MENU_EXIT_LINE_NUMBER     23   /**< Ligne d'affichage de la sortie du menu */
+#define HEADER_LINE_1_NUMBER      6    /**< Ligne pour l'affichage de l'ID */
+#define HEADER_LINE_2_NUMBER      7    /**< Ligne pour l'affichage de la version */
+#define HEADER_LINE_3_NUMBER      8    /**< Ligne pour l'affichage de la liaison active */
+#define MENU_INFO_LINE_NUMBER     9    /**< Ligne pour les instructions du menu */
+#define MENU_START_LINE_NUMBER    10   /**< Ligne de départ pour les options du menu (10 à 21) */
+#define INPUT_PROMPT_LINE_NUMBER  22   /**< Ligne d'affichage de l'invite de saisie */
+#define INPUT_LINE_NUMBER         23   /**< Ligne d'affichage de la saisie utilisateur */
+#define MENU_EXIT_LINE_NUMBER     24   /**< Ligne d'affichage de la sortie du menu */
+
+/* --- Modèle de l'écran pour les mises à jour partielles --- */
+#define SCREEN_LINES              MENU_EXIT_LINE_NUMBER  /**< Lignes du terminal gérées par le menu */
+#define SCREEN_LINE_SIZE          (96U)  /**< Contenu mémorisé par ligne, attributs VT100 compris */
+#define TEMPERATURE_PERIOD_MS     (1000U)  /**< Période minimale de lecture du TMP1075 par le menu */
 
 /* --- Macros pour convertir un nombre en chaîne --- */
 #define STR_HELPER(x) #x
@@ -90,6 +95,17 @@
  * Utilisée dans plusieurs fonctions du bootloader. */
 static bool firmware_ok = false;
 
+/* Dernier contenu émis pour chaque ligne de l'écran (ligne n à l'indice n - 1) ;
+ * screen_drawn est faux tant que l'écran du terminal n'a pas été entièrement dessiné. */
+static char screen_lines[SCREEN_LINES][SCREEN_LINE_SIZE];
+static bool screen_drawn = false;
+/* Octets émis par le rafraîchissement en cours */
+static uint32_t screen_bytes;
+
+/* Dernière lecture du capteur de température par le menu */
+static uint32_t temperature_tick;
+static bool temperature_valid = false;
+
 /* Définition d'un type fonction pour le saut vers l'application.
  * pFunction est un pointeur vers une fonction ne prenant aucun paramètre et ne retournant rien. */
 typedef void (*pFunction)(void);
@@ -123,7 +139,11 @@ const char* ascii_art[] = {
  *   4 : Lecture Anémomètre      <-- Nouvelle option  
  *   5 : Température Actuelle  
  *   6 : Mise à jour firmware (XMODEM 1K)  
- *   7 : Lancer à l'application
+ *   7 : Mise à jour firmware (XMODEM 1K-G, liaison fiable)  
+ *   8 : Mise à jour firmware (fenêtre glissante, liaison longue)  
+ *   9 : Mise à jour firmware (YMODEM, nom et taille du fichier dans le bloc 0)  
+ *  10 : Mise à jour firmware (YMODEM-G, liaison fiable)  
+ *  11 : Lancer à l'application
  */
 const char * const menu_items[MENU_OPTIONS] = {
     "Modifier CoefAnemo",
@@ -133,6 +153,10 @@ const char * const menu_items[MENU_OPTIONS] = {
     "Lecture Anémomètre",
     "Température Actuelle",
     "Mise à jour firmware (XMODEM 1K)",
+    "Mise à jour firmware (XMODEM 1K-G)",
+    "Mise à jour firmware (fenêtre glissante)",
+    "Mise à jour firmware (YMODEM)",
+    "Mise à jour firmware (YMODEM-G)",
     "Lancer à l'application"
 };
 
@@ -143,28 +167,110 @@ const char * const menu_items[MENU_OPTIONS] = {
 /**
  * @brief Vérifie si un firmware valide est présent.
  *
- * La fonction compare la valeur "Presence" dans la structure appInfoRAM à 0x12345678.
+ * L'application doit avoir été vérifiée après sa mise à jour : en-tête et marqueur
+ * de la page d'information de l'image (voir image.c).
  *
  * @return true  si un firmware valide est présent.
  * @return false sinon.
  */
 static bool FirmwarePresent(void) {
-    if (v_AppConfig.Presence == 0x12345678) {
+    if (image_check() == IMAGE_OK) {
         return true;
     }
     return false;
 }
 
+/**
+ * @brief Émet une chaîne du menu sur la liaison active (USART2 ou USB CDC).
+ *
+ * @param[in] pText Chaîne à émettre.
+ */
+static void Menu_Send(const char *pText)
+{
+    transport_send_string(v_transport, pText);
+}
+
+/**
+ * @brief Émet une chaîne du menu en comptant les octets du rafraîchissement.
+ *
+ * @param[in] pText Chaîne à émettre.
+ */
+static void Screen_Send(const char *pText)
+{
+    screen_bytes += (uint32_t)strlen(pText);
+    Menu_Send(pText);
+}
+
+/**
+ * @brief Met à jour une ligne de l'écran si son contenu a changé.
+ *
+ * Le curseur est placé en début de ligne, le nouveau contenu est émis et la fin
+ * de l'ancien contenu est effacée. Un contenu trop long pour screen_lines est
+ * toujours réémis.
+ *
+ * @param[in] line  Numéro de ligne VT100 (1 à SCREEN_LINES).
+ * @param[in] pText Contenu de la ligne, attributs VT100 compris.
+ */
+static void Screen_SetLine(uint8_t line, const char *pText)
+{
+    char cursor[16];
+
+    if (screen_drawn && (strlen(pText) < SCREEN_LINE_SIZE) && (strcmp(screen_lines[line - 1U], pText) == 0))
+    {
+        return;
+    }
+    (void)snprintf(cursor, sizeof(cursor), "\033[%u;1H", (unsigned int)line);
+    Screen_Send(cursor);
+    Screen_Send(pText);
+    Screen_Send(VT100_CLEAR_LINE);
+    (void)snprintf(screen_lines[line - 1U], SCREEN_LINE_SIZE, "%s", pText);
+    v_menu_stats.lines++;
+}
+
+/**
+ * @brief Force le rafraîchissement complet au prochain affichage du menu.
+ *
+ * À appeler quand l'écran du terminal a pu être modifié hors du menu (entrée
+ * dans le menu, transfert de firmware).
+ */
+static void Screen_Invalidate(void)
+{
+    screen_drawn = false;
+}
+
+/**
+ * @brief Température du capteur, lue au plus une fois par TEMPERATURE_PERIOD_MS.
+ *
+ * La lecture I2C du TMP1075 est bloquante : elle n'est pas refaite à chaque touche.
+ *
+ * @return float Dernière température mesurée.
+ */
+static float Bootloader_ReadTemperature(void)
+{
+    if (!temperature_valid || ((HAL_GetTick() - temperature_tick) >= TEMPERATURE_PERIOD_MS))
+    {
+        v_temperature_mesuree = TMP1075_ReadTemperature();
+        temperature_tick = HAL_GetTick();
+        temperature_valid = true;
+    }
+    return v_temperature_mesuree;
+}
+
 /**
  * @brief Affiche le menu de sélection à des positions absolues.
  *
- * La fonction affiche :
+ * La fonction compose :
  * - L'ASCII art (les lignes VT100_ASCII_LINE_x sont intégrées dans ascii_art),
  * - Les informations d'en-tête (ID et Version),
- * - Une ligne vide,
+ * - La liaison active (USART2 ou USB CDC),
  * - Les instructions du menu,
  * - Puis chaque option du menu à partir de MENU_START_LINE_NUMBER.
  *
+ * Seules les lignes dont le contenu a changé depuis le dernier affichage sont
+ * émises (Screen_SetLine()) ; l'ASCII art n'est émis qu'au premier affichage.
+ * Un déplacement dans le menu n'émet que les deux options concernées. Les octets
+ * émis sont comptés dans v_menu_stats.
+ *
  * Pour les options 0 à 3 et l'option 5 (Température Actuelle), des valeurs actuelles sont affichées.
  * Les autres options s'affichent simplement.
  *
@@ -173,98 +279,98 @@ static bool FirmwarePresent(void) {
  */
 static void Bootloader_DisplayMenu(const AppConfig_t *pConfig, uint8_t menu_index) {
     char buffer[BUFFER_SIZE];
+    char label[SCREEN_LINE_SIZE];
     uint8_t i;
-    
+    float temperature;
+    bool full = !screen_drawn;
+
+    screen_bytes = 0U;
+
     /* Actualise la variable firmware_ok selon la présence d'un firmware valide */
     firmware_ok = FirmwarePresent();
 
-    /* Affichage de l'ASCII art */
-    SendStringFTDI((char*)ascii_art[0]);
-    SendStringFTDI((char*)ascii_art[1]);
-    SendStringFTDI((char*)ascii_art[2]);
-    SendStringFTDI((char*)ascii_art[3]);
-    SendStringFTDI((char*)ascii_art[4]);
+    /* Affichage de l'ASCII art, qui ne change pas */
+    if (full) {
+        for (i = 0U; i < (sizeof(ascii_art) / sizeof(ascii_art[0])); i++) {
+            Screen_Send(ascii_art[i]);
+        }
+    }
 
     /* Affichage de l'en-tête aux positions absolues */
-    (void)snprintf(buffer, BUFFER_SIZE, VT100_HEADER_LINE_1 "UNIQUE ID ADAMO : %08X%08X%08X    Tension USB : %.2f",
+    (void)snprintf(buffer, BUFFER_SIZE, "UNIQUE ID ADAMO : %08X%08X%08X    Tension USB : %.2f",
                    pConfig->uniqueID0, pConfig->uniqueID1, pConfig->uniqueID2, v_ADC1_IN10);
-    SendStringFTDI(buffer);
+    Screen_SetLine(HEADER_LINE_1_NUMBER, buffer);
 
     if (firmware_ok == false) {
-        (void)snprintf(buffer, BUFFER_SIZE, VT100_HEADER_LINE_2 "Version : %u.%02u%c (Firmware non trouvé)",
+        (void)snprintf(buffer, BUFFER_SIZE, "Version : %u.%02u%c (Firmware non trouvé)",
                        pConfig->MAJEUR_VERSION, pConfig->MINEUR_VERSION, (char)pConfig->RELEASE_VERSION);
     } else {
-        (void)snprintf(buffer, BUFFER_SIZE, VT100_HEADER_LINE_2 "Version : %s, %s, %s",
-                       v_AppConfig.Version_Compile, v_AppConfig.Date_Compile, v_AppConfig.Heure_Compile);
+        (void)snprintf(buffer, BUFFER_SIZE, "Version : %s, %s, %s",
+                       pConfig->Version_Compile, pConfig->Date_Compile, pConfig->Heure_Compile);
     }
-    SendStringFTDI(buffer);
+    Screen_SetLine(HEADER_LINE_2_NUMBER, buffer);
 
-    SendStringFTDI(VT100_HEADER_LINE_3);
-    SendStringFTDI(VT100_MENU_INFO_LINE "Utilisez les flèches Haut/Bas pour naviguer et ENTRÉE pour sélectionner");
+    (void)snprintf(buffer, BUFFER_SIZE, "Liaison : %s", v_transport->name);
+    Screen_SetLine(HEADER_LINE_3_NUMBER, buffer);
+    Screen_SetLine(MENU_INFO_LINE_NUMBER, "Utilisez les flèches Haut/Bas pour naviguer et ENTRÉE pour sélectionner");
 
     /* Affichage des options du menu, une par ligne à partir de MENU_START_LINE_NUMBER */
     for (i = 0U; i < MENU_OPTIONS; i++)
     {
-        (void)snprintf(buffer, BUFFER_SIZE, "\033[%u;1H", (unsigned int)(MENU_START_LINE_NUMBER + i));
-        SendStringFTDI(buffer);
-
         /* Pour "Lancer à l'application" en absence de firmware, affiche en gris */
-        firmware_ok = FirmwarePresent();
         if ((i == MENU_OPTIONS - 1U) && (firmware_ok == false))
         {
-            SendStringFTDI(VT100_GRAY);
-            (void)snprintf(buffer, BUFFER_SIZE, "%s", menu_items[i]);
-            SendStringFTDI(buffer);
-            SendStringFTDI(VT100_RESET);
+            (void)snprintf(buffer, BUFFER_SIZE, VT100_GRAY "%s" VT100_RESET, menu_items[i]);
         }
         else
         {
-            if (i == menu_index)
-            {
-                SendStringFTDI("\033[7m");
-            }
-            if ((i == 0U) || (i == 1U) || (i == 2U) || (i == 3U))
+            switch (i)
             {
-                switch (i)
-                {
-                    case 0U:
-                        (void)snprintf(buffer, BUFFER_SIZE, "%s (actuel : %.4f)", menu_items[i], pConfig->CoefAnemo);
-                        break;
-                    case 1U:
-                        (void)snprintf(buffer, BUFFER_SIZE, "%s (actuel : %.4f)", menu_items[i], pConfig->CoefPluvio);
-                        break;
-                    case 2U:
-                        (void)snprintf(buffer, BUFFER_SIZE, "%s (actuel : %.4f)", menu_items[i], pConfig->Temp_A);
-                        break;
-                    case 3U:
-                        (void)snprintf(buffer, BUFFER_SIZE, "%s (actuel : %.4f)", menu_items[i], pConfig->Temp_B);
-                        break;
-                    default:
-                        break;
-                }
+                case 0U:
+                    (void)snprintf(label, sizeof(label), "%s (actuel : %.4f)", menu_items[i], Config_Get_Float(KVLOG_KEY_COEF_ANEMO));
+                    break;
+                case 1U:
+                    (void)snprintf(label, sizeof(label), "%s (actuel : %.4f)", menu_items[i], Config_Get_Float(KVLOG_KEY_COEF_PLUVIO));
+                    break;
+                case 2U:
+                    (void)snprintf(label, sizeof(label), "%s (actuel : %.4f)", menu_items[i], Config_Get_Float(KVLOG_KEY_TEMP_A));
+                    break;
+                case 3U:
+                    (void)snprintf(label, sizeof(label), "%s (actuel : %.4f)", menu_items[i], Config_Get_Float(KVLOG_KEY_TEMP_B));
+                    break;
+                case 5U:
+                    /* Pour "Température Actuelle", calcul et affichage de la température */
+                    temperature = (Bootloader_ReadTemperature() * Config_Get_Float(KVLOG_KEY_TEMP_A)) + Config_Get_Float(KVLOG_KEY_TEMP_B);
+                    (void)snprintf(label, sizeof(label), "%s (Mesurée : %2.1f , Calculée : %2.1f)",
+                                   menu_items[i], v_temperature_mesuree, temperature);
+                    break;
+                default:
+                    /* Pour "Lecture Anémomètre" et les options "Mise à jour firmware" */
+                    (void)snprintf(label, sizeof(label), "%s", menu_items[i]);
+                    break;
             }
-            else if (i == 5U)
+            if (i == menu_index)
             {
-                /* Pour "Température Actuelle", calcul et affichage de la température */
-				v_temperature_mesuree = TMP1075_ReadTemperature();
-
-                v_config_system.Temperature = (v_temperature_mesuree * v_config_system.Temp_A) + v_config_system.Temp_B;
-                (void)snprintf(buffer, BUFFER_SIZE, "%s (Mesurée : %2.1f , Calculée : %2.1f)",
-                               menu_items[i], v_temperature_mesuree, v_config_system.Temperature);
+                (void)snprintf(buffer, BUFFER_SIZE, "\033[7m%s" VT100_RESET, label);
             }
             else
             {
-                /* Pour "Lecture Anémomètre" et "Mise à jour firmware (XMODEM 1K)" */
-                (void)snprintf(buffer, BUFFER_SIZE, "%s", menu_items[i]);
-            }
-            SendStringFTDI(buffer);
-            if (i == menu_index)
-            {
-                SendStringFTDI(VT100_RESET);
+                (void)snprintf(buffer, BUFFER_SIZE, "%s", label);
             }
         }
+        Screen_SetLine((uint8_t)(MENU_START_LINE_NUMBER + i), buffer);
+    }
+    if (full) {
+        Screen_Send(VT100_CURSOR_HIDE);
+    }
+    screen_drawn = true;
+
+    v_menu_stats.redraws++;
+    v_menu_stats.bytes += screen_bytes;
+    v_menu_stats.last_bytes = screen_bytes;
+    if (screen_bytes > v_menu_stats.max_bytes) {
+        v_menu_stats.max_bytes = screen_bytes;
     }
-    SendStringFTDI(VT100_CURSOR_HIDE);
 }
 
 ///**
@@ -300,17 +406,17 @@ static void Bootloader_GetInputFloat(const char *pPrompt, float *pValue)
     uint8_t ch;
 
     (void)snprintf(input_buffer, BUFFER_SIZE, VT100_INPUT_PROMPT_LINE "%s", pPrompt);
-    SendStringFTDI(input_buffer);
-    SendStringFTDI(VT100_CURSOR_SHOW);
-    SendStringFTDI(VT100_INPUT_CLEAR);
+    Menu_Send(input_buffer);
+    Menu_Send(VT100_CURSOR_SHOW);
+    Menu_Send(VT100_INPUT_CLEAR);
 
     memset(input_buffer, 0, sizeof(input_buffer));
     while (i < (BUFFER_SIZE - 1U))
     {
 //        ch = Bootloader_GetInputChar();
-		while(fifo_is_empy(&usart2_fifo)) {};
+		while(fifo_is_empy(v_transport->rx)) {};
 //		fifo_wait_for(&usart2_fifo, 1, 100);
-		fifo_get(&usart2_fifo, &ch);
+		fifo_get(v_transport->rx, &ch);
 		
         if ((ch == '\r') || (ch == '\n'))
         {
@@ -322,19 +428,52 @@ static void Bootloader_GetInputFloat(const char *pPrompt, float *pValue)
             i++;
             {
                 char echo[2] = {(char)ch, '\0'};
-                SendStringFTDI(echo);
+                Menu_Send(echo);
             }
         }
         HAL_Delay(10U);
     }
     input_buffer[i] = '\0';
-    SendStringFTDI("\r\n");
+    Menu_Send("\r\n");
 
     *pValue = (float)atof(input_buffer);
 
-    SendStringFTDI(VT100_PROMPT_CLEAR);
-    SendStringFTDI(VT100_INPUT_CLEAR);
-    SendStringFTDI(VT100_CURSOR_HIDE);
+    Menu_Send(VT100_PROMPT_CLEAR);
+    Menu_Send(VT100_INPUT_CLEAR);
+    Menu_Send(VT100_CURSOR_HIDE);
+}
+
+/**
+ * @brief Vérifie et enregistre une valeur saisie dans le menu.
+ *
+ * La valeur doit être strictement comprise entre les bornes ; le résultat de
+ * l'écriture dans le journal de configuration est affiché sur la ligne d'invite.
+ *
+ * @param[in] key   Clé du champ (KVLOG_KEY_xxx).
+ * @param[in] pName Nom du champ affiché.
+ * @param[in] value Valeur saisie.
+ * @param[in] min   Borne inférieure (exclue).
+ * @param[in] max   Borne supérieure (exclue).
+ */
+static void Bootloader_WriteValue(uint32_t key, const char *pName, float value, float min, float max)
+{
+    char buffer[BUFFER_SIZE];
+
+    if (!((value > min) && (value < max)))
+    {
+        (void)snprintf(buffer, BUFFER_SIZE,
+                       VT100_INPUT_LINE "Valeur invalide pour %s. Doit être > %.1f et < %.1f\r\n",
+                       pName, (double)min, (double)max);
+    }
+    else if (Config_Write_Value(key, value) != KVLOG_OK)
+    {
+        (void)snprintf(buffer, BUFFER_SIZE, VT100_INPUT_LINE "Erreur d'écriture en flash : %s non modifié.\r\n", pName);
+    }
+    else
+    {
+        (void)snprintf(buffer, BUFFER_SIZE, VT100_INPUT_LINE "%s mis à jour.\r\n", pName);
+    }
+    Menu_Send(buffer);
 }
 
 /**
@@ -344,7 +483,8 @@ static void Bootloader_GetInputFloat(const char *pPrompt, float *pValue)
  * La navigation se fait via les flèches Haut/Bas et la validation par ENTRÉE.
  *
  * Pour éviter le clignotement, aucune commande VT100_CLEAR_SCREEN n'est utilisée lors des rafraîchissements.
- * Seul le repositionnement du curseur (VT100_CURSOR_HOME) est effectué pour mettre à jour l'affichage.
+ * L'écran est dessiné entièrement à l'entrée dans le menu et après un transfert ;
+ * chaque touche ne réémet ensuite que les lignes modifiées (Bootloader_DisplayMenu()).
  */
 void Bootloader_Menu(void)
 {
@@ -354,97 +494,73 @@ void Bootloader_Menu(void)
     uint8_t seq1, seq2;
     uint8_t tmp_char;
     uint8_t selectable_options;
+    float value;
 
-    (void)Config_Read(&v_config_system);
     firmware_ok = FirmwarePresent();
     selectable_options = firmware_ok ? MENU_OPTIONS : (MENU_OPTIONS - 1U);
 
     /* Rafraîchissement initial sans effacer l'écran complet */
-    SendStringFTDI(VT100_CURSOR_HOME);
-    Bootloader_DisplayMenu(&v_config_system, menu_index);
+    Screen_Invalidate();
+    Bootloader_DisplayMenu(Config_Get(), menu_index);
 
     while (1) {
 //        fifo_wait_for(&usart2_fifo, 1, 100);
-		while(fifo_is_empy(&usart2_fifo)) {};
+		while(fifo_is_empy(v_transport->rx)) {};
 		
-        fifo_get(&usart2_fifo, &key);
+        fifo_get(v_transport->rx, &key);
         if (key == 0x1B) { /* Séquence d'échappement VT100 (flèches) */ 
-            /* Mise à jour sans effacer tout l'écran */
-            SendStringFTDI(VT100_CURSOR_HOME);
-            Bootloader_DisplayMenu(&v_config_system, menu_index);
-			while(fifo_is_empy(&usart2_fifo)) {};
-			fifo_get(&usart2_fifo, &seq1);
-			while(fifo_is_empy(&usart2_fifo)) {};
-			fifo_get(&usart2_fifo, &seq2);
+			while(fifo_is_empy(v_transport->rx)) {};
+			fifo_get(v_transport->rx, &seq1);
+			while(fifo_is_empy(v_transport->rx)) {};
+			fifo_get(v_transport->rx, &seq2);
             if (seq1 == '[') {
                 if (seq2 == 'A') {
                     menu_index = (menu_index == 0U) ? selectable_options - 1U : menu_index - 1U;
                 } else if (seq2 == 'B') {
                     menu_index = (menu_index + 1U) % selectable_options;
                 }
-                SendStringFTDI(VT100_CURSOR_HOME);
-                Bootloader_DisplayMenu(&v_config_system, menu_index);
+                /* Mise à jour des seules lignes modifiées */
+                Bootloader_DisplayMenu(Config_Get(), menu_index);
             }
         } else if ((key == '\r') || (key == '\n')) {
-            SendStringFTDI(VT100_CURSOR_HOME);
-            Bootloader_DisplayMenu(&v_config_system, menu_index);
             switch (menu_index) {
                 case 0U:
-                    Bootloader_GetInputFloat("Entrez la nouvelle valeur pour CoefAnemo : ", &v_config_system.CoefAnemo);
-                    if ((v_config_system.CoefAnemo <= 0.0F) || (v_config_system.CoefAnemo >= 5.0F))
-                    {
-                        (void)snprintf(buffer, BUFFER_SIZE,
-                                         VT100_INPUT_LINE "Valeur invalide pour CoefAnemo. Doit être > 0.0 et < 5.0\r\n");
-                        SendStringFTDI(buffer);
-                    }
-                    else
-                    {
-						Write_Structure_To_Flash(flash_address_config, &v_config_system, sizeof(AppConfig_t));
-                        SendStringFTDI(VT100_INPUT_LINE "CoefAnemo mis à jour.\r\n");
-                    }
+                    Bootloader_GetInputFloat("Entrez la nouvelle valeur pour CoefAnemo : ", &value);
+                    Bootloader_WriteValue(KVLOG_KEY_COEF_ANEMO, "CoefAnemo", value, COEF_ANEMO_MIN, COEF_ANEMO_MAX);
                     break;
                 case 1U:
-                    Bootloader_GetInputFloat("Entrez la nouvelle valeur pour CoefPluvio : ", &v_config_system.CoefPluvio);
-                    if ((v_config_system.CoefPluvio <= 0.0F) || (v_config_system.CoefPluvio >= 2.0F))
-                    {
-                        SendStringFTDI(VT100_INPUT_LINE "Valeur invalide pour CoefPluvio. Doit être > 0.0 et < 2.0\r\n");
-                    }
-                    else
-                    {
-						Write_Structure_To_Flash(flash_address_config, &v_config_system, sizeof(AppConfig_t));
-                        SendStringFTDI(VT100_INPUT_LINE "CoefPluvio mis à jour.\r\n");
-                    }
+                    Bootloader_GetInputFloat("Entrez la nouvelle valeur pour CoefPluvio : ", &value);
+                    Bootloader_WriteValue(KVLOG_KEY_COEF_PLUVIO, "CoefPluvio", value, COEF_PLUVIO_MIN, COEF_PLUVIO_MAX);
                     break;
                 case 2U:
-                    Bootloader_GetInputFloat("Entrez la nouvelle valeur pour Temp_A : ", &v_config_system.Temp_A);
-					Write_Structure_To_Flash(flash_address_config, &v_config_system, sizeof(AppConfig_t));
-			
-                break;
+                    Bootloader_GetInputFloat("Entrez la nouvelle valeur pour Temp_A : ", &value);
+                    Bootloader_WriteValue(KVLOG_KEY_TEMP_A, "Temp_A", value, TEMP_A_MIN, TEMP_A_MAX);
+                    break;
                 case 3U:
-                    Bootloader_GetInputFloat("Entrez la nouvelle valeur pour Temp_B : ", &v_config_system.Temp_B);
-					Write_Structure_To_Flash(flash_address_config, &v_config_system, sizeof(AppConfig_t));
-                break;
+                    Bootloader_GetInputFloat("Entrez la nouvelle valeur pour Temp_B : ", &value);
+                    Bootloader_WriteValue(KVLOG_KEY_TEMP_B, "Temp_B", value, TEMP_B_MIN, TEMP_B_MAX);
+                    break;
                 case 4U: {
                     /* Nouvelle option : Lecture Anémomètre
                      * Affiche toutes les secondes "Vitesse Vent : %.1f m/s" sur la ligne d'invite.
                      * La boucle se termine dès qu'un caractère est détecté.
                      */
-                    SendStringFTDI(VT100_PROMPT_CLEAR);
+                    Menu_Send(VT100_PROMPT_CLEAR);
                     while (1) {
 						uint8_t ch;
                         char msg[BUFFER_SIZE];
                         (void)snprintf(msg, BUFFER_SIZE, "Vitesse Vent : %.1f m/s", v_vitesse_vent);
-                        SendStringFTDI(VT100_INPUT_PROMPT_LINE);
-                        SendStringFTDI(msg);
+                        Menu_Send(VT100_INPUT_PROMPT_LINE);
+                        Menu_Send(msg);
                         HAL_Delay(1000);
-						while(fifo_is_empy(&usart2_fifo)) {};
-						fifo_get(&usart2_fifo, &ch);
+						while(fifo_is_empy(v_transport->rx)) {};
+						fifo_get(v_transport->rx, &ch);
 								
                         if (ch != 0)
                         {
                             break;
                         }
-                        SendStringFTDI(VT100_PROMPT_CLEAR);
+                        Menu_Send(VT100_PROMPT_CLEAR);
                     }
                     break;
                 }
@@ -464,33 +580,55 @@ void Bootloader_Menu(void)
 //                    } while ((tmp_char != '\r') && (tmp_char != '\n'));
                 break;
                 case 6U:
+                case 7U:
+                case 8U:
+                case 9U:
+                case 10U:
                 {
-                    /* Option "Mise à jour firmware (XMODEM 1K)" */
-                    xmodem_receive_1k_blockwise(&usart2_fifo, flash_write_callback);
+                    /* Options "Mise à jour firmware" : XMODEM 1K, XMODEM 1K-G, fenêtre glissante, YMODEM, YMODEM-G */
+                    if (menu_index == 6U) {
+                        xmodem_receive_1k_blockwise(v_transport, flash_write_callback);
+                    } else if (menu_index == 7U) {
+                        xmodem_receive_1k_g(v_transport, flash_write_callback);
+                    } else if (menu_index == 8U) {
+                        slwin_receive(v_transport, flash_write_callback);
+                    } else {
+                        (void)YMODEM_Receive(v_transport, (menu_index == 10U) ? 1U : 0U, flash_write_callback);
+                    }
+                    /* Temps d'écriture flash de l'image (voir flash_pipe.c) */
+                    (void)snprintf(buffer, BUFFER_SIZE,
+                                   VT100_INPUT_LINE "Flash : %u pages, effacement %u ms, programmation %u ms, %u lignes vierges\r\n",
+                                   (unsigned int)v_flash_pipe_stats.pages,
+                                   (unsigned int)(v_flash_pipe_stats.erase_us / 1000U),
+                                   (unsigned int)(v_flash_pipe_stats.program_us / 1000U),
+                                   (unsigned int)v_flash_pipe_stats.blank_rows);
+                    Menu_Send(buffer);
                     do {
 //                        tmp_char = Bootloader_GetInputChar();
-						while(fifo_is_empy(&usart2_fifo)) {};
-						fifo_get(&usart2_fifo, &tmp_char);
+						while(fifo_is_empy(v_transport->rx)) {};
+						fifo_get(v_transport->rx, &tmp_char);
 //	                    HAL_Delay(10U);
                     } while ((tmp_char != '\r') && (tmp_char != '\n'));
-                    SendStringFTDI(VT100_INPUT_CLEAR);
-                    SendStringFTDI(VT100_PROMPT_CLEAR);
+                    Menu_Send(VT100_INPUT_CLEAR);
+                    Menu_Send(VT100_PROMPT_CLEAR);
+                    /* Le programme de transfert du terminal a pu masquer l'écran */
+                    Screen_Invalidate();
                 } break;
-                case 7U:
+                case 11U:
                     /* Option "Lancer à l'application" */
                     if (firmware_ok)
                     {
-                        SendStringFTDI(VT100_INPUT_LINE "Passage à l'application...\r\n");
-                        SendStringFTDI(VT100_MENU_EXIT_LINE "Sortie du menu du bootloader...\r\n");
+                        Menu_Send(VT100_INPUT_LINE "Passage à l'application...\r\n");
+                        Menu_Send(VT100_MENU_EXIT_LINE "Sortie du menu du bootloader...\r\n");
                         Bootloader_JumpToApplication();
                     }
                     else
                     {
-                        SendStringFTDI(VT100_INPUT_LINE "Firmware non présent. Option indisponible.\r\n");
+                        Menu_Send(VT100_INPUT_LINE "Firmware non présent. Option indisponible.\r\n");
                         do {
 //                            tmp_char = Bootloader_GetInputChar();
-							while(fifo_is_empy(&usart2_fifo)) {};
-							fifo_get(&usart2_fifo, &tmp_char);
+							while(fifo_is_empy(v_transport->rx)) {};
+							fifo_get(v_transport->rx, &tmp_char);
 //							HAL_Delay(10U);
                         } while ((tmp_char != '\r') && (tmp_char != '\n'));
                     }
@@ -498,6 +636,9 @@ void Bootloader_Menu(void)
                 default:
                     break;
             }
+            /* Valeurs modifiées et présence du firmware après l'action */
+            Bootloader_DisplayMenu(Config_Get(), menu_index);
+            selectable_options = firmware_ok ? MENU_OPTIONS : (MENU_OPTIONS - 1U);
         }
         HAL_Delay(10U);
     }
@@ -527,8 +668,12 @@ void Bootloader_JumpToApplication(void) {
 //    pFunction Jump_To_Application;
 //	void (*app_reset_handler)(void) = (void*)(*((volatile uint32_t*) (APPLICATION_ADDRESS + 4U)));	
 //    uint32_t Jump_To_Application = *(__IO uint32_t*)(0x8010000 + 4);
-    memcpy(v_AppConfig.Boot_Bootloader, "TOOB",4);
-	Write_Structure_To_Flash(flash_address, &v_AppConfig, sizeof(AppConfig_t));	
+    /* Coefficients du journal dans la page lue par l'application (si modifiés) */
+    Config_Publish();
+    /* Cause de réinitialisation, indicateurs et versions : registres de sauvegarde */
+    handoff_publish();
+    /* Fin de l'émission en cours (réponse, message de sortie) avant l'arrêt du DMA ou de l'USB */
+    (void)transport_flush(v_transport, UART2_TX_TIMEOUT_MS);
     if(((*(__IO uint32_t *)APPLICATION_ADDRESS) & 0x2FFE0000) == 0x20000000) {
         __disable_irq();
 		RCC->CIER = 0x00000000; // Disable all interrupts related to clock
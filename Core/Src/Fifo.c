@@ -1,12 +1,25 @@
+
 #include "inc.h"
 #include <stdint.h>
 
-/** 
+/**
  * @file fifo.c
  * @brief Implémentation d'un FIFO pour la liaison série sur STM32G431.
+ *
+ * FIFO circulaire à un producteur et un consommateur, sans masquage des
+ * interruptions : le producteur (interruption DMA) n'écrit que head, le
+ * consommateur (boucle principale) n'écrit que tail. Les deux indices sont des
+ * compteurs libres ramenés dans le tampon par FIFO_MASK ; toute la capacité du
+ * tampon est utilisable.
+ *
+ * Ordre des accès (__DMB()) :
+ *   - producteur : lecture de tail, copie des octets, publication de head ;
+ *   - consommateur : lecture de head, lecture des octets, publication de tail.
+ * Un indice n'est publié qu'une fois les octets qu'il couvre écrits ou lus.
  */
 
-
+/* FIFO_BUFFER_SIZE doit être une puissance de 2 */
+typedef char fifo_size_is_power_of_two[((FIFO_BUFFER_SIZE & FIFO_MASK) == 0U) ? 1 : -1];
 
 
 
@@ -26,14 +39,69 @@ void fifo_init(fifo_t *fifo)
     }
 }
 
+/**
+ * @brief Vide le FIFO.
+ *
+ * Le producteur et le consommateur ne doivent pas accéder au FIFO pendant l'appel.
+ *
+ * @param[in,out] fifo Pointeur vers la structure FIFO.
+ */
+void fifo_reset(fifo_t *fifo)
+{
+    fifo_init(fifo);
+}
+
+/**
+ * @brief Retourne la capacité du FIFO.
+ *
+ * @param[in] fifo Pointeur vers la structure FIFO.
+ * @return unsigned int Nombre maximal d'octets présents à la fois.
+ */
+unsigned int fifo_size(fifo_t *fifo)
+{
+    (void)fifo;
+    return FIFO_BUFFER_SIZE;
+}
+
+/**
+ * @brief Retourne le nombre d'octets présents dans le FIFO.
+ *
+ * Chaque indice est lu en une seule fois : le résultat est cohérent pour le
+ * producteur comme pour le consommateur, sans masquage des interruptions.
+ *
+ * @param[in] fifo Pointeur vers la structure FIFO.
+ * @return unsigned int Nombre d'octets disponibles en lecture.
+ */
+unsigned int fifo_len(fifo_t *fifo)
+{
+    if (fifo == (void *)0)
+    {
+        return 0U;
+    }
+    return fifo->head - fifo->tail;
+}
+
+/**
+ * @brief Retourne la place libre dans le FIFO.
+ *
+ * @param[in] fifo Pointeur vers la structure FIFO.
+ * @return unsigned int Nombre d'octets pouvant être insérés.
+ */
+unsigned int fifo_free(fifo_t *fifo)
+{
+    if (fifo == (void *)0)
+    {
+        return 0U;
+    }
+    return FIFO_BUFFER_SIZE - fifo_len(fifo);
+}
+
 #include <stdbool.h>
 
 /**
  * @brief Vérifie si le FIFO est vide.
  *
  * Cette fonction retourne true si le FIFO est vide (i.e. si head == tail).
- * Pour garantir la cohérence des lectures en contexte concurrent, les interruptions
- * sont désactivées lors de la lecture des indices.
  *
  * @param[in] fifo Pointeur vers la structure FIFO.
  * @return bool true si le FIFO est vide, false sinon.
@@ -44,13 +112,33 @@ bool fifo_is_empy(fifo_t *fifo)
 
     if (fifo != (void *)0)
     {
-//        __disable_irq();
         isEmpty = (fifo->head == fifo->tail);
-//        __enable_irq();
     }
     return isEmpty;
 }
 
+/**
+ * @brief Vérifie si le FIFO est vide (voir fifo_is_empy()).
+ *
+ * @param[in] fifo Pointeur vers la structure FIFO.
+ * @return int 1 si le FIFO est vide, 0 sinon.
+ */
+int fifo_is_empty(fifo_t *fifo)
+{
+    return fifo_is_empy(fifo) ? 1 : 0;
+}
+
+/**
+ * @brief Vérifie si le FIFO est plein.
+ *
+ * @param[in] fifo Pointeur vers la structure FIFO.
+ * @return int 1 si le FIFO est plein (ou le pointeur nul), 0 sinon.
+ */
+int fifo_is_full(fifo_t *fifo)
+{
+    return (fifo_free(fifo) == 0U) ? 1 : 0;
+}
+
 
 /**
  * @brief Insère une valeur dans le FIFO.
@@ -64,7 +152,7 @@ bool fifo_is_empy(fifo_t *fifo)
 int fifo_put(fifo_t *fifo, uint8_t val)
 {
     int ret = FIFO_OK;
-    uint32_t next_head;
+    uint32_t head;
 
     if (fifo == (void *)0)
     {
@@ -72,26 +160,75 @@ int fifo_put(fifo_t *fifo, uint8_t val)
     }
     else
     {
-        next_head = (fifo->head + 1U) % FIFO_BUFFER_SIZE;
-        if (next_head == fifo->tail)
+        head = fifo->head;
+        if ((head - fifo->tail) >= FIFO_BUFFER_SIZE)
         {
             /* FIFO plein */
             ret = FIFO_ERROR;
         }
         else
         {
-            fifo->buffer[fifo->head] = val;
-            fifo->head = next_head;
+            /* La case a été libérée par le consommateur avant la lecture de tail */
+            __DMB();
+            fifo->buffer[head & FIFO_MASK] = val;
+            __DMB();
+            fifo->head = head + 1U;
         }
     }
     return ret;
 }
 
+/**
+ * @brief Insère un bloc d'octets dans le FIFO.
+ *
+ * Les octets sont copiés en au plus deux segments contigus (avant et après le
+ * rebouclage du tampon), puis l'indice de tête est publié une seule fois, ce qui
+ * permet au producteur (interruption DMA) de livrer une plage complète en une
+ * seule opération. Les octets qui ne tiennent pas dans l'espace libre sont ignorés.
+ *
+ * @param[in,out] fifo Pointeur vers la structure FIFO.
+ * @param[in] buf Pointeur vers les octets à insérer.
+ * @param[in] n Nombre d'octets à insérer.
+ * @return unsigned int Nombre d'octets effectivement insérés.
+ */
+unsigned int fifo_in(fifo_t *fifo, const uint8_t *buf, unsigned long n)
+{
+    uint32_t head;
+    uint32_t space;
+    uint32_t start;
+    uint32_t first;
+
+    if ((fifo == (void *)0) || (buf == (void *)0))
+    {
+        return 0U;
+    }
+
+    head = fifo->head;
+    space = FIFO_BUFFER_SIZE - (head - fifo->tail);
+    if (n > space)
+    {
+        n = space;
+    }
+    __DMB();
+
+    start = head & FIFO_MASK;
+    first = FIFO_BUFFER_SIZE - start;
+    if (first > n)
+    {
+        first = (uint32_t)n;
+    }
+    (void)memcpy(&fifo->buffer[start], buf, first);
+    (void)memcpy(&fifo->buffer[0], &buf[first], (uint32_t)n - first);
+
+    __DMB();
+    fifo->head = head + (uint32_t)n;
+    return (unsigned int)n;
+}
+
 /**
  * @brief Récupère une valeur dans le FIFO.
  *
  * Cette fonction récupère une valeur dans le FIFO si celui-ci n'est pas vide.
- * Elle désactive les interruptions pour garantir l'atomicité de la lecture.
  *
  * @param[in,out] fifo Pointeur vers la structure FIFO.
  * @param[out] val Pointeur où sera stockée la valeur lue.
@@ -100,6 +237,7 @@ int fifo_put(fifo_t *fifo, uint8_t val)
 int fifo_get(fifo_t *fifo, uint8_t *val)
 {
     int ret = FIFO_OK;
+    uint32_t tail;
 
     if ((fifo == (void *)0) || (val == (void *)0))
     {
@@ -107,23 +245,140 @@ int fifo_get(fifo_t *fifo, uint8_t *val)
     }
     else
     {
-//        __disable_irq();
-        if (fifo->head == fifo->tail)
+        tail = fifo->tail;
+        if (fifo->head == tail)
         {
             /* FIFO vide */
-//            __enable_irq();
             ret = FIFO_ERROR;
         }
         else
         {
-            *val = fifo->buffer[fifo->tail];
-            fifo->tail = (fifo->tail + 1U) % FIFO_BUFFER_SIZE;
-//            __enable_irq();
+            /* Octet écrit par le producteur avant la publication de head */
+            __DMB();
+            *val = fifo->buffer[tail & FIFO_MASK];
+            __DMB();
+            fifo->tail = tail + 1U;
         }
     }
     return ret;
 }
 
+/**
+ * @brief Retire un bloc d'octets du FIFO.
+ *
+ * Les octets sont copiés en au plus deux segments contigus puis l'indice de queue
+ * est publié une seule fois.
+ *
+ * @param[in,out] fifo Pointeur vers la structure FIFO.
+ * @param[out] buf Pointeur vers la zone de destination.
+ * @param[in] n Nombre maximal d'octets à retirer.
+ * @return unsigned int Nombre d'octets effectivement retirés.
+ */
+unsigned int fifo_out(fifo_t *fifo, uint8_t *buf, unsigned long n)
+{
+    uint32_t tail;
+    uint32_t available;
+    uint32_t start;
+    uint32_t first;
+
+    if ((fifo == (void *)0) || (buf == (void *)0))
+    {
+        return 0U;
+    }
+
+    tail = fifo->tail;
+    available = fifo->head - tail;
+    if (n > available)
+    {
+        n = available;
+    }
+    __DMB();
+
+    start = tail & FIFO_MASK;
+    first = FIFO_BUFFER_SIZE - start;
+    if (first > n)
+    {
+        first = (uint32_t)n;
+    }
+    (void)memcpy(buf, &fifo->buffer[start], first);
+    (void)memcpy(&buf[first], &fifo->buffer[0], (uint32_t)n - first);
+
+    __DMB();
+    fifo->tail = tail + (uint32_t)n;
+    return (unsigned int)n;
+}
+
+/**
+ * @brief Décrit une plage d'octets du FIFO sans la retirer.
+ *
+ * La plage commence @p offset octets après la position de lecture et est décrite
+ * en au plus deux segments contigus dans le tampon. Les octets décrits restent
+ * valides tant qu'ils n'ont pas été libérés par fifo_commit().
+ *
+ * @param[in]  fifo   Pointeur vers la structure FIFO.
+ * @param[in]  offset Nombre d'octets à sauter depuis la position de lecture.
+ * @param[in]  n      Nombre d'octets à décrire.
+ * @param[out] span   Descripteur rempli avec les segments de la plage.
+ * @return unsigned int Nombre d'octets décrits (inférieur à n si le FIFO n'en contient pas assez).
+ */
+unsigned int fifo_peek(fifo_t *fifo, unsigned int offset, unsigned int n, fifo_span_t *span)
+{
+    uint32_t available;
+    uint32_t start;
+    uint32_t first;
+
+    if ((fifo == (void *)0) || (span == (void *)0))
+    {
+        return 0U;
+    }
+
+    available = fifo_len(fifo);
+    if (offset >= available)
+    {
+        n = 0U;
+    }
+    else if (n > (available - offset))
+    {
+        n = available - offset;
+    }
+    __DMB();
+
+    start = (fifo->tail + offset) & FIFO_MASK;
+    first = FIFO_BUFFER_SIZE - start;
+    if (first > n)
+    {
+        first = n;
+    }
+    span->data[0] = &fifo->buffer[start];
+    span->length[0] = first;
+    span->data[1] = &fifo->buffer[0];
+    span->length[1] = n - first;
+    return n;
+}
+
+/**
+ * @brief Libère des octets lus en place dans le FIFO.
+ *
+ * @param[in,out] fifo Pointeur vers la structure FIFO.
+ * @param[in] n Nombre d'octets à libérer (borné au nombre d'octets présents).
+ */
+void fifo_commit(fifo_t *fifo, unsigned int n)
+{
+    uint32_t available;
+
+    if (fifo != (void *)0)
+    {
+        available = fifo_len(fifo);
+        if (n > available)
+        {
+            n = available;
+        }
+        /* Lectures en place terminées avant de rendre les cases au producteur */
+        __DMB();
+        fifo->tail = fifo->tail + n;
+    }
+}
+
 /**
  * @brief Attend qu'un nombre minimum d'octets soit disponible dans le FIFO.
  *
@@ -137,11 +392,7 @@ int fifo_get(fifo_t *fifo, uint8_t *val)
  */
 int fifo_wait_for(fifo_t *fifo, unsigned int count, unsigned int timeout_ms)
 {
-    int ret = FIFO_ERROR;
     uint32_t start_time;
-    uint32_t available;
-    uint32_t temp_head;
-    uint32_t temp_tail;
 
     if (fifo == NULL)
     {
@@ -149,36 +400,13 @@ int fifo_wait_for(fifo_t *fifo, unsigned int count, unsigned int timeout_ms)
     }
 
     start_time = HAL_GetTick();
-    while (1)
+    while (fifo_len(fifo) < count)
     {
-        /* Désactivation temporaire des interruptions pour lecture cohérente */
-        __disable_irq();
-        temp_head = fifo->head;
-        temp_tail = fifo->tail;
-        __enable_irq();
-
-        if (temp_head >= temp_tail)
-        {
-            available = temp_head - temp_tail;
-        }
-        else
-        {
-            available = (FIFO_BUFFER_SIZE - temp_tail) + temp_head;
-        }
-
-        if (available >= count)
-        {
-            ret = FIFO_OK;
-            break;
-        }
-
         /* Gestion robuste du timeout */
-        uint32_t elapsed_time = HAL_GetTick() - start_time;
-        if (elapsed_time >= timeout_ms)
+        if ((HAL_GetTick() - start_time) >= timeout_ms)
         {
-            break;
+            return FIFO_ERROR;
         }
     }
-
-    return ret;
+    return FIFO_OK;
 }
@@ -1,23 +1,21 @@
 #include "inc.h"
-
-/* Variable globale générée par CubeMX */
-extern USBD_HandleTypeDef hUsbDeviceFS;
-
-
-
-/**
- * @brief Buffer circulaire pour la réception via USB CDC.
- */
+#include "usbd_cdc_if.h"
 
 /**
- * @brief Indice d'insertion dans le buffer.
+ * @file Rou_cdc.c
+ * @brief Liaison USB CDC : réception dans cdc_fifo, émission par une file vidée
+ *        à chaque fin de transfert IN.
+ *
+ * CDC_Send() (liaison transport_cdc, voir transport.c), CDC_SendString(),
+ * CDC_SendMem() et CDC_PutChar() copient les octets dans cdc_tx_fifo et rendent
+ * la main : l'interruption de fin de transfert (CDC_TransmitCplt_FS()) lance le
+ * transfert suivant avec tout ce qui a été déposé entre-temps. Un caractère isolé
+ * ne coûte donc plus une trame de 1 ms. CDC_TxWrite() n'attend jamais et retourne
+ * le nombre d'octets acceptés.
  */
-volatile uint16_t CDC_RxHead = 0U;
 
-/**
- * @brief Indice de lecture dans le buffer.
- */
-volatile uint16_t CDC_RxTail = 0U;
+/* Variable globale générée par CubeMX */
+extern USBD_HandleTypeDef hUsbDeviceFS;
 
 /**
  * @brief Vérifie si l'USB CDC est initialisé et configuré.
@@ -65,8 +63,7 @@ bool CDC_GetChar(uint8_t *p_char)
 
     /* Si le tampon n'est pas vide (l'indice d'écriture diffère de l'indice de lecture) */
     if (fifo_is_empty(&cdc_fifo) == 0) {
-        if (fifo_get(&cdc_fifo, p_char)) {
-        }
+        ret = (fifo_get(&cdc_fifo, p_char) == FIFO_OK);
     }	
     /* Réactivation des interruptions */
     __enable_irq();
@@ -74,61 +71,161 @@ bool CDC_GetChar(uint8_t *p_char)
     return ret;
 }
 
+/* Transfert IN en cours : longueur du segment de cdc_tx_fifo en émission */
+static volatile bool cdc_tx_busy = false;
+static volatile uint32_t cdc_tx_length = 0U;
+
 /**
- * @brief Envoie une chaîne de caractères via l'USB CDC.
+ * @brief Lance l'émission du segment contigu en tête de la file, si l'endpoint IN est libre.
  *
- * Cette fonction utilise la fonction CDC_Transmit_FS() générée par STM32CubeMX pour
- * transmettre la chaîne *p_str* sur le port USB CDC.
+ * Appelée avec les interruptions masquées, ou depuis l'interruption USB. Le
+ * segment est émis en place, en paquets de 64 octets : les écritures déposées
+ * pendant le transfert précédent partent ensemble. Un transfert dont la longueur
+ * est multiple de 64 est terminé par un paquet vide (ZLP) envoyé par la classe
+ * CDC avant l'appel de CDC_TransmitCplt_FS() ; il est compté dans v_cdc_tx_stats.
+ */
+static void CDC_TxStart(void) {
+	fifo_span_t span;
+
+	if (cdc_tx_busy || !CDC_IsInitialized() || (fifo_peek(&cdc_tx_fifo, 0U, FIFO_BUFFER_SIZE, &span) == 0U)) {
+		return;
+	}
+	cdc_tx_busy = true;
+	cdc_tx_length = span.length[0];
+	v_cdc_tx_stats.transfers++;
+	if ((cdc_tx_length % CDC_DATA_FS_IN_PACKET_SIZE) == 0U) {
+		v_cdc_tx_stats.zlps++;
+	}
+	if (CDC_Transmit_FS((uint8_t *)span.data[0], (uint16_t)cdc_tx_length) != USBD_OK) {
+		cdc_tx_busy = false;
+	}
+}
+
+/**
+ * @brief Vide la file d'émission (configuration ou déconfiguration du port USB).
+ */
+void CDC_TxReset(void) {
+	fifo_init(&cdc_tx_fifo);
+	cdc_tx_busy = false;
+	cdc_tx_length = 0U;
+}
+
+/**
+ * @brief Fin d'un transfert IN : libère le segment émis et lance le suivant.
  *
- * @param[in] p_str Pointeur sur la chaîne de caractères à envoyer (terminée par '\0').
- * @return true Si la transmission a été initiée avec succès.
- * @return false Sinon.
+ * Appelée par CDC_TransmitCplt_FS() (usbd_cdc_if.c), après le ZLP éventuel.
  */
-bool CDC_SendString(const char *p_str) {
-    uint16_t length = (uint16_t)strlen(p_str);
+void CDC_TxComplete(void) {
+	fifo_commit(&cdc_tx_fifo, cdc_tx_length);
+	v_cdc_tx_stats.bytes += cdc_tx_length;
+	cdc_tx_length = 0U;
+	cdc_tx_busy = false;
+	CDC_TxStart();
+}
 
-	while (CDC_Transmit_FS((uint8_t *)p_str, length) != USBD_OK) {
+/**
+ * @brief Dépose des octets dans la file d'émission, sans attendre.
+ *
+ * @param[in] data   Octets à émettre.
+ * @param[in] length Nombre d'octets.
+ * @return uint32_t Nombre d'octets acceptés (inférieur à length si la file est pleine).
+ */
+uint32_t CDC_TxWrite(const uint8_t *data, uint32_t length) {
+	uint32_t written = fifo_in(&cdc_tx_fifo, data, length);
+	uint32_t used = fifo_len(&cdc_tx_fifo);
+
+	if (used > v_cdc_tx_stats.high_water) {
+		v_cdc_tx_stats.high_water = used;
 	}
-	cdcTxComplete = true;
-	return cdcTxComplete;
+	__disable_irq();
+	CDC_TxStart();
+	__enable_irq();
+	return written;
 }
 
-bool CDC_SendMem(const char *p_str, uint16_t length) {
-	while (CDC_Transmit_FS((uint8_t *)p_str, length) != USBD_OK) {
+/**
+ * @brief Attend la fin de l'émission de la file.
+ *
+ * @param[in] timeout_ms Délai maximal en millisecondes.
+ * @return int FIFO_OK si tous les octets ont été émis, FIFO_ERROR en cas de timeout
+ *             ou si le port n'est pas configuré.
+ */
+int CDC_TxFlush(uint32_t timeout_ms) {
+	uint32_t start_time = HAL_GetTick();
+
+	while (cdc_tx_busy || (fifo_len(&cdc_tx_fifo) != 0U)) {
+		if (!CDC_IsInitialized() || ((HAL_GetTick() - start_time) >= timeout_ms)) {
+			return FIFO_ERROR;
+		}
 	}
-	cdcTxComplete = true;
-	return cdcTxComplete;
+	return FIFO_OK;
 }
 
-	
-//    if (CDC_Transmit_FS((uint8_t *)p_str, length) == USBD_OK) {
-//		while(cdcTxComplete == false) {
-//			/* Vous pouvez ajouter un timeout pour éviter un blocage infini */
-//		}		
-//		cdcTxComplete = true;
-//        return cdcTxComplete;
-//    }
-    
-//}
+/**
+ * @brief Dépose des octets dans la file, en attendant de la place si elle est pleine.
+ *
+ * Fonction d'émission de transport_cdc (transport.c). L'attente est bornée par
+ * CDC_TX_TIMEOUT_MS ; les octets restants sont perdus et comptés, de même que
+ * tous les octets si le port n'est pas configuré.
+ *
+ * @param[in] data   Octets à émettre.
+ * @param[in] length Nombre d'octets.
+ */
+void CDC_Send(const uint8_t *data, uint32_t length) {
+	uint32_t start_time = HAL_GetTick();
+	uint32_t written;
+
+	if (!CDC_IsInitialized()) {
+		v_cdc_tx_stats.dropped += length;
+		return;
+	}
+	written = CDC_TxWrite(data, length);
+	while (written < length) {
+		if ((HAL_GetTick() - start_time) >= CDC_TX_TIMEOUT_MS) {
+			v_cdc_tx_stats.dropped += length - written;
+			return;
+		}
+		v_cdc_tx_stats.waits++;
+		written += CDC_TxWrite(&data[written], length - written);
+	}
+}
+
+/**
+ * @brief Envoie une chaîne de caractères via l'USB CDC.
+ *
+ * @param[in] p_str Pointeur sur la chaîne de caractères à envoyer (terminée par '\0').
+ * @return true Si le port USB CDC est opérationnel.
+ * @return false Sinon.
+ */
+bool CDC_SendString(const char *p_str) {
+	CDC_Send((const uint8_t *)p_str, (uint32_t)strlen(p_str));
+	return CDC_IsInitialized();
+}
+
+bool CDC_SendMem(const char *p_str, uint16_t length) {
+	CDC_Send((const uint8_t *)p_str, length);
+	return CDC_IsInitialized();
+}
 
 /**
  * @brief Callback de réception des données USB CDC.
  *
- * Cette fonction doit être appelée depuis CDC_Receive_FS() (déjà générée par CubeMX)
- * afin d'insérer les données reçues dans le buffer circulaire.
+ * Appelée depuis CDC_Receive_FS() (interruption USB) : le paquet est copié dans
+ * cdc_fifo en une seule fois. CDC_Receive_FS() n'arme l'endpoint pour le paquet
+ * suivant que si la FIFO peut le recevoir : la copie ne perd aucun octet.
  *
  * @param[in] Buf Pointeur sur les données reçues.
  * @param[in] Len Nombre d'octets reçus.
- * @return int Retourne USBD_OK.
  */
-int CDC_ReceiveCallback(uint8_t *Buf, uint32_t Len) {
-    uint32_t i;
-    for (i = 0U; i < Len; i++) {
-		fifo_put(&cdc_fifo, Buf[i]);
-    }
-
-    /* La fonction CDC_Receive_FS() doit relancer la réception, c'est géré dans le fichier usbd_cdc_if.c */
-    return USBD_OK;
+void CDC_ReceiveCallback(const uint8_t *Buf, uint32_t Len) {
+	uint32_t now = HAL_GetTick();
+
+	if (v_cdc_rx_stats.packets == 0U) {
+		v_cdc_rx_stats.first_ms = now;
+	}
+	v_cdc_rx_stats.packets++;
+	v_cdc_rx_stats.last_ms = now;
+	v_cdc_rx_stats.bytes += fifo_in(&cdc_fifo, Buf, Len);
 }
 
 /**
@@ -137,10 +234,6 @@ int CDC_ReceiveCallback(uint8_t *Buf, uint32_t Len) {
  * @param[in] ch Caractère à envoyer.
  */
 void CDC_PutChar(uint8_t ch) {
-    /* Pour envoyer un seul caractère, on l'envoie dans une chaîne de deux octets */
-    char buf[2];
-    buf[0] = (char)ch;
-    buf[1] = '\0';
-    CDC_SendString(buf);
+	CDC_Send(&ch, 1U);
 }
 
@@ -0,0 +1,99 @@
+#include "inc.h"
+
+/**
+ * @file cobs.c
+ * @brief Encodage COBS (Consistent Overhead Byte Stuffing) des trames série.
+ *
+ * Une trame encodée ne contient aucun octet 0x00 : celui-ci sert de délimiteur de
+ * trame sur la liaison, ce qui permet au récepteur de se resynchroniser sur la
+ * trame suivante après une erreur. Le surcoût est d'un octet par tranche de 254
+ * octets, plus un octet.
+ */
+
+
+/**
+ * @brief Encode une trame en COBS.
+ *
+ * Le délimiteur 0x00 n'est pas ajouté. Le tampon de destination doit pouvoir
+ * contenir COBS_MAX_ENCODED_SIZE(length) octets.
+ *
+ * @param[in]  src    Données à encoder.
+ * @param[in]  length Longueur des données en octets.
+ * @param[out] dst    Tampon de destination (distinct de src).
+ * @return uint32_t Longueur de la trame encodée en octets.
+ */
+uint32_t cobs_encode(const uint8_t *src, uint32_t length, uint8_t *dst)
+{
+    uint32_t code_index = 0U;
+    uint32_t out = 1U;
+    uint32_t i;
+    uint8_t code = 1U;
+
+    for (i = 0U; i < length; i++)
+    {
+        if (src[i] == 0U)
+        {
+            dst[code_index] = code;
+            code_index = out;
+            out++;
+            code = 1U;
+        }
+        else
+        {
+            dst[out] = src[i];
+            out++;
+            code++;
+            if (code == 0xFFU)
+            {
+                dst[code_index] = code;
+                code_index = out;
+                out++;
+                code = 1U;
+            }
+        }
+    }
+    dst[code_index] = code;
+    return out;
+}
+
+/**
+ * @brief Décode une trame COBS (sans son délimiteur).
+ *
+ * Le décodage peut se faire en place (dst == src), la trame décodée étant toujours
+ * plus courte que la trame encodée.
+ *
+ * @param[in]  src    Trame encodée.
+ * @param[in]  length Longueur de la trame encodée en octets.
+ * @param[out] dst    Tampon de destination (au moins length octets).
+ * @return int32_t Longueur de la trame décodée, -1 si la trame est invalide.
+ */
+int32_t cobs_decode(const uint8_t *src, uint32_t length, uint8_t *dst)
+{
+    uint32_t in = 0U;
+    uint32_t out = 0U;
+    uint32_t i;
+    uint8_t code;
+
+    while (in < length)
+    {
+        code = src[in];
+        if ((code == 0U) || ((in + code) > length))
+        {
+            return -1;
+        }
+        in++;
+        for (i = 1U; i < code; i++)
+        {
+            dst[out] = src[in];
+            out++;
+            in++;
+        }
+        /* Un code inférieur à 0xFF marque un zéro, sauf en fin de trame */
+        if ((code != 0xFFU) && (in < length))
+        {
+            dst[out] = 0U;
+            out++;
+        }
+    }
+    return (int32_t)out;
+}
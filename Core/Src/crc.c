@@ -0,0 +1,287 @@
+#include <string.h>
+#include "crc.h"
+#if CRC_HW_BACKEND
+#include "stm32g4xx_hal.h"
+#endif
+
+/**
+ * @file crc.c
+ * @brief Moteurs CRC16-CCITT et CRC32 (voir crc.h).
+ *
+ * L'état intermédiaire transmis entre deux appels est le registre du CRC sans
+ * inversion finale : le CRC16 démarre à 0, le CRC32 à 0xFFFFFFFF et crc32_final()
+ * applique l'inversion finale.
+ */
+
+
+/**
+ * @brief CRC16-CCITT bit à bit (référence).
+ */
+uint16_t crc16_update_bitwise(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    uint32_t i;
+    uint32_t bit;
+
+    for (i = 0U; i < length; i++)
+    {
+        crc ^= (uint16_t)((uint16_t)data[i] << 8U);
+        for (bit = 0U; bit < 8U; bit++)
+        {
+            crc = ((crc & 0x8000U) != 0U) ? (uint16_t)((crc << 1U) ^ CRC16_POLY) : (uint16_t)(crc << 1U);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief CRC32 bit à bit (référence).
+ */
+uint32_t crc32_update_bitwise(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+    uint32_t i;
+    uint32_t bit;
+
+    for (i = 0U; i < length; i++)
+    {
+        crc ^= data[i];
+        for (bit = 0U; bit < 8U; bit++)
+        {
+            crc = (crc >> 1U) ^ (CRC32_POLY & (0U - (crc & 1U)));
+        }
+    }
+    return crc;
+}
+
+#if CRC_SLICE8_BACKEND
+
+/* Tables slice-by-8 : table[k][b] = CRC de l'octet b suivi de k octets nuls */
+static uint16_t crc16_table[8][256];
+static uint32_t crc32_table[8][256];
+static int crc_tables_ready = 0;
+
+static void crc_build_tables(void)
+{
+    uint32_t b;
+    uint32_t k;
+    uint8_t byte;
+
+    for (b = 0U; b < 256U; b++)
+    {
+        byte = (uint8_t)b;
+        crc16_table[0][b] = (uint16_t)crc16_update_bitwise((uint16_t)0U, &byte, 1U);
+        crc32_table[0][b] = crc32_update_bitwise(0U, &byte, 1U);
+    }
+    for (k = 1U; k < 8U; k++)
+    {
+        for (b = 0U; b < 256U; b++)
+        {
+            crc16_table[k][b] = (uint16_t)((crc16_table[k - 1U][b] << 8U)
+                                           ^ crc16_table[0][crc16_table[k - 1U][b] >> 8U]);
+            crc32_table[k][b] = (crc32_table[k - 1U][b] >> 8U) ^ crc32_table[0][crc32_table[k - 1U][b] & 0xFFU];
+        }
+    }
+    crc_tables_ready = 1;
+}
+
+/**
+ * @brief CRC16-CCITT par tranches de 8 octets.
+ */
+uint16_t crc16_update_slice8(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    if (!crc_tables_ready)
+    {
+        crc_build_tables();
+    }
+    while (length >= 8U)
+    {
+        crc = (uint16_t)(crc16_table[7][data[0] ^ (crc >> 8U)] ^ crc16_table[6][data[1] ^ (crc & 0xFFU)]
+                       ^ crc16_table[5][data[2]] ^ crc16_table[4][data[3]]
+                       ^ crc16_table[3][data[4]] ^ crc16_table[2][data[5]]
+                       ^ crc16_table[1][data[6]] ^ crc16_table[0][data[7]]);
+        data += 8;
+        length -= 8U;
+    }
+    while (length > 0U)
+    {
+        crc = (uint16_t)((crc << 8U) ^ crc16_table[0][(crc >> 8U) ^ *data]);
+        data++;
+        length--;
+    }
+    return crc;
+}
+
+/**
+ * @brief CRC32 par tranches de 8 octets.
+ */
+uint32_t crc32_update_slice8(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+    uint32_t lo;
+    uint32_t hi;
+
+    if (!crc_tables_ready)
+    {
+        crc_build_tables();
+    }
+    while (length >= 8U)
+    {
+        lo = crc ^ ((uint32_t)data[0] | ((uint32_t)data[1] << 8U) | ((uint32_t)data[2] << 16U) | ((uint32_t)data[3] << 24U));
+        hi = (uint32_t)data[4] | ((uint32_t)data[5] << 8U) | ((uint32_t)data[6] << 16U) | ((uint32_t)data[7] << 24U);
+        crc = crc32_table[7][lo & 0xFFU] ^ crc32_table[6][(lo >> 8U) & 0xFFU]
+            ^ crc32_table[5][(lo >> 16U) & 0xFFU] ^ crc32_table[4][lo >> 24U]
+            ^ crc32_table[3][hi & 0xFFU] ^ crc32_table[2][(hi >> 8U) & 0xFFU]
+            ^ crc32_table[1][(hi >> 16U) & 0xFFU] ^ crc32_table[0][hi >> 24U];
+        data += 8;
+        length -= 8U;
+    }
+    while (length > 0U)
+    {
+        crc = (crc >> 8U) ^ crc32_table[0][(crc ^ *data) & 0xFFU];
+        data++;
+        length--;
+    }
+    return crc;
+}
+
+#endif /* CRC_SLICE8_BACKEND */
+
+#if CRC_HW_BACKEND
+
+/**
+ * @brief Programme l'unité CRC et y passe les données.
+ *
+ * L'unité est reconfigurée à chaque appel (polynôme, taille, inversions, valeur
+ * initiale) : les calculs CRC16 et CRC32 peuvent être entrelacés. Les mots de 32
+ * bits sont écrits octet de poids fort en tête pour respecter l'ordre des octets
+ * en mémoire ; le reste est écrit octet par octet.
+ *
+ * @param[in] cr     Taille du polynôme et inversions (registre CRC_CR, sans RESET).
+ * @param[in] poly   Polynôme (forme directe).
+ * @param[in] init   Registre interne du CRC au début du calcul.
+ * @param[in] data   Données.
+ * @param[in] length Nombre d'octets.
+ * @return uint32_t Registre de données après le calcul.
+ */
+static uint32_t crc_hw_run(uint32_t cr, uint32_t poly, uint32_t init, const uint8_t *data, uint32_t length)
+{
+    uint32_t word;
+
+    if (__HAL_RCC_CRC_IS_CLK_DISABLED())
+    {
+        __HAL_RCC_CRC_CLK_ENABLE();
+    }
+    CRC->POL = poly;
+    CRC->INIT = init;
+    CRC->CR = cr | CRC_CR_RESET;
+
+    while (length >= 4U)
+    {
+        (void)memcpy(&word, data, sizeof(word));
+        CRC->DR = __REV(word);
+        data += 4;
+        length -= 4U;
+    }
+    while (length > 0U)
+    {
+        *(__IO uint8_t *)&CRC->DR = *data;
+        data++;
+        length--;
+    }
+    return CRC->DR;
+}
+
+/**
+ * @brief CRC16-CCITT sur l'unité CRC.
+ */
+uint16_t crc16_update_hw(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    if (length == 0U)
+    {
+        return crc;
+    }
+    return (uint16_t)crc_hw_run(CRC_CR_POLYSIZE_0, CRC16_POLY, crc, data, length);
+}
+
+/**
+ * @brief CRC32 sur l'unité CRC (entrée inversée par octet, sortie inversée).
+ */
+uint32_t crc32_update_hw(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+    if (length == 0U)
+    {
+        return crc;
+    }
+    /* Le registre interne travaille en forme directe : la valeur réfléchie est retournée */
+    return crc_hw_run(CRC_CR_REV_IN_0 | CRC_CR_REV_OUT, 0x04C11DB7UL, __RBIT(crc), data, length);
+}
+
+#endif /* CRC_HW_BACKEND */
+
+/**
+ * @brief Valeur initiale du CRC16-CCITT (XMODEM).
+ */
+uint16_t crc16_init(void)
+{
+    return 0U;
+}
+
+/**
+ * @brief Met à jour un CRC16-CCITT avec le moteur le plus rapide disponible.
+ *
+ * @param[in] crc    CRC des données précédentes (crc16_init() au départ).
+ * @param[in] data   Données.
+ * @param[in] length Nombre d'octets.
+ * @return uint16_t CRC mis à jour.
+ */
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+#if CRC_HW_BACKEND
+    return crc16_update_hw(crc, data, length);
+#elif CRC_SLICE8_BACKEND
+    return crc16_update_slice8(crc, data, length);
+#else
+    return crc16_update_bitwise(crc, data, length);
+#endif
+}
+
+/**
+ * @brief Résultat du CRC16-CCITT (XMODEM : pas d'inversion finale).
+ */
+uint16_t crc16_final(uint16_t crc)
+{
+    return crc;
+}
+
+/**
+ * @brief Valeur initiale du CRC32.
+ */
+uint32_t crc32_init(void)
+{
+    return 0xFFFFFFFFUL;
+}
+
+/**
+ * @brief Met à jour un CRC32 avec le moteur le plus rapide disponible.
+ *
+ * @param[in] crc    CRC des données précédentes (crc32_init() au départ).
+ * @param[in] data   Données.
+ * @param[in] length Nombre d'octets.
+ * @return uint32_t CRC mis à jour.
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t length)
+{
+#if CRC_HW_BACKEND
+    return crc32_update_hw(crc, data, length);
+#elif CRC_SLICE8_BACKEND
+    return crc32_update_slice8(crc, data, length);
+#else
+    return crc32_update_bitwise(crc, data, length);
+#endif
+}
+
+/**
+ * @brief Résultat du CRC32 (inversion finale).
+ */
+uint32_t crc32_final(uint32_t crc)
+{
+    return ~crc;
+}
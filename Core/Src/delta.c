@@ -0,0 +1,352 @@
+#include <string.h>
+#include "crc.h"
+#include "delta.h"
+
+/**
+ * @file delta.c
+ * @brief Reconstruction en flux d'une image firmware à partir d'un patch (voir delta.h).
+ *
+ * Le patch est accepté par morceaux de taille quelconque. Les copies sont lues
+ * directement dans l'image source : une page source n'est plus lisible dès que
+ * sa page cible a commencé à être produite, sauf pour cette page elle-même, qui
+ * est entièrement préparée en RAM avant d'être effacée.
+ */
+
+/** Signature en tête d'un patch. */
+static const uint8_t delta_magic[4] = { 'A', 'D', 'L', '1' };
+
+/** Octets de complément de la dernière page. */
+static const uint8_t delta_blank[64] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+/* Étapes du décodage */
+#define DELTA_STATE_HEADER  0U  /**< En-tête du patch */
+#define DELTA_STATE_PAGE    1U  /**< En-tête de page */
+#define DELTA_STATE_OP      2U  /**< En-tête d'opération */
+#define DELTA_STATE_DATA    3U  /**< Données littérales */
+#define DELTA_STATE_END     4U  /**< Toutes les pages sont reçues */
+
+
+/**
+ * @brief Indique si des données commencent par la signature d'un patch.
+ *
+ * @param[in] data   Premiers octets de l'image.
+ * @param[in] length Nombre d'octets disponibles.
+ * @return int 1 s'il s'agit d'un patch, 0 sinon.
+ */
+int delta_is_patch(const uint8_t *data, uint32_t length)
+{
+    if ((data == NULL) || (length < sizeof(delta_magic)))
+    {
+        return 0;
+    }
+    return (memcmp(data, delta_magic, sizeof(delta_magic)) == 0) ? 1 : 0;
+}
+
+/**
+ * @brief Initialise le décodeur pour un nouveau patch.
+ *
+ * @param[out] decoder      État du décodeur.
+ * @param[in]  source       Image source (application installée).
+ * @param[in]  source_limit Nombre d'octets lisibles à partir de source.
+ */
+void delta_decoder_init(delta_decoder_t *decoder, const uint8_t *source, uint32_t source_limit)
+{
+    (void)memset(decoder, 0, sizeof(*decoder));
+    decoder->source = source;
+    decoder->source_length = source_limit;
+    decoder->state = DELTA_STATE_HEADER;
+    decoder->status = DELTA_OK;
+}
+
+static uint32_t delta_get16(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8U);
+}
+
+static uint32_t delta_get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8U) | ((uint32_t)p[2] << 16U) | ((uint32_t)p[3] << 24U);
+}
+
+static int delta_is_written(const delta_decoder_t *decoder, uint32_t page)
+{
+    return ((decoder->written[page / 32U] >> (page % 32U)) & 1U) != 0U;
+}
+
+/**
+ * @brief Contrôle l'en-tête du patch et l'image source.
+ *
+ * @return int DELTA_OK si le patch s'applique à l'image source, DELTA_ERROR sinon.
+ */
+static int delta_parse_header(delta_decoder_t *decoder)
+{
+    const uint8_t *header = decoder->field;
+    uint32_t source_length = delta_get32(&header[8]);
+
+    if ((memcmp(header, delta_magic, sizeof(delta_magic)) != 0)
+        || (delta_get16(&header[4]) != DELTA_PAGE_SIZE)
+        || (source_length > decoder->source_length))
+    {
+        return DELTA_ERROR;
+    }
+    decoder->page_count = delta_get16(&header[6]);
+    decoder->target_length = delta_get32(&header[16]);
+    decoder->target_crc = delta_get32(&header[20]);
+    if ((decoder->target_length == 0U) || (decoder->target_length > (DELTA_MAX_PAGES * DELTA_PAGE_SIZE))
+        || (decoder->page_count > ((decoder->target_length + DELTA_PAGE_SIZE - 1U) / DELTA_PAGE_SIZE)))
+    {
+        return DELTA_ERROR;
+    }
+
+    /* Un patch calculé pour une autre image source la corromprait */
+    if (crc32_final(crc32_update(crc32_init(), decoder->source, source_length)) != delta_get32(&header[12]))
+    {
+        return DELTA_ERROR;
+    }
+    decoder->source_length = source_length;
+    return DELTA_OK;
+}
+
+/**
+ * @brief Contrôle l'en-tête d'une page et la marque comme réécrite.
+ *
+ * @return int DELTA_OK si la page est valide, DELTA_ERROR sinon.
+ */
+static int delta_parse_page(delta_decoder_t *decoder)
+{
+    uint32_t page = delta_get16(&decoder->field[0]);
+    uint32_t length = delta_get16(&decoder->field[2]);
+    uint32_t expected;
+
+    if ((page >= ((decoder->target_length + DELTA_PAGE_SIZE - 1U) / DELTA_PAGE_SIZE))
+        || delta_is_written(decoder, page))
+    {
+        return DELTA_ERROR;
+    }
+    expected = decoder->target_length - (page * DELTA_PAGE_SIZE);
+    if (expected > DELTA_PAGE_SIZE)
+    {
+        expected = DELTA_PAGE_SIZE;
+    }
+    if (length != expected)
+    {
+        return DELTA_ERROR;
+    }
+    decoder->written[page / 32U] |= 1UL << (page % 32U);
+    decoder->page = page;
+    decoder->offset = page * DELTA_PAGE_SIZE;
+    decoder->page_remaining = length;
+    return DELTA_OK;
+}
+
+/**
+ * @brief Transmet des octets de la page en cours à la sortie.
+ */
+static int delta_emit(delta_decoder_t *decoder, const uint8_t *data, uint32_t length,
+                      delta_sink_t sink, void *context)
+{
+    if (sink(context, decoder->offset, data, length) != 0)
+    {
+        return DELTA_ERROR;
+    }
+    decoder->offset += length;
+    decoder->page_remaining -= length;
+    return DELTA_OK;
+}
+
+/**
+ * @brief Termine la page en cours : complément de la dernière page et page suivante.
+ */
+static int delta_end_page(delta_decoder_t *decoder, delta_sink_t sink, void *context)
+{
+    uint32_t n;
+
+    if ((decoder->offset % DELTA_PAGE_SIZE) != 0U)
+    {
+        decoder->page_remaining = DELTA_PAGE_SIZE - (decoder->offset % DELTA_PAGE_SIZE);
+        while (decoder->page_remaining > 0U)
+        {
+            n = (decoder->page_remaining < sizeof(delta_blank)) ? decoder->page_remaining : sizeof(delta_blank);
+            if (delta_emit(decoder, delta_blank, n, sink, context) != DELTA_OK)
+            {
+                return DELTA_ERROR;
+            }
+        }
+    }
+    decoder->pages_done++;
+    decoder->state = (decoder->pages_done == decoder->page_count) ? DELTA_STATE_END : DELTA_STATE_PAGE;
+    return DELTA_OK;
+}
+
+/**
+ * @brief Exécute l'opération dont l'en-tête vient d'être reçu.
+ *
+ * @return int DELTA_OK, ou DELTA_ERROR si l'opération est invalide.
+ */
+static int delta_run_op(delta_decoder_t *decoder, delta_sink_t sink, void *context)
+{
+    uint32_t length = delta_get16(&decoder->field[1]);
+    uint32_t source;
+    uint32_t page;
+
+    if ((length == 0U) || (length > decoder->page_remaining))
+    {
+        return DELTA_ERROR;
+    }
+    if (decoder->field[0] == DELTA_OP_DATA)
+    {
+        decoder->data_remaining = length;
+        decoder->state = DELTA_STATE_DATA;
+        return DELTA_OK;
+    }
+
+    source = delta_get32(&decoder->field[3]);
+    if ((source > decoder->source_length) || (length > (decoder->source_length - source)))
+    {
+        return DELTA_ERROR;
+    }
+    /* Les pages source déjà réécrites ne contiennent plus l'ancienne image */
+    for (page = source / DELTA_PAGE_SIZE; page <= ((source + length - 1U) / DELTA_PAGE_SIZE); page++)
+    {
+        if ((page != decoder->page) && (page < DELTA_MAX_PAGES) && delta_is_written(decoder, page))
+        {
+            return DELTA_ERROR;
+        }
+    }
+    if (delta_emit(decoder, &decoder->source[source], length, sink, context) != DELTA_OK)
+    {
+        return DELTA_ERROR;
+    }
+    if (decoder->page_remaining == 0U)
+    {
+        return delta_end_page(decoder, sink, context);
+    }
+    decoder->state = DELTA_STATE_OP;
+    return DELTA_OK;
+}
+
+/**
+ * @brief Nombre d'octets d'en-tête attendus pour l'étape en cours.
+ */
+static uint32_t delta_field_size(const delta_decoder_t *decoder)
+{
+    switch (decoder->state)
+    {
+    case DELTA_STATE_HEADER:
+        return DELTA_HEADER_SIZE;
+    case DELTA_STATE_PAGE:
+        return DELTA_PAGE_HEADER_SIZE;
+    default:
+        return ((decoder->field_length > 0U) && (decoder->field[0] == DELTA_OP_COPY))
+               ? DELTA_COPY_HEADER_SIZE : DELTA_OP_HEADER_SIZE;
+    }
+}
+
+/**
+ * @brief Traite un morceau du patch.
+ *
+ * @param[in,out] decoder État du décodeur.
+ * @param[in]     data    Octets du patch.
+ * @param[in]     length  Nombre d'octets.
+ * @param[in]     sink    Fonction de sortie des octets reconstruits.
+ * @param[in]     context Contexte transmis à sink.
+ * @return int DELTA_OK si d'autres données sont attendues, DELTA_DONE quand toutes
+ *             les pages sont reconstruites, DELTA_ERROR en cas d'erreur.
+ */
+int delta_decode(delta_decoder_t *decoder, const uint8_t *data, uint32_t length,
+                 delta_sink_t sink, void *context)
+{
+    uint32_t i = 0U;
+    uint32_t n;
+    int status;
+
+    while ((decoder->status == DELTA_OK) && (decoder->state != DELTA_STATE_END) && (i < length))
+    {
+        if (decoder->state == DELTA_STATE_DATA)
+        {
+            n = length - i;
+            if (n > decoder->data_remaining)
+            {
+                n = decoder->data_remaining;
+            }
+            status = delta_emit(decoder, &data[i], n, sink, context);
+            i += n;
+            decoder->data_remaining -= n;
+            if ((status == DELTA_OK) && (decoder->data_remaining == 0U))
+            {
+                if (decoder->page_remaining == 0U)
+                {
+                    status = delta_end_page(decoder, sink, context);
+                }
+                else
+                {
+                    decoder->state = DELTA_STATE_OP;
+                }
+            }
+        }
+        else
+        {
+            decoder->field[decoder->field_length] = data[i];
+            decoder->field_length++;
+            i++;
+            if ((decoder->state == DELTA_STATE_OP) && (decoder->field_length == 1U)
+                && (data[i - 1U] != DELTA_OP_COPY) && (data[i - 1U] != DELTA_OP_DATA))
+            {
+                status = DELTA_ERROR;
+            }
+            else if (decoder->field_length < delta_field_size(decoder))
+            {
+                continue;
+            }
+            else if (decoder->state == DELTA_STATE_HEADER)
+            {
+                status = delta_parse_header(decoder);
+                decoder->state = (decoder->page_count != 0U) ? DELTA_STATE_PAGE : DELTA_STATE_END;
+            }
+            else if (decoder->state == DELTA_STATE_PAGE)
+            {
+                status = delta_parse_page(decoder);
+                decoder->state = DELTA_STATE_OP;
+            }
+            else
+            {
+                status = delta_run_op(decoder, sink, context);
+            }
+            decoder->field_length = 0U;
+        }
+
+        if (status != DELTA_OK)
+        {
+            decoder->status = DELTA_ERROR;
+        }
+    }
+
+    if ((decoder->status == DELTA_OK) && (decoder->state == DELTA_STATE_END))
+    {
+        decoder->status = DELTA_DONE;
+    }
+    return decoder->status;
+}
+
+/**
+ * @brief Contrôle final de l'image reconstruite.
+ *
+ * @param[in] decoder État du décodeur après le dernier morceau du patch.
+ * @param[in] target  Image cible reconstruite (en flash sur la cible).
+ * @return int DELTA_DONE si toutes les pages sont reconstruites et que le CRC32 de
+ *             l'image correspond, DELTA_ERROR sinon.
+ */
+int delta_finish(const delta_decoder_t *decoder, const uint8_t *target)
+{
+    if ((decoder->status != DELTA_DONE)
+        || (crc32_final(crc32_update(crc32_init(), target, decoder->target_length)) != decoder->target_crc))
+    {
+        return DELTA_ERROR;
+    }
+    return DELTA_DONE;
+}
@@ -0,0 +1,52 @@
+#include "inc.h"
+
+/**
+ * @file flash_fast.c
+ * @brief Programmation rapide d'une ligne de flash (32 doubles mots), exécutée en RAM.
+ *
+ * Le STM32G431 n'a qu'une banque : en mode rapide (FSTPG), les 64 mots d'une ligne
+ * doivent être écrits sans interruption ni lecture de la flash, faute de quoi
+ * l'opération est abandonnée (MISSERR, FASTERR). Ce module est donc placé en RAM :
+ * attribut __RAM_FUNC pour GCC et IAR, zone Code/Const affectée à IRAM1 dans les
+ * options du fichier pour Keil (voir stm32g4xx_hal_def.h). Il n'appelle aucune
+ * fonction résidant en flash.
+ */
+
+/**
+ * @brief Programme une ligne de FLASH_ROW_SIZE octets en mode rapide.
+ *
+ * La flash doit être déverrouillée, la ligne effacée et HCLK d'au moins 8 MHz.
+ *
+ * @param[in] address Adresse de la ligne (alignée sur FLASH_ROW_SIZE).
+ * @param[in] row     Données (alignées sur 4 octets).
+ * @return int 0 en cas de succès, -1 si la flash signale une erreur.
+ */
+__RAM_FUNC int flash_fast_program_row(uint32_t address, const uint32_t *row)
+{
+    volatile uint32_t *dest = (volatile uint32_t *)address;
+    uint32_t primask;
+    uint32_t i;
+    uint32_t sr;
+
+    while ((FLASH->SR & FLASH_SR_BSY) != 0U)
+    {
+    }
+    FLASH->SR = FLASH_FLAG_SR_ERRORS | FLASH_SR_EOP;
+    FLASH->CR |= FLASH_CR_FSTPG;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    for (i = 0U; i < (FLASH_ROW_SIZE / sizeof(uint32_t)); i++)
+    {
+        dest[i] = row[i];
+    }
+    while ((FLASH->SR & FLASH_SR_BSY) != 0U)
+    {
+    }
+    __set_PRIMASK(primask);
+
+    FLASH->CR &= ~FLASH_CR_FSTPG;
+    sr = FLASH->SR;
+    FLASH->SR = FLASH_FLAG_SR_ERRORS | FLASH_SR_EOP;
+    return ((sr & FLASH_FLAG_SR_ERRORS) != 0U) ? -1 : 0;
+}
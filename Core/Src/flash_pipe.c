@@ -0,0 +1,502 @@
+#include "inc.h"
+
+/**
+ * @file flash_pipe.c
+ * @brief Pipeline d'écriture flash à double tampon pour la mise à jour de l'application.
+ *
+ * Les données reçues sont copiées dans l'un des FLASH_PIPE_SLOTS tampons d'une page
+ * (2 ko). Lorsqu'un tampon est plein, sa page est effacée, programmée puis vérifiée
+ * par étapes courtes lors des appels à flash_pipe_poll(), pendant que la réception
+ * remplit le tampon suivant. L'appelant n'est bloqué que lorsque tous les tampons
+ * sont occupés.
+ *
+ * Le STM32G431 n'a qu'une banque : le CPU est suspendu pendant chaque opération
+ * flash, mais la réception DMA de l'USART2 continue de remplir son tampon circulaire
+ * et les octets sont publiés dans la FIFO à la reprise. Ce tampon
+ * (UART2_RX_DMA_BUFFER_SIZE octets) couvre la programmation d'une ligne (1,9 ms)
+ * jusqu'à 921600 bauds, mais pas l'effacement d'une page (22 ms) au-delà de
+ * 115200 bauds : les effacements ont donc lieu ligne silencieuse.
+ *   - En stop-and-wait, le récepteur appelle flash_pipe_prepare() avant d'acquitter
+ *     un bloc : les pages complètes sont effacées pendant que l'émetteur attend,
+ *     seules la programmation et la vérification recouvrent la réception.
+ *   - En streaming sur une liaison sans contrôle de flux, la zone est effacée par
+ *     flash_pipe_preerase() avant le démarrage du flux.
+ *
+ * Lorsque la taille de l'image est connue, flash_pipe_erase_ahead() fait effacer
+ * toute la plage en une seule opération avant la première page ; les pages sont
+ * ensuite programmées par lignes en mode rapide, sans programmer les lignes vierges.
+ */
+
+/**
+ * @brief État du pipeline d'écriture flash.
+ */
+static struct
+{
+    flash_slot_t slot[FLASH_PIPE_SLOTS];    /**< Tampons de préparation. */
+    uint32_t fill;                          /**< Indice du tampon en cours de remplissage. */
+    uint32_t work;                          /**< Indice du tampon en cours d'écriture. */
+    uint32_t address;                       /**< Adresse de la prochaine page à préparer. */
+    uint32_t end_address;                   /**< Dernier octet autorisé en écriture. */
+    uint32_t offset;                        /**< Position de programmation dans la page courante. */
+    uint32_t erase_end;                     /**< Fin de la plage à effacer d'un bloc, 0 si aucune. */
+    uint32_t erased_start;                  /**< Début de la plage déjà effacée. */
+    uint32_t erased_end;                    /**< Fin (exclue) de la plage déjà effacée. */
+    flash_stage_t stage;                    /**< Étape de la page courante. */
+    bool invalidated;                       /**< Application installée déjà invalidée (image.c). */
+    int status;                             /**< FLASH_PIPE_ERROR après une erreur, FLASH_PIPE_OK sinon. */
+} flash_pipe;
+
+
+/**
+ * @brief Initialise le pipeline pour une nouvelle écriture.
+ *
+ * @param[in] address     Adresse de la première page à écrire (alignée sur une page).
+ * @param[in] end_address Dernier octet de la zone autorisée en écriture.
+ */
+void flash_pipe_init(uint32_t address, uint32_t end_address)
+{
+    uint32_t i;
+
+    for (i = 0U; i < FLASH_PIPE_SLOTS; i++)
+    {
+        flash_pipe.slot[i].state = FLASH_SLOT_FREE;
+        flash_pipe.slot[i].length = 0U;
+        flash_pipe.slot[i].erased = false;
+    }
+    flash_pipe.fill = 0U;
+    flash_pipe.work = 0U;
+    flash_pipe.address = address;
+    flash_pipe.end_address = end_address;
+    flash_pipe.offset = 0U;
+    flash_pipe.erase_end = 0U;
+    flash_pipe.erased_start = 0U;
+    flash_pipe.erased_end = 0U;
+    flash_pipe.stage = FLASH_STAGE_IDLE;
+    flash_pipe.invalidated = false;
+    flash_pipe.status = FLASH_PIPE_OK;
+    (void)memset(&v_flash_pipe_stats, 0, sizeof(v_flash_pipe_stats));
+}
+
+/**
+ * @brief Annonce la fin de l'image pour effacer toute la plage en une seule opération.
+ *
+ * À appeler avant la première page. L'effacement a lieu à l'étape d'effacement de
+ * la première page ; les pages suivantes de la plage ne sont plus effacées. Les
+ * pages doivent alors être écrites dans l'ordre (pas de flash_pipe_seek()).
+ *
+ * @param[in] end_address Dernier octet de l'image.
+ */
+void flash_pipe_erase_ahead(uint32_t end_address)
+{
+    if (end_address > flash_pipe.end_address)
+    {
+        end_address = flash_pipe.end_address;
+    }
+    flash_pipe.erase_end = end_address;
+}
+
+/**
+ * @brief Efface une plage de pages, après avoir invalidé l'application installée.
+ *
+ * La plage effacée est mémorisée : les pages qu'elle contient ne sont plus effacées.
+ *
+ * @param[in] address Adresse de la première page.
+ * @param[in] count   Nombre de pages.
+ * @return int 0 en cas de succès, -1 en cas d'erreur.
+ */
+static int flash_pipe_erase_range(uint32_t address, uint32_t count)
+{
+    uint32_t start_time = get_time_us();
+
+    /* L'image installée n'est plus valide dès sa première modification */
+    if (!flash_pipe.invalidated)
+    {
+        if (image_invalidate() != IMAGE_OK)
+        {
+            return -1;
+        }
+        flash_pipe.invalidated = true;
+    }
+    if (((count == 1U) ? flash_erase_page(address) : flash_erase_pages(address, count)) != 0)
+    {
+        return -1;
+    }
+    flash_pipe.erased_start = address;
+    flash_pipe.erased_end = address + (count * FLASH_PAGE_SIZE);
+    v_flash_pipe_stats.erase_us += get_time_us() - start_time;
+    return 0;
+}
+
+/**
+ * @brief Efface la page d'un tampon, ou toute la plage annoncée s'il en est la première page.
+ *
+ * @param[in,out] slot Tampon dont la page doit être effacée.
+ * @return int 0 en cas de succès, -1 en cas d'erreur.
+ */
+static int flash_pipe_erase_slot(flash_slot_t *slot)
+{
+    uint32_t count = 1U;
+
+    if (slot->erased || ((slot->address >= flash_pipe.erased_start) && (slot->address < flash_pipe.erased_end)))
+    {
+        /* Page déjà effacée, seule ou avec toute la plage de l'image */
+        slot->erased = true;
+        return 0;
+    }
+    if (flash_pipe.erase_end >= slot->address)
+    {
+        count = ((flash_pipe.erase_end - slot->address) / FLASH_PAGE_SIZE) + 1U;
+        flash_pipe.erase_end = 0U;
+    }
+    if (flash_pipe_erase_range(slot->address, count) != 0)
+    {
+        return -1;
+    }
+    slot->erased = true;
+    return 0;
+}
+
+/**
+ * @brief Passe le pipeline en erreur jusqu'à la prochaine initialisation.
+ *
+ * @return int FLASH_PIPE_ERROR.
+ */
+static int flash_pipe_fail(void)
+{
+    flash_pipe.status = FLASH_PIPE_ERROR;
+    flash_pipe.stage = FLASH_STAGE_IDLE;
+    v_flash_pipe_stats.errors++;
+    return FLASH_PIPE_ERROR;
+}
+
+/**
+ * @brief Interrompt l'écriture à la demande de l'appelant (données reçues invalides).
+ *
+ * Le pipeline passe en erreur : la boucle de réception l'apprend par flash_pipe_poll()
+ * et annule la session.
+ */
+void flash_pipe_abort(void)
+{
+    (void)flash_pipe_fail();
+}
+
+/**
+ * @brief Copie des données dans les tampons de préparation libres.
+ *
+ * La fonction ne bloque pas : elle accepte autant d'octets que les tampons libres
+ * peuvent en contenir et retourne ce nombre (0 si tous les tampons sont occupés).
+ *
+ * @param[in] data   Pointeur sur les données à écrire.
+ * @param[in] length Nombre d'octets à écrire.
+ * @return int Nombre d'octets acceptés, FLASH_PIPE_ERROR en cas d'erreur.
+ */
+int flash_pipe_write(const uint8_t *data, uint32_t length)
+{
+    flash_slot_t *slot;
+    uint32_t accepted = 0U;
+    uint32_t n;
+
+    if ((data == NULL) || (flash_pipe.status != FLASH_PIPE_OK))
+    {
+        return FLASH_PIPE_ERROR;
+    }
+
+    while (accepted < length)
+    {
+        slot = &flash_pipe.slot[flash_pipe.fill];
+        if (slot->state == FLASH_SLOT_FREE)
+        {
+            /* Protection de la zone située après la fin autorisée */
+            if ((flash_pipe.address + FLASH_PAGE_SIZE - 1U) > flash_pipe.end_address)
+            {
+                return flash_pipe_fail();
+            }
+            slot->address = flash_pipe.address;
+            slot->length = 0U;
+            slot->erased = false;
+            slot->state = FLASH_SLOT_FILLING;
+            flash_pipe.address += FLASH_PAGE_SIZE;
+        }
+        if (slot->state != FLASH_SLOT_FILLING)
+        {
+            /* Tous les tampons sont occupés */
+            break;
+        }
+
+        n = FLASH_PAGE_SIZE - slot->length;
+        if (n > (length - accepted))
+        {
+            n = length - accepted;
+        }
+        (void)memcpy(&slot->data[slot->length], &data[accepted], n);
+        slot->length += n;
+        accepted += n;
+
+        if (slot->length == FLASH_PAGE_SIZE)
+        {
+            slot->state = FLASH_SLOT_READY;
+            flash_pipe.fill = (flash_pipe.fill + 1U) % FLASH_PIPE_SLOTS;
+        }
+    }
+    return (int)accepted;
+}
+
+/**
+ * @brief Copie toutes les données dans le pipeline en attendant qu'un tampon se libère.
+ *
+ * @param[in] data   Pointeur sur les données à écrire.
+ * @param[in] length Nombre d'octets à écrire.
+ * @return int FLASH_PIPE_OK en cas de succès, FLASH_PIPE_ERROR en cas d'erreur.
+ */
+int flash_pipe_write_all(const uint8_t *data, uint32_t length)
+{
+    uint32_t start_time = 0U;
+    bool stalled = false;
+    int n;
+
+    while (length > 0U)
+    {
+        n = flash_pipe_write(data, length);
+        if (n < 0)
+        {
+            return FLASH_PIPE_ERROR;
+        }
+        data += n;
+        length -= (uint32_t)n;
+
+        if (length > 0U)
+        {
+            if (!stalled)
+            {
+                stalled = true;
+                start_time = get_time_us();
+            }
+            if (flash_pipe_poll() == FLASH_PIPE_ERROR)
+            {
+                return FLASH_PIPE_ERROR;
+            }
+        }
+    }
+
+    if (stalled)
+    {
+        v_flash_pipe_stats.stall_us += get_time_us() - start_time;
+    }
+    return FLASH_PIPE_OK;
+}
+
+/**
+ * @brief Fait avancer d'une étape le traitement de la page en cours.
+ *
+ * Chaque appel effectue au plus une étape courte : effacement de la page,
+ * programmation de FLASH_PIPE_PROGRAM_CHUNK doubles mots, ou vérification.
+ * À appeler régulièrement depuis la boucle de réception.
+ *
+ * @return int FLASH_PIPE_OK si aucune page n'est en attente, FLASH_PIPE_BUSY si des
+ *             pages restent à traiter, FLASH_PIPE_ERROR en cas d'erreur.
+ */
+int flash_pipe_poll(void)
+{
+    flash_slot_t *slot = &flash_pipe.slot[flash_pipe.work];
+    uint32_t start_time;
+    uint32_t n;
+    int ret;
+
+    if (flash_pipe.status != FLASH_PIPE_OK)
+    {
+        return FLASH_PIPE_ERROR;
+    }
+
+    start_time = get_time_us();
+    switch (flash_pipe.stage)
+    {
+    case FLASH_STAGE_IDLE:
+        if (slot->state != FLASH_SLOT_READY)
+        {
+            return FLASH_PIPE_OK;
+        }
+        slot->state = FLASH_SLOT_BUSY;
+        flash_pipe.offset = 0U;
+        flash_pipe.stage = FLASH_STAGE_ERASE;
+        break;
+
+    case FLASH_STAGE_ERASE:
+        if (flash_pipe_erase_slot(slot) != 0)
+        {
+            return flash_pipe_fail();
+        }
+        flash_pipe.stage = FLASH_STAGE_PROGRAM;
+        break;
+
+    case FLASH_STAGE_PROGRAM:
+        n = slot->length - flash_pipe.offset;
+        if (n > (FLASH_PIPE_PROGRAM_CHUNK * sizeof(uint64_t)))
+        {
+            n = FLASH_PIPE_PROGRAM_CHUNK * sizeof(uint64_t);
+        }
+        ret = flash_program_rows(slot->address + flash_pipe.offset, &slot->data[flash_pipe.offset], n);
+        if (ret < 0)
+        {
+            return flash_pipe_fail();
+        }
+        v_flash_pipe_stats.blank_rows += (uint32_t)ret;
+        flash_pipe.offset += n;
+        v_flash_pipe_stats.program_us += get_time_us() - start_time;
+        if (flash_pipe.offset >= slot->length)
+        {
+            flash_pipe.stage = FLASH_STAGE_VERIFY;
+        }
+        break;
+
+    case FLASH_STAGE_VERIFY:
+    default:
+        if (memcmp(slot->data, (const void *)slot->address, slot->length) != 0)
+        {
+            return flash_pipe_fail();
+        }
+        v_flash_pipe_stats.verify_us += get_time_us() - start_time;
+        v_flash_pipe_stats.pages++;
+        image_journal_page(slot->address);
+        slot->state = FLASH_SLOT_FREE;
+        slot->length = 0U;
+        flash_pipe.work = (flash_pipe.work + 1U) % FLASH_PIPE_SLOTS;
+        flash_pipe.stage = FLASH_STAGE_IDLE;
+        if (flash_pipe.slot[flash_pipe.work].state != FLASH_SLOT_READY)
+        {
+            return FLASH_PIPE_OK;
+        }
+        break;
+    }
+    return FLASH_PIPE_BUSY;
+}
+
+/**
+ * @brief Efface sans attendre les pages des tampons pleins, avant que l'émetteur ne reprenne.
+ *
+ * À appeler par les récepteurs stop-and-wait avant l'acquittement d'un bloc : la
+ * ligne est silencieuse pendant l'effacement (22 ms par page, ou toute la plage
+ * annoncée par flash_pipe_erase_ahead()) et aucun octet n'est perdu. La
+ * programmation et la vérification restent faites par flash_pipe_poll() pendant
+ * la réception du bloc suivant. Seules les pages dont le contenu est complet sont
+ * effacées : l'application installée reste lisible pour un patch (delta.h).
+ *
+ * @return int FLASH_PIPE_OK en cas de succès, FLASH_PIPE_ERROR en cas d'erreur.
+ */
+int flash_pipe_prepare(void)
+{
+    flash_slot_t *slot;
+    uint32_t i;
+
+    if (flash_pipe.status != FLASH_PIPE_OK)
+    {
+        return FLASH_PIPE_ERROR;
+    }
+    /* Tampons dans l'ordre d'écriture, à partir de celui en cours de traitement */
+    for (i = 0U; i < FLASH_PIPE_SLOTS; i++)
+    {
+        slot = &flash_pipe.slot[(flash_pipe.work + i) % FLASH_PIPE_SLOTS];
+        if ((slot->state == FLASH_SLOT_READY) || (slot->state == FLASH_SLOT_BUSY))
+        {
+            if (flash_pipe_erase_slot(slot) != 0)
+            {
+                return flash_pipe_fail();
+            }
+        }
+    }
+    return FLASH_PIPE_OK;
+}
+
+/**
+ * @brief Efface immédiatement les pages de la prochaine page à préparer jusqu'à une adresse.
+ *
+ * Pour les réceptions en streaming sur une liaison sans contrôle de flux (USART2) :
+ * l'émetteur ne s'arrête jamais, la plage doit donc être effacée avant le
+ * démarrage du flux. Les pages de la plage ne sont plus effacées ensuite ; elles
+ * doivent être écrites dans l'ordre (pas de flash_pipe_seek()).
+ *
+ * @param[in] end_address Dernier octet à effacer (borné à la zone autorisée).
+ * @return int FLASH_PIPE_OK en cas de succès, FLASH_PIPE_ERROR en cas d'erreur.
+ */
+int flash_pipe_preerase(uint32_t end_address)
+{
+    if (flash_pipe.status != FLASH_PIPE_OK)
+    {
+        return FLASH_PIPE_ERROR;
+    }
+    if (end_address > flash_pipe.end_address)
+    {
+        end_address = flash_pipe.end_address;
+    }
+    if (end_address < flash_pipe.address)
+    {
+        return FLASH_PIPE_OK;
+    }
+    if (flash_pipe_erase_range(flash_pipe.address, ((end_address - flash_pipe.address) / FLASH_PAGE_SIZE) + 1U) != 0)
+    {
+        return flash_pipe_fail();
+    }
+    flash_pipe.erase_end = 0U;
+    return FLASH_PIPE_OK;
+}
+
+/**
+ * @brief Indique si une page a été effacée par le pipeline depuis son initialisation.
+ *
+ * @param[in] address Adresse dans la page.
+ * @return bool true si la page fait partie de la dernière plage effacée.
+ */
+bool flash_pipe_is_erased(uint32_t address)
+{
+    return (address >= flash_pipe.erased_start) && (address < flash_pipe.erased_end);
+}
+
+/**
+ * @brief Choisit l'adresse de la prochaine page à préparer.
+ *
+ * Permet d'écrire les pages dans un ordre quelconque (application d'un patch).
+ * La page en cours de remplissage doit être complète.
+ *
+ * @param[in] address Adresse de la page (alignée sur une page).
+ * @return int FLASH_PIPE_OK, ou FLASH_PIPE_ERROR si l'adresse n'est pas alignée ou
+ *             si une page est en cours de remplissage.
+ */
+int flash_pipe_seek(uint32_t address)
+{
+    if ((flash_pipe.status != FLASH_PIPE_OK) || ((address % FLASH_PAGE_SIZE) != 0U)
+        || (flash_pipe.slot[flash_pipe.fill].state == FLASH_SLOT_FILLING))
+    {
+        return flash_pipe_fail();
+    }
+    flash_pipe.address = address;
+    return FLASH_PIPE_OK;
+}
+
+/**
+ * @brief Écrit le tampon partiellement rempli et attend la fin de toutes les pages.
+ *
+ * Le dernier double mot incomplet est complété par 0xFF.
+ *
+ * @return int FLASH_PIPE_OK si toutes les pages sont écrites et vérifiées, FLASH_PIPE_ERROR sinon.
+ */
+int flash_pipe_flush(void)
+{
+    flash_slot_t *slot = &flash_pipe.slot[flash_pipe.fill];
+    uint32_t padded;
+    int ret;
+
+    if (slot->state == FLASH_SLOT_FILLING)
+    {
+        padded = (slot->length + sizeof(uint64_t) - 1U) & ~(uint32_t)(sizeof(uint64_t) - 1U);
+        (void)memset(&slot->data[slot->length], 0xFF, padded - slot->length);
+        slot->length = padded;
+        slot->state = (padded != 0U) ? FLASH_SLOT_READY : FLASH_SLOT_FREE;
+        flash_pipe.fill = (flash_pipe.fill + 1U) % FLASH_PIPE_SLOTS;
+    }
+
+    do
+    {
+        ret = flash_pipe_poll();
+    } while (ret == FLASH_PIPE_BUSY);
+
+    return ret;
+}
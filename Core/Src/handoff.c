@@ -0,0 +1,155 @@
+#include "inc.h"
+
+/**
+ * @file handoff.c
+ * @brief Boîte aux lettres bootloader/application dans les registres de sauvegarde TAMP.
+ *
+ * Remplace l'écriture de "TOOB" dans la page de configuration à chaque lancement de
+ * l'application : la boîte aux lettres (voir handoff.h) transmet la cause de
+ * réinitialisation, les indicateurs et les versions sans écriture en flash.
+ */
+
+/** Premier registre de sauvegarde de la boîte aux lettres. */
+#define HANDOFF_BKP     (&TAMP->BKP0R + HANDOFF_BKP_FIRST)
+
+/** État relevé au démarrage et indicateurs à transmettre à l'application. */
+static uint8_t handoff_reset_cause = HANDOFF_RESET_POWER;
+static uint16_t handoff_flags = 0U;
+static bool handoff_requested = false;
+
+
+/**
+ * @brief Calcule le CRC32 de la boîte aux lettres (champs précédant crc32).
+ */
+static uint32_t handoff_crc32(const handoff_t *mailbox)
+{
+    return crc32_final(crc32_update(crc32_init(), (const uint8_t *)mailbox, offsetof(handoff_t, crc32)));
+}
+
+/**
+ * @brief Lit la boîte aux lettres.
+ *
+ * @param[out] mailbox Contenu lu.
+ * @return int HANDOFF_OK si la signature et le CRC sont valides, HANDOFF_ERROR sinon.
+ */
+static int handoff_read(handoff_t *mailbox)
+{
+    uint32_t words[HANDOFF_WORDS];
+    uint32_t i;
+
+    __HAL_RCC_RTCAPB_CLK_ENABLE();
+    for (i = 0U; i < HANDOFF_WORDS; i++)
+    {
+        words[i] = HANDOFF_BKP[i];
+    }
+    (void)memcpy(mailbox, words, sizeof(*mailbox));
+    if ((mailbox->magic != HANDOFF_MAGIC) || (handoff_crc32(mailbox) != mailbox->crc32))
+    {
+        return HANDOFF_ERROR;
+    }
+    return HANDOFF_OK;
+}
+
+/**
+ * @brief Écrit la boîte aux lettres (le CRC est calculé ici).
+ *
+ * @param[in,out] mailbox Contenu à écrire.
+ */
+static void handoff_write(handoff_t *mailbox)
+{
+    uint32_t words[HANDOFF_WORDS];
+    uint32_t i;
+
+    mailbox->magic = HANDOFF_MAGIC;
+    mailbox->crc32 = handoff_crc32(mailbox);
+    (void)memcpy(words, mailbox, sizeof(words));
+
+    __HAL_RCC_PWR_CLK_ENABLE();
+    __HAL_RCC_RTCAPB_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    for (i = 0U; i < HANDOFF_WORDS; i++)
+    {
+        HANDOFF_BKP[i] = words[i];
+    }
+    HAL_PWR_DisableBkUpAccess();
+}
+
+/**
+ * @brief Relève la cause de réinitialisation et la demande éventuelle de l'application.
+ *
+ * À appeler une fois au démarrage. Les indicateurs de RCC_CSR sont effacés pour que
+ * la cause suivante soit exacte. La demande d'entrée dans le bootloader est
+ * consommée : elle ne vaut que pour ce démarrage.
+ */
+void handoff_init(void)
+{
+    handoff_t mailbox;
+    uint32_t csr = RCC->CSR;
+
+    if ((csr & (RCC_CSR_IWDGRSTF | RCC_CSR_WWDGRSTF)) != 0U)
+    {
+        handoff_reset_cause = HANDOFF_RESET_WATCHDOG;
+    }
+    else if ((csr & RCC_CSR_BORRSTF) != 0U)
+    {
+        handoff_reset_cause = HANDOFF_RESET_POWER;
+    }
+    else if ((csr & RCC_CSR_SFTRSTF) != 0U)
+    {
+        handoff_reset_cause = HANDOFF_RESET_SOFTWARE;
+    }
+    else if ((csr & RCC_CSR_PINRSTF) != 0U)
+    {
+        handoff_reset_cause = HANDOFF_RESET_PIN;
+    }
+    else
+    {
+        handoff_reset_cause = HANDOFF_RESET_OTHER;
+    }
+    RCC->CSR |= RCC_CSR_RMVF;
+
+    if ((handoff_read(&mailbox) == HANDOFF_OK)
+        && ((mailbox.flags & HANDOFF_FLAG_ENTER_BOOTLOADER) != 0U))
+    {
+        handoff_requested = true;
+        mailbox.flags &= (uint16_t)~HANDOFF_FLAG_ENTER_BOOTLOADER;
+        handoff_write(&mailbox);
+    }
+}
+
+/**
+ * @brief Indique si l'application a demandé l'entrée dans le bootloader.
+ *
+ * @return bool true si HANDOFF_FLAG_ENTER_BOOTLOADER était présent au démarrage.
+ */
+bool handoff_bootloader_requested(void)
+{
+    return handoff_requested;
+}
+
+/**
+ * @brief Ajoute des indicateurs à transmettre à l'application au prochain lancement.
+ *
+ * @param[in] flags HANDOFF_FLAG_xxx.
+ */
+void handoff_set_flags(uint16_t flags)
+{
+    handoff_flags |= flags;
+}
+
+/**
+ * @brief Écrit la boîte aux lettres destinée à l'application, juste avant le saut.
+ */
+void handoff_publish(void)
+{
+    const image_header_t *header = image_get_header();
+    handoff_t mailbox;
+
+    mailbox.reset_cause = handoff_reset_cause;
+    mailbox.reserved = 0U;
+    mailbox.flags = handoff_flags;
+    mailbox.bootloader_version = ((uint32_t)L_MAJEUR_VERSION << 16U) | ((uint32_t)L_MINEUR_VERSION << 8U)
+                               | (uint32_t)L_RELEASE_VERSION;
+    mailbox.application_version = (header != NULL) ? header->version : 0U;
+    handoff_write(&mailbox);
+}
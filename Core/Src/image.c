@@ -0,0 +1,408 @@
+#include "inc.h"
+
+/**
+ * @file image.c
+ * @brief Contrôle d'intégrité de l'application : en-tête, vérification et marqueur.
+ *
+ * Page IMAGE_INFO_ADDRESS :
+ *
+ *     0  : image_header_t (32 octets) | image_marker_t (8 octets)
+ *     48 : marqueur de mise à jour en cours (double mot IMAGE_UPDATE_MAGIC)
+ *     64 : journal de reprise : en-tête de l'image en cours d'écriture (32 octets),
+ *          puis une entrée image_journal_entry_t par page vérifiée
+ *
+ * La page est effacée avant que la première page de l'application soit modifiée,
+ * puis réécrite une fois la nouvelle image vérifiée. Une mise à jour interrompue
+ * laisse donc la page effacée et le bootloader reste actif. Le marqueur est
+ * programmé après l'en-tête : s'il manque, l'image est vérifiée une seule fois au
+ * démarrage suivant et le marqueur est alors ajouté.
+ *
+ * Pendant une mise à jour, l'en-tête de l'image installée est effacé : la fin de la
+ * page sert de journal des pages écrites et vérifiées, pour reprendre un transfert
+ * interrompu (voir image.h). Le journal disparaît avec l'enregistrement de l'image.
+ *
+ * Application installée avant l'introduction de cette page (ancien bootloader,
+ * programmation par SWD) : la page est entièrement vierge. L'application est alors
+ * lancée sur le seul contrôle de sa table des vecteurs (image_legacy_check()), et
+ * reçoit un en-tête à sa prochaine mise à jour. Le marqueur de mise à jour en cours,
+ * programmé dès l'invalidation, empêche qu'une mise à jour interrompue soit prise
+ * pour une telle application.
+ */
+
+/** En-tête et marqueur enregistrés. */
+#define IMAGE_INFO_HEADER   ((const image_header_t *)IMAGE_INFO_ADDRESS)
+#define IMAGE_INFO_MARKER   ((const image_marker_t *)(IMAGE_INFO_ADDRESS + IMAGE_HEADER_SIZE))
+
+/** Marqueur de mise à jour en cours : la page n'est plus celle d'une application sans en-tête. */
+#define IMAGE_UPDATE_ADDRESS    (IMAGE_INFO_ADDRESS + 48U)
+#define IMAGE_UPDATE_MAGIC      (0x50445055UL)  /**< "UPDP" en petit-boutiste, deux fois */
+
+/** Journal de reprise : en-tête de l'image en cours d'écriture puis entrées. */
+#define IMAGE_JOURNAL_ADDRESS   (IMAGE_INFO_ADDRESS + 64U)
+#define IMAGE_JOURNAL_HEADER    ((const image_header_t *)IMAGE_JOURNAL_ADDRESS)
+#define IMAGE_JOURNAL_ENTRIES   ((const image_journal_entry_t *)(IMAGE_JOURNAL_ADDRESS + IMAGE_HEADER_SIZE))
+#define IMAGE_JOURNAL_CAPACITY  ((FLASH_PAGE_SIZE - 64U - IMAGE_HEADER_SIZE) / sizeof(image_journal_entry_t))
+#define IMAGE_JOURNAL_MAGIC     (0x4A500000UL)  /**< Entrée : "PJ" + numéro de page sur 16 bits */
+
+/**
+ * @brief Entrée du journal : page vérifiée et CRC32 de son contenu.
+ */
+typedef struct
+{
+    uint32_t page;      /**< IMAGE_JOURNAL_MAGIC | numéro de page dans l'image. */
+    uint32_t crc32;     /**< CRC32 de la page. */
+} image_journal_entry_t;
+
+/** Journal en cours d'écriture et prochaine entrée libre. */
+static bool image_journal_active = false;
+static uint32_t image_journal_next;
+
+
+/**
+ * @brief Calcule le CRC32 d'une zone de la flash ou de la RAM.
+ */
+static uint32_t image_crc32(const void *data, uint32_t length)
+{
+    return crc32_final(crc32_update(crc32_init(), (const uint8_t *)data, length));
+}
+
+/**
+ * @brief Contrôle la cohérence d'un en-tête (signature, CRC, adresse et taille).
+ *
+ * @param[in] header En-tête à contrôler.
+ * @return int IMAGE_OK si l'en-tête décrit une image de la zone application, IMAGE_ERROR sinon.
+ */
+int image_header_check(const image_header_t *header)
+{
+    if ((header->magic != IMAGE_HEADER_MAGIC)
+        || (header->load_address != APPLICATION_ADDRESS)
+        || (header->length == 0U)
+        || (header->length > (FLASH_APP_END_ADDRESS - APPLICATION_ADDRESS + 1U))
+        || (image_crc32(header, IMAGE_HEADER_CRC_SIZE) != header->header_crc))
+    {
+        return IMAGE_ERROR;
+    }
+    return IMAGE_OK;
+}
+
+/**
+ * @brief Programme le marqueur de mise à jour en cours dans la page d'information effacée.
+ *
+ * @return int IMAGE_OK en cas de succès ou si le marqueur est déjà présent, IMAGE_ERROR sinon.
+ */
+static int image_mark_update(void)
+{
+    const uint32_t *mark = (const uint32_t *)IMAGE_UPDATE_ADDRESS;
+    uint32_t value[2];
+    fifo_span_t span;
+
+    if ((mark[0] == IMAGE_UPDATE_MAGIC) && (mark[1] == IMAGE_UPDATE_MAGIC))
+    {
+        return IMAGE_OK;
+    }
+    value[0] = IMAGE_UPDATE_MAGIC;
+    value[1] = IMAGE_UPDATE_MAGIC;
+    span.data[0] = (const uint8_t *)value;
+    span.length[0] = sizeof(value);
+    span.data[1] = NULL;
+    span.length[1] = 0U;
+    return (flash_program_span(IMAGE_UPDATE_ADDRESS, &span) == 0) ? IMAGE_OK : IMAGE_ERROR;
+}
+
+/**
+ * @brief Invalide l'image installée avant sa modification.
+ *
+ * L'en-tête est effacé et le marqueur de mise à jour en cours est programmé : une
+ * coupure avant image_commit() laisse le bootloader actif.
+ *
+ * @return int IMAGE_OK en cas de succès, IMAGE_ERROR si l'effacement a échoué.
+ */
+int image_invalidate(void)
+{
+    if (IMAGE_INFO_HEADER->magic != 0xFFFFFFFFUL)
+    {
+        image_journal_active = false;
+        if (flash_erase_page(IMAGE_INFO_ADDRESS) != 0)
+        {
+            return IMAGE_ERROR;
+        }
+    }
+    /* En-tête déjà effacé : le journal éventuel est conservé */
+    return image_mark_update();
+}
+
+/**
+ * @brief Contrôle une application installée sans en-tête (page d'information vierge).
+ *
+ * Aucun CRC n'est disponible : seule la table des vecteurs est contrôlée (pointeur
+ * de pile en RAM, vecteur de reset Thumb dans la zone application).
+ *
+ * @return int IMAGE_OK si l'application peut être lancée, IMAGE_ERROR sinon.
+ */
+static int image_legacy_check(void)
+{
+    const uint32_t *info = (const uint32_t *)IMAGE_INFO_ADDRESS;
+    const uint32_t *vectors = (const uint32_t *)APPLICATION_ADDRESS;
+    uint32_t i;
+
+    /* Page vierge : ni en-tête, ni marqueur de mise à jour, ni journal */
+    for (i = 0U; i < (FLASH_PAGE_SIZE / sizeof(uint32_t)); i++)
+    {
+        if (info[i] != 0xFFFFFFFFUL)
+        {
+            return IMAGE_ERROR;
+        }
+    }
+    if (((vectors[0] & 0x2FFE0000U) != 0x20000000U)
+        || ((vectors[1] & 1U) == 0U)
+        || (vectors[1] < APPLICATION_ADDRESS)
+        || (vectors[1] >= IMAGE_INFO_ADDRESS))
+    {
+        return IMAGE_ERROR;
+    }
+    return IMAGE_OK;
+}
+
+/**
+ * @brief Programme le marqueur de vérification après l'en-tête enregistré.
+ */
+static int image_write_marker(uint32_t crc)
+{
+    image_marker_t marker;
+    fifo_span_t span;
+
+    marker.magic = IMAGE_VERIFIED_MAGIC;
+    marker.crc32 = crc;
+    span.data[0] = (const uint8_t *)&marker;
+    span.length[0] = sizeof(marker);
+    span.data[1] = NULL;
+    span.length[1] = 0U;
+    return (flash_program_span(IMAGE_INFO_ADDRESS + IMAGE_HEADER_SIZE, &span) == 0) ? IMAGE_OK : IMAGE_ERROR;
+}
+
+/**
+ * @brief Vérifie la nouvelle image en flash et l'enregistre comme valide.
+ *
+ * Sans en-tête (image transférée sans en-tête), un en-tête est construit à partir
+ * des octets écrits : l'intégrité du transfert repose alors sur les CRC des blocs,
+ * et le CRC32 enregistré ne protège que contre une altération ultérieure.
+ *
+ * @param[in] header En-tête reçu avec l'image, ou NULL.
+ * @param[in] length Nombre d'octets de l'image écrits en flash.
+ * @return int IMAGE_OK si l'image est conforme et enregistrée, IMAGE_ERROR sinon.
+ */
+int image_commit(const image_header_t *header, uint32_t length)
+{
+    image_header_t info;
+    fifo_span_t span;
+
+    if (header != NULL)
+    {
+        info = *header;
+        if ((image_header_check(&info) != IMAGE_OK) || (info.length > length)
+            || (image_crc32((const void *)APPLICATION_ADDRESS, info.length) != info.crc32))
+        {
+            return IMAGE_ERROR;
+        }
+    }
+    else
+    {
+        info.magic = IMAGE_HEADER_MAGIC;
+        info.load_address = APPLICATION_ADDRESS;
+        info.length = length;
+        info.crc32 = image_crc32((const void *)APPLICATION_ADDRESS, length);
+        info.version = 0U;
+        info.flags = 0U;
+        info.reserved = 0xFFFFFFFFUL;
+        info.header_crc = image_crc32(&info, IMAGE_HEADER_CRC_SIZE);
+        if (image_header_check(&info) != IMAGE_OK)
+        {
+            return IMAGE_ERROR;
+        }
+    }
+
+    image_journal_active = false;
+    span.data[0] = (const uint8_t *)&info;
+    span.length[0] = sizeof(info);
+    span.data[1] = NULL;
+    span.length[1] = 0U;
+    if ((flash_erase_page(IMAGE_INFO_ADDRESS) != 0)
+        || (flash_program_span(IMAGE_INFO_ADDRESS, &span) != 0))
+    {
+        return IMAGE_ERROR;
+    }
+    if (image_write_marker(info.crc32) != IMAGE_OK)
+    {
+        return IMAGE_ERROR;
+    }
+    handoff_set_flags(HANDOFF_FLAG_UPDATED);
+    return IMAGE_OK;
+}
+
+/**
+ * @brief Indique si l'application installée peut être lancée.
+ *
+ * Cas normal : en-tête et marqueur présents, contrôle en temps constant (32 octets).
+ * En-tête sans marqueur (coupure après l'enregistrement de l'en-tête) : l'image est
+ * vérifiée une fois et le marqueur est programmé. Page d'information vierge :
+ * application installée sans en-tête, voir image_legacy_check().
+ *
+ * @return int IMAGE_OK si l'image est valide, IMAGE_ERROR sinon.
+ */
+int image_check(void)
+{
+    const image_header_t *header = IMAGE_INFO_HEADER;
+    const image_marker_t *marker = IMAGE_INFO_MARKER;
+
+    if (image_header_check(header) != IMAGE_OK)
+    {
+        return image_legacy_check();
+    }
+
+    if ((marker->magic != IMAGE_VERIFIED_MAGIC) || (marker->crc32 != header->crc32))
+    {
+        if ((marker->magic != 0xFFFFFFFFUL) || (marker->crc32 != 0xFFFFFFFFUL)
+            || (image_crc32((const void *)APPLICATION_ADDRESS, header->length) != header->crc32)
+            || (image_write_marker(header->crc32) != IMAGE_OK))
+        {
+            return IMAGE_ERROR;
+        }
+    }
+
+    /* Le premier mot de la table des vecteurs doit être un pointeur de pile en RAM */
+    if (((*(const uint32_t *)APPLICATION_ADDRESS) & 0x2FFE0000U) != 0x20000000U)
+    {
+        return IMAGE_ERROR;
+    }
+    return IMAGE_OK;
+}
+
+/**
+ * @brief Vérifie complètement l'application installée.
+ *
+ * Contrairement à image_check(), le CRC32 de toute l'image est recalculé depuis
+ * la flash, même si le marqueur de vérification est présent. Une application sans
+ * en-tête ne peut pas être vérifiée.
+ *
+ * @return int IMAGE_OK si l'image est valide, IMAGE_ERROR sinon.
+ */
+int image_verify(void)
+{
+    const image_header_t *header = IMAGE_INFO_HEADER;
+
+    if ((image_header_check(header) != IMAGE_OK) || (image_check() != IMAGE_OK)
+        || (image_crc32((const void *)APPLICATION_ADDRESS, header->length) != header->crc32))
+    {
+        return IMAGE_ERROR;
+    }
+    return IMAGE_OK;
+}
+
+/**
+ * @brief Retourne l'en-tête de l'application installée.
+ *
+ * @return const image_header_t* En-tête enregistré, ou NULL s'il est absent ou invalide.
+ */
+const image_header_t *image_get_header(void)
+{
+    return (image_header_check(IMAGE_INFO_HEADER) == IMAGE_OK) ? IMAGE_INFO_HEADER : NULL;
+}
+
+/**
+ * @brief Démarre le journal de reprise d'une image, ou reprend celui d'un transfert interrompu.
+ *
+ * Si le journal enregistré concerne la même image (en-tête identique), les pages
+ * journalisées dont le contenu en flash correspond toujours à leur CRC32 sont
+ * comptées à partir de la première. Sinon, l'application installée est invalidée
+ * et un nouveau journal est créé.
+ *
+ * @param[in] header En-tête de l'image reçue.
+ * @return int Nombre de pages déjà écrites et vérifiées à partir du début de
+ *             l'image, ou IMAGE_ERROR si le journal n'a pas pu être créé.
+ */
+int image_journal_begin(const image_header_t *header)
+{
+    const image_journal_entry_t *entry = IMAGE_JOURNAL_ENTRIES;
+    uint32_t entries = 0U;
+    uint32_t pages = 0U;
+    uint32_t crc;
+    uint32_t i;
+    bool found = true;
+    fifo_span_t span;
+
+    if ((IMAGE_INFO_HEADER->magic == 0xFFFFFFFFUL)
+        && (memcmp(IMAGE_JOURNAL_HEADER, header, sizeof(image_header_t)) == 0))
+    {
+        while ((entries < IMAGE_JOURNAL_CAPACITY) && (entry[entries].page != 0xFFFFFFFFUL))
+        {
+            entries++;
+        }
+        /* Pages consécutives depuis le début, dans n'importe quel ordre du journal */
+        while (found && ((pages * FLASH_PAGE_SIZE) < header->length))
+        {
+            crc = image_crc32((const void *)(APPLICATION_ADDRESS + (pages * FLASH_PAGE_SIZE)), FLASH_PAGE_SIZE);
+            found = false;
+            for (i = 0U; i < entries; i++)
+            {
+                if ((entry[i].page == (IMAGE_JOURNAL_MAGIC | pages)) && (entry[i].crc32 == crc))
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (found)
+            {
+                pages++;
+            }
+        }
+        image_journal_next = entries;
+        image_journal_active = true;
+        return (int)pages;
+    }
+
+    span.data[0] = (const uint8_t *)header;
+    span.length[0] = sizeof(image_header_t);
+    span.data[1] = NULL;
+    span.length[1] = 0U;
+    if ((flash_erase_page(IMAGE_INFO_ADDRESS) != 0)
+        || (image_mark_update() != IMAGE_OK)
+        || (flash_program_span(IMAGE_JOURNAL_ADDRESS, &span) != 0))
+    {
+        return IMAGE_ERROR;
+    }
+    image_journal_next = 0U;
+    image_journal_active = true;
+    return 0;
+}
+
+/**
+ * @brief Inscrit une page écrite et vérifiée dans le journal de reprise.
+ *
+ * Sans journal actif (image compressée, patch, transfert sans reprise), l'appel est
+ * ignoré. Une erreur d'écriture du journal n'interrompt pas la mise à jour : elle
+ * limite seulement une reprise ultérieure.
+ *
+ * @param[in] address Adresse de la page en flash.
+ */
+void image_journal_page(uint32_t address)
+{
+    image_journal_entry_t entry;
+    fifo_span_t span;
+
+    if (!image_journal_active || (image_journal_next >= IMAGE_JOURNAL_CAPACITY)
+        || (address < APPLICATION_ADDRESS))
+    {
+        return;
+    }
+    entry.page = IMAGE_JOURNAL_MAGIC | ((address - APPLICATION_ADDRESS) / FLASH_PAGE_SIZE);
+    entry.crc32 = image_crc32((const void *)address, FLASH_PAGE_SIZE);
+    span.data[0] = (const uint8_t *)&entry;
+    span.length[0] = sizeof(entry);
+    span.data[1] = NULL;
+    span.length[1] = 0U;
+    if (flash_program_span(IMAGE_JOURNAL_ADDRESS + IMAGE_HEADER_SIZE + (image_journal_next * sizeof(entry)), &span) != 0)
+    {
+        image_journal_active = false;
+    }
+    image_journal_next++;
+}
@@ -0,0 +1,288 @@
+#include "inc.h"
+
+/**
+ * @file kvlog.c
+ * @brief Journal de configuration : enregistrements clé/valeur ajoutés en flash.
+ *
+ * Chaque modification d'un champ de configuration ajoute un enregistrement de
+ * 8 octets (un seul double mot programmé, sans effacement) à la page active :
+ *
+ *     page  : kvlog_page_header_t (8 octets) | 255 emplacements kvlog_record_t
+ *     record: étiquette | clé (2) | CRC16 de l'étiquette et de la valeur (2) | valeur (4)
+ *
+ * Le dernier enregistrement valide d'une clé l'emporte. Un enregistrement dont le
+ * CRC est faux (coupure pendant la programmation) est ignoré ; son emplacement
+ * n'est pas réutilisé.
+ *
+ * Lorsque la page active est pleine, les dernières valeurs sont recopiées dans
+ * l'autre page, dont l'en-tête est programmé en dernier avec une génération
+ * incrémentée : une coupure pendant le compactage laisse l'ancienne page active.
+ * L'ancienne page n'est effacée qu'au compactage suivant. Chaque page n'est donc
+ * effacée qu'une fois tous les 2 x 255 enregistrements environ.
+ *
+ * Au démarrage, kvlog_init() parcourt la page active et construit l'index RAM
+ * (dernière valeur de chaque clé) : kvlog_get() est ensuite en temps constant.
+ */
+
+#define KVLOG_PAGE_MAGIC    (0x474C564BUL)  /**< "KVLG" */
+#define KVLOG_RECORD_TAG    (0x4B00U)       /**< Étiquette "K" + clé sur 8 bits */
+#define KVLOG_CAPACITY      ((FLASH_PAGE_SIZE / sizeof(kvlog_record_t)) - 1U)
+
+/**
+ * @brief En-tête d'une page du journal (premier double mot).
+ */
+typedef struct
+{
+    uint32_t magic;         /**< KVLOG_PAGE_MAGIC. */
+    uint32_t generation;    /**< Incrémentée à chaque compactage. */
+} kvlog_page_header_t;
+
+/**
+ * @brief Enregistrement d'une valeur (un double mot).
+ */
+typedef struct
+{
+    uint16_t key;           /**< KVLOG_RECORD_TAG | clé. */
+    uint16_t crc16;         /**< CRC16 de key et value. */
+    uint32_t value;         /**< Valeur (float stocké tel quel). */
+} kvlog_record_t;
+
+/**
+ * @brief État du journal et index RAM des dernières valeurs.
+ */
+static struct
+{
+    uint32_t value[KVLOG_KEY_COUNT];    /**< Dernière valeur de chaque clé. */
+    uint32_t present;                   /**< Bit n : la clé n a une valeur. */
+    uint32_t page;                      /**< Adresse de la page active, 0 si aucune. */
+    uint32_t generation;                /**< Génération de la page active. */
+    uint32_t next;                      /**< Prochain emplacement libre (1 à KVLOG_CAPACITY). */
+    bool ready;                         /**< Index construit. */
+} kvlog;
+
+
+/**
+ * @brief Calcule le CRC16 d'un enregistrement (étiquette et valeur).
+ */
+static uint16_t kvlog_record_crc(const kvlog_record_t *record)
+{
+    uint16_t crc = crc16_init();
+
+    crc = crc16_update(crc, (const uint8_t *)&record->key, sizeof(record->key));
+    crc = crc16_update(crc, (const uint8_t *)&record->value, sizeof(record->value));
+    return crc16_final(crc);
+}
+
+/**
+ * @brief Retourne l'adresse d'un emplacement de la page.
+ */
+static const kvlog_record_t *kvlog_slot(uint32_t page, uint32_t slot)
+{
+    return (const kvlog_record_t *)(page + (slot * sizeof(kvlog_record_t)));
+}
+
+/**
+ * @brief Programme un double mot du journal et contrôle la relecture.
+ *
+ * @return int KVLOG_OK, ou KVLOG_ERROR si la programmation a échoué.
+ */
+static int kvlog_program(uint32_t address, const void *data)
+{
+    fifo_span_t span;
+
+    span.data[0] = (const uint8_t *)data;
+    span.length[0] = sizeof(uint64_t);
+    span.data[1] = NULL;
+    span.length[1] = 0U;
+    if ((flash_program_span(address, &span) != 0)
+        || (memcmp((const void *)address, data, sizeof(uint64_t)) != 0))
+    {
+        return KVLOG_ERROR;
+    }
+    return KVLOG_OK;
+}
+
+/**
+ * @brief Indique si une page porte un en-tête valide.
+ */
+static bool kvlog_page_valid(uint32_t page)
+{
+    return ((const kvlog_page_header_t *)page)->magic == KVLOG_PAGE_MAGIC;
+}
+
+/**
+ * @brief Construit l'index RAM à partir de la page active.
+ *
+ * Aucune écriture en flash : une première page n'est préparée qu'au premier
+ * enregistrement.
+ */
+void kvlog_init(void)
+{
+    const kvlog_page_header_t *header0 = (const kvlog_page_header_t *)KVLOG_PAGE0_ADDRESS;
+    const kvlog_page_header_t *header1 = (const kvlog_page_header_t *)KVLOG_PAGE1_ADDRESS;
+    const kvlog_record_t *record;
+    uint32_t slot;
+    uint32_t key;
+
+    kvlog.present = 0U;
+    kvlog.page = 0U;
+    kvlog.generation = 0U;
+    kvlog.next = 1U;
+    kvlog.ready = true;
+
+    /* Page active : en-tête valide de génération la plus récente */
+    if (kvlog_page_valid(KVLOG_PAGE0_ADDRESS))
+    {
+        kvlog.page = KVLOG_PAGE0_ADDRESS;
+        kvlog.generation = header0->generation;
+    }
+    if (kvlog_page_valid(KVLOG_PAGE1_ADDRESS)
+        && ((kvlog.page == 0U) || ((int32_t)(header1->generation - kvlog.generation) > 0)))
+    {
+        kvlog.page = KVLOG_PAGE1_ADDRESS;
+        kvlog.generation = header1->generation;
+    }
+    if (kvlog.page == 0U)
+    {
+        return;
+    }
+
+    for (slot = 1U; slot <= KVLOG_CAPACITY; slot++)
+    {
+        record = kvlog_slot(kvlog.page, slot);
+        if ((record->key == 0xFFFFU) && (record->crc16 == 0xFFFFU) && (record->value == 0xFFFFFFFFUL))
+        {
+            /* Premier emplacement vierge : fin du journal */
+            break;
+        }
+        key = (uint32_t)record->key & 0xFFU;
+        if (((record->key & 0xFF00U) == KVLOG_RECORD_TAG) && (key < KVLOG_KEY_COUNT)
+            && (kvlog_record_crc(record) == record->crc16))
+        {
+            kvlog.value[key] = record->value;
+            kvlog.present |= (1UL << key);
+        }
+    }
+    kvlog.next = slot;
+}
+
+/**
+ * @brief Recopie les dernières valeurs dans l'autre page et l'active.
+ *
+ * @return int KVLOG_OK, ou KVLOG_ERROR en cas d'erreur d'écriture (la page active
+ *             reste inchangée).
+ */
+static int kvlog_compact(void)
+{
+    kvlog_page_header_t header;
+    kvlog_record_t record;
+    uint32_t target;
+    uint32_t slot = 1U;
+    uint32_t key;
+
+    target = (kvlog.page == KVLOG_PAGE0_ADDRESS) ? KVLOG_PAGE1_ADDRESS : KVLOG_PAGE0_ADDRESS;
+    if (flash_erase_page(target) != 0)
+    {
+        return KVLOG_ERROR;
+    }
+
+    for (key = 0U; key < KVLOG_KEY_COUNT; key++)
+    {
+        if ((kvlog.present & (1UL << key)) != 0U)
+        {
+            record.key = (uint16_t)(KVLOG_RECORD_TAG | key);
+            record.value = kvlog.value[key];
+            record.crc16 = kvlog_record_crc(&record);
+            if (kvlog_program((uint32_t)kvlog_slot(target, slot), &record) != KVLOG_OK)
+            {
+                return KVLOG_ERROR;
+            }
+            slot++;
+        }
+    }
+
+    /* En-tête en dernier : la nouvelle page n'existe qu'une fois complète */
+    header.magic = KVLOG_PAGE_MAGIC;
+    header.generation = kvlog.generation + 1U;
+    if (kvlog_program(target, &header) != KVLOG_OK)
+    {
+        return KVLOG_ERROR;
+    }
+    kvlog.page = target;
+    kvlog.generation = header.generation;
+    kvlog.next = slot;
+    return KVLOG_OK;
+}
+
+/**
+ * @brief Lit la dernière valeur enregistrée d'une clé (index RAM).
+ *
+ * @param[in]  key   Clé (KVLOG_KEY_xxx).
+ * @param[out] value Valeur enregistrée.
+ * @return int KVLOG_OK, ou KVLOG_ERROR si la clé n'a pas de valeur.
+ */
+int kvlog_get(uint32_t key, uint32_t *value)
+{
+    if (!kvlog.ready)
+    {
+        kvlog_init();
+    }
+    if ((key >= KVLOG_KEY_COUNT) || ((kvlog.present & (1UL << key)) == 0U))
+    {
+        return KVLOG_ERROR;
+    }
+    *value = kvlog.value[key];
+    return KVLOG_OK;
+}
+
+/**
+ * @brief Enregistre une nouvelle valeur pour une clé.
+ *
+ * Cas normal : programmation d'un seul double mot. Une valeur identique à la
+ * valeur enregistrée n'est pas réécrite.
+ *
+ * @param[in] key   Clé (KVLOG_KEY_xxx).
+ * @param[in] value Nouvelle valeur.
+ * @return int KVLOG_OK, ou KVLOG_ERROR si la clé est invalide ou en cas d'erreur flash.
+ */
+int kvlog_set(uint32_t key, uint32_t value)
+{
+    kvlog_record_t record;
+    uint32_t address;
+
+    if (!kvlog.ready)
+    {
+        kvlog_init();
+    }
+    if (key >= KVLOG_KEY_COUNT)
+    {
+        return KVLOG_ERROR;
+    }
+    if (((kvlog.present & (1UL << key)) != 0U) && (kvlog.value[key] == value))
+    {
+        return KVLOG_OK;
+    }
+
+    /* Pas encore de page active, ou page pleine */
+    if ((kvlog.page == 0U) || (kvlog.next > KVLOG_CAPACITY))
+    {
+        if (kvlog_compact() != KVLOG_OK)
+        {
+            return KVLOG_ERROR;
+        }
+    }
+
+    record.key = (uint16_t)(KVLOG_RECORD_TAG | key);
+    record.value = value;
+    record.crc16 = kvlog_record_crc(&record);
+    address = (uint32_t)kvlog_slot(kvlog.page, kvlog.next);
+    /* L'emplacement est consommé même en cas d'échec : il n'est plus vierge */
+    kvlog.next++;
+    if (kvlog_program(address, &record) != KVLOG_OK)
+    {
+        return KVLOG_ERROR;
+    }
+    kvlog.value[key] = value;
+    kvlog.present |= (1UL << key);
+    return KVLOG_OK;
+}
@@ -0,0 +1,213 @@
+#include <string.h>
+#include "lzss.h"
+
+/**
+ * @file lzss.c
+ * @brief Décompression LZSS en flux des images firmware (voir lzss.h pour le format).
+ *
+ * Le décodeur accepte les données par morceaux de taille quelconque (blocs XMODEM,
+ * paquets YMODEM...) : l'état, y compris les bits d'un élément à cheval sur deux
+ * morceaux, est conservé entre deux appels.
+ */
+
+/** Signature en tête d'une image compressée. */
+static const uint8_t lzss_magic[4] = { 'A', 'L', 'Z', '1' };
+
+/* Taille d'un élément le plus long : étiquette + écart + longueur */
+#define LZSS_BACKREF_BITS   (1U + LZSS_WINDOW_BITS + LZSS_LOOKAHEAD_BITS)
+
+
+/**
+ * @brief Indique si des données commencent par la signature d'une image compressée.
+ *
+ * @param[in] data   Premiers octets de l'image.
+ * @param[in] length Nombre d'octets disponibles.
+ * @return int 1 si l'image est compressée, 0 sinon.
+ */
+int lzss_is_compressed(const uint8_t *data, uint32_t length)
+{
+    if ((data == NULL) || (length < sizeof(lzss_magic)))
+    {
+        return 0;
+    }
+    return (memcmp(data, lzss_magic, sizeof(lzss_magic)) == 0) ? 1 : 0;
+}
+
+/**
+ * @brief Initialise le décodeur pour une nouvelle image.
+ *
+ * @param[out] decoder État du décodeur.
+ */
+void lzss_decoder_init(lzss_decoder_t *decoder)
+{
+    decoder->position = 0U;
+    decoder->flushed = 0U;
+    decoder->produced = 0U;
+    decoder->length = 0U;
+    decoder->bits = 0U;
+    decoder->bit_count = 0U;
+    decoder->header_length = 0U;
+    decoder->status = LZSS_OK;
+}
+
+/**
+ * @brief Transmet à la sortie les octets décompressés depuis le dernier appel.
+ *
+ * @return int LZSS_OK, ou LZSS_ERROR si la sortie a refusé les données.
+ */
+static int lzss_flush(lzss_decoder_t *decoder, lzss_sink_t sink, void *context)
+{
+    uint32_t count = decoder->position - decoder->flushed;
+
+    if (count != 0U)
+    {
+        if (sink(context, &decoder->window[decoder->flushed], count) != 0)
+        {
+            return LZSS_ERROR;
+        }
+    }
+    decoder->flushed = decoder->position % LZSS_WINDOW_SIZE;
+    decoder->position = decoder->flushed;
+    return LZSS_OK;
+}
+
+/**
+ * @brief Ajoute un octet décompressé à la fenêtre.
+ *
+ * @return int LZSS_OK, ou LZSS_ERROR si la sortie a refusé les données.
+ */
+static int lzss_emit(lzss_decoder_t *decoder, uint8_t byte, lzss_sink_t sink, void *context)
+{
+    decoder->window[decoder->position] = byte;
+    decoder->position++;
+    decoder->produced++;
+    if (decoder->position == LZSS_WINDOW_SIZE)
+    {
+        /* Fin du tampon circulaire : la partie non transmise est contiguë */
+        return lzss_flush(decoder, sink, context);
+    }
+    return LZSS_OK;
+}
+
+/**
+ * @brief Contrôle l'en-tête reçu.
+ *
+ * @return int LZSS_OK si l'en-tête est valide, LZSS_ERROR sinon.
+ */
+static int lzss_parse_header(lzss_decoder_t *decoder)
+{
+    const uint8_t *header = decoder->header;
+
+    if ((memcmp(header, lzss_magic, sizeof(lzss_magic)) != 0)
+        || (header[4] != LZSS_WINDOW_BITS) || (header[5] != LZSS_LOOKAHEAD_BITS))
+    {
+        return LZSS_ERROR;
+    }
+    decoder->length = (uint32_t)header[8] | ((uint32_t)header[9] << 8U)
+                    | ((uint32_t)header[10] << 16U) | ((uint32_t)header[11] << 24U);
+    return LZSS_OK;
+}
+
+/**
+ * @brief Décompresse un morceau de l'image.
+ *
+ * @param[in,out] decoder État du décodeur.
+ * @param[in]     data    Octets compressés.
+ * @param[in]     length  Nombre d'octets.
+ * @param[in]     sink    Fonction de sortie des octets décompressés.
+ * @param[in]     context Contexte transmis à sink.
+ * @return int LZSS_OK si d'autres données sont attendues, LZSS_DONE quand la taille
+ *             annoncée est atteinte, LZSS_ERROR en cas d'erreur.
+ */
+int lzss_decode(lzss_decoder_t *decoder, const uint8_t *data, uint32_t length,
+                lzss_sink_t sink, void *context)
+{
+    uint32_t i = 0U;
+    uint32_t offset;
+    uint32_t count;
+    uint32_t source;
+
+    if (decoder->status != LZSS_OK)
+    {
+        return decoder->status;
+    }
+
+    /* En-tête */
+    while ((decoder->header_length < LZSS_HEADER_SIZE) && (i < length))
+    {
+        decoder->header[decoder->header_length] = data[i];
+        decoder->header_length++;
+        i++;
+        if ((decoder->header_length == LZSS_HEADER_SIZE) && (lzss_parse_header(decoder) != LZSS_OK))
+        {
+            decoder->status = LZSS_ERROR;
+            return LZSS_ERROR;
+        }
+    }
+
+    while ((decoder->status == LZSS_OK) && (decoder->produced < decoder->length))
+    {
+        /* Remplissage jusqu'à disposer d'un élément complet, ou fin du morceau */
+        while ((decoder->bit_count < LZSS_BACKREF_BITS) && (i < length))
+        {
+            decoder->bits = (decoder->bits << 8U) | data[i];
+            decoder->bit_count += 8U;
+            i++;
+        }
+        if (decoder->bit_count == 0U)
+        {
+            break;
+        }
+
+        if (((decoder->bits >> (decoder->bit_count - 1U)) & 1U) != 0U)
+        {
+            /* Littéral */
+            if (decoder->bit_count < 9U)
+            {
+                break;
+            }
+            decoder->bit_count -= 9U;
+            if (lzss_emit(decoder, (uint8_t)(decoder->bits >> decoder->bit_count), sink, context) != LZSS_OK)
+            {
+                decoder->status = LZSS_ERROR;
+            }
+        }
+        else
+        {
+            /* Référence arrière */
+            if (decoder->bit_count < LZSS_BACKREF_BITS)
+            {
+                break;
+            }
+            decoder->bit_count -= LZSS_BACKREF_BITS;
+            offset = ((decoder->bits >> (decoder->bit_count + LZSS_LOOKAHEAD_BITS)) & (LZSS_WINDOW_SIZE - 1U)) + 1U;
+            count = ((decoder->bits >> decoder->bit_count) & (LZSS_MAX_MATCH - 1U)) + 1U;
+            if (offset > decoder->produced)
+            {
+                decoder->status = LZSS_ERROR;
+                break;
+            }
+            while ((count > 0U) && (decoder->produced < decoder->length) && (decoder->status == LZSS_OK))
+            {
+                source = (decoder->position + LZSS_WINDOW_SIZE - offset) % LZSS_WINDOW_SIZE;
+                if (lzss_emit(decoder, decoder->window[source], sink, context) != LZSS_OK)
+                {
+                    decoder->status = LZSS_ERROR;
+                }
+                count--;
+            }
+        }
+        decoder->bits &= (1UL << decoder->bit_count) - 1U;
+    }
+
+    if ((decoder->status == LZSS_OK) && (lzss_flush(decoder, sink, context) != LZSS_OK))
+    {
+        decoder->status = LZSS_ERROR;
+    }
+    if ((decoder->status == LZSS_OK) && (decoder->header_length == LZSS_HEADER_SIZE)
+        && (decoder->produced >= decoder->length))
+    {
+        decoder->status = LZSS_DONE;
+    }
+    return decoder->status;
+}
@@ -1,4 +1,5 @@
 #include <inc.h>
+#include "usb_device.h"
 
 
 void SystemClock_Config2MZ(void);
@@ -24,14 +25,14 @@ uint32_t unique_id[3];
 //        (void)memcpy(pRamInfo, pFlashInfo, sizeof(BootloaderInfo_t));
 //    }
 //}
-AppConfig_t config_read_back;
 int main(void) {
 //    uint32_t start_tick;
     uint8_t received_char;
+    const transport_t *link;
 //    bool enter_bootloader = false;
-    uint32_t app_stack;
     /* Initialisation du système et configuration */
     HAL_Init();
+	handoff_init();
     NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
 	SystemClock_Config2MZ(); 
     MX_GPIO_Init();
@@ -40,8 +41,8 @@ int main(void) {
 	HAL_ADCEx_Calibration_Start(&hadc1,ADC_SINGLE_ENDED);
 	HAL_ADCEx_Calibration_Start(&hadc2,ADC_SINGLE_ENDED);
 	Read_ADC_Values();	
-    Read_Structure_From_Flash(flash_address, &config_read_back, sizeof(AppConfig_t));
-	Read_Structure_From_Flash(flash_address, &v_AppConfig, sizeof(AppConfig_t));
+	kvlog_init();
+	Config_Init();
 //    Read_Structure_From_Flash(flash_address, &config_read_back, sizeof(AppConfig_t));
 //	if (config_read_back.uniqueID0 == 0xFFFFFFFF) {
 //		Read_UniqueID(unique_id);		
@@ -69,15 +70,13 @@ int main(void) {
 //		__NOP();
 //	}
 //	if (strncmp(config_read_back.Boot_Bootloader, "BOOT", 4) != 0) {
-	if (v_ADC1_IN10 < 4.5)  {
+	/* Sans USB et sans demande de l'application (handoff.h) : lancement direct */
+	if ((v_ADC1_IN10 < 4.5) && !handoff_bootloader_requested())  {
 		// BOOT FIRMWARE DIRECTEMENT
 //		if (config_read_back.Presence == 0x12345678) {
-			/* Lecture du pointeur de pile initial dans le flash de l'application */
-			app_stack = *((volatile uint32_t *)APPLICATION_ADDRESS);
-			/* Vérification simple que l'adresse du pointeur de pile est dans la plage RAM
-			   (ici, 0x20000000 est l'adresse de base de la RAM sur beaucoup de STM32, 
-			   à adapter selon votre microcontrôleur) */
-			if ((app_stack & 0x2FFE0000U) == 0x20000000U)
+			/* En-tête vérifié et marqueur présents, ou application sans en-tête et page
+			   d'information vierge (voir image.c) ; pointeur de pile en RAM */
+			if (image_check() == IMAGE_OK)
 			{
 				Bootloader_JumpToApplication();
 			}
@@ -86,8 +85,11 @@ int main(void) {
 		// BOOTLOADER MISE A JOURT PARAMETTRE
 		SystemClock_Config();
 		fifo_init(&usart2_fifo);
+		fifo_init(&cdc_fifo);
 		
 		UART2_Init();	
+		/* Port USB CDC : même menu et mêmes récepteurs que l'USART2 (transport.c) */
+		MX_USB_Device_Init();
 		HAL_ADCEx_Calibration_Start(&hadc1,ADC_SINGLE_ENDED);
 		HAL_ADCEx_Calibration_Start(&hadc2,ADC_SINGLE_ENDED);
 		Read_ADC_Values();
@@ -99,13 +101,21 @@ int main(void) {
 		MX_LPTIM1_Init();
 		ADC12_COMMON->CCR |= ADC_CCR_VREFEN;	
 		HAL_TIM_Base_Start_IT(&htim2);
+		/* Premier octet mesuré par l'USART : 0x7F au débit de l'outil PC, ou espace à 38400 bauds */
+		UART2_AutoBaudArm();
 		while (1) {
-			/* Démarrage du compte à rebours de 10 secondes. La boucle s'exécute pendant 10 secondes, quel que soit l'état du CDC. */
-			if (fifo_wait_for(&usart2_fifo, 1, BOOTLOADER_WAIT_TIME_MS) == FIFO_OK) {
-				fifo_get(&usart2_fifo, &received_char);
+			/* Compte à rebours de 10 secondes : la liaison (USART2 ou USB CDC) qui reçoit le premier octet devient active */
+			link = transport_wait_first(BOOTLOADER_WAIT_TIME_MS, &received_char);
+			/* Débit mesuré par l'USART, ou mesure manquée : retour au débit par défaut */
+			(void)UART2_AutoBaudResult();
+			if (link != NULL) {
 				if (received_char == ' ') {
 		//			enter_bootloader = true;
 					Bootloader_Menu();
+				} else if (received_char == 0x00U) {
+					/* Délimiteur COBS : commandes binaires d'un outil de provisionnement (prov.c) */
+					(void)prov_session(link);
+					UART2_AutoBaudArm();
 				}
 			}
 		}
@@ -142,8 +152,10 @@ void SystemClock_Config(void)
   RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
   HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_8);
 
-  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_ADC12;
+  /* USB : HSI48 démarré et synchronisé sur les SOF par USBD_Clock_Config() (usb_device.c) */
+  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_ADC12|RCC_PERIPHCLK_USB;
   PeriphClkInit.Adc12ClockSelection = RCC_ADC12CLKSOURCE_PLL;
+  PeriphClkInit.UsbClockSelection = RCC_USBCLKSOURCE_HSI48;
   if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
   {
     Error_Handler();
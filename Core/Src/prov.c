@@ -0,0 +1,552 @@
+
+#include "inc.h"
+
+/**
+ * @file prov.c
+ * @brief Canal de commandes binaire pour le provisionnement en production.
+ *
+ * Alternative au menu VT100 pour un outil PC (Tools/prov_tool.c) : une session
+ * commence par l'octet 0x00 à la place de l'espace du menu. Les trames sont
+ * encodées en COBS et terminées par 0x00, comme celles de slwin.c. Contenu d'une
+ * trame décodée :
+ *
+ *     commande :  code (1) | séquence (1) | données (0 à PROV_PAYLOAD_MAX) | CRC16 (2)
+ *     réponse  :  code | 0x80 (1) | séquence (1) | statut (1) | données | CRC16 (2)
+ *
+ * Le CRC16 (polynôme 0x1021, MSB en tête) porte sur tout ce qui le précède. Une
+ * trame invalide est ignorée : l'outil répète la commande, avec la même séquence,
+ * faute de réponse. Les valeurs sur plusieurs octets sont petit-boutistes ; les
+ * coefficients sont des float IEEE 754 sur 4 octets.
+ *
+ * Commandes :
+ *   - PROV_CMD_INFO : identifiant unique, versions du bootloader et de la
+ *     configuration, état et en-tête de l'application ;
+ *   - PROV_CMD_CONFIG_READ : liste de clés KVLOG_KEY_xxx (toutes si vide), réponse
+ *     clé (1) | statut (1) | valeur (4) pour chacune ;
+ *   - PROV_CMD_CONFIG_WRITE : liste de clé (1) | valeur (4), toutes contrôlées avant
+ *     la première écriture, réponse clé (1) | statut (1) pour chacune ;
+ *   - PROV_CMD_UPDATE : protocole (1, PROV_UPDATE_xxx). La réponse précède la
+ *     réception ; une seconde réponse, de même séquence, en donne le résultat ;
+ *   - PROV_CMD_VERIFY : recalcul du CRC32 de l'application (image_verify()) ;
+ *   - PROV_CMD_JUMP : lancement de l'application après la réponse ;
+ *   - PROV_CMD_EXIT : fin de la session, retour à l'attente du menu ;
+ *   - PROV_CMD_BAUD : débit (4), USART2 seulement (PROV_STATUS_COMMAND sur
+ *     l'USB CDC). La réponse, au débit courant, donne le débit obtenu (4) puis
+ *     les deux extrémités basculent. L'outil confirme la liaison par
+ *     PROV_CMD_PROBE au nouveau débit ; faute de trame de test valide dans les
+ *     PROV_PROBE_TIMEOUT_MS, le bootloader revient à UART2_BAUD_DEFAULT, comme
+ *     l'outil faute d'écho ;
+ *   - PROV_CMD_PROBE : données quelconques renvoyées telles quelles.
+ */
+
+/* Codes de commande */
+#define PROV_CMD_INFO           0x01U
+#define PROV_CMD_CONFIG_READ    0x02U
+#define PROV_CMD_CONFIG_WRITE   0x03U
+#define PROV_CMD_UPDATE         0x04U
+#define PROV_CMD_VERIFY         0x05U
+#define PROV_CMD_JUMP           0x06U
+#define PROV_CMD_EXIT           0x07U
+#define PROV_CMD_BAUD           0x08U
+#define PROV_CMD_PROBE          0x09U
+#define PROV_RESPONSE           0x80U   /**< Ajouté au code de la commande dans la réponse */
+
+/* Statuts */
+#define PROV_STATUS_OK          0x00U
+#define PROV_STATUS_COMMAND     0x01U   /**< Commande inconnue */
+#define PROV_STATUS_LENGTH      0x02U   /**< Longueur des données incorrecte */
+#define PROV_STATUS_KEY         0x03U   /**< Clé inconnue */
+#define PROV_STATUS_RANGE       0x04U   /**< Valeur hors limites */
+#define PROV_STATUS_FLASH       0x05U   /**< Erreur d'écriture flash */
+#define PROV_STATUS_IMAGE       0x06U   /**< Application absente ou invalide */
+
+/* Protocoles de PROV_CMD_UPDATE, dans l'ordre du menu */
+#define PROV_UPDATE_XMODEM_1K   0x00U
+#define PROV_UPDATE_XMODEM_1K_G 0x01U
+#define PROV_UPDATE_SLWIN       0x02U
+#define PROV_UPDATE_YMODEM      0x03U
+#define PROV_UPDATE_YMODEM_G    0x04U
+
+#define PROV_VERSION            0x03U   /**< Version du protocole, dans la réponse à PROV_CMD_INFO */
+
+/* Clés accessibles : champs de AppConfig_t du journal de configuration */
+#define PROV_KEY_COUNT          (KVLOG_KEY_TEMP_B + 1U)
+
+#define PROV_HEADER_SIZE        2U
+#define PROV_TRAILER_SIZE       2U
+#define PROV_FRAME_SIZE         (PROV_HEADER_SIZE + 1U + PROV_PAYLOAD_MAX + PROV_TRAILER_SIZE)
+#define PROV_ENCODED_SIZE       (PROV_FRAME_SIZE + (PROV_FRAME_SIZE / 254U) + 1U)
+
+#define PROV_CONFIG_ITEM_SIZE   5U      /**< Clé (1) | valeur (4) */
+
+
+/** Trame en cours de réception (encodée), décodée en place une fois complète. */
+static uint8_t prov_frame[PROV_ENCODED_SIZE];
+static uint32_t prov_frame_length;
+static bool prov_frame_overflow;
+
+/** Données de la réponse en préparation. */
+static uint8_t prov_reply[PROV_PAYLOAD_MAX];
+static uint32_t prov_reply_length;
+
+/** Liaison de la session en cours. */
+static const transport_t *prov_link;
+
+
+static void prov_put_u32(uint8_t *dst, uint32_t value)
+{
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8U);
+    dst[2] = (uint8_t)(value >> 16U);
+    dst[3] = (uint8_t)(value >> 24U);
+}
+
+static uint32_t prov_get_u32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8U) | ((uint32_t)src[2] << 16U) | ((uint32_t)src[3] << 24U);
+}
+
+/**
+ * @brief Ajoute un mot de 32 bits aux données de la réponse.
+ */
+static void prov_reply_u32(uint32_t value)
+{
+    prov_put_u32(&prov_reply[prov_reply_length], value);
+    prov_reply_length += 4U;
+}
+
+/**
+ * @brief Encode et envoie une réponse avec les données de prov_reply.
+ *
+ * @param[in] cmd    Code de la commande traitée.
+ * @param[in] seq    Séquence de la commande.
+ * @param[in] status Statut PROV_STATUS_xxx.
+ */
+static void prov_send(uint8_t cmd, uint8_t seq, uint8_t status)
+{
+    uint8_t raw[PROV_FRAME_SIZE];
+    uint8_t encoded[PROV_ENCODED_SIZE + 1U];
+    uint32_t length;
+    uint16_t crc;
+
+    raw[0] = (uint8_t)(cmd | PROV_RESPONSE);
+    raw[1] = seq;
+    raw[2] = status;
+    (void)memcpy(&raw[3], prov_reply, prov_reply_length);
+    length = 3U + prov_reply_length;
+    crc = crc16_final(crc16_update(crc16_init(), raw, length));
+    raw[length] = (uint8_t)(crc >> 8U);
+    raw[length + 1U] = (uint8_t)crc;
+
+    length = cobs_encode(raw, length + PROV_TRAILER_SIZE, encoded);
+    encoded[length] = 0U;
+    transport_send(prov_link, encoded, length + 1U);
+}
+
+/**
+ * @brief Lit une trame complète dans la FIFO.
+ *
+ * Une trame trop longue est ignorée jusqu'au délimiteur suivant.
+ *
+ * @param[in] fifo       Pointeur vers la FIFO de réception.
+ * @param[in] timeout_ms Délai maximal sans trame complète, en millisecondes.
+ * @return int Longueur de la trame décodée (> 0), 0 en cas de timeout.
+ */
+static int prov_read_frame(fifo_t *fifo, uint32_t timeout_ms)
+{
+    uint32_t start_time = HAL_GetTick();
+    int32_t length;
+    uint8_t byte;
+
+    while ((HAL_GetTick() - start_time) < timeout_ms)
+    {
+        if (fifo_get(fifo, &byte) != FIFO_OK)
+        {
+            continue;
+        }
+        if (byte != 0U)
+        {
+            if (prov_frame_length < sizeof(prov_frame))
+            {
+                prov_frame[prov_frame_length] = byte;
+                prov_frame_length++;
+            }
+            else
+            {
+                prov_frame_overflow = true;
+            }
+            continue;
+        }
+
+        /* Délimiteur : décodage en place de la trame accumulée */
+        length = -1;
+        if (!prov_frame_overflow && (prov_frame_length != 0U))
+        {
+            length = cobs_decode(prov_frame, prov_frame_length, prov_frame);
+        }
+        prov_frame_length = 0U;
+        prov_frame_overflow = false;
+        if (length > 0)
+        {
+            return (int)length;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Attend une commande valide : taille et CRC contrôlés.
+ *
+ * Les trames invalides sont ignorées. La commande est dans prov_frame : code,
+ * séquence puis données.
+ *
+ * @param[in] fifo       Pointeur vers la FIFO de réception.
+ * @param[in] timeout_ms Délai maximal sans commande valide, en millisecondes.
+ * @return int Longueur des données de la commande, -1 en cas de timeout.
+ */
+static int prov_receive(fifo_t *fifo, uint32_t timeout_ms)
+{
+    uint32_t start_time = HAL_GetTick();
+    uint32_t elapsed;
+    uint32_t length;
+    uint16_t crc;
+    int frame;
+
+    for (;;)
+    {
+        elapsed = HAL_GetTick() - start_time;
+        frame = (elapsed < timeout_ms) ? prov_read_frame(fifo, timeout_ms - elapsed) : 0;
+        if (frame == 0)
+        {
+            return -1;
+        }
+
+        length = (uint32_t)frame;
+        if ((length < (PROV_HEADER_SIZE + PROV_TRAILER_SIZE))
+            || (length > (PROV_HEADER_SIZE + PROV_PAYLOAD_MAX + PROV_TRAILER_SIZE)))
+        {
+            continue;
+        }
+        length -= PROV_HEADER_SIZE + PROV_TRAILER_SIZE;
+        crc = (uint16_t)(((uint16_t)prov_frame[PROV_HEADER_SIZE + length] << 8U)
+                       | prov_frame[PROV_HEADER_SIZE + length + 1U]);
+        if (crc16_final(crc16_update(crc16_init(), prov_frame, PROV_HEADER_SIZE + length)) == crc)
+        {
+            return (int)length;
+        }
+    }
+}
+
+/**
+ * @brief Contrôle une valeur de configuration avant écriture, comme le menu.
+ *
+ * @return uint8_t PROV_STATUS_OK, PROV_STATUS_KEY ou PROV_STATUS_RANGE.
+ */
+static uint8_t prov_check_value(uint8_t key, float value)
+{
+    if (key >= PROV_KEY_COUNT)
+    {
+        return PROV_STATUS_KEY;
+    }
+    if ((key == KVLOG_KEY_COEF_ANEMO) && ((value <= COEF_ANEMO_MIN) || (value >= COEF_ANEMO_MAX)))
+    {
+        return PROV_STATUS_RANGE;
+    }
+    if ((key == KVLOG_KEY_COEF_PLUVIO) && ((value <= COEF_PLUVIO_MIN) || (value >= COEF_PLUVIO_MAX)))
+    {
+        return PROV_STATUS_RANGE;
+    }
+    if ((key == KVLOG_KEY_TEMP_A) && ((value <= TEMP_A_MIN) || (value >= TEMP_A_MAX)))
+    {
+        return PROV_STATUS_RANGE;
+    }
+    if ((key == KVLOG_KEY_TEMP_B) && ((value <= TEMP_B_MIN) || (value >= TEMP_B_MAX)))
+    {
+        return PROV_STATUS_RANGE;
+    }
+    return PROV_STATUS_OK;
+}
+
+/**
+ * @brief PROV_CMD_INFO : identification de la carte.
+ *
+ * Réponse : version du protocole (1) | PROV_PAYLOAD_MAX (2) | uniqueID0..2 (12) |
+ * version du bootloader (3) | version de la configuration (3) | application
+ * valide (1) | version (4) et taille (4) de l'image | Version_Compile (32).
+ */
+static uint8_t prov_info(void)
+{
+    const AppConfig_t *config = Config_Get();
+    const image_header_t *header = image_get_header();
+
+    prov_reply[0] = PROV_VERSION;
+    prov_reply[1] = (uint8_t)PROV_PAYLOAD_MAX;
+    prov_reply[2] = (uint8_t)(PROV_PAYLOAD_MAX >> 8U);
+    prov_reply_length = 3U;
+    prov_reply_u32(config->uniqueID0);
+    prov_reply_u32(config->uniqueID1);
+    prov_reply_u32(config->uniqueID2);
+    prov_reply[prov_reply_length++] = (uint8_t)L_MAJEUR_VERSION;
+    prov_reply[prov_reply_length++] = (uint8_t)L_MINEUR_VERSION;
+    prov_reply[prov_reply_length++] = (uint8_t)L_RELEASE_VERSION;
+    prov_reply[prov_reply_length++] = (uint8_t)config->MAJEUR_VERSION;
+    prov_reply[prov_reply_length++] = (uint8_t)config->MINEUR_VERSION;
+    prov_reply[prov_reply_length++] = (uint8_t)config->RELEASE_VERSION;
+    prov_reply[prov_reply_length++] = (image_check() == IMAGE_OK) ? 1U : 0U;
+    prov_reply_u32((header != NULL) ? header->version : 0U);
+    prov_reply_u32((header != NULL) ? header->length : 0U);
+    (void)memcpy(&prov_reply[prov_reply_length], config->Version_Compile, sizeof(config->Version_Compile));
+    prov_reply_length += sizeof(config->Version_Compile);
+    return PROV_STATUS_OK;
+}
+
+/**
+ * @brief PROV_CMD_CONFIG_READ : lecture d'une liste de clés.
+ */
+static uint8_t prov_config_read(const uint8_t *data, uint32_t length)
+{
+    uint32_t count = (length == 0U) ? PROV_KEY_COUNT : length;
+    uint32_t i;
+    uint32_t raw;
+    float value;
+    uint8_t key;
+
+    if ((count * 6U) > PROV_PAYLOAD_MAX)
+    {
+        return PROV_STATUS_LENGTH;
+    }
+    for (i = 0U; i < count; i++)
+    {
+        key = (length == 0U) ? (uint8_t)i : data[i];
+        value = Config_Get_Float(key);
+        (void)memcpy(&raw, &value, sizeof(raw));
+        prov_reply[prov_reply_length++] = key;
+        prov_reply[prov_reply_length++] = (key < PROV_KEY_COUNT) ? PROV_STATUS_OK : PROV_STATUS_KEY;
+        prov_reply_u32(raw);
+    }
+    return PROV_STATUS_OK;
+}
+
+/**
+ * @brief PROV_CMD_CONFIG_WRITE : écriture d'une liste de valeurs dans le journal.
+ *
+ * Aucune valeur n'est écrite si l'une d'elles est refusée. Une valeur identique à
+ * la valeur courante n'est pas réécrite : répéter la commande est sans effet.
+ */
+static uint8_t prov_config_write(const uint8_t *data, uint32_t length)
+{
+    uint8_t result = PROV_STATUS_OK;
+    uint8_t status;
+    uint32_t i;
+    uint32_t raw;
+    float value;
+
+    if (((length % PROV_CONFIG_ITEM_SIZE) != 0U) || (length == 0U))
+    {
+        return PROV_STATUS_LENGTH;
+    }
+    for (i = 0U; i < length; i += PROV_CONFIG_ITEM_SIZE)
+    {
+        raw = prov_get_u32(&data[i + 1U]);
+        (void)memcpy(&value, &raw, sizeof(value));
+        status = prov_check_value(data[i], value);
+        prov_reply[prov_reply_length++] = data[i];
+        prov_reply[prov_reply_length++] = status;
+        if (status != PROV_STATUS_OK)
+        {
+            result = status;
+        }
+    }
+    if (result != PROV_STATUS_OK)
+    {
+        return result;
+    }
+
+    prov_reply_length = 0U;
+    for (i = 0U; i < length; i += PROV_CONFIG_ITEM_SIZE)
+    {
+        raw = prov_get_u32(&data[i + 1U]);
+        (void)memcpy(&value, &raw, sizeof(value));
+        status = PROV_STATUS_OK;
+        if ((Config_Get_Float(data[i]) != value) && (Config_Write_Value(data[i], value) != KVLOG_OK))
+        {
+            status = PROV_STATUS_FLASH;
+            result = status;
+        }
+        prov_reply[prov_reply_length++] = data[i];
+        prov_reply[prov_reply_length++] = status;
+    }
+    return result;
+}
+
+/**
+ * @brief PROV_CMD_UPDATE : réception d'une image par l'un des protocoles du menu.
+ *
+ * Réponse finale : pages (4) | effacement (4, ms) | programmation (4, ms).
+ */
+static void prov_update(fifo_t *fifo, uint8_t seq, const uint8_t *data, uint32_t length)
+{
+    int result;
+
+    if ((length != 1U) || (data[0] > PROV_UPDATE_YMODEM_G))
+    {
+        prov_send(PROV_CMD_UPDATE, seq, PROV_STATUS_LENGTH);
+        return;
+    }
+    prov_send(PROV_CMD_UPDATE, seq, PROV_STATUS_OK);
+
+    if (data[0] == PROV_UPDATE_XMODEM_1K)
+    {
+        result = xmodem_receive_1k_blockwise(prov_link, flash_write_callback);
+    }
+    else if (data[0] == PROV_UPDATE_XMODEM_1K_G)
+    {
+        result = xmodem_receive_1k_g(prov_link, flash_write_callback);
+    }
+    else if (data[0] == PROV_UPDATE_SLWIN)
+    {
+        result = slwin_receive(prov_link, flash_write_callback);
+    }
+    else
+    {
+        result = YMODEM_Receive(prov_link, (data[0] == PROV_UPDATE_YMODEM_G) ? 1U : 0U, flash_write_callback);
+    }
+
+    /* Laisse passer la fin de l'échange du protocole avant la réponse finale */
+    HAL_Delay(100U);
+    fifo_reset(fifo);
+    prov_frame_length = 0U;
+    prov_frame_overflow = false;
+
+    prov_reply_u32(v_flash_pipe_stats.pages);
+    prov_reply_u32(v_flash_pipe_stats.erase_us / 1000U);
+    prov_reply_u32(v_flash_pipe_stats.program_us / 1000U);
+    prov_send(PROV_CMD_UPDATE, seq, ((result == 0) && (image_check() == IMAGE_OK)) ? PROV_STATUS_OK : PROV_STATUS_IMAGE);
+}
+
+/**
+ * @brief PROV_CMD_BAUD : changement de débit de l'USART2, confirmé par PROV_CMD_PROBE.
+ *
+ * Sans objet sur l'USB CDC (PROV_STATUS_COMMAND) : le débit y est celui du bus.
+ */
+static void prov_baud(fifo_t *fifo, uint8_t seq, const uint8_t *data, uint32_t length)
+{
+    uint32_t baud;
+    uint32_t actual;
+    int received;
+
+    if (length != 4U)
+    {
+        prov_send(PROV_CMD_BAUD, seq, PROV_STATUS_LENGTH);
+        return;
+    }
+    if (prov_link != &transport_uart2)
+    {
+        prov_send(PROV_CMD_BAUD, seq, PROV_STATUS_COMMAND);
+        return;
+    }
+    baud = prov_get_u32(data);
+    actual = UART2_CheckBaudRate(baud);
+    if (actual == 0U)
+    {
+        prov_send(PROV_CMD_BAUD, seq, PROV_STATUS_RANGE);
+        return;
+    }
+    prov_reply_u32(actual);
+    prov_send(PROV_CMD_BAUD, seq, PROV_STATUS_OK);
+    (void)UART2_SetBaudRate(baud);
+    prov_frame_length = 0U;
+    prov_frame_overflow = false;
+
+    /* Trame de test au nouveau débit, sinon retour des deux côtés au débit par défaut */
+    received = prov_receive(fifo, PROV_PROBE_TIMEOUT_MS);
+    if ((received < 0) || (prov_frame[0] != PROV_CMD_PROBE))
+    {
+        (void)UART2_SetBaudRate(UART2_BAUD_DEFAULT);
+        prov_frame_length = 0U;
+        prov_frame_overflow = false;
+        return;
+    }
+    prov_reply_length = (uint32_t)received;
+    (void)memcpy(prov_reply, &prov_frame[PROV_HEADER_SIZE], prov_reply_length);
+    prov_send(PROV_CMD_PROBE, prov_frame[1], PROV_STATUS_OK);
+}
+
+/**
+ * @brief Session de commandes binaires, après réception de l'octet 0x00.
+ *
+ * @param[in] link Liaison qui a reçu l'octet 0x00 (USART2 ou USB CDC, voir transport.c).
+ * @return int 0 après PROV_CMD_EXIT, -1 après PROV_IDLE_TIMEOUT_MS sans commande valide.
+ */
+int prov_session(const transport_t *link)
+{
+    fifo_t *fifo = link->rx;
+    const uint8_t *data;
+    uint32_t length;
+    uint8_t cmd;
+    uint8_t seq;
+    uint8_t status;
+    int received;
+
+    prov_link = link;
+    prov_frame_length = 0U;
+    prov_frame_overflow = false;
+
+    for (;;)
+    {
+        received = prov_receive(fifo, PROV_IDLE_TIMEOUT_MS);
+        if (received < 0)
+        {
+            return -1;
+        }
+
+        length = (uint32_t)received;
+        cmd = prov_frame[0];
+        seq = prov_frame[1];
+        data = &prov_frame[PROV_HEADER_SIZE];
+        prov_reply_length = 0U;
+        switch (cmd)
+        {
+            case PROV_CMD_INFO:
+                status = prov_info();
+                break;
+            case PROV_CMD_CONFIG_READ:
+                status = prov_config_read(data, length);
+                break;
+            case PROV_CMD_CONFIG_WRITE:
+                status = prov_config_write(data, length);
+                break;
+            case PROV_CMD_UPDATE:
+                prov_update(fifo, seq, data, length);
+                continue;
+            case PROV_CMD_VERIFY:
+                status = (image_verify() == IMAGE_OK) ? PROV_STATUS_OK : PROV_STATUS_IMAGE;
+                break;
+            case PROV_CMD_JUMP:
+                if (image_check() != IMAGE_OK)
+                {
+                    status = PROV_STATUS_IMAGE;
+                    break;
+                }
+                prov_send(cmd, seq, PROV_STATUS_OK);
+                Bootloader_JumpToApplication();
+                /* Retour seulement si le saut a été refusé */
+                return -1;
+            case PROV_CMD_EXIT:
+                prov_send(cmd, seq, PROV_STATUS_OK);
+                return 0;
+            case PROV_CMD_BAUD:
+                prov_baud(fifo, seq, data, length);
+                continue;
+            case PROV_CMD_PROBE:
+                (void)memcpy(prov_reply, data, length);
+                prov_reply_length = length;
+                status = PROV_STATUS_OK;
+                break;
+            default:
+                status = PROV_STATUS_COMMAND;
+                break;
+        }
+        prov_send(cmd, seq, status);
+    }
+}
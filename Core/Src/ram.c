@@ -3,12 +3,13 @@
 const uint32_t flash_address_config = 0x0801F800;
 
 float v_temperature_mesuree;
-AppConfig_t v_config_system;
 
 fifo_t usart2_fifo;
+fifo_t usart2_tx_fifo;
+fifo_t cdc_tx_fifo;
+fifo_t cdc_fifo;
+const transport_t *v_transport = &transport_uart2;	/* Liaison du premier octet reçu (transport.c) */
 //__attribute__((section("BootloaderInfoSection"), used))  BootloaderInfo_t appInfoRAM;
-AppConfig_t v_AppConfig;
-const uint32_t flash_address = 0x0801F800;
 
 float v_vitesse_vent;
 
@@ -28,6 +29,16 @@ float v_ADC1_IN10;
 float v_ADC2_IN10;
 UART_HandleTypeDef hUART1;
 UART_HandleTypeDef hUART2;
+DMA_HandleTypeDef hdma_usart2_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
+uint8_t uart2_rx_dma_buffer[UART2_RX_DMA_BUFFER_SIZE];
+uart_rx_stats_t v_uart2_rx_stats;
+uart_tx_stats_t v_uart2_tx_stats;
+cdc_rx_stats_t v_cdc_rx_stats;
+cdc_tx_stats_t v_cdc_tx_stats;
+volatile uint16_t uart2_rx_dma_position;	/* Position du tampon DMA jusqu'à laquelle les octets ont été publiés */
+flash_pipe_stats_t v_flash_pipe_stats;
+menu_stats_t v_menu_stats;
 TIM_HandleTypeDef    TimHandle;
 I2C_HandleTypeDef hi2c1;
 float v_temperture_TM1075;
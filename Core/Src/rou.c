@@ -1,182 +1,185 @@
 #include <inc.h>
 
+/**
+ * @file rou.c
+ * @brief Émission USART2 non bloquante : file d'émission vidée par DMA.
+ *
+ * Les octets à émettre sont copiés dans usart2_tx_fifo ; le DMA (DMA1 Channel 2)
+ * transmet le plus long segment contigu de la file, puis l'interruption de fin
+ * de transfert libère ce segment et lance le suivant. L'appelant ne paie que la
+ * copie : la réception et le traitement des trames continuent pendant l'émission.
+ *
+ * UART2_Send() (liaison transport_uart2, voir transport.c), SendStringFTDI() et
+ * SendCharFTDI() n'attendent que si la file est pleine, au plus
+ * UART2_TX_TIMEOUT_MS (les octets restants sont alors perdus et comptés).
+ * UART2_TxFlush() attend la fin de l'émission, avant un changement de débit ou le
+ * saut vers l'application.
+ *
+ * Réception : UART2_RxEvent() publie dans usart2_fifo les octets déposés par le
+ * DMA circulaire (demi-tampon, tampon complet, ligne inactive) ; UART2_RxError()
+ * relance le DMA après une erreur UART sans perdre les octets déjà reçus.
+ */
+
 //void Read_Structure_From_Flash(uint32_t address, void *data, size_t size) {
 //    // Copier les données de la Flash vers la structure
 //    memcpy(data, (void *)address, size);
 //}
 
+/* Transfert DMA en cours : longueur du segment de usart2_tx_fifo en émission */
+static volatile bool uart2_tx_busy = false;
+static volatile uint32_t uart2_tx_length = 0U;
 
-void SendCharFTDI(char Carac) {
-	(void)HAL_UART_Transmit(&hUART2, (uint8_t *)&Carac, 1, HAL_MAX_DELAY);
+/**
+ * @brief Lance l'émission du segment contigu en tête de la file, si le DMA est libre.
+ *
+ * Appelée avec les interruptions masquées, ou depuis l'interruption de fin de transfert.
+ */
+static void UART2_TxStart(void) {
+	fifo_span_t span;
+
+	if (uart2_tx_busy || (fifo_peek(&usart2_tx_fifo, 0U, FIFO_BUFFER_SIZE, &span) == 0U)) {
+		return;
+	}
+	uart2_tx_busy = true;
+	uart2_tx_length = span.length[0];
+	v_uart2_tx_stats.transfers++;
+	if (HAL_UART_Transmit_DMA(&hUART2, span.data[0], (uint16_t)span.length[0]) != HAL_OK) {
+		uart2_tx_busy = false;
+	}
 }
 
-
-void SendStringFTDI(char *Chaine) {
-	(void)HAL_UART_Transmit(&hUART2, (uint8_t *)Chaine, strlen(Chaine), HAL_MAX_DELAY);
-}
 /**
- * @brief Initialise la broche PA0 (par exemple) en mode EXTI (front montant).
- * @return Aucun.
+ * @brief Vide la file d'émission (initialisation de l'USART2, DMA arrêté).
  */
-void MX_GPIO_EXTI0_Init(void)
-{
-  GPIO_InitTypeDef GPIO_InitStruct;
-
-  /* Activer l'horloge du GPIOA (si PA0) */
-  __HAL_RCC_GPIOA_CLK_ENABLE();
-
-  /* Config de la pin PA0 en mode interrupt rising */
-  GPIO_InitStruct.Pin  = GPIO_PIN_0;
-  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
-  GPIO_InitStruct.Pull = GPIO_NOPULL;
-  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
-
-  /* Configurer la priorité EXTI0 et activer l’IRQ */
-  HAL_NVIC_SetPriority(EXTI0_IRQn, 2U, 0U);
-  HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+void UART2_TxReset(void) {
+	fifo_init(&usart2_tx_fifo);
+	uart2_tx_busy = false;
+	uart2_tx_length = 0U;
 }
 
+/**
+ * @brief Fin d'un transfert DMA : libère le segment émis et lance le suivant.
+ *
+ * Appelée par HAL_UART_TxCpltCallback().
+ */
+void UART2_TxComplete(void) {
+	fifo_commit(&usart2_tx_fifo, uart2_tx_length);
+	v_uart2_tx_stats.bytes += uart2_tx_length;
+	uart2_tx_length = 0U;
+	uart2_tx_busy = false;
+	UART2_TxStart();
+}
 
 /**
- * @brief Initialise TIM2 pour un tick de 1 µs.
+ * @brief Dépose des octets dans la file d'émission, sans attendre.
  *
- * Cette fonction configure TIM2 avec un préscaler calculé à partir de SystemCoreClock.
- * La fréquence d'horloge du compteur TIM2 est ainsi réglée sur 1 MHz (1 µs par tick).
+ * @param[in] data   Octets à émettre.
+ * @param[in] length Nombre d'octets.
+ * @return uint32_t Nombre d'octets acceptés (inférieur à length si la file est pleine).
+ */
+uint32_t UART2_TxWrite(const uint8_t *data, uint32_t length) {
+	uint32_t written = fifo_in(&usart2_tx_fifo, data, length);
+	uint32_t used = fifo_len(&usart2_tx_fifo);
+
+	if (used > v_uart2_tx_stats.high_water) {
+		v_uart2_tx_stats.high_water = used;
+	}
+	__disable_irq();
+	UART2_TxStart();
+	__enable_irq();
+	return written;
+}
+
+/**
+ * @brief Attend la fin de l'émission de la file.
  *
- * @note Il est impératif que SystemCoreClock contienne la fréquence réelle du processeur.
+ * @param[in] timeout_ms Délai maximal en millisecondes.
+ * @return int FIFO_OK si tous les octets ont été émis, FIFO_ERROR en cas de timeout.
  */
-void MX_TIM2_Init_1us(void)
-{
-    uint32_t uwPrescalerValue = 0U;
-
-    /* Activer l'horloge pour TIM2 */
-    __HAL_RCC_TIM2_CLK_ENABLE();
-
-    /* Calculer le préscaler pour obtenir une fréquence de 1 MHz.
-     * SystemCoreClock correspond à la fréquence du processeur.
-     * On souhaite que : f_timer = SystemCoreClock / (uwPrescalerValue + 1) = 1 MHz.
-     * Donc, uwPrescalerValue = (SystemCoreClock / 1e6) - 1.
-     */
-    uwPrescalerValue = (uint32_t)(SystemCoreClock / 1000000U) - 1U;
-
-    /* Configuration du timer TIM2 */
-    htim2.Instance               = TIM2;
-    htim2.Init.Prescaler         = uwPrescalerValue;
-    htim2.Init.CounterMode       = TIM_COUNTERMODE_UP;
-    htim2.Init.Period            = 0xFFFFFFFFUL;  /* Compteur 32 bits */
-    htim2.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
-    htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
-
-    /* Initialisation du timer */
-    if (HAL_TIM_Base_Init(&htim2) != HAL_OK)
-    {
-        /* Gestion de l'erreur */
-        Error_Handler();
-    }
-
-    /* Lancer le timer en mode base */
-    if (HAL_TIM_Base_Start(&htim2) != HAL_OK)
-    {
-        /* Gestion de l'erreur */
-        Error_Handler();
-    }
+int UART2_TxFlush(uint32_t timeout_ms) {
+	uint32_t start_time = HAL_GetTick();
+
+	while (uart2_tx_busy || (fifo_len(&usart2_tx_fifo) != 0U)) {
+		if ((HAL_GetTick() - start_time) >= timeout_ms) {
+			return FIFO_ERROR;
+		}
+	}
+	return FIFO_OK;
 }
 
-///**
-// * @brief  Initialise TIM2 pour qu'il incrémente à 1 MHz (1 µs par tick).
-// *         APB1 = 16 MHz => Prescaler = 15 => 1 MHz.
-// * @return Aucun.
-// */
-//void MX_TIM2_Init_1us(void)
-//{
-//  /* Activer l'horloge pour TIM2 */
-//  __HAL_RCC_TIM2_CLK_ENABLE();
-
-//  /* Configurer le handle htim2 */
-//  htim2.Instance               = TIM2;
-//  htim2.Init.Prescaler         = (uint32_t)(2UL - 1UL); /* PSC = 15 pour diviser 16 MHz par 16 => 1 MHz */
-//  htim2.Init.CounterMode       = TIM_COUNTERMODE_UP;
-//  htim2.Init.Period            = 0xFFFFFFFFUL;           /* 32 bits entier */
-//  htim2.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
-//  htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
-
-//  /* Initialisation du timer */
-//  if (HAL_TIM_Base_Init(&htim2) != HAL_OK)
-//  {
-//    /* Gérer l'erreur */
-//    Error_Handler();
-//  }
-
-//  /* Lancer le timer en mode libre (base) */
-//  if (HAL_TIM_Base_Start(&htim2) != HAL_OK)
-//  {
-//    /* Gérer l'erreur */
-//    Error_Handler();
-//  }
-//}
+/**
+ * @brief Dépose des octets dans la file, en attendant de la place si elle est pleine.
+ *
+ * Fonction d'émission de transport_uart2 (transport.c).
+ */
+void UART2_Send(const uint8_t *data, uint32_t length) {
+	uint32_t start_time = HAL_GetTick();
+	uint32_t written;
+
+	written = UART2_TxWrite(data, length);
+	while (written < length) {
+		if ((HAL_GetTick() - start_time) >= UART2_TX_TIMEOUT_MS) {
+			v_uart2_tx_stats.dropped += length - written;
+			return;
+		}
+		v_uart2_tx_stats.waits++;
+		written += UART2_TxWrite(&data[written], length - written);
+	}
+}
 
+/**
+ * @brief Publie dans la FIFO les octets déposés par le DMA jusqu'à une position du tampon.
+ *
+ * Appelée par HAL_UARTEx_RxEventCallback() : @p position est la position
+ * d'écriture du DMA dans uart2_rx_dma_buffer (UART2_RX_DMA_BUFFER_SIZE en fin de
+ * tampon). Un évènement déjà traité (position non postérieure à la dernière
+ * publication, interruptions servies dans le désordre après un blocage) est ignoré.
+ *
+ * @param[in] position Position d'écriture du DMA.
+ */
+void UART2_RxEvent(uint16_t position) {
+	uint16_t length;
+	unsigned int copied;
+
+	v_uart2_rx_stats.events++;
+	if (position <= uart2_rx_dma_position) {
+		return;
+	}
+	length = position - uart2_rx_dma_position;
+	copied = fifo_in(&usart2_fifo, &uart2_rx_dma_buffer[uart2_rx_dma_position], length);
+	v_uart2_rx_stats.bytes += copied;
+	v_uart2_rx_stats.dropped += (uint32_t)length - copied;
+	/* Le DMA circulaire est revenu au début du tampon */
+	uart2_rx_dma_position = (position >= UART2_RX_DMA_BUFFER_SIZE) ? 0U : position;
+}
 
-// Initialisation de Timer2 en mode Input Capture
-void MX_TIM2_Init(void) {
- /* Activer l’horloge de TIM2 */
-  __HAL_RCC_TIM2_CLK_ENABLE();
-
-  /* Préparer le handle */
-  htim2.Instance = TIM2;
-  htim2.Init.Prescaler         = (uint32_t)(16UL - 1UL); /* APB1=16 MHz => division par 16 => 1 MHz => 1 tick/us */
-  htim2.Init.CounterMode       = TIM_COUNTERMODE_UP;
-  htim2.Init.Period            = 0xFFFFFFFFUL;           /* 32 bits plein */
-  htim2.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
-  htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
-
-  /* Initialisation */
-  if (HAL_TIM_Base_Init(&htim2) != HAL_OK)
-  {
-    /* Gérer l'erreur */
-    Error_Handler();
-  }
-
-  /* Lancer le timer en mode "base" (libre) */
-  if (HAL_TIM_Base_Start(&htim2) != HAL_OK)
-  {
-    /* Gérer l'erreur */
-    Error_Handler();
-  }
+/**
+ * @brief Relance la réception DMA après une erreur UART (overrun, bruit, trame).
+ *
+ * Appelée par HAL_UART_ErrorCallback(). Le DMA est arrêté, puis les octets reçus
+ * depuis la dernière publication sont publiés jusqu'à sa position d'écriture
+ * (taille du tampon moins NDTR, figé par l'arrêt) avant la relance au début du
+ * tampon. L'arrêt efface les évènements de demi-tampon et de tampon complet encore
+ * en attente : un retour au début non publié est traité ici.
+ */
+void UART2_RxError(void) {
+	uint16_t position;
+
+	v_uart2_rx_stats.errors++;
+	(void)HAL_UART_AbortReceive(&hUART2);
+	position = (uint16_t)(UART2_RX_DMA_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(hUART2.hdmarx));
+	if (position < uart2_rx_dma_position) {
+		UART2_RxEvent(UART2_RX_DMA_BUFFER_SIZE);
+	}
+	UART2_RxEvent(position);
+	UART2_StartReceiveDMA();
 }
 
-void MX_TIM2_IC_CH1_Init(void)
-{
-  TIM_IC_InitTypeDef sConfigIC;
-
-  /* TIM2 est déjà initialisé (MX_TIM2_Init_1us).
-   * On le re-configure en mode Input Capture sur la Channel 1.
-   */
-
-  if (HAL_TIM_IC_Init(&htim2) != HAL_OK)
-  {
-    /* Erreur */
-    Error_Handler();
-  }
-
-  /* Configuration de la Channel 1 en capture sur front montant */
-  (void)memset((void*)&sConfigIC, 0, sizeof(sConfigIC));
-  sConfigIC.ICPolarity  = TIM_ICPOLARITY_RISING;
-  sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
-  sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
-  sConfigIC.ICFilter    = 0U;
-
-  if (HAL_TIM_IC_ConfigChannel(&htim2, &sConfigIC, TIM_CHANNEL_1) != HAL_OK)
-  {
-    /* Erreur */
-    Error_Handler();
-  }
-
-  /* Démarrer la capture sur CH1 (on peut, ou non, activer l’interruption timer) */
-  if (HAL_TIM_IC_Start(&htim2, TIM_CHANNEL_1) != HAL_OK)
-  {
-    /* Erreur */
-    Error_Handler();
-  }
+void SendCharFTDI(char Carac) {
+	UART2_Send((const uint8_t *)&Carac, 1U);
 }
 
 
+void SendStringFTDI(char *Chaine) {
+	UART2_Send((const uint8_t *)Chaine, (uint32_t)strlen(Chaine));
+}
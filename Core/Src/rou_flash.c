@@ -1,9 +1,5 @@
 #include "inc.h"
 
-#define L_MAJEUR_VERSION 0L
-#define L_MINEUR_VERSION 0L
-#define L_RELEASE_VERSION 'a'
-
 
 void Read_UniqueID(uint32_t *id) {
     id[0] = *(uint32_t *)0x1FFF7590;  // Lire le premier mot de l'ID
@@ -17,35 +13,162 @@ void Read_Structure_From_Flash(uint32_t address, void *data, size_t size) {
 }
 
 /**
- * @brief Lit la configuration stockée en Flash.
+ * @brief Champs de AppConfig_t enregistrés dans le journal de configuration (kvlog.c).
+ *
+ * Rangés dans l'ordre des clés : config_log_fields[key] décrit la clé key.
+ */
+static const struct
+{
+    uint32_t key;       /**< Clé du journal. */
+    size_t offset;      /**< Position du champ dans AppConfig_t. */
+} config_log_fields[] =
+{
+    { KVLOG_KEY_COEF_ANEMO,  offsetof(AppConfig_t, CoefAnemo)  },
+    { KVLOG_KEY_COEF_PLUVIO, offsetof(AppConfig_t, CoefPluvio) },
+    { KVLOG_KEY_TEMP_A,      offsetof(AppConfig_t, Temp_A)     },
+    { KVLOG_KEY_TEMP_B,      offsetof(AppConfig_t, Temp_B)     },
+};
+
+#define CONFIG_LOG_FIELDS   (sizeof(config_log_fields) / sizeof(config_log_fields[0]))
+
+/**
+ * @brief Retourne la configuration stockée en Flash, lue en place.
+ *
+ * Les coefficients modifiés depuis le menu sont dans le journal de configuration :
+ * les lire par Config_Get_Float().
  *
- * Copie la structure AppConfig_t depuis l’adresse APP_CONFIG_ADDRESS.
+ * @return const AppConfig_t* Configuration en Flash (page flash_address_config).
+ */
+const AppConfig_t *Config_Get(void) {
+	return (const AppConfig_t *)flash_address_config;
+}
+
+/**
+ * @brief Lit un coefficient : valeur du journal, sinon valeur de la page AppConfig_t.
  *
- * @param[out] config Pointeur sur une structure AppConfig_t dans laquelle la configuration sera copiée.
+ * @param[in] key Clé du champ (KVLOG_KEY_xxx).
+ * @return float Valeur courante, 0 si la clé est inconnue.
  */
-void Config_Read(AppConfig_t * const config) {
-	uint32_t unique_id[3];	
-	AppConfig_t config_read_back;
-//    const AppConfig_t * flash_config = (const AppConfig_t *)APP_CONFIG_ADDRESS;
-    Read_Structure_From_Flash(flash_address_config, &config_read_back, sizeof(AppConfig_t));
-	
-
-	if (config_read_back.uniqueID0 == 0xFFFFFFFF) {
+float Config_Get_Float(uint32_t key) {
+	uint32_t value;
+	float result = 0.0F;
+
+	if (key >= CONFIG_LOG_FIELDS) {
+		return result;
+	}
+	if (kvlog_get(key, &value) != KVLOG_OK) {
+		(void)memcpy(&value, (const uint8_t *)Config_Get() + config_log_fields[key].offset, sizeof(value));
+	}
+	(void)memcpy(&result, &value, sizeof(result));
+	return result;
+}
+
+/**
+ * @brief Prépare la page de configuration au démarrage.
+ *
+ * Page vierge : écriture des valeurs par défaut. Page de version 0 (disposition
+ * d'origine, sans champ Schema) : la version est programmée en place si le double
+ * mot correspondant est encore effacé, la page est réécrite sinon. Une version plus
+ * récente que CONFIG_SCHEMA_VERSION est laissée telle quelle.
+ */
+void Config_Init(void) {
+	const AppConfig_t * const flash_config = Config_Get();
+	AppConfig_t config;
+	uint32_t unique_id[3];
+	uint32_t schema[2];
+	fifo_span_t span;
+
+	if (flash_config->uniqueID0 == 0xFFFFFFFF) {
+		(void)memset(&config, 0, sizeof(config));
 		Read_UniqueID(unique_id);	
-		config_read_back.uniqueID0  = unique_id[0];
-		config_read_back.uniqueID1  = unique_id[1];
-		config_read_back.uniqueID2  = unique_id[2];
-		config_read_back.CoefAnemo  = 1.1176f; 
-		config_read_back.CoefPluvio = 0.2f;
-		config_read_back.Temp_A =  1.0f;
-		config_read_back.Temp_B = 0.0f;
-		config_read_back.MAJEUR_VERSION  = L_MAJEUR_VERSION;
-		config_read_back.MINEUR_VERSION  = L_MINEUR_VERSION;
-		config_read_back.RELEASE_VERSION = L_RELEASE_VERSION;
-		Write_Structure_To_Flash(flash_address_config, &config_read_back, sizeof(AppConfig_t));
+		config.uniqueID0  = unique_id[0];
+		config.uniqueID1  = unique_id[1];
+		config.uniqueID2  = unique_id[2];
+		config.CoefAnemo  = 1.1176f; 
+		config.CoefPluvio = 0.2f;
+		config.Temp_A =  1.0f;
+		config.Temp_B = 0.0f;
+		config.MAJEUR_VERSION  = L_MAJEUR_VERSION;
+		config.MINEUR_VERSION  = L_MINEUR_VERSION;
+		config.RELEASE_VERSION = L_RELEASE_VERSION;
+		config.Schema = CONFIG_SCHEMA_MAGIC | CONFIG_SCHEMA_VERSION;
+		config.Reserved = 0xFFFFFFFF;
+		Write_Structure_To_Flash(flash_address_config, &config, sizeof(AppConfig_t));
+		return;
 	}
-	(void)memcpy(config, &config_read_back, sizeof(AppConfig_t));
 
+	if ((flash_config->Schema & CONFIG_SCHEMA_MASK) == CONFIG_SCHEMA_MAGIC) {
+		/* Version 1 ou plus récente : rien à migrer */
+		return;
+	}
+
+	/* Version 0 -> 1 : seul le champ Schema s'ajoute à la disposition d'origine */
+	schema[0] = CONFIG_SCHEMA_MAGIC | CONFIG_SCHEMA_VERSION;
+	schema[1] = 0xFFFFFFFF;
+	if ((flash_config->Schema == 0xFFFFFFFF) && (flash_config->Reserved == 0xFFFFFFFF)) {
+		span.data[0] = (const uint8_t *)schema;
+		span.length[0] = sizeof(schema);
+		span.data[1] = NULL;
+		span.length[1] = 0U;
+		if (flash_program_span(flash_address_config + offsetof(AppConfig_t, Schema), &span) == 0) {
+			return;
+		}
+	}
+	(void)memcpy(&config, flash_config, sizeof(config));
+	config.Schema = schema[0];
+	config.Reserved = schema[1];
+	Write_Structure_To_Flash(flash_address_config, &config, sizeof(AppConfig_t));
+}
+
+/**
+ * @brief Applique à une configuration les valeurs du journal de configuration.
+ *
+ * Les valeurs modifiées depuis le menu sont plus récentes que la page AppConfig_t.
+ *
+ * @param[in,out] config Configuration lue depuis la page AppConfig_t.
+ */
+void Config_Merge(AppConfig_t * const config) {
+	uint32_t i;
+	uint32_t value;
+
+	for (i = 0U; i < CONFIG_LOG_FIELDS; i++) {
+		if (kvlog_get(config_log_fields[i].key, &value) == KVLOG_OK) {
+			(void)memcpy((uint8_t *)config + config_log_fields[i].offset, &value, sizeof(value));
+		}
+	}
+}
+
+/**
+ * @brief Publie la configuration dans la page lue par l'application avant le saut.
+ *
+ * Les coefficients du journal sont recopiés dans la page, qui n'est effacée et
+ * réécrite que si son contenu change. Les échanges à chaque lancement (ancien
+ * "TOOB" de Boot_Bootloader) passent par la boîte aux lettres (handoff.c).
+ */
+void Config_Publish(void) {
+	AppConfig_t config;
+
+	(void)memcpy(&config, Config_Get(), sizeof(config));
+	Config_Merge(&config);
+	if (memcmp(&config, Config_Get(), sizeof(config)) != 0) {
+		Write_Structure_To_Flash(flash_address_config, &config, sizeof(AppConfig_t));
+	}
+}
+
+/**
+ * @brief Enregistre un coefficient modifié dans le journal de configuration.
+ *
+ * Remplace la réécriture de la page AppConfig_t : un seul double mot est programmé.
+ *
+ * @param[in] key   Clé du champ (KVLOG_KEY_xxx).
+ * @param[in] value Nouvelle valeur.
+ * @return int KVLOG_OK en cas de succès, KVLOG_ERROR sinon.
+ */
+int Config_Write_Value(uint32_t key, float value) {
+	uint32_t raw;
+
+	(void)memcpy(&raw, &value, sizeof(raw));
+	return kvlog_set(key, raw);
 }
 
 void Write_Structure_To_Flash(uint32_t address, void *data, size_t size) {
@@ -84,26 +207,39 @@ void Write_Structure_To_Flash(uint32_t address, void *data, size_t size) {
 }
 
 /**
- * @brief Efface une plage de mémoire Flash.
+ * @brief Efface en une seule opération une suite de pages de 2 ko.
+ *
+ * Remplace l'effacement page par page lorsque la taille de l'image est connue :
+ * une seule requête HAL_FLASHEx_Erase() pour toute la plage.
  *
- * @param[in] start_address Adresse de début.
- * @param[in] end_address   Adresse de fin.
+ * @param[in] address Adresse de la première page (alignée sur une page).
+ * @param[in] count   Nombre de pages.
+ * @return int  0 en cas de succès, une valeur négative en cas d'erreur.
  */
-void Flash_Erase(uint32_t start_address, uint32_t end_address) {
+int flash_erase_pages(uint32_t address, uint32_t count)
+{
     FLASH_EraseInitTypeDef erase_init;
     uint32_t page_error = 0U;
-    uint32_t nb_pages;
+    int ret = 0;
 
-    nb_pages = ((end_address - start_address) + 1U) / FLASH_PAGE_SIZE;
+    if (((address % FLASH_PAGE_SIZE) != 0U) || (count == 0U))
+    {
+        return -1;
+    }
+    if (HAL_FLASH_Unlock() != HAL_OK)
+    {
+        return -2;
+    }
     erase_init.TypeErase   = FLASH_TYPEERASE_PAGES;
-    erase_init.Page        = start_address;
-    erase_init.NbPages     = nb_pages;
-
+    erase_init.Banks       = FLASH_BANK_1;
+    erase_init.Page        = (address - FLASH_BASE_ADDRESS) / FLASH_PAGE_SIZE;
+    erase_init.NbPages     = count;
     if (HAL_FLASHEx_Erase(&erase_init, &page_error) != HAL_OK)
     {
-        SendStringFTDI("Flash erase error.\r\n");
-
+        ret = -3;
     }
+    (void)HAL_FLASH_Lock();
+    return ret;
 }
 
 /**
@@ -140,59 +276,212 @@ static int flash_erase_sector(uint32_t address)
 }
 
 /**
- * @brief Écrit des données en Flash pour le STM32G431.
+ * @brief Efface une page de 2 ko de la mémoire Flash.
  *
- * Cette fonction efface le secteur de 2 ko contenant l'adresse cible,
- * puis programme les données par double mot (64 bits, 8 octets) via HAL_FLASH_Program().
- * La zone flash doit être effacée au préalable ou être effacée par cette fonction.
+ * Version autonome de flash_erase_sector() : la Flash est déverrouillée le temps
+ * de l'effacement puis reverrouillée.
  *
- * @param[in] address Adresse de début en flash (doit être alignée sur 8 octets et se trouver sur un secteur de 2 ko).
- * @param[in] data    Pointeur vers le buffer source contenant les données à écrire.
- * @param[in] length  Longueur des données à écrire en octets (doit être multiple de 8 et ≤ 2048).
+ * @param[in] address Adresse située dans la page à effacer.
  * @return int  0 en cas de succès, une valeur négative en cas d'erreur.
  */
-int flash_write(uint32_t address, const uint8_t *data, uint32_t length)
+int flash_erase_page(uint32_t address)
+{
+    int ret;
+
+    if (HAL_FLASH_Unlock() != HAL_OK)
+    {
+        return -2;
+    }
+    ret = flash_erase_sector(address);
+    (void)HAL_FLASH_Lock();
+    return ret;
+}
+
+/**
+ * @brief Programme en Flash une plage d'octets décrite par un descripteur de FIFO.
+ *
+ * Les octets sont lus directement dans les segments du descripteur, sans copie
+ * intermédiaire de la plage complète : seul un double mot chevauchant la frontière
+ * entre les deux segments est reconstitué dans une variable locale. Un dernier
+ * double mot incomplet est complété par 0xFF. La zone doit avoir été effacée.
+ *
+ * @param[in] address Adresse de début en Flash (alignée sur 8 octets).
+ * @param[in] span    Descripteur des données à programmer.
+ * @return int  0 en cas de succès, une valeur négative en cas d'erreur.
+ */
+int flash_program_span(uint32_t address, const fifo_span_t *span)
 {
     HAL_StatusTypeDef status;
-    uint32_t addr = address;
-    uint32_t end_addr = address + length;
+    uint8_t bytes[sizeof(uint64_t)];
     uint64_t dword;
-    
-    /* Effacer le secteur de 2 ko contenant l'adresse */
-    if (flash_erase_sector(address) != 0)
+    uint32_t segment = 0U;
+    uint32_t pos = 0U;
+    uint32_t fill = 0U;
+
+    if ((span == NULL) || ((address % sizeof(uint64_t)) != 0U))
     {
         return -1;
     }
 
-    /* Déverrouillage de la Flash */
     status = HAL_FLASH_Unlock();
     if (status != HAL_OK)
     {
         return -2;
     }
 
-    /* Programmation par double mot (8 octets à la fois) */
-    while (addr < end_addr)
+    while (segment < 2U)
     {
-        /* Copie de 8 octets depuis le buffer source dans une variable locale */
-        (void)memcpy(&dword, data, sizeof(dword));
+        if (pos >= span->length[segment])
+        {
+            segment++;
+            pos = 0U;
+            continue;
+        }
 
-        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, addr, dword);
+        if ((fill == 0U) && ((span->length[segment] - pos) >= sizeof(dword)))
+        {
+            /* Double mot entièrement contenu dans le segment courant */
+            (void)memcpy(&dword, &span->data[segment][pos], sizeof(dword));
+            pos += sizeof(dword);
+        }
+        else
+        {
+            /* Double mot à cheval sur les deux segments ou en fin de plage */
+            bytes[fill] = span->data[segment][pos];
+            fill++;
+            pos++;
+            if (fill < sizeof(bytes))
+            {
+                continue;
+            }
+            (void)memcpy(&dword, bytes, sizeof(dword));
+            fill = 0U;
+        }
+
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, address, dword);
         if (status != HAL_OK)
         {
             (void)HAL_FLASH_Lock();
             return -3;
         }
-        addr += sizeof(dword);
-        data += sizeof(dword);
+        address += sizeof(dword);
     }
 
-    /* Verrouillage de la Flash */
-    (void)HAL_FLASH_Lock();
+    if (fill != 0U)
+    {
+        (void)memset(&bytes[fill], 0xFF, sizeof(bytes) - fill);
+        (void)memcpy(&dword, bytes, sizeof(dword));
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, address, dword);
+        if (status != HAL_OK)
+        {
+            (void)HAL_FLASH_Lock();
+            return -3;
+        }
+    }
 
+    (void)HAL_FLASH_Lock();
     return 0;
 }
 
+/**
+ * @brief Programme une zone effacée par lignes de FLASH_ROW_SIZE octets.
+ *
+ * Les lignes entièrement à 0xFF ne sont pas programmées (la flash effacée contient
+ * déjà cette valeur). Les lignes complètes et alignées sont écrites en mode rapide
+ * (flash_fast.c) si HCLK le permet, les autres par double mot.
+ *
+ * @param[in] address Adresse de début en Flash (alignée sur 8 octets).
+ * @param[in] data    Données à programmer (alignées sur 4 octets).
+ * @param[in] length  Nombre d'octets (multiple de 8).
+ * @return int  Nombre de lignes vierges ignorées, une valeur négative en cas d'erreur.
+ */
+int flash_program_rows(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    fifo_span_t span;
+    bool fast = (HAL_RCC_GetHCLKFreq() >= 8000000U);
+    uint32_t skipped = 0U;
+    uint32_t n;
+    uint32_t i;
+    bool blank;
+
+    if (((address % sizeof(uint64_t)) != 0U) || ((length % sizeof(uint64_t)) != 0U))
+    {
+        return -1;
+    }
+
+    while (length > 0U)
+    {
+        /* Jusqu'à la fin de la ligne courante */
+        n = FLASH_ROW_SIZE - (address % FLASH_ROW_SIZE);
+        if (n > length)
+        {
+            n = length;
+        }
+
+        blank = true;
+        for (i = 0U; (i < n) && blank; i += sizeof(uint32_t))
+        {
+            blank = (*(const uint32_t *)&data[i] == 0xFFFFFFFFUL);
+        }
+
+        if (blank)
+        {
+            skipped++;
+        }
+        else if (fast && (n == FLASH_ROW_SIZE))
+        {
+            if (HAL_FLASH_Unlock() != HAL_OK)
+            {
+                return -2;
+            }
+            i = (uint32_t)flash_fast_program_row(address, (const uint32_t *)data);
+            (void)HAL_FLASH_Lock();
+            if (i != 0U)
+            {
+                return -3;
+            }
+        }
+        else
+        {
+            span.data[0] = data;
+            span.length[0] = n;
+            span.data[1] = NULL;
+            span.length[1] = 0U;
+            if (flash_program_span(address, &span) != 0)
+            {
+                return -3;
+            }
+        }
+        address += n;
+        data += n;
+        length -= n;
+    }
+    return (int)skipped;
+}
+
+/**
+ * @brief Écrit des données en Flash pour le STM32G431.
+ *
+ * Cette fonction efface le secteur de 2 ko contenant l'adresse cible, puis programme
+ * les données par lignes de 256 octets en mode rapide (voir flash_program_rows()) ;
+ * les lignes vierges ne sont pas programmées.
+ *
+ * @param[in] address Adresse de début en flash (doit être alignée sur 8 octets et se trouver sur un secteur de 2 ko).
+ * @param[in] data    Pointeur vers le buffer source contenant les données à écrire (aligné sur 4 octets).
+ * @param[in] length  Longueur des données à écrire en octets (doit être multiple de 8 et ≤ 2048).
+ * @return int  0 en cas de succès, une valeur négative en cas d'erreur.
+ */
+int flash_write(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    /* Effacer le secteur de 2 ko contenant l'adresse */
+    if (flash_erase_page(address) != 0)
+    {
+        return -1;
+    }
+
+    return (flash_program_rows(address, data, length) < 0) ? -3 : 0;
+}
+
 /**
  * @brief Lit des données depuis la Flash.
  *
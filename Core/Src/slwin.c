@@ -0,0 +1,347 @@
+#include "inc.h"
+
+/**
+ * @file slwin.c
+ * @brief Réception de firmware par protocole à fenêtre glissante avec retransmission sélective.
+ *
+ * Chaque trame est encodée en COBS et terminée par 0x00, ce qui permet de se
+ * resynchroniser sur la trame suivante après une erreur. Contenu d'une trame décodée :
+ *
+ *     type (1) | séquence (1) | données (0 à SLWIN_BLOCK_SIZE) | CRC16 (2, MSB en tête)
+ *
+ * Le CRC16 (polynôme 0x1021, comme XMODEM) porte sur le type, la séquence et les
+ * données. L'émetteur peut avoir jusqu'à SLWIN_WINDOW blocs DATA non acquittés.
+ * Le récepteur répond à chaque trame par un ACK contenant la séquence attendue
+ * (acquittement cumulatif de tous les blocs précédents) et un masque des blocs
+ * suivants déjà reçus (bit i : séquence attendue + 1 + i). L'émetteur ne réémet
+ * que les blocs absents. Sans trame pendant SLWIN_ACK_TIMEOUT_MS, le récepteur
+ * répète son dernier ACK.
+ *
+ * Les blocs sont transmis dans l'ordre au pipeline d'écriture flash ; le bloc
+ * attendu est écrit directement depuis la trame reçue, seuls les blocs arrivés
+ * en avance sont conservés dans la fenêtre.
+ */
+
+/* Types de trame */
+#define SLWIN_TYPE_DATA     0x01U   /**< Émetteur : bloc de données */
+#define SLWIN_TYPE_END      0x02U   /**< Émetteur : fin de l'image (numérotée comme un bloc) */
+#define SLWIN_TYPE_ABORT    0x18U   /**< Annulation de la session (dans les deux sens) */
+#define SLWIN_TYPE_READY    0x80U   /**< Récepteur : prêt, taille de fenêtre en donnée */
+#define SLWIN_TYPE_ACK      0x81U   /**< Récepteur : séquence attendue et masque des blocs reçus */
+
+/* Type + séquence en tête de trame, CRC16 en fin de trame */
+#define SLWIN_HEADER_SIZE   2U
+#define SLWIN_TRAILER_SIZE  2U
+#define SLWIN_FRAME_SIZE    (SLWIN_HEADER_SIZE + SLWIN_BLOCK_SIZE + SLWIN_TRAILER_SIZE)
+
+/* Trame encodée la plus longue : un octet de code par tranche de 254 octets, plus un */
+#define SLWIN_ENCODED_SIZE  (SLWIN_FRAME_SIZE + (SLWIN_FRAME_SIZE / 254U) + 1U)
+
+/* Les blocs en avance sont rangés par séquence (8 bits) modulo SLWIN_WINDOW, et le
+   masque de l'ACK couvre SLWIN_WINDOW - 1 blocs sur 7 bits */
+_Static_assert(((SLWIN_WINDOW & (SLWIN_WINDOW - 1U)) == 0U) && (SLWIN_WINDOW >= 2U) && (SLWIN_WINDOW <= 8U),
+               "SLWIN_WINDOW : puissance de 2 entre 2 et 8");
+
+/* Retours internes de la lecture d'une trame */
+#define SLWIN_READ_TIMEOUT  (0)
+#define SLWIN_READ_ABORT    (-1)
+
+
+/** Trame en cours de réception (encodée), décodée en place une fois complète. */
+static uint8_t slwin_frame[SLWIN_ENCODED_SIZE];
+static uint32_t slwin_frame_length;
+static bool slwin_frame_overflow;
+
+/** Blocs reçus en avance, rangés par séquence modulo SLWIN_WINDOW. */
+static uint8_t slwin_slot[SLWIN_WINDOW][SLWIN_BLOCK_SIZE];
+static uint16_t slwin_slot_length[SLWIN_WINDOW];
+static uint8_t slwin_slot_type[SLWIN_WINDOW];
+static uint8_t slwin_slot_seq[SLWIN_WINDOW];
+static bool slwin_slot_valid[SLWIN_WINDOW];
+
+/** Prochaine séquence à transmettre à la flash. */
+static uint8_t slwin_base;
+/** Nombre de blocs DATA transmis à la flash. */
+static uint32_t slwin_blocks;
+
+/** Liaison de la session en cours. */
+static const transport_t *slwin_link;
+/** Reçoit les blocs dans l'ordre (flash_write_callback()). */
+static xmodem_block_callback_t slwin_callback;
+
+
+/**
+ * @brief Encode et envoie une trame courte du récepteur.
+ *
+ * @param[in] type Type de trame.
+ * @param[in] seq  Octet de séquence.
+ * @param[in] arg  Octet de donnée (taille de fenêtre, masque de réception...).
+ */
+static void slwin_send(uint8_t type, uint8_t seq, uint8_t arg)
+{
+    uint8_t raw[SLWIN_HEADER_SIZE + 1U + SLWIN_TRAILER_SIZE];
+    uint8_t encoded[sizeof(raw) + 2U];
+    uint32_t length;
+    uint16_t crc;
+
+    raw[0] = type;
+    raw[1] = seq;
+    raw[2] = arg;
+    crc = crc16_final(crc16_update(crc16_init(), raw, 3U));
+    raw[3] = (uint8_t)(crc >> 8U);
+    raw[4] = (uint8_t)crc;
+
+    length = cobs_encode(raw, sizeof(raw), encoded);
+    encoded[length] = 0U;
+    transport_send(slwin_link, encoded, length + 1U);
+}
+
+/**
+ * @brief Envoie l'acquittement cumulatif et sélectif courant.
+ */
+static void slwin_send_ack(void)
+{
+    uint8_t mask = 0U;
+    uint8_t seq;
+    uint32_t i;
+
+    for (i = 1U; i < SLWIN_WINDOW; i++)
+    {
+        seq = (uint8_t)(slwin_base + i);
+        if (slwin_slot_valid[seq % SLWIN_WINDOW] && (slwin_slot_seq[seq % SLWIN_WINDOW] == seq))
+        {
+            mask |= (uint8_t)(1U << (i - 1U));
+        }
+    }
+    slwin_send(SLWIN_TYPE_ACK, slwin_base, mask);
+}
+
+/**
+ * @brief Lit une trame complète dans la FIFO en faisant avancer le pipeline d'écriture flash.
+ *
+ * Une trame trop longue est ignorée jusqu'au délimiteur suivant. En cas de timeout,
+ * les octets déjà reçus sont conservés pour l'appel suivant.
+ *
+ * @param[in] fifo       Pointeur vers la FIFO de réception.
+ * @param[in] timeout_ms Délai maximal sans trame complète, en millisecondes.
+ * @return int Longueur de la trame décodée (> 0), SLWIN_READ_TIMEOUT, ou
+ *             SLWIN_READ_ABORT si l'écriture flash a échoué.
+ */
+static int slwin_read_frame(fifo_t *fifo, uint32_t timeout_ms)
+{
+    uint32_t start_time = HAL_GetTick();
+    int32_t length;
+    uint8_t byte;
+
+    for (;;)
+    {
+        if (fifo_get(fifo, &byte) == FIFO_OK)
+        {
+            if (byte != 0U)
+            {
+                if (slwin_frame_length < sizeof(slwin_frame))
+                {
+                    slwin_frame[slwin_frame_length] = byte;
+                    slwin_frame_length++;
+                }
+                else
+                {
+                    slwin_frame_overflow = true;
+                }
+                continue;
+            }
+
+            /* Délimiteur : décodage en place de la trame accumulée */
+            length = -1;
+            if (!slwin_frame_overflow && (slwin_frame_length != 0U))
+            {
+                length = cobs_decode(slwin_frame, slwin_frame_length, slwin_frame);
+            }
+            slwin_frame_length = 0U;
+            slwin_frame_overflow = false;
+            if (length > 0)
+            {
+                return (int)length;
+            }
+            continue;
+        }
+
+        if (flash_pipe_poll() == FLASH_PIPE_ERROR)
+        {
+            return SLWIN_READ_ABORT;
+        }
+        if ((HAL_GetTick() - start_time) >= timeout_ms)
+        {
+            return SLWIN_READ_TIMEOUT;
+        }
+    }
+}
+
+/**
+ * @brief Transmet un bloc, dans l'ordre, au pipeline d'écriture flash.
+ *
+ * Les blocs passent par slwin_callback comme ceux de XMODEM : en-tête
+ * d'image, images compressées et patchs sont acceptés de la même façon.
+ *
+ * @param[in] type   Type de la trame (DATA ou END).
+ * @param[in] data   Données du bloc.
+ * @param[in] length Longueur des données.
+ * @return int 1 si la fin de l'image est atteinte, écrite et vérifiée, 0 pour
+ *             continuer, -1 en cas d'erreur d'écriture.
+ */
+static int slwin_deliver(uint8_t type, const uint8_t *data, uint32_t length)
+{
+    fifo_span_t span;
+
+    slwin_base++;
+    if (type == SLWIN_TYPE_END)
+    {
+        return ((flash_pipe_flush() == FLASH_PIPE_OK) && (flash_write_finish() == 0)) ? 1 : -1;
+    }
+    span.data[0] = data;
+    span.length[0] = length;
+    span.data[1] = NULL;
+    span.length[1] = 0U;
+    slwin_blocks++;
+    slwin_callback(&span, slwin_blocks, 0U);
+    return (flash_pipe_poll() == FLASH_PIPE_ERROR) ? -1 : 0;
+}
+
+/**
+ * @brief Réception d'une image firmware par le protocole à fenêtre glissante.
+ *
+ * @param[in] link     Liaison de la session (USART2 ou USB CDC, voir transport.c).
+ * @param[in] callback Fonction appelée pour chaque bloc, dans l'ordre (flash_write_callback()).
+ * @return int 0 si l'image est entièrement reçue et écrite, -1 en cas d'erreur ou d'annulation.
+ */
+int slwin_receive(const transport_t *link, xmodem_block_callback_t callback)
+{
+    fifo_t *fifo = link->rx;
+    bool started = false;
+    uint32_t idle = 0U;
+    uint32_t length;
+    uint32_t slot;
+    uint16_t crc;
+    uint8_t type;
+    uint8_t seq;
+    uint8_t distance;
+    int status;
+
+    slwin_link = link;
+    slwin_callback = callback;
+    flash_pipe_init(FLASH_APP_START_ADDRESS, FLASH_APP_END_ADDRESS);
+    (void)memset(slwin_slot_valid, 0, sizeof(slwin_slot_valid));
+    slwin_frame_length = 0U;
+    slwin_frame_overflow = false;
+    slwin_base = 0U;
+    slwin_blocks = 0U;
+
+    /* Sans contrôle de flux (USART2), la fenêtre arrive d'un trait et le tampon DMA ne
+       couvre pas l'effacement d'une page : la zone est effacée avant READY */
+    if (!link->flow_control && (flash_pipe_preerase(FLASH_APP_END_ADDRESS) != FLASH_PIPE_OK))
+    {
+        slwin_send(SLWIN_TYPE_ABORT, 0U, 0U);
+        return -1;
+    }
+
+    slwin_send(SLWIN_TYPE_READY, 0U, (uint8_t)SLWIN_WINDOW);
+
+    for (;;)
+    {
+        status = slwin_read_frame(fifo, SLWIN_ACK_TIMEOUT_MS);
+        if (status == SLWIN_READ_ABORT)
+        {
+            slwin_send(SLWIN_TYPE_ABORT, slwin_base, 0U);
+            return -1;
+        }
+        if (status == SLWIN_READ_TIMEOUT)
+        {
+            idle++;
+            if (idle >= SLWIN_MAX_IDLE)
+            {
+                slwin_send(SLWIN_TYPE_ABORT, slwin_base, 0U);
+                return -1;
+            }
+            if (started)
+            {
+                slwin_send_ack();
+            }
+            else
+            {
+                slwin_send(SLWIN_TYPE_READY, 0U, (uint8_t)SLWIN_WINDOW);
+            }
+            continue;
+        }
+        idle = 0U;
+
+        /* Contrôle de la trame : taille minimale et CRC */
+        length = (uint32_t)status;
+        if (length < (SLWIN_HEADER_SIZE + SLWIN_TRAILER_SIZE))
+        {
+            continue;
+        }
+        length -= SLWIN_HEADER_SIZE + SLWIN_TRAILER_SIZE;
+        crc = (uint16_t)(((uint16_t)slwin_frame[SLWIN_HEADER_SIZE + length] << 8U)
+                       | slwin_frame[SLWIN_HEADER_SIZE + length + 1U]);
+        if (crc16_final(crc16_update(crc16_init(), slwin_frame, SLWIN_HEADER_SIZE + length)) != crc)
+        {
+            /* L'ACK immédiat signale le trou à l'émetteur sans attendre le timeout */
+            if (started)
+            {
+                slwin_send_ack();
+            }
+            continue;
+        }
+
+        type = slwin_frame[0];
+        seq = slwin_frame[1];
+        if (type == SLWIN_TYPE_ABORT)
+        {
+            return -1;
+        }
+        if (((type != SLWIN_TYPE_DATA) && (type != SLWIN_TYPE_END)) || (length > SLWIN_BLOCK_SIZE))
+        {
+            continue;
+        }
+        started = true;
+
+        distance = (uint8_t)(seq - slwin_base);
+        if (distance == 0U)
+        {
+            /* Bloc attendu : écriture directe depuis la trame, puis des blocs déjà reçus qui suivent */
+            status = slwin_deliver(type, &slwin_frame[SLWIN_HEADER_SIZE], length);
+            slot = slwin_base % SLWIN_WINDOW;
+            while ((status == 0) && slwin_slot_valid[slot] && (slwin_slot_seq[slot] == slwin_base))
+            {
+                slwin_slot_valid[slot] = false;
+                status = slwin_deliver(slwin_slot_type[slot], slwin_slot[slot], slwin_slot_length[slot]);
+                slot = slwin_base % SLWIN_WINDOW;
+            }
+            if (status < 0)
+            {
+                slwin_send(SLWIN_TYPE_ABORT, slwin_base, 0U);
+                return -1;
+            }
+            if (status > 0)
+            {
+                slwin_send_ack();
+                return 0;
+            }
+        }
+        else if (distance < SLWIN_WINDOW)
+        {
+            /* Bloc en avance : conservé dans la fenêtre */
+            slot = seq % SLWIN_WINDOW;
+            (void)memcpy(slwin_slot[slot], &slwin_frame[SLWIN_HEADER_SIZE], length);
+            slwin_slot_length[slot] = (uint16_t)length;
+            slwin_slot_type[slot] = type;
+            slwin_slot_seq[slot] = seq;
+            slwin_slot_valid[slot] = true;
+        }
+        else
+        {
+            /* Bloc déjà écrit (ACK perdu) ou hors fenêtre : seul l'ACK est renvoyé */
+        }
+        slwin_send_ack();
+    }
+}
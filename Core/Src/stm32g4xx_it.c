@@ -6,10 +6,10 @@ extern DMA_HandleTypeDef hdma_usart1_rx;
 extern DMA_HandleTypeDef hdma_usart1_tx;
 extern UART_HandleTypeDef huart1;
 extern TIM_HandleTypeDef    TimHandle;
+extern PCD_HandleTypeDef hpcd_USB_FS;
 
 volatile uint32_t last_capture = 0;    // Dernière valeur capturée
 volatile uint32_t time_difference = 0; // Temps entre deux interruptions en µs
-uint8_t volatile received_char2;
 /* USER CODE BEGIN EV */
 
 /* USER CODE END EV */
@@ -155,7 +155,16 @@ void SysTick_Handler(void)
 /**
   * @brief This function handles USB low priority interrupt remap.
   */
+void USB_LP_IRQHandler(void)
+{
+  /* USER CODE BEGIN USB_LP_IRQn 0 */
+
+  /* USER CODE END USB_LP_IRQn 0 */
+  HAL_PCD_IRQHandler(&hpcd_USB_FS);
+  /* USER CODE BEGIN USB_LP_IRQn 1 */
 
+  /* USER CODE END USB_LP_IRQn 1 */
+}
 
 /**
   * @brief This function handles TIM1 update interrupt and TIM16 global interrupt.
@@ -217,12 +226,53 @@ void USART2_IRQHandler(void) {
     HAL_UART_IRQHandler(&hUART2);
 }
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+// Routine d'interruption du DMA de réception de l'UART2
+void DMA1_Channel1_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&hdma_usart2_rx);
+}
+
+// Routine d'interruption du DMA d'émission de l'UART2
+void DMA1_Channel2_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&hdma_usart2_tx);
+}
+
+/**
+ * @brief Fin d'un transfert DMA d'émission : segment suivant de usart2_tx_fifo (rou.c).
+ *
+ * @param[in] huart Handle de l'UART à l'origine de l'évènement.
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+	if(huart->Instance == hUART2.Instance) {
+		UART2_TxComplete();
+	}
+}
+
+/**
+ * @brief Publie dans usart2_fifo les octets déposés par le DMA de l'UART2.
+ *
+ * Appelée sur demi-tampon, tampon complet et détection de ligne inactive.
+ * @p Size est la position d'écriture courante du DMA dans uart2_rx_dma_buffer ;
+ * la plage [uart2_rx_dma_position, Size) est copiée d'un bloc dans la FIFO
+ * (UART2_RxEvent(), rou.c).
+ *
+ * @param[in] huart Handle de l'UART à l'origine de l'évènement.
+ * @param[in] Size  Position d'écriture du DMA dans le tampon circulaire.
+ */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+	if(huart->Instance == hUART2.Instance) {
+		UART2_RxEvent(Size);
+	}
+}
+
+/**
+ * @brief Relance la réception DMA après une erreur UART (overrun, bruit, trame).
+ *
+ * @param[in] huart Handle de l'UART en erreur.
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
 	if(huart->Instance == hUART2.Instance) {
-        /* Stocker l'octet reçu dans la FIFO */
-        fifo_put(&usart2_fifo, received_char2);
-        /* Relancer la réception d'un nouvel octet */
-		HAL_UART_Receive_IT(&hUART2, (uint8_t*)&received_char2, 1);
+		/* Les octets déjà reçus sont publiés avant la relance (rou.c) */
+		UART2_RxError();
 	}
 }
 
@@ -0,0 +1,95 @@
+#include "inc.h"
+
+/**
+ * @file transport.c
+ * @brief Liaisons avec le PC : USART2 (câble FT232R) et USB CDC.
+ *
+ * Chaque liaison associe une FIFO de réception à une fonction d'émission
+ * (transport_t). La liaison active, v_transport, est celle qui reçoit le premier
+ * octet de l'attente du bootloader (transport_wait_first()) : le menu et les
+ * récepteurs fonctionnent ensuite de la même façon sur l'une ou l'autre.
+ */
+
+/** USART2 : réception DMA circulaire (usart.c), file d'émission vidée par DMA (rou.c). */
+const transport_t transport_uart2 = { &usart2_fifo, UART2_Send, UART2_TxFlush, "USART2", false };
+
+#if (USBD_FTDI_EMULATION == 1U)
+/** USB en émulation FT232R : réception et émission par usbd_FTDI.c. */
+const transport_t transport_cdc = { &cdc_fifo, FTDI_Send, FTDI_TxFlush, "USB FTDI", true };
+#else
+/** USB CDC : réception par l'endpoint OUT (usbd_cdc_if.c), émission par Rou_cdc.c. */
+const transport_t transport_cdc = { &cdc_fifo, CDC_Send, CDC_TxFlush, "USB CDC", true };
+#endif
+
+/**
+ * @brief Attend le premier octet sur l'une des deux liaisons et la rend active.
+ *
+ * @param[in]  timeout_ms Délai maximal en millisecondes.
+ * @param[out] byte       Octet reçu.
+ * @return const transport_t* Liaison qui a reçu l'octet, NULL en cas de timeout.
+ */
+const transport_t *transport_wait_first(uint32_t timeout_ms, uint8_t *byte)
+{
+    uint32_t start_time = HAL_GetTick();
+
+    for (;;)
+    {
+        if (fifo_get(transport_uart2.rx, byte) == FIFO_OK)
+        {
+            v_transport = &transport_uart2;
+            return v_transport;
+        }
+        if (fifo_get(transport_cdc.rx, byte) == FIFO_OK)
+        {
+            v_transport = &transport_cdc;
+            return v_transport;
+        }
+        if ((HAL_GetTick() - start_time) >= timeout_ms)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Émet des octets sur une liaison.
+ *
+ * @param[in] link   Liaison.
+ * @param[in] data   Octets à émettre.
+ * @param[in] length Nombre d'octets.
+ */
+void transport_send(const transport_t *link, const uint8_t *data, uint32_t length)
+{
+    if (length != 0U)
+    {
+        link->send(data, length);
+    }
+}
+
+/**
+ * @brief Émet un octet sur une liaison.
+ */
+void transport_send_char(const transport_t *link, uint8_t c)
+{
+    link->send(&c, 1U);
+}
+
+/**
+ * @brief Émet une chaîne terminée par '\0' sur une liaison.
+ */
+void transport_send_string(const transport_t *link, const char *text)
+{
+    transport_send(link, (const uint8_t *)text, (uint32_t)strlen(text));
+}
+
+/**
+ * @brief Attend la fin de l'émission sur une liaison.
+ *
+ * @param[in] link       Liaison.
+ * @param[in] timeout_ms Délai maximal en millisecondes.
+ * @return int FIFO_OK si tous les octets ont été émis, FIFO_ERROR en cas de timeout.
+ */
+int transport_flush(const transport_t *link, uint32_t timeout_ms)
+{
+    return link->flush(timeout_ms);
+}
@@ -1,13 +1,188 @@
 #include "inc.h"
 extern volatile unsigned char received_char;
-extern volatile unsigned char received_char2;
+
+/**
+ * @brief Configure les canaux DMA de l'USART2 : Channel 1 en réception, Channel 2 en émission.
+ *
+ * Le canal fonctionne en mode circulaire sur uart2_rx_dma_buffer : le matériel
+ * recopie seul chaque octet reçu, seules les fins de plage génèrent une interruption.
+ */
+static void UART2_DMA_Init(void) {
+	__HAL_RCC_DMAMUX1_CLK_ENABLE();
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	hdma_usart2_rx.Instance = DMA1_Channel1;
+	hdma_usart2_rx.Init.Request = DMA_REQUEST_USART2_RX;
+	hdma_usart2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_usart2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_usart2_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_usart2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_usart2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_usart2_rx.Init.Mode = DMA_CIRCULAR;
+	hdma_usart2_rx.Init.Priority = DMA_PRIORITY_HIGH;
+	if (HAL_DMA_Init(&hdma_usart2_rx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hUART2, hdmarx, hdma_usart2_rx);
+
+	HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 0U, 0U);
+	HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+
+	/* Émission : DMA1 Channel 2 en mode normal, un segment de usart2_tx_fifo par transfert (rou.c) */
+	hdma_usart2_tx.Instance = DMA1_Channel2;
+	hdma_usart2_tx.Init.Request = DMA_REQUEST_USART2_TX;
+	hdma_usart2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_usart2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_usart2_tx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_usart2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_usart2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_usart2_tx.Init.Mode = DMA_NORMAL;
+	hdma_usart2_tx.Init.Priority = DMA_PRIORITY_MEDIUM;
+	if (HAL_DMA_Init(&hdma_usart2_tx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hUART2, hdmatx, hdma_usart2_tx);
+
+	HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, 1U, 0U);
+	HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+}
+
+/**
+ * @brief Lance (ou relance) la réception DMA circulaire de l'USART2.
+ *
+ * Les évènements demi-tampon, tampon complet et ligne inactive sont remontés
+ * par HAL_UARTEx_RxEventCallback(). Appelée à l'initialisation et après une
+ * erreur UART qui a interrompu le transfert.
+ */
+void UART2_StartReceiveDMA(void) {
+	uart2_rx_dma_position = 0U;
+	if (HAL_UARTEx_ReceiveToIdle_DMA(&hUART2, uart2_rx_dma_buffer, UART2_RX_DMA_BUFFER_SIZE) != HAL_OK)
+	{
+		Error_Handler();
+	}
+}
+
+/** Détection automatique du débit armée, premier octet non encore examiné */
+static bool uart2_autobaud_armed = false;
+
+/**
+ * @brief Débit réellement obtenu avec PCLK1 pour un débit demandé.
+ *
+ * @param[in] baud Débit demandé.
+ * @return uint32_t Débit obtenu, 0 hors de UART2_BAUD_MIN..UART2_BAUD_MAX ou hors tolérance.
+ */
+uint32_t UART2_CheckBaudRate(uint32_t baud) {
+	uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+	uint32_t brr;
+	uint32_t actual;
+
+	if ((baud < UART2_BAUD_MIN) || (baud > UART2_BAUD_MAX)) {
+		return 0U;
+	}
+	brr = UART_DIV_SAMPLING16(pclk, baud, hUART2.Init.ClockPrescaler);
+	if (brr < 16U) {
+		return 0U;
+	}
+	actual = pclk / brr;
+	/* Écart de 2 % au plus entre les deux extrémités de la liaison */
+	if (((actual > baud) ? (actual - baud) : (baud - actual)) > (baud / 50U)) {
+		return 0U;
+	}
+	return actual;
+}
+
+/**
+ * @brief Reprogramme le BRR de l'USART2 et relance la réception.
+ *
+ * La réception DMA est interrompue le temps du changement ; les octets reçus à
+ * l'ancien débit et non lus sont abandonnés.
+ *
+ * @param[in] baud     Débit à appliquer.
+ * @param[in] autobaud true pour mesurer le débit sur le premier octet reçu (UART2_AUTOBAUD_SYNC).
+ */
+static void UART2_ApplyBaudRate(uint32_t baud, bool autobaud) {
+	(void)HAL_UART_AbortReceive(&hUART2);
+	__HAL_UART_DISABLE(&hUART2);
+	hUART2.Instance->BRR = UART_DIV_SAMPLING16(HAL_RCC_GetPCLK1Freq(), baud, hUART2.Init.ClockPrescaler);
+	if (autobaud) {
+		/* ABREN et ABRMOD ne sont modifiables qu'avec UE à 0 */
+		MODIFY_REG(hUART2.Instance->CR2, USART_CR2_ABREN | USART_CR2_ABRMODE,
+				UART_ADVFEATURE_AUTOBAUDRATE_ENABLE | UART_ADVFEATURE_AUTOBAUDRATE_ON0X7FFRAME);
+	} else {
+		CLEAR_BIT(hUART2.Instance->CR2, USART_CR2_ABREN);
+	}
+	__HAL_UART_ENABLE(&hUART2);
+	hUART2.Init.BaudRate = baud;
+	uart2_autobaud_armed = autobaud;
+	fifo_reset(&usart2_fifo);
+	UART2_StartReceiveDMA();
+}
+
+/**
+ * @brief Change le débit de l'USART2 (PROV_CMD_BAUD).
+ *
+ * Les octets en file d'émission partent d'abord à l'ancien débit : la réponse qui
+ * annonce le changement est entièrement émise avant la bascule.
+ *
+ * @param[in] baud Débit demandé, de UART2_BAUD_MIN à UART2_BAUD_MAX.
+ * @return int 0 en cas de succès, -1 si le débit n'est pas réalisable (débit inchangé).
+ */
+int UART2_SetBaudRate(uint32_t baud) {
+	if (UART2_CheckBaudRate(baud) == 0U) {
+		return -1;
+	}
+	(void)UART2_TxFlush(UART2_TX_TIMEOUT_MS);
+	UART2_ApplyBaudRate(baud, false);
+	return 0;
+}
+
+/**
+ * @brief Revient à UART2_BAUD_DEFAULT et arme la détection automatique du débit.
+ *
+ * Appelée en attente d'une session : l'USART mesure le premier octet reçu, qui
+ * doit être UART2_AUTOBAUD_SYNC (0x7F) émis au débit de l'outil PC. Un autre
+ * premier octet fait échouer la mesure : le débit revient à UART2_BAUD_DEFAULT et
+ * cet octet peut être perdu (l'espace du menu est alors à répéter).
+ */
+void UART2_AutoBaudArm(void) {
+	(void)UART2_TxFlush(UART2_TX_TIMEOUT_MS);
+	UART2_ApplyBaudRate(UART2_BAUD_DEFAULT, true);
+}
+
+/**
+ * @brief Résultat de la détection automatique, à appeler après le premier octet reçu.
+ *
+ * La détection n'a lieu qu'une fois par armement : les octets suivants sont reçus
+ * au débit mesuré, ou à UART2_BAUD_DEFAULT si la mesure a échoué.
+ *
+ * @return uint32_t Débit mesuré, 0 si la détection n'était pas armée ou a échoué.
+ */
+uint32_t UART2_AutoBaudResult(void) {
+	uint32_t baud = 0U;
+
+	if (!uart2_autobaud_armed || !__HAL_UART_GET_FLAG(&hUART2, UART_FLAG_ABRF)) {
+		return 0U;
+	}
+	uart2_autobaud_armed = false;
+	if (!__HAL_UART_GET_FLAG(&hUART2, UART_FLAG_ABRE) && (hUART2.Instance->BRR != 0U)) {
+		baud = UART2_CheckBaudRate(HAL_RCC_GetPCLK1Freq() / hUART2.Instance->BRR);
+	}
+	if (baud == 0U) {
+		UART2_ApplyBaudRate(UART2_BAUD_DEFAULT, false);
+	} else {
+		hUART2.Init.BaudRate = baud;
+	}
+	return baud;
+}
 
 void UART2_Init(void) {
 //	char RX_Buffer;
     __HAL_RCC_USART2_CLK_ENABLE();
 
 	hUART2.Instance = USART2;
-	hUART2.Init.BaudRate = 38400;
+	hUART2.Init.BaudRate = UART2_BAUD_DEFAULT;
 	hUART2.Init.WordLength = UART_WORDLENGTH_8B;
 	hUART2.Init.StopBits = UART_STOPBITS_1;
 	hUART2.Init.Parity = UART_PARITY_NONE;
@@ -33,12 +208,15 @@ void UART2_Init(void) {
 		Error_Handler();
 	}
 	
-	HAL_UART_RegisterCallback(&hUART2,HAL_UART_RX_COMPLETE_CB_ID,HAL_UART_RxCpltCallback);	
-	__HAL_UART_ENABLE_IT(&hUART2, UART_IT_RXNE);
+	UART2_DMA_Init();
+	HAL_UART_RegisterRxEventCallback(&hUART2, HAL_UARTEx_RxEventCallback);
+	HAL_UART_RegisterCallback(&hUART2, HAL_UART_ERROR_CB_ID, HAL_UART_ErrorCallback);
+	HAL_UART_RegisterCallback(&hUART2, HAL_UART_TX_COMPLETE_CB_ID, HAL_UART_TxCpltCallback);
 	
 	HAL_NVIC_SetPriority(USART2_IRQn, 0U, 0U);
 	HAL_NVIC_EnableIRQ(USART2_IRQn);
-	HAL_UART_Receive_IT(&hUART2, (uint8_t *)&received_char2, 1);	
+	UART2_TxReset();
+	UART2_StartReceiveDMA();
 }
 
 /* USART1 init function */
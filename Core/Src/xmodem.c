@@ -3,51 +3,13 @@
 #include "inc.h"      /* Contient les définitions de fifo_t, HAL_GetTick(), fifo_get(), fifo_wait_for(), etc. */
 
 
-/**
- * @brief Table de pré-calcul pour le CRC16 (polynôme 0x1021).
- */
-static const uint16_t crc16_table[256] = {
-    0x0000U, 0x1021U, 0x2042U, 0x3063U, 0x4084U, 0x50A5U, 0x60C6U, 0x70E7U,
-    0x8108U, 0x9129U, 0xA14AU, 0xB16BU, 0xC18CU, 0xD1ADU, 0xE1CEU, 0xF1EFU,
-    0x1231U, 0x0210U, 0x3273U, 0x2252U, 0x52B5U, 0x4294U, 0x72F7U, 0x62D6U,
-    0x9339U, 0x8318U, 0xB37BU, 0xA35AU, 0xD3BDU, 0xC39CU, 0xF3FFU, 0xE3DEU,
-    0x2462U, 0x3443U, 0x0420U, 0x1401U, 0x64E6U, 0x74C7U, 0x44A4U, 0x5485U,
-    0xA56AU, 0xB54BU, 0x8528U, 0x9509U, 0xE5EEU, 0xF5CFU, 0xC5ACU, 0xD58DU,
-    0x3653U, 0x2672U, 0x1611U, 0x0630U, 0x76D7U, 0x66F6U, 0x5695U, 0x46B4U,
-    0xB75BU, 0xA77AU, 0x9719U, 0x8738U, 0xF7DFU, 0xE7FEU, 0xD79DU, 0xC7BCU,
-    0x48C4U, 0x58E5U, 0x6886U, 0x78A7U, 0x0840U, 0x1861U, 0x2802U, 0x3823U,
-    0xC9CCU, 0xD9EDU, 0xE98EU, 0xF9AFU, 0x8948U, 0x9969U, 0xA90AU, 0xB92BU,
-    0x5AF5U, 0x4AD4U, 0x7AB7U, 0x6A96U, 0x1A71U, 0x0A50U, 0x3A33U, 0x2A12U,
-    0xDBFDU, 0xCBDCU, 0xFBBFU, 0xEB9EU, 0x9B79U, 0x8B58U, 0xBB3BU, 0xAB1AU,
-    0x6CA6U, 0x7C87U, 0x4CE4U, 0x5CC5U, 0x2C22U, 0x3C03U, 0x0C60U, 0x1C41U,
-    0xEDAEU, 0xFD8FU, 0xCDECU, 0xDDCDU, 0xAD2AU, 0xBD0BU, 0x8D68U, 0x9D49U,
-    0x7E97U, 0x6EB6U, 0x5ED5U, 0x4EF4U, 0x3E13U, 0x2E32U, 0x1E51U, 0x0E70U,
-    0xFF9FU, 0xEFBEU, 0xDFDDU, 0xCFFCU, 0xBF1BU, 0xAF3AU, 0x9F59U, 0x8F78U,
-    0x9188U, 0x81A9U, 0xB1CAU, 0xA1EBU, 0xD10CU, 0xC12DU, 0xF14EU, 0xE16FU,
-    0x1080U, 0x00A1U, 0x30C2U, 0x20E3U, 0x5004U, 0x4025U, 0x7046U, 0x6067U,
-    0x83B9U, 0x9398U, 0xA3FBU, 0xB3DAU, 0xC33DU, 0xD31CU, 0xE37FU, 0xF35EU,
-    0x02B1U, 0x1290U, 0x22F3U, 0x32D2U, 0x4235U, 0x5214U, 0x6277U, 0x7256U,
-    0xB5EAU, 0xA5CBU, 0x95A8U, 0x8589U, 0xF56EU, 0xE54FU, 0xD52CU, 0xC50DU,
-    0x34E2U, 0x24C3U, 0x14A0U, 0x0481U, 0x7466U, 0x6447U, 0x5424U, 0x4405U,
-    0xA7DBU, 0xB7FAU, 0x8799U, 0x97B8U, 0xE75FU, 0xF77EU, 0xC71DU, 0xD73CU,
-    0x26D3U, 0x36F2U, 0x0691U, 0x16B0U, 0x6657U, 0x7676U, 0x4615U, 0x5634U,
-    0xD94CU, 0xC96DU, 0xF90EU, 0xE92FU, 0x99C8U, 0x89E9U, 0xB98AU, 0xA9ABU,
-    0x5844U, 0x4865U, 0x7806U, 0x6827U, 0x18C0U, 0x08E1U, 0x3882U, 0x28A3U,
-    0xCB7DU, 0xDB5CU, 0xEB3FU, 0xFB1EU, 0x8BF9U, 0x9BD8U, 0xABBBU, 0xBB9AU,
-    0x4A75U, 0x5A54U, 0x6A37U, 0x7A16U, 0x0AF1U, 0x1AD0U, 0x2AB3U, 0x3A92U,
-    0xFD2EU, 0xED0FU, 0xDD6CU, 0xCD4DU, 0xBDAAU, 0xAD8BU, 0x9DE8U, 0x8DC9U,
-    0x7C26U, 0x6C07U, 0x5C64U, 0x4C45U, 0x3CA2U, 0x2C83U, 0x1CE0U, 0x0CC1U,
-    0xEF1FU, 0xFF3EU, 0xCF5DU, 0xDF7CU, 0xAF9BU, 0xBFBAU, 0x8FD9U, 0x9FF8U,
-    0x6E17U, 0x7E36U, 0x4E55U, 0x5E74U, 0x2E93U, 0x3EB2U, 0x0ED1U, 0x1EF0U
-};
-
-
 /* Macros XMODEM identiques aux versions précédentes */
 #define XMODEM_STX            0x02U   /**< Start Of Text pour blocs de 1024 octets (XMODEM-1K) */
 #define XMODEM_EOT            0x04U   /**< End Of Transmission */
 #define XMODEM_ACK            0x06U   /**< Acknowledge */
 #define XMODEM_NAK            0x15U   /**< Negative Acknowledge */
 #define XMODEM_CAN            0x18U   /**< Cancel */
+#define XMODEM_RESUME         0x52U   /**< 'R' : reprise à la position qui suit (voir image.h) */
 
 #define XMODEM_HEADER_TIMEOUT_MS    1000U  /**< Délai pour l'en-tête (ms) */
 #define XMODEM_BYTE_TIMEOUT_MS      1000U   /**< Délai pour un octet (ms) */
@@ -61,275 +23,591 @@ static const uint16_t crc16_table[256] = {
 /* Taille d'un bloc XMODEM 1K */
 #define XMODEM_1K_BLOCK_SIZE        1024U
 
-/* Taille d'un paquet (deux blocs de 1024 octets) */
-#define FLASH_PACKET_SIZE           (2U * XMODEM_1K_BLOCK_SIZE)
-
 
 /* Prototypes des fonctions externes */
 extern uint32_t HAL_GetTick(void);      /**< Retourne le tick système */
 
-/* Prototypes des fonctions flash (à adapter selon votre plateforme) */
-extern int flash_write(uint32_t address, const uint8_t *data, uint32_t length);
-extern int flash_read(uint32_t address, uint8_t *data, uint32_t length);
+/* Taille d'une trame XMODEM 1K après l'octet STX : blk, ~blk, 1024 octets, CRC16 */
+#define XMODEM_1K_FRAME_SIZE        (2U + XMODEM_1K_BLOCK_SIZE + 2U)
+
+/* Attente interrompue par une erreur du pipeline d'écriture flash */
+#define XMODEM_WAIT_ABORT           (-2)
+
 /**
- * @brief Calcule le CRC16 (polynôme 0x1021) sur un bloc de données (méthode XMODEM).
+ * @brief Calcule le CRC16 XMODEM d'une plage décrite par un descripteur de FIFO.
+ *
+ * Le calcul est effectué en place sur les segments du tampon circulaire.
  *
- * @param[in] data   Pointeur sur le bloc de données.
- * @param[in] length Longueur du bloc.
+ * @param[in] span Descripteur de la plage.
  * @return uint16_t CRC16 calculé.
  */
-static uint16_t xmodem_compute_crc16(const uint8_t *data, uint16_t length)
+static uint16_t xmodem_compute_crc16(const fifo_span_t *span)
+{
+    uint16_t crc;
+
+    crc = crc16_update(crc16_init(), span->data[0], span->length[0]);
+    return crc16_final(crc16_update(crc, span->data[1], span->length[1]));
+}
+
+/**
+ * @brief Lit un octet d'une plage décrite par un descripteur de FIFO.
+ *
+ * @param[in] span  Descripteur de la plage.
+ * @param[in] index Position de l'octet dans la plage.
+ * @return uint8_t Octet lu.
+ */
+static uint8_t xmodem_span_byte(const fifo_span_t *span, uint32_t index)
+{
+    if (index < span->length[0])
+    {
+        return span->data[0][index];
+    }
+    return span->data[1][index - span->length[0]];
+}
+
+
+
+/**
+ * @brief Attend des octets dans la FIFO en faisant avancer le pipeline d'écriture flash.
+ *
+ * Les pages préparées sont effacées, programmées et vérifiées pendant l'attente du
+ * bloc suivant.
+ *
+ * @param[in] fifo       Pointeur vers la FIFO de réception.
+ * @param[in] count      Nombre d'octets minimum à attendre.
+ * @param[in] timeout_ms Délai maximal en millisecondes.
+ * @return int FIFO_OK si les octets sont disponibles, FIFO_ERROR en cas de timeout,
+ *             XMODEM_WAIT_ABORT si l'écriture flash a échoué.
+ */
+static int xmodem_wait_for(fifo_t *fifo, unsigned int count, unsigned int timeout_ms)
 {
-    uint16_t crc = 0U;
-    uint16_t i;
-    uint8_t j;
-    uint8_t byte;
+    uint32_t start_time = HAL_GetTick();
 
-    for (i = 0U; i < length; i++)
+    while (fifo_len(fifo) < count)
     {
-        byte = data[i];
-        crc ^= ((uint16_t)byte << 8U);
-        for (j = 0U; j < 8U; j++)
+        if (flash_pipe_poll() == FLASH_PIPE_ERROR)
         {
-            if ((crc & 0x8000U) != 0U)
-            {
-                crc = (uint16_t)((crc << 1U) ^ 0x1021U);
-            }
-            else
-            {
-                crc <<= 1U;
-            }
+            return XMODEM_WAIT_ABORT;
+        }
+        if ((HAL_GetTick() - start_time) >= timeout_ms)
+        {
+            return FIFO_ERROR;
         }
     }
-    return crc;
+    return FIFO_OK;
 }
 
+/**
+ * @brief Annule la session en cours (deux CAN) côté récepteur.
+ *
+ * @param[in] link Liaison de la session.
+ * @return int -1, à retourner par le récepteur.
+ */
+static int xmodem_abort(const transport_t *link)
+{
+    static const uint8_t cancel[2] = { XMODEM_CAN, XMODEM_CAN };
 
+    transport_send(link, cancel, sizeof(cancel));
+    return -1;
+}
 
 /**
- * @brief Réception XMODEM 1K en mode blockwise.
+ * @brief Acquitte un bloc accepté en mode stop-and-wait.
+ *
+ * Le bloc 1 d'une image dont une partie est déjà en flash (transfert interrompu,
+ * voir image.h) est acquitté par XMODEM_RESUME suivi de la position de reprise.
+ *
+ * @param[in] link  Liaison de la session.
+ * @param[in] first true pour le bloc 1.
+ */
+static void xmodem_ack_block(const transport_t *link, bool first)
+{
+    uint32_t offset = first ? flash_write_resume() : 0U;
+    uint8_t resume[5];
+    uint32_t i;
+
+    if (offset == 0U) {
+        transport_send_char(link, XMODEM_ACK);
+        return;
+    }
+    resume[0] = XMODEM_RESUME;
+    for (i = 0U; i < 4U; i++) {
+        resume[1U + i] = (uint8_t)(offset >> (8U * i));
+    }
+    transport_send(link, resume, sizeof(resume));
+}
+
+/**
+ * @brief Signale une trame erronée à l'émetteur.
+ *
+ * En mode stop-and-wait, la trame est refusée (NAK) et sera réémise. En mode
+ * streaming, l'émetteur ne réémet jamais : la session est annulée.
+ *
+ * @param[in] link      Liaison de la session.
+ * @param[in] streaming true en mode XMODEM-1K-G.
+ * @return int 0 pour poursuivre la réception, -1 si la session est annulée.
+ */
+static int xmodem_reject(const transport_t *link, bool streaming)
+{
+    if (streaming) {
+        return xmodem_abort(link);
+    }
+    transport_send_char(link, XMODEM_NAK);
+    return 0;
+}
+
+/**
+ * @brief Réception XMODEM 1K, en mode stop-and-wait ou en mode streaming (-G).
  *
  * Cette fonction implémente le protocole XMODEM 1K en mode réception, sans stocker
  * la totalité des paquets reçus en RAM. Pour chaque bloc valide, elle appelle la fonction
- * de rappel fournie.
+ * de rappel fournie. Le bloc est acquitté dès que la fonction de rappel l'a pris en
+ * charge ; l'écriture flash se poursuit en tâche de fond pendant la réception du bloc
+ * suivant (voir flash_pipe.c) et est terminée avant l'acquittement de l'EOT.
  *
- * @param[in,out] fifo      Pointeur vers la FIFO d'où seront extraits les octets reçus.
+ * En mode streaming, la session est demandée par 'G' au lieu de 'C' : l'émetteur
+ * envoie les blocs sans attendre d'acquittement, seul l'EOT est acquitté, et la
+ * première erreur annule la session au lieu d'un NAK.
+ *
+ * @param[in]     link      Liaison de la session (FIFO de réception et émission).
  * @param[in]     callback  Fonction de rappel appelée pour traiter chaque bloc.
+ * @param[in]     streaming true pour le mode XMODEM-1K-G.
  * @return int  0 si la transmission s'est correctement terminée (EOT reçu), -1 en cas d'erreur.
  */
-int xmodem_receive_1k_blockwise(fifo_t *fifo, xmodem_block_callback_t callback)
+static int xmodem_receive_1k(const transport_t *link, xmodem_block_callback_t callback, bool streaming)
 {
+    fifo_t *fifo = link->rx;
+    const uint8_t start_char = streaming ? (uint8_t)'G' : (uint8_t)'C';
     uint8_t block_expected = 1U;
+    uint32_t blocks_accepted = 0U;
     uint8_t retry = 0U;
     uint8_t header;
     uint8_t block_num;
     uint8_t block_num_comp;
-    uint8_t data[XMODEM_1K_BLOCK_SIZE];
-    uint8_t crc_msb;
-    uint8_t crc_lsb;
+    fifo_span_t frame;
+    fifo_span_t data;
     uint16_t rx_crc;
     uint16_t calc_crc;
-    uint32_t i;
     int status;
 
 
-    /* Envoi initial de 'C' pour signaler l'utilisation du CRC */
-    SendCharFTDI((uint8_t)'C');
+    flash_pipe_init(FLASH_APP_ADDRESS, FLASH_APP_END_ADDRESS);
+
+    /* Streaming sans contrôle de flux (USART2) : l'émetteur ne s'arrête jamais et le
+       tampon DMA ne couvre pas l'effacement d'une page, la zone est effacée avant 'G' */
+    if (streaming && !link->flow_control && (flash_pipe_preerase(FLASH_APP_END_ADDRESS) != FLASH_PIPE_OK)) {
+        return xmodem_abort(link);
+    }
+
+    /* Envoi initial de 'C' (CRC) ou 'G' (streaming) pour démarrer la session */
+    transport_send_char(link, start_char);
 
     for (;;) {
         /* Attente de réception d'au moins un octet */
-        if (fifo_wait_for(fifo, 1U, XMODEM_HEADER_TIMEOUT_MS) == FIFO_ERROR) {
+        status = xmodem_wait_for(fifo, 1U, XMODEM_HEADER_TIMEOUT_MS);
+        if (status == XMODEM_WAIT_ABORT) {
+            return xmodem_abort(link);
+        }
+        if (status == FIFO_ERROR) {
+            /* En streaming, un silence au milieu du flux est une erreur */
+            if (streaming && (block_expected != 1U)) {
+                return xmodem_abort(link);
+            }
             retry++;
             if (retry >= XMODEM_MAX_RETRIES) {
-                SendCharFTDI(XMODEM_CAN);
-                SendCharFTDI(XMODEM_CAN);
-                return -1;
+                return xmodem_abort(link);
             }
-            SendCharFTDI((uint8_t)'C');
+            transport_send_char(link, start_char);
             continue;
         }
 
         /* Récupération de l'en-tête */
-//		while(fifo_is_empy(&usart2_fifo)) {};
         status = fifo_get(fifo, &header);
         if (status == FIFO_ERROR) {
             continue;
         }
 
         if (header == XMODEM_EOT) {
-            SendCharFTDI(XMODEM_ACK);
+            /* Fin de transfert : l'image doit être entièrement écrite avant l'ACK */
+            if ((flash_pipe_flush() != FLASH_PIPE_OK) || (flash_write_finish() != 0)) {
+                return xmodem_abort(link);
+            }
+            transport_send_char(link, XMODEM_ACK);
             break;
         } else if (header == XMODEM_STX) {
             /* Bloc XMODEM 1K : STX, blk, ~blk, 1024 octets, CRC16 (2 octets) */
-            if (fifo_wait_for(fifo, 2U + XMODEM_1K_BLOCK_SIZE + 2U, XMODEM_HEADER_TIMEOUT_MS) == 0) {
-                SendCharFTDI(XMODEM_NAK);
-                continue;
+            status = xmodem_wait_for(fifo, XMODEM_1K_FRAME_SIZE, XMODEM_HEADER_TIMEOUT_MS);
+            if (status == XMODEM_WAIT_ABORT) {
+                return xmodem_abort(link);
             }
-			while(fifo_is_empy(&usart2_fifo)) {};
-            (void)fifo_get(fifo, &block_num);
-			while(fifo_is_empy(&usart2_fifo)) {};
-            (void)fifo_get(fifo, &block_num_comp);
-            if (((uint8_t)(block_num + block_num_comp)) != 0xFFU) {
-                SendCharFTDI(XMODEM_NAK);
-                continue;
-            }
-            /* Réception des 1024 octets */
-            for (i = 0U; i < XMODEM_1K_BLOCK_SIZE; i++) {
-				while(fifo_is_empy(&usart2_fifo)) {};
-                status = fifo_get(fifo, &data[i]);
-                if (status == 0) {
-                    break;
+            if (status != FIFO_OK) {
+                /* Trame incomplète : purge de ce qui a été reçu */
+                fifo_commit(fifo, fifo_len(fifo));
+                if (xmodem_reject(link, streaming) != 0) {
+                    return -1;
                 }
-            }
-            if (i != XMODEM_1K_BLOCK_SIZE) {
-                SendCharFTDI(XMODEM_NAK);
                 continue;
             }
-            /* Réception du CRC16 (MSB puis LSB) */
-			while(fifo_is_empy(&usart2_fifo)) {};
-            if (fifo_get(fifo, &crc_msb) == 0) {
-                SendCharFTDI(XMODEM_NAK);
-                continue;
-            }
-			while(fifo_is_empy(&usart2_fifo)) {};
-            if (fifo_get(fifo, &crc_lsb) == 0) {
-                SendCharFTDI(XMODEM_NAK);
+
+            /* La trame est traitée en place dans la FIFO, sans copie */
+            (void)fifo_peek(fifo, 0U, XMODEM_1K_FRAME_SIZE, &frame);
+            block_num = xmodem_span_byte(&frame, 0U);
+            block_num_comp = xmodem_span_byte(&frame, 1U);
+            rx_crc = (uint16_t)(((uint16_t)xmodem_span_byte(&frame, 2U + XMODEM_1K_BLOCK_SIZE) << 8U)
+                              | xmodem_span_byte(&frame, 3U + XMODEM_1K_BLOCK_SIZE));
+            (void)fifo_peek(fifo, 2U, XMODEM_1K_BLOCK_SIZE, &data);
+
+            if (((uint8_t)(block_num + block_num_comp)) != 0xFFU) {
+                fifo_commit(fifo, XMODEM_1K_FRAME_SIZE);
+                if (xmodem_reject(link, streaming) != 0) {
+                    return -1;
+                }
                 continue;
             }
-            rx_crc = (uint16_t)(((uint16_t)crc_msb << 8U) | crc_lsb);
-            calc_crc = xmodem_compute_crc16(data, XMODEM_1K_BLOCK_SIZE);
+            calc_crc = xmodem_compute_crc16(&data);
             if (calc_crc != rx_crc) {
-                SendCharFTDI(XMODEM_NAK);
+                fifo_commit(fifo, XMODEM_1K_FRAME_SIZE);
+                if (xmodem_reject(link, streaming) != 0) {
+                    return -1;
+                }
                 continue;
             }
             /* Gestion des numéros de bloc */
 			if (block_num == block_expected) {
-				/* Appel de la fonction de callback pour traiter le bloc en passant le CRC reçu */
-				callback(data, block_expected, rx_crc);
+				/* Appel de la fonction de callback avec le descripteur du bloc, libéré au retour */
+				callback(&data, block_expected, rx_crc);
+				fifo_commit(fifo, XMODEM_1K_FRAME_SIZE);
+				if (flash_pipe_poll() == FLASH_PIPE_ERROR) {
+					return xmodem_abort(link);
+				}
 				block_expected++;
-				SendCharFTDI(XMODEM_ACK);
-			} else if (block_num == (uint8_t)(block_expected - 1U)) {
-                /* Bloc dupliqué : renvoi d'un ACK */
-                SendCharFTDI(XMODEM_ACK);
+				blocks_accepted++;
+				if (!streaming) {
+					/* Effacement des pages complètes pendant que l'émetteur attend l'ACK */
+					if (flash_pipe_prepare() != FLASH_PIPE_OK) {
+						return xmodem_abort(link);
+					}
+					xmodem_ack_block(link, blocks_accepted == 1U);
+				}
+			} else if ((block_num == (uint8_t)(block_expected - 1U)) && !streaming) {
+                /* Bloc dupliqué, réponse perdue : même réponse (reprise éventuelle pour le bloc 1) */
+                fifo_commit(fifo, XMODEM_1K_FRAME_SIZE);
+                xmodem_ack_block(link, blocks_accepted == 1U);
             } else {
-                SendCharFTDI(XMODEM_NAK);
+                fifo_commit(fifo, XMODEM_1K_FRAME_SIZE);
+                if (xmodem_reject(link, streaming) != 0) {
+                    return -1;
+                }
             }
             retry = 0U;
         } else if (header == XMODEM_CAN) {
-            if (fifo_wait_for(fifo, 1U, XMODEM_BYTE_TIMEOUT_MS) != 0) {
-				while(fifo_is_empy(&usart2_fifo)) {};
+            if (xmodem_wait_for(fifo, 1U, XMODEM_BYTE_TIMEOUT_MS) == FIFO_OK) {
                 (void)fifo_get(fifo, &header);
                 if (header == XMODEM_CAN) {
-                    SendCharFTDI(XMODEM_ACK);
+                    transport_send_char(link, XMODEM_ACK);
                     return -1;
                 }
             }
-            SendCharFTDI(XMODEM_NAK);
+            if (xmodem_reject(link, streaming) != 0) {
+                return -1;
+            }
         } else {
-            SendCharFTDI(XMODEM_NAK);
+            if (xmodem_reject(link, streaming) != 0) {
+                return -1;
+            }
         }
     }
     return 0;
 }
 
+/**
+ * @brief Réception XMODEM 1K en mode blockwise (stop-and-wait, chaque bloc est acquitté).
+ *
+ * @param[in]     link      Liaison de la session (USART2 ou USB CDC, voir transport.c).
+ * @param[in]     callback  Fonction de rappel appelée pour traiter chaque bloc.
+ * @return int  0 si la transmission s'est correctement terminée (EOT reçu), -1 en cas d'erreur.
+ */
+int xmodem_receive_1k_blockwise(const transport_t *link, xmodem_block_callback_t callback)
+{
+    return xmodem_receive_1k(link, callback, false);
+}
 
 /**
- * @brief Calcule le CRC16 (polynôme 0x1021) sur un bloc de données à l'aide d'une table pré‑calculée.
+ * @brief Réception XMODEM-1K-G (streaming, sans acquittement par bloc).
  *
- * @param[in] data   Pointeur sur le buffer de données.
- * @param[in] length Longueur des données en octets.
- * @return uint16_t CRC16 calculé.
+ * Réservé aux liaisons fiables (USB CDC, câble court) : la première erreur annule
+ * la session, qui doit alors être relancée.
+ *
+ * @param[in]     link      Liaison de la session (USART2 ou USB CDC, voir transport.c).
+ * @param[in]     callback  Fonction de rappel appelée pour traiter chaque bloc.
+ * @return int  0 si la transmission s'est correctement terminée (EOT reçu), -1 en cas d'erreur.
  */
-static uint16_t flash_compute_crc16(const uint8_t *data, uint32_t length)
+int xmodem_receive_1k_g(const transport_t *link, xmodem_block_callback_t callback)
 {
-    uint16_t crc = 0U;
-    uint32_t i;
+    return xmodem_receive_1k(link, callback, true);
+}
 
-    if (data == NULL)
-    {
-        /* En cas d'erreur, vous pouvez gérer le problème ici (ex. retourner 0 ou lever une erreur) */
-        return 0U;
+
+/* Format de l'image en cours de réception, détecté dans le premier bloc */
+#define FLASH_FORMAT_RAW    0U  /**< Image brute */
+#define FLASH_FORMAT_LZSS   1U  /**< Image compressée (lzss.h) */
+#define FLASH_FORMAT_DELTA  2U  /**< Patch différentiel appliqué à l'application installée (delta.h) */
+
+/** Décodeur de l'image compressée en cours de réception (fenêtre de 1 ko). */
+static lzss_decoder_t flash_decoder;
+/** Décodeur du patch en cours de réception. */
+static delta_decoder_t flash_delta;
+/** Prochaine position d'écriture du patch dans l'image, pour repositionner le pipeline. */
+static uint32_t flash_delta_offset;
+/** Format de l'image en cours de réception. */
+static uint8_t flash_format = FLASH_FORMAT_RAW;
+/** En-tête reçu en tête de l'image (image.h), s'il est présent. */
+static image_header_t flash_header;
+static bool flash_has_header = false;
+/** Nombre d'octets d'une image brute transmis au pipeline. */
+static uint32_t flash_raw_length;
+/** Image brute avec en-tête dont l'émetteur sait reprendre le transfert. */
+static bool flash_resumable = false;
+/** Position de reprise décidée au bloc 1, renvoyée si le bloc 1 est réémis. */
+static uint32_t flash_resume_offset;
+
+/**
+ * @brief Sortie du décodeur LZSS vers le pipeline d'écriture flash.
+ *
+ * @param[in] context Inutilisé.
+ * @param[in] data    Octets décompressés.
+ * @param[in] length  Nombre d'octets.
+ * @return int 0 en cas de succès, -1 en cas d'erreur d'écriture.
+ */
+static int flash_decoder_sink(void *context, const uint8_t *data, uint32_t length)
+{
+    (void)context;
+    return (flash_pipe_write_all(data, length) == FLASH_PIPE_OK) ? 0 : -1;
+}
+
+/**
+ * @brief Sortie du décodeur de patch vers le pipeline d'écriture flash.
+ *
+ * Les pages sont reconstruites dans l'ordre du patch : le pipeline est repositionné
+ * au début de chaque page qui ne suit pas la précédente.
+ *
+ * @param[in] context Inutilisé.
+ * @param[in] offset  Position des octets dans l'image.
+ * @param[in] data    Octets reconstruits.
+ * @param[in] length  Nombre d'octets.
+ * @return int 0 en cas de succès, -1 en cas d'erreur d'écriture.
+ */
+static int flash_delta_sink(void *context, uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    (void)context;
+    if ((offset != flash_delta_offset) && (flash_pipe_seek(FLASH_APP_ADDRESS + offset) != FLASH_PIPE_OK)) {
+        return -1;
     }
+    flash_delta_offset = offset + length;
+    return (flash_pipe_write_all(data, length) == FLASH_PIPE_OK) ? 0 : -1;
+}
 
-    for (i = 0U; i < length; i++)
-    {
-        crc = (uint16_t)((crc << 8U) ^ crc16_table[((crc >> 8U) ^ data[i]) & 0xFFU]);
+/**
+ * @brief Transmet un segment de bloc reçu au pipeline, directement ou via un décodeur.
+ *
+ * @param[in] data   Octets reçus.
+ * @param[in] length Nombre d'octets.
+ * @return int 0 en cas de succès, -1 en cas d'erreur.
+ */
+static int flash_write_segment(const uint8_t *data, uint32_t length)
+{
+    if (length == 0U) {
+        return 0;
+    }
+    if (flash_format == FLASH_FORMAT_LZSS) {
+        return (lzss_decode(&flash_decoder, data, length, flash_decoder_sink, NULL) == LZSS_ERROR) ? -1 : 0;
+    }
+    if (flash_format == FLASH_FORMAT_DELTA) {
+        return (delta_decode(&flash_delta, data, length, flash_delta_sink, NULL) == DELTA_ERROR) ? -1 : 0;
+    }
+    /* Image annoncée par un en-tête : le bourrage du dernier bloc n'est pas écrit */
+    if (flash_has_header && (length > (flash_header.length - flash_raw_length))) {
+        length = flash_header.length - flash_raw_length;
+        if (length == 0U) {
+            return 0;
+        }
+    }
+    flash_raw_length += length;
+    return (flash_pipe_write_all(data, length) == FLASH_PIPE_OK) ? 0 : -1;
+}
+
+/**
+ * @brief Retire les premiers octets d'une plage décrite par un descripteur de FIFO.
+ *
+ * @param[in,out] span Descripteur de la plage.
+ * @param[in]     n    Nombre d'octets à retirer (au plus la longueur de la plage).
+ */
+static void xmodem_span_skip(fifo_span_t *span, uint32_t n)
+{
+    if (n < span->length[0]) {
+        span->data[0] += n;
+        span->length[0] -= n;
+    } else {
+        n -= span->length[0];
+        span->data[0] = span->data[1] + n;
+        span->length[0] = span->length[1] - n;
+        span->data[1] = NULL;
+        span->length[1] = 0U;
     }
-    return crc;
 }
+
 /**
- * @brief Callback pour accumuler deux blocs et écrire 2048 octets en flash.
+ * @brief Callback d'écriture en flash de chaque bloc reçu.
  *
- * Cette fonction est appelée pour chaque bloc de 1024 octets reçu.
- * Elle accumule les blocs dans un tampon statique. Lorsque deux blocs ont été
- * réceptionnés, elle écrit les 2048 octets en flash à l'adresse FLASH_APP_ADDRESS
- * (mise à jour au fur et à mesure), relit les données écrites, recalcule le CRC
- * sur chaque segment de 1024 octets et compare avec les CRC reçus.
+ * Cette fonction est appelée pour chaque bloc reçu (XMODEM ou YMODEM). Le bloc est
+ * copié depuis la FIFO de réception dans le tampon de préparation courant du
+ * pipeline d'écriture flash, qui efface, programme et vérifie chaque page de 2 ko
+ * pendant la réception des blocs suivants. La fonction n'attend que si les deux
+ * tampons de préparation sont occupés ; une erreur d'écriture est signalée par
+ * flash_pipe_poll() à la boucle de réception.
  *
- * @param[in] block         Pointeur sur le bloc de 1024 octets reçu.
+ * Le premier bloc peut commencer par un en-tête d'image (image.h), retiré du flux
+ * et vérifié en fin de transfert. Le premier bloc détermine ensuite le format :
+ *   - signature d'une image compressée (lzss.h) : l'image est décompressée au fil
+ *     de l'eau vers le pipeline ;
+ *   - signature d'un patch (delta.h) : la nouvelle image est reconstruite en place
+ *     à partir de l'application installée, seules les pages modifiées sont réécrites.
+ * Le bourrage qui suit la fin annoncée est ignoré.
+ *
+ * @param[in] block         Descripteur du bloc de données.
  * @param[in] block_number  Numéro du bloc reçu (commençant par 1).
- * @param[in] received_crc  CRC calculé lors de la réception pour ce bloc.
+ * @param[in] received_crc  CRC vérifié lors de la réception pour ce bloc.
  */
-static uint8_t flash_buffer[FLASH_PACKET_SIZE] = {0};
-static uint8_t verify_buffer[FLASH_PACKET_SIZE] = {0};
-void flash_write_callback(const uint8_t *block, uint32_t block_number, uint16_t received_crc) {
-    /* Tampon statique pour accumuler deux blocs (2048 octets) */
-    /* Tableau statique pour mémoriser les CRC reçus pour chaque bloc */
-    static uint16_t rx_crc[2] = {0U, 0U};
-    /* Compteur de blocs accumulés dans le paquet courant (0 ou 1) */
-    static uint8_t block_index = 0U;
-    /* Adresse de flash courante, initialisée au départ défini par FLASH_APP_ADDRESS */
-    static uint32_t flash_current_address = FLASH_APP_ADDRESS;
-    int ret;
-    uint16_t calc_crc;
-	(void)block_number;
-    /* Copie du bloc reçu dans le tampon correspondant */
-    memcpy(&flash_buffer[block_index * XMODEM_1K_BLOCK_SIZE], block, XMODEM_1K_BLOCK_SIZE);
-    rx_crc[block_index] = received_crc;
-    block_index++;
-
-    /* Si deux blocs ont été accumulés, écrire en flash */
-    if (block_index == 2U) {
-        /* Écriture en flash de 2048 octets à l'adresse flash_current_address */
-        ret = flash_write(flash_current_address, flash_buffer, FLASH_PACKET_SIZE);
-        if (ret != 0) {
-//            printf("Erreur d'écriture flash à l'adresse 0x%08lX\r\n", (unsigned long)flash_current_address);
-            /* Réinitialiser block_index pour tenter de reprendre la transmission */
-            block_index = 0U;
-            return;
-        }
+void flash_write_callback(const fifo_span_t *block, uint32_t block_number, uint16_t received_crc) {
+    fifo_span_t payload = *block;
+    uint8_t head[IMAGE_HEADER_SIZE];
+    uint32_t length = 0U;
+    uint32_t i;
+    (void)received_crc;
 
-        /* Lecture de la zone flash pour vérification */
-        ret = flash_read(flash_current_address, verify_buffer, FLASH_PACKET_SIZE);
-        if (ret != 0)
-        {
-//            printf("Erreur de lecture flash à l'adresse 0x%08lX\r\n", (unsigned long)flash_current_address);
-            block_index = 0U;
-            return;
+    if (block_number == 1U) {
+        flash_format = FLASH_FORMAT_RAW;
+        flash_has_header = false;
+        flash_resumable = false;
+        flash_resume_offset = 0U;
+        flash_raw_length = 0U;
+
+        /* L'en-tête et la signature peuvent être coupés par le rebouclage de la FIFO */
+        if ((payload.length[0] + payload.length[1]) >= IMAGE_HEADER_SIZE) {
+            for (i = 0U; i < IMAGE_HEADER_SIZE; i++) {
+                head[i] = xmodem_span_byte(&payload, i);
+            }
+            (void)memcpy(&flash_header, head, sizeof(flash_header));
+            if (flash_header.magic == IMAGE_HEADER_MAGIC) {
+                if (image_header_check(&flash_header) != IMAGE_OK) {
+                    flash_pipe_abort();
+                    return;
+                }
+                flash_has_header = true;
+                xmodem_span_skip(&payload, IMAGE_HEADER_SIZE);
+            }
         }
 
-        /* Calcul et comparaison du CRC sur le premier bloc (1024 octets) */
-        calc_crc = flash_compute_crc16(&verify_buffer[0], XMODEM_1K_BLOCK_SIZE);
-        if (calc_crc != rx_crc[0])
-        {
-//            printf("Erreur CRC sur bloc 1: attendu 0x%04X, calculé 0x%04X\r\n", rx_crc[0], calc_crc);
-            block_index = 0U;
-            return;
+        if ((payload.length[0] + payload.length[1]) >= LZSS_HEADER_SIZE) {
+            for (i = 0U; i < LZSS_HEADER_SIZE; i++) {
+                head[i] = xmodem_span_byte(&payload, i);
+            }
+            if (lzss_is_compressed(head, 4U) != 0) {
+                flash_format = FLASH_FORMAT_LZSS;
+                lzss_decoder_init(&flash_decoder);
+                length = (uint32_t)head[8] | ((uint32_t)head[9] << 8U)
+                       | ((uint32_t)head[10] << 16U) | ((uint32_t)head[11] << 24U);
+            } else if (delta_is_patch(head, 4U) != 0) {
+                /* Le patch lit l'application installée : impossible si la zone a été effacée */
+                if (flash_pipe_is_erased(FLASH_APP_ADDRESS)) {
+                    flash_pipe_abort();
+                    return;
+                }
+                flash_format = FLASH_FORMAT_DELTA;
+                flash_delta_offset = 0U;
+                delta_decoder_init(&flash_delta, (const uint8_t *)FLASH_APP_ADDRESS,
+                                   FLASH_APP_END_ADDRESS - FLASH_APP_ADDRESS + 1U);
+            }
         }
+        flash_resumable = flash_has_header && (flash_format == FLASH_FORMAT_RAW)
+                          && ((flash_header.flags & IMAGE_FLAG_RESUMABLE) != 0U);
 
-        /* Calcul et comparaison du CRC sur le deuxième bloc (1024 octets) */
-        calc_crc = flash_compute_crc16(&verify_buffer[XMODEM_1K_BLOCK_SIZE], XMODEM_1K_BLOCK_SIZE);
-        if (calc_crc != rx_crc[1])
-        {
-//            printf("Erreur CRC sur bloc 2: attendu 0x%04X, calculé 0x%04X\r\n", rx_crc[1], calc_crc);
-            block_index = 0U;
-            return;
+        /* Taille connue (hors patch, écrit en place) : effacement de la plage en une fois */
+        if (flash_has_header && (flash_format == FLASH_FORMAT_RAW)) {
+            length = flash_header.length;
         }
+        if (length != 0U) {
+            flash_pipe_erase_ahead(FLASH_APP_ADDRESS + length - 1U);
+        }
+    }
+
+    if ((flash_write_segment(payload.data[0], payload.length[0]) != 0)
+        || (flash_write_segment(payload.data[1], payload.length[1]) != 0)) {
+        flash_pipe_abort();
+    }
+}
 
-        /* Si la vérification est réussie, mise à jour de l'adresse flash pour le prochain paquet */
-//        printf("Paquet de 2048 octets écrit et vérifié à l'adresse 0x%08lX\r\n", (unsigned long)flash_current_address);
-        flash_current_address += FLASH_PACKET_SIZE;
-        /* Réinitialisation du compteur de blocs pour le prochain paquet */
-        block_index = 0U;
+/**
+ * @brief Décide de la reprise d'un transfert interrompu après l'acceptation du bloc 1.
+ *
+ * Réservé aux récepteurs qui peuvent transmettre la position de reprise à
+ * l'émetteur (XMODEM-1K stop-and-wait). Le journal de reprise est démarré, ou
+ * repris s'il concerne la même image : le pipeline est alors repositionné après
+ * les pages déjà écrites et le reste du bloc 1 est abandonné (aucune page n'a
+ * encore été effacée). Les appels suivants, pour un bloc 1 réémis parce que la
+ * réponse a été perdue, retournent la même position.
+ *
+ * @return uint32_t Position de reprise dans le fichier transféré (en-tête compris),
+ *                  ou 0 pour poursuivre normalement.
+ */
+uint32_t flash_write_resume(void)
+{
+    int pages;
+
+    if (!flash_resumable) {
+        return flash_resume_offset;
+    }
+    flash_resumable = false;
+    pages = image_journal_begin(&flash_header);
+    if (pages < 0) {
+        flash_pipe_abort();
+        return 0U;
+    }
+    if (pages == 0) {
+        return 0U;
+    }
+    flash_pipe_init(FLASH_APP_ADDRESS + ((uint32_t)pages * FLASH_PAGE_SIZE), FLASH_APP_END_ADDRESS);
+    flash_pipe_erase_ahead(FLASH_APP_ADDRESS + flash_header.length - 1U);
+    flash_raw_length = (uint32_t)pages * FLASH_PAGE_SIZE;
+    flash_resume_offset = IMAGE_HEADER_SIZE + flash_raw_length;
+    return flash_resume_offset;
+}
+
+/**
+ * @brief Contrôle de fin d'image, après l'écriture de toutes les pages.
+ *
+ * L'image doit être complète (fin du flux compressé, toutes les pages d'un patch
+ * reconstruites) ; son CRC32 en flash est ensuite comparé à celui de l'en-tête reçu
+ * et l'image est enregistrée comme valide (voir image.c).
+ *
+ * @return int 0 si l'image est complète et enregistrée, -1 sinon.
+ */
+int flash_write_finish(void)
+{
+    uint32_t length = flash_raw_length;
+
+    if (flash_format == FLASH_FORMAT_DELTA) {
+        if (delta_finish(&flash_delta, (const uint8_t *)FLASH_APP_ADDRESS) != DELTA_DONE) {
+            return -1;
+        }
+        length = flash_delta.target_length;
+    } else if (flash_format == FLASH_FORMAT_LZSS) {
+        if (flash_decoder.status != LZSS_DONE) {
+            return -1;
+        }
+        length = flash_decoder.length;
+    } else {
+        /* Image brute */
     }
+    return (image_commit(flash_has_header ? &flash_header : NULL, length) == IMAGE_OK) ? 0 : -1;
 }
@@ -2,8 +2,8 @@
 #include "ymodem_conf.h"
 #include "ymodem.h"
 
-static uint8_t YMODEM_GetByte(void);
 static void YMODEM_SendByte(uint8_t byte);
+static void YMODEM_Purge(void);
 #define YM_FILE_NAME_LENGTH			(256)
 #define YM_FILE_SIZE_LENGTH			(16)
 
@@ -22,6 +22,13 @@ static void YMODEM_SendByte(uint8_t byte);
 /* Nombre maximal de retransmissions par bloc */
 #define MAX_RETRANS             50U
 
+/* Silence de la ligne au-delà duquel le paquet en cours est abandonné (ms) */
+#define YMODEM_BYTE_TIMEOUT_MS  1000U
+
+/* Silence attendu avant un NAK, et durée maximale de la purge (ms) */
+#define YMODEM_PURGE_QUIET_MS   100U
+#define YMODEM_PURGE_MAX_MS     3000U
+
 /**
  * @brief  YMODEM Control Characters
  * 
@@ -34,14 +41,12 @@ enum YM_CC {
 	NAK			= 0x15,  /* negative acknowledge */
 	CA			= 0x18,  /* two of these in succession aborts transfer */
 	CRC16		= 0x43,  /* 'C' == 0x43, request 16-bit CRC */
+	STREAM		= 0x47,  /* 'G' == 0x47, request streaming (YMODEM-G) */
 	ABORT1		= 0x41,  /* 'A' == 0x41, abort by user */
 	ABORT2		= 0x61,  /* 'a' == 0x61, abort by user */
 };
 
 
-/** Polynomial for CRC calculation **/
-#define YM_CRC_POLY		(0x1021)
-
 #define SWAP16(x)		(x >> 8) | ((x & 0xff) << 8)
 #define ISVALIDDEC(c) 	((c >= '0') && (c <= '9'))
 #define CONVERTDEC(c)	(c - '0')
@@ -87,13 +92,20 @@ static uint16_t packetSize;						/** Size of current packet **/
 static int32_t 	packetsReceived;				/** Num packets received **/
 static uint32_t flashAddr; 						/** Flash memory address to write packet to **/
 static YMODEM_T nextStatus; 					/** Status to return after closing a connection **/
+static uint8_t 	streaming;						/** YMODEM-G: no per-packet ACK, abort on first error **/
+static uint8_t 	startChar;						/** 'C' or 'G', requests the next file / data **/
+static const transport_t *ymodem_link;			/** Liaison de la session (USART2 ou USB CDC) **/
+static xmodem_block_callback_t blockCallback;	/** Receives each data packet (flash path) **/
 
 
 /**
  * @brief  Initialise YMODEM Rx State 
  * 
+ * @param  streamingMode	1 for YMODEM-G (negotiated with 'G', no per-packet ACK,
+ * 							the first error aborts the session), 0 for YMODEM
+ * @param  callback		Called with each data packet, trimmed to the file size
  */
-void YMODEM_Init(void) {
+void YMODEM_Init(uint8_t streamingMode, xmodem_block_callback_t callback) {
 	memset(fileName, 	0, YM_FILE_NAME_LENGTH);
 	memset(fileSizeStr, 0, YM_FILE_SIZE_LENGTH);
 	fileSize 		= 0;
@@ -105,6 +117,10 @@ void YMODEM_Init(void) {
 	eotReceived 	= 0;
 	flashAddr 		= YMODEM_FLASH_START;
 	nextStatus 		= YMODEM_OK;
+	streaming 		= streamingMode;
+	startChar 		= streamingMode ? STREAM : CRC16;
+	blockCallback 	= callback;
+	flash_pipe_init(YMODEM_FLASH_START, FLASH_APP_END_ADDRESS);
 }
 
 
@@ -119,7 +135,7 @@ void YMODEM_Init(void) {
 static YMODEM_T GenerateResponse(YM_RET_T retVal, uint8_t *respBuff, uint8_t *len) {
 	switch (retVal) {
 		case YM_OK:
-			len = 0;
+			*len = 0;
 			return YMODEM_OK;
 			break;
 		case YM_ABORT:
@@ -141,24 +157,39 @@ static YMODEM_T GenerateResponse(YM_RET_T retVal, uint8_t *respBuff, uint8_t *le
 			nextStatus = YMODEM_SIZE_ERR;
 			return YMODEM_TX_PENDING;
 		case YM_START_RX:
+			/* YMODEM-G: block 0 is not acknowledged, 'G' starts the data stream */
+			if (streaming) {
+				respBuff[0] = STREAM;
+				*len = 1;
+				return YMODEM_TX_PENDING;
+			}
 			respBuff[0] = ACK;
 			respBuff[1] = CRC16;
 			*len = 2;
 			return YMODEM_TX_PENDING;
 			break;
 		case YM_RX_ERROR:
+			/* YMODEM-G: the sender never retransmits, abort the session */
+			if (streaming) {
+				YMODEM_Abort(respBuff, len);
+				return YMODEM_TX_PENDING;
+			}
 			respBuff[0] = NAK;
 			*len = 1;
 			return YMODEM_TX_PENDING;
 			break;
 		case YM_RX_OK:
+			if (streaming) {
+				*len = 0;
+				return YMODEM_OK;
+			}
 			respBuff[0] = ACK;
 			*len = 1;
 			return YMODEM_TX_PENDING;
 			break;
 		case YM_RX_COMPLETE:
 			respBuff[0] = ACK;
-			respBuff[1] = CRC16;
+			respBuff[1] = startChar;
 			*len = 2;
 			return YMODEM_TX_PENDING;
 			break;
@@ -227,7 +258,8 @@ YMODEM_T YMODEM_ReceiveByte(uint8_t c, uint8_t *respBuff, uint8_t *respLen) {
 				case EOT: 
 				/* One more packet comes after with 0,FF so reset this */
 					eotReceived = 1;
-					ret = YM_RX_COMPLETE;
+					/* The whole image must be written and committed (image.c) before EOT is acknowledged */
+					ret = ((flash_pipe_flush() == FLASH_PIPE_OK) && (flash_write_finish() == 0)) ? YM_RX_COMPLETE : YM_WRITE_ERR;
 					break;
 				case CA:
 					/* Two of these aborts transfer */
@@ -255,8 +287,10 @@ YMODEM_T YMODEM_ReceiveByte(uint8_t c, uint8_t *respBuff, uint8_t *respLen) {
 				/* Last byte of packet */
 				packet_data[packetBytes++] = c; 
 				if (packet_data[YM_PACKET_SEQNO_INDEX] != ((packet_data[YM_PACKET_SEQNO_COMP_INDEX] ^ 0xFF) & 0xFF)) {
-					/* Check byte 1 == (byte 2 XOR 0xFF) */
+					/* Check byte 1 == (byte 2 XOR 0xFF), wait for the next packet */
 					ret = YM_RX_ERROR;
+					startOfPacket = 1;
+					packetBytes = 0;
 					break;
 				} else {
 					/* Full packet received */
@@ -273,6 +307,45 @@ YMODEM_T YMODEM_ReceiveByte(uint8_t c, uint8_t *respBuff, uint8_t *respLen) {
 	return GenerateResponse(ret, respBuff, respLen);
 }
 
+/**
+ * @brief  				Handles a silent line during a session (no byte for YMODEM_BYTE_TIMEOUT_MS).
+ * 						A partially received packet is discarded and the sender is asked
+ * 						to retransmit, so that a lost byte does not desynchronise the receiver.
+ * 
+ * @param  respBuff		Buffer to write the data to be sent back to the sender
+ * @param  respLen		Length of the data to send to the sender.
+ * @return YMODEM_T 	YMODEM_TX_PENDING, or the closing status if the session has ended.
+ */
+YMODEM_T YMODEM_Timeout(uint8_t *respBuff, uint8_t *respLen) {
+	YM_RET_T ret;
+
+	*respLen = 0;
+	if (nextStatus != YMODEM_OK) return nextStatus;
+
+	if (!startOfPacket || (packetsReceived != 0) || eotReceived) {
+		startOfPacket = 1;
+		packetBytes = 0;
+		ret = YM_RX_ERROR;
+	} else {
+		/* Header packet not received yet: request it again */
+		respBuff[0] = startChar;
+		*respLen = 1;
+		return YMODEM_TX_PENDING;
+	}
+	prevC = 0;
+	return GenerateResponse(ret, respBuff, respLen);
+}
+
+/**
+ * @brief  				Status of the session after the last response.
+ * 
+ * @return YMODEM_T 	YMODEM_OK while the session is open, otherwise the closing status
+ * 						(YMODEM_COMPLETE, YMODEM_ABORTED, ...).
+ */
+YMODEM_T YMODEM_Status(void) {
+	return nextStatus;
+}
+
 static YM_RET_T YMODEM_ProcessPacket(void) {
 	YM_RET_T ret = YM_OK;
 	do {
@@ -301,40 +374,42 @@ static YM_RET_T YMODEM_ProcessPacket(void) {
 }
 
 /**
- * @brief  				Writes a data packet to the flash set in ymodem_conf.h
- * 						Optionally validates the writes.
+ * @brief  				Hands a data packet to the block callback (flash path).
+ * 						The padding of the last packet is trimmed using the file size.
  * 
  * @return YM_RET_T 	YM_WRITE_ERR if write fails, otherwise YM_RX_OK
  */
 static YM_RET_T YMODEM_ProcessDataPacket(void) {
 	YM_RET_T ret;
+	fifo_span_t span;
+	uint32_t written;
+	uint32_t length;
+	uint16_t packetCRC;
 	do { 
-////KRIS		if (HAL_FLASH_Unlock() != HAL_OK) {
-////			ret = YM_WRITE_ERR;
-////			break;
-////		}
-
-////		__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR );// FLASH_FLAG_PGSERR);
-
-////		const uint8_t *buffIn = (const uint8_t *)packet_data + YM_PACKET_HEADER;
-
-////		for (uint32_t i = 0; (i < packetSize) && (flashAddr <= YMODEM_FLASH_START + YMODEM_FLASH_SIZE); i++) {
-////			if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE, flashAddr, buffIn[i]) != HAL_OK) {
-////				ret = YM_WRITE_ERR;
-////				break;
-////			}
-
-////			flashAddr++;
-////		}
-////							
-////		HAL_FLASH_Lock();
-////		
-////		#ifdef YMODEM_VALIDATE_PROGRAMMING
-////		if(memcmp((void *)(flashAddr-packetSize), (void *)&packet_data[YM_PACKET_HEADER], packetSize) != 0) {
-////			ret = YM_WRITE_ERR;
-////			break;
-////		}
-////		#endif
+		written = flashAddr - YMODEM_FLASH_START;
+		length = packetSize;
+		if ((fileSize != 0U) && (length > (fileSize - written))) {
+			length = (written < fileSize) ? (fileSize - written) : 0U;
+		}
+
+		if ((length != 0U) && (blockCallback != NULL)) {
+			packetCRC = (uint16_t)((packet_data[YM_PACKET_HEADER + packetSize] << 8) | packet_data[YM_PACKET_HEADER + packetSize + 1]);
+			span.data[0] 	= &packet_data[YM_PACKET_HEADER];
+			span.length[0] 	= length;
+			span.data[1] 	= &packet_data[YM_PACKET_HEADER];
+			span.length[1] 	= 0U;
+			blockCallback(&span, (uint32_t)packetsReceived, packetCRC);
+			if (flash_pipe_poll() == FLASH_PIPE_ERROR) {
+				ret = YM_WRITE_ERR;
+				break;
+			}
+			/* Stop-and-wait: erase full pages before the ACK, while the sender waits */
+			if (!streaming && (flash_pipe_prepare() != FLASH_PIPE_OK)) {
+				ret = YM_WRITE_ERR;
+				break;
+			}
+		}
+		flashAddr += length;
 
 		ret = YM_RX_OK;
 		packetsReceived++;
@@ -369,31 +444,24 @@ static YM_RET_T YMODEM_ProcessFirstPacket(void) {
 			fileSizeStr[i++] = '\0';
 			Str2Int(fileSizeStr, &fileSize);
 
-			/* Test size of image < Flash size */
-			if (fileSize > (YMODEM_FLASH_SIZE - 1)) {
+			/* Test size of image < Flash size (pages are erased by the flash pipeline).
+			 * The image header (image.h) is not written: a full-size image may carry one. */
+			if (fileSize > (YMODEM_FLASH_SIZE + IMAGE_HEADER_SIZE)) {
 				/* End session */
 				ret = YM_SIZE_ERR;
 				break;
-			} else {
-////KRIS				/* Erase Flash Sector */
-////				FLASH_EraseInitTypeDef EraseInitStruct;
-////				uint32_t sectorError;
-
-////				EraseInitStruct.TypeErase		= FLASH_TYPEERASE_SECTORS;
-////				EraseInitStruct.Sector			= YMODEM_FLASH_FIRST_SECTOR_NUM;
-////				EraseInitStruct.NbSectors		= YMODEM_FLASH_NUM_OF_SECTORS;
-////				EraseInitStruct.VoltageRange	= FLASH_VOLTAGE_RANGE_3;
-////				
-////				HAL_FLASH_Unlock();
-////				__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR );// FLASH_FLAG_PGSERR);
-////				if(HAL_FLASHEx_Erase(&EraseInitStruct, &sectorError) != HAL_OK) {
-////					HAL_FLASH_Lock();
-////					ret = YM_WRITE_ERR;
-////					break;
-////				}
-////				HAL_FLASH_Lock();
 			}
 
+			/* YMODEM-G without flow control (USART2): the sender never pauses, so the
+			 * DMA ring cannot absorb a page erase. Erase the whole application area
+			 * before 'G': fileSize is the transferred size, smaller than the written
+			 * image for an LZSS image. */
+			if (streaming && !ymodem_link->flow_control) {
+				if (flash_pipe_preerase(FLASH_APP_END_ADDRESS) != FLASH_PIPE_OK) {
+					ret = YM_WRITE_ERR;
+					break;
+				}
+			}
 
 			/* Send ACK AND CRC, READY FOR DATA */
 			ret = YM_START_RX;
@@ -437,41 +505,12 @@ static uint32_t Str2Int(uint8_t *inputstr, uint32_t *intnum) {
 	return res;
 }
 
-static uint16_t crc_update(uint16_t crc_in, int incr)
-{
-        uint16_t xor = crc_in >> 15;
-        uint16_t out = crc_in << 1;
-
-        if (incr)
-                out++;
-
-        if (xor)
-                out ^= YM_CRC_POLY;
-
-        return out;
-}
-
-
-static uint16_t crc16(const uint8_t *data, uint16_t size)
-{
-        uint16_t crc, i;
-
-        for (crc = 0; size > 0; size--, data++)
-                for (i = 0x80; i; i >>= 1)
-                        crc = crc_update(crc, *data & i);
-
-        for (i = 0; i < 16; i++)
-                crc = crc_update(crc, 0);
-
-        return crc;
-}
-
 static YM_RET_T YMODEM_CheckCRC(void) {
 	uint16_t sourceCRC = 0;
 	sourceCRC = packet_data[(packetSize+YM_PACKET_OVERHEAD) - 1];
 	sourceCRC = (sourceCRC << 8) | packet_data[(packetSize+YM_PACKET_OVERHEAD) - 2];
 
-	uint16_t newCRC = SWAP16(crc16(packet_data+YM_PACKET_HEADER, packetSize));
+	uint16_t newCRC = SWAP16(crc16_final(crc16_update(crc16_init(), packet_data+YM_PACKET_HEADER, packetSize)));
 	if (newCRC != sourceCRC) {
 		return YM_RX_ERROR;
 	} else {
@@ -479,114 +518,151 @@ static YM_RET_T YMODEM_CheckCRC(void) {
 	}
 }
 
-int YMODEM_Receive(void) {
+/**
+ * @brief  				Receives a file over the link, YMODEM or YMODEM-G.
+ * 
+ * @param  link			Link of the session (USART2 or USB CDC)
+ * @param  streamingMode	1 for YMODEM-G, 0 for YMODEM
+ * @param  callback		Receives each data packet (flash_write_callback())
+ * @return int			0 when the file is received and committed, -1 otherwise
+ */
+int YMODEM_Receive(const transport_t *link, uint8_t streamingMode, xmodem_block_callback_t callback) {
     uint8_t retransmissions;
-    uint8_t byte;	
 	uint8_t buff[100];
 	char Chaine[50];
 	uint8_t payload[5];
 	uint8_t payloadLen;
 //	uint8_t pcOutputStr[100];
 	uint8_t fwDownloading = 1;
+	int result = -1;
 	uint32_t CptBuf = 0L;
-	fifo_reset(&cdc_fifo);
-    /* Phase d'initialisation : envoyer des 'C' jusqu'à réception du bloc d'en-tête */
+	uint32_t lastRxTick;
+	uint8_t timeouts = 0U;
+	ymodem_link = link;
+	/* Octets reçus avant la session (menu) : vidés côté lecteur, le DMA peut écrire en même temps */
+	fifo_commit(ymodem_link->rx, fifo_len(ymodem_link->rx));
+	YMODEM_Init(streamingMode, callback);
+    /* Phase d'initialisation : envoyer des 'C' ('G' en YMODEM-G) jusqu'à réception du bloc d'en-tête */
     retransmissions = 0;
     do
     {
-        YMODEM_SendByte('C');
+        YMODEM_SendByte(startChar);
         HAL_Delay(1000U);
-//        byte = YMODEM_GetByte();
-        if (!fifo_is_empty(&cdc_fifo)) {
+        if (!fifo_is_empty(ymodem_link->rx)) {
             /* On a reçu un bloc d'en-tête */
             break;
         }
         retransmissions++;
     } while (retransmissions < MAX_RETRANS);	
-	for(;;) {	
-		if (fwDownloading) {	
-			/* ABORT if "a" sent */
-			CptBuf = 0L;
-			while(!fifo_is_empty(&cdc_fifo)) {
-				fifo_get(&cdc_fifo, &buff[CptBuf++]);
-			}
-
-			if ((strcmp((char *)buff, "a") == 0) && (strlen((char *)buff) <= 3)) { 
-				/* Send abort */
-
+	lastRxTick = HAL_GetTick();
+	while (fwDownloading) {	
+		/* Écriture flash en tâche de fond pendant la réception */
+		(void)flash_pipe_poll();
+
+		CptBuf = 0L;
+		while(!fifo_is_empty(ymodem_link->rx) && (CptBuf < (sizeof(buff) - 1U))) {
+			fifo_get(ymodem_link->rx, &buff[CptBuf++]);
+		}
+		buff[CptBuf] = 0U;
+
+		/* Ligne silencieuse : paquet partiel abandonné, session annulée après MAX_RETRANS silences */
+		if (CptBuf != 0U) {
+			lastRxTick = HAL_GetTick();
+			timeouts = 0U;
+		} else if ((HAL_GetTick() - lastRxTick) >= YMODEM_BYTE_TIMEOUT_MS) {
+			lastRxTick = HAL_GetTick();
+			timeouts++;
+			if (timeouts >= MAX_RETRANS) {
 				YMODEM_Abort(payload, &payloadLen);
-	//			HAL_UART_Transmit(&SERIAL_UART, payload, payloadLen);
-				CDC_SendMem((char *)&payload[0], payloadLen);
 			} else {
-				for (uint8_t i = 0; i < CptBuf; i++) {
-					YMODEM_T ret = YMODEM_ReceiveByte(buff[i], payload, &payloadLen);
-					switch (ret) {
-						case YMODEM_OK:
-							break; 
-						case YMODEM_TX_PENDING:
-	//						HAL_UART_Transmit(&SERIAL_UART, payload, payloadLen);
-							CDC_SendMem((char *)&payload[0], payloadLen);
-							break;
-						case YMODEM_ABORTED:
-							fwDownloading = 0;
-							sprintf(Chaine, "Aborted\r\n");
-	//						HAL_UART_Transmit(&SERIAL_UART, pcOutputString, strlen(pcOutputString));
-							CDC_SendMem(&Chaine[0], strlen(Chaine));
-						break;
-						case YMODEM_WRITE_ERR:
-							fwDownloading = 0;
-							sprintf(Chaine, "Write Error\r\n");
-	//						HAL_UART_Transmit(&SERIAL_UART, pcOutputString, strlen(pcOutputString));
-							CDC_SendMem(&Chaine[0], strlen(Chaine));
-							break;
-						case YMODEM_SIZE_ERR:
-							fwDownloading = 0;
-							sprintf(Chaine, "File too big\r\n");
-	//						HAL_UART_Transmit(&SERIAL_UART, pcOutputString, strlen(pcOutputString));
-							CDC_SendMem(&Chaine[0], strlen(Chaine));
-							break;
-						case YMODEM_COMPLETE:
-							fwDownloading = 0;
-							sprintf(Chaine, "Download Complete\r\n");
-	//						HAL_UART_Transmit(&SERIAL_UART, pcOutputString, strlen(pcOutputString));
-							CDC_SendMem(&Chaine[0], strlen(Chaine));
-							break;
-					}
-					// If transfer stopped, dont process more data
-					if (ret > YMODEM_TX_PENDING) break;
+				(void)YMODEM_Timeout(payload, &payloadLen);
+			}
+			transport_send(ymodem_link, &payload[0], payloadLen);
+			if (YMODEM_Status() != YMODEM_OK) {
+				fwDownloading = 0;
+			}
+			continue;
+		}
+
+		/* Un "a" en début de paquet annule la session (YMODEM_ReceiveByte()) */
+		for (uint8_t i = 0; i < CptBuf; i++) {
+			YMODEM_T ret = YMODEM_ReceiveByte(buff[i], payload, &payloadLen);
+			if (ret == YMODEM_TX_PENDING) {
+				if ((payloadLen == 1U) && (payload[0] == NAK)) {
+					/* Rest of a bad packet: one NAK once the line is quiet, not one per stray byte */
+					YMODEM_Purge();
+					CptBuf = i + 1U;
 				}
+//				HAL_UART_Transmit(&SERIAL_UART, payload, payloadLen);
+				transport_send(ymodem_link, &payload[0], payloadLen);
+				/* The response may close the session (last ACK, abort): do not wait for another byte */
+				ret = YMODEM_Status();
+			}
+			switch (ret) {
+				case YMODEM_OK:
+				case YMODEM_TX_PENDING:
+					break;
+				case YMODEM_ABORTED:
+					fwDownloading = 0;
+					sprintf(Chaine, "Aborted\r\n");
+//						HAL_UART_Transmit(&SERIAL_UART, pcOutputString, strlen(pcOutputString));
+					transport_send_string(ymodem_link, Chaine);
+				break;
+				case YMODEM_WRITE_ERR:
+					fwDownloading = 0;
+					sprintf(Chaine, "Write Error\r\n");
+//						HAL_UART_Transmit(&SERIAL_UART, pcOutputString, strlen(pcOutputString));
+					transport_send_string(ymodem_link, Chaine);
+					break;
+				case YMODEM_SIZE_ERR:
+					fwDownloading = 0;
+					sprintf(Chaine, "File too big\r\n");
+//						HAL_UART_Transmit(&SERIAL_UART, pcOutputString, strlen(pcOutputString));
+					transport_send_string(ymodem_link, Chaine);
+					break;
+				case YMODEM_COMPLETE:
+					fwDownloading = 0;
+					result = 0;
+					sprintf(Chaine, "Download Complete\r\n");
+//						HAL_UART_Transmit(&SERIAL_UART, pcOutputString, strlen(pcOutputString));
+					transport_send_string(ymodem_link, Chaine);
+					break;
 			}
+			// If transfer stopped, dont process more data
+			if (ret > YMODEM_TX_PENDING) break;
 		}
 	}	
 	
-	return(0);
+	return(result);
 }
 
 /**
- * @brief Récupère un octet en bloquant depuis le FIFO de réception.
+ * @brief Vide la réception jusqu'à un silence de YMODEM_PURGE_QUIET_MS.
  *
- * Cette fonction bloque tant qu'aucun octet n'est disponible dans le FIFO.
- *
- * @return uint8_t Octet reçu.
+ * Les octets restants d'un paquet rejeté (ou d'une retransmission de l'émetteur)
+ * sont consommés côté lecteur, sans fifo_reset() concurrent du DMA, afin que le NAK
+ * suivant arrive quand l'émetteur attend une réponse. Bornée par YMODEM_PURGE_MAX_MS.
  */
-static uint8_t YMODEM_GetByte(void)
+static void YMODEM_Purge(void)
 {
-    uint8_t byte = 0U;
-    /* Blocage tant qu'aucun caractère n'est disponible dans le FIFO */
-    fifo_get(&cdc_fifo, &byte);
-    
-    return byte;
+	uint32_t start = HAL_GetTick();
+	uint32_t quiet = start;
+
+	while (((HAL_GetTick() - quiet) < YMODEM_PURGE_QUIET_MS) && ((HAL_GetTick() - start) < YMODEM_PURGE_MAX_MS)) {
+		(void)flash_pipe_poll();
+		if (!fifo_is_empty(ymodem_link->rx)) {
+			fifo_commit(ymodem_link->rx, fifo_len(ymodem_link->rx));
+			quiet = HAL_GetTick();
+		}
+	}
 }
 
-
 /**
- * @brief Envoie un octet via CDC.
+ * @brief Envoie un octet sur la liaison de la session.
  *
  * @param[in] byte Octet à envoyer.
  */
 static void YMODEM_SendByte(uint8_t byte)
 {
-    char c = (char)byte;
-    /* On suppose que CDC_PutChar() envoie un caractère */
-    (void)CDC_PutChar(c);
+    transport_send_char(ymodem_link, byte);
 }
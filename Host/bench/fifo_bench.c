@@ -0,0 +1,410 @@
+#include "port.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @file fifo_bench.c
+ * @brief Banc de mesure du FIFO (Fifo.c) face à l'implémentation précédente.
+ *
+ * L'implémentation précédente (indices bornés par % FIFO_BUFFER_SIZE, une case
+ * toujours libre, consommation octet par octet) est reproduite ici sous le préfixe
+ * legacy_. Les mesures portent sur le même fifo_t :
+ *   - byte : fifo_put() puis fifo_get() par blocs de « chunk » octets ;
+ *   - in-get : fifo_in() par blocs, lecture octet par octet (récepteurs actuels) ;
+ *   - in-out : fifo_in() puis fifo_out() par blocs (legacy : fifo_get()) ;
+ *   - in-peek : fifo_in() puis lecture en place fifo_peek() / fifo_commit() ;
+ *   - spsc : producteur et consommateur dans deux fils, contenu contrôlé.
+ * Sur la cible, l'ancienne fifo_wait_for() masquait en plus les interruptions à
+ * chaque tour d'attente ; ce coût n'existe pas sur l'hôte et n'est pas mesuré.
+ *
+ * Utilisation :
+ *     fifo_bench [-n mégaoctets] [-c tailles_de_bloc]
+ *
+ * Par défaut : 64 Mo par mesure, blocs de 16, 128 et 1024 octets.
+ *
+ * Sortie CSV sur stdout :
+ *     test,impl,chunk,bytes,time_s,mbytes_per_s,errors
+ */
+
+#define BENCH_MAX_LIST      (8U)
+
+/* ------------------------------------------------------------------------- */
+/*                      Implémentation précédente                            */
+/* ------------------------------------------------------------------------- */
+
+static int legacy_put(fifo_t *fifo, uint8_t val)
+{
+    uint32_t next_head = (fifo->head + 1U) % FIFO_BUFFER_SIZE;
+
+    if (next_head == fifo->tail)
+    {
+        return FIFO_ERROR;
+    }
+    fifo->buffer[fifo->head] = val;
+    fifo->head = next_head;
+    return FIFO_OK;
+}
+
+static int legacy_get(fifo_t *fifo, uint8_t *val)
+{
+    if (fifo->head == fifo->tail)
+    {
+        return FIFO_ERROR;
+    }
+    *val = fifo->buffer[fifo->tail];
+    fifo->tail = (fifo->tail + 1U) % FIFO_BUFFER_SIZE;
+    return FIFO_OK;
+}
+
+static unsigned int legacy_in(fifo_t *fifo, const uint8_t *buf, unsigned long n)
+{
+    uint32_t head = fifo->head;
+    uint32_t tail = fifo->tail;
+    uint32_t space = (tail + FIFO_BUFFER_SIZE - head - 1U) % FIFO_BUFFER_SIZE;
+    uint32_t first;
+
+    if (n > space)
+    {
+        n = space;
+    }
+    first = FIFO_BUFFER_SIZE - head;
+    if (first > n)
+    {
+        first = (uint32_t)n;
+    }
+    (void)memcpy(&fifo->buffer[head], buf, first);
+    (void)memcpy(&fifo->buffer[0], &buf[first], (uint32_t)n - first);
+    fifo->head = (head + (uint32_t)n) % FIFO_BUFFER_SIZE;
+    return (unsigned int)n;
+}
+
+static unsigned int legacy_len(fifo_t *fifo)
+{
+    return (fifo->head + FIFO_BUFFER_SIZE - fifo->tail) % FIFO_BUFFER_SIZE;
+}
+
+static unsigned int legacy_peek(fifo_t *fifo, unsigned int n, fifo_span_t *span)
+{
+    uint32_t available = legacy_len(fifo);
+    uint32_t start = fifo->tail;
+    uint32_t first;
+
+    if (n > available)
+    {
+        n = available;
+    }
+    first = FIFO_BUFFER_SIZE - start;
+    if (first > n)
+    {
+        first = n;
+    }
+    span->data[0] = &fifo->buffer[start];
+    span->length[0] = first;
+    span->data[1] = &fifo->buffer[0];
+    span->length[1] = n - first;
+    return n;
+}
+
+static void legacy_commit(fifo_t *fifo, unsigned int n)
+{
+    uint32_t available = legacy_len(fifo);
+
+    if (n > available)
+    {
+        n = available;
+    }
+    fifo->tail = (fifo->tail + n) % FIFO_BUFFER_SIZE;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                              Mesures                                      */
+/* ------------------------------------------------------------------------- */
+
+static fifo_t bench_fifo;
+static uint8_t source[FIFO_BUFFER_SIZE];
+static uint8_t sink[FIFO_BUFFER_SIZE];
+static volatile uint32_t checksum;
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static void report(const char *test, const char *impl, uint32_t chunk, uint64_t bytes, double seconds, uint32_t errors)
+{
+    printf("%s,%s,%u,%llu,%.3f,%.1f,%u\n", test, impl, (unsigned int)chunk, (unsigned long long)bytes,
+           seconds, (double)bytes / seconds / 1e6, (unsigned int)errors);
+    (void)fflush(stdout);
+}
+
+static void bench_byte(bool legacy, uint32_t chunk, uint64_t total)
+{
+    uint64_t done;
+    uint32_t sum = 0U;
+    uint32_t i;
+    uint8_t value;
+    double start;
+
+    fifo_init(&bench_fifo);
+    start = now_s();
+    for (done = 0U; done < total; done += chunk)
+    {
+        for (i = 0U; i < chunk; i++)
+        {
+            (void)(legacy ? legacy_put(&bench_fifo, source[i]) : fifo_put(&bench_fifo, source[i]));
+        }
+        for (i = 0U; i < chunk; i++)
+        {
+            (void)(legacy ? legacy_get(&bench_fifo, &value) : fifo_get(&bench_fifo, &value));
+            sum += value;
+        }
+    }
+    checksum = sum;
+    report("byte", legacy ? "legacy" : "spsc", chunk, total, now_s() - start, 0U);
+}
+
+static void bench_in_get(bool legacy, uint32_t chunk, uint64_t total)
+{
+    uint64_t done;
+    uint32_t sum = 0U;
+    uint32_t i;
+    uint8_t value;
+    double start;
+
+    fifo_init(&bench_fifo);
+    start = now_s();
+    for (done = 0U; done < total; done += chunk)
+    {
+        (void)(legacy ? legacy_in(&bench_fifo, source, chunk) : fifo_in(&bench_fifo, source, chunk));
+        for (i = 0U; i < chunk; i++)
+        {
+            (void)(legacy ? legacy_get(&bench_fifo, &value) : fifo_get(&bench_fifo, &value));
+            sum += value;
+        }
+    }
+    checksum = sum;
+    report("in-get", legacy ? "legacy" : "spsc", chunk, total, now_s() - start, 0U);
+}
+
+static void bench_in_out(bool legacy, uint32_t chunk, uint64_t total)
+{
+    uint64_t done;
+    uint32_t i;
+    double start;
+
+    fifo_init(&bench_fifo);
+    start = now_s();
+    for (done = 0U; done < total; done += chunk)
+    {
+        if (legacy)
+        {
+            (void)legacy_in(&bench_fifo, source, chunk);
+            for (i = 0U; i < chunk; i++)
+            {
+                (void)legacy_get(&bench_fifo, &sink[i]);
+            }
+        }
+        else
+        {
+            (void)fifo_in(&bench_fifo, source, chunk);
+            (void)fifo_out(&bench_fifo, sink, chunk);
+        }
+    }
+    checksum = sink[chunk - 1U];
+    report("in-out", legacy ? "legacy" : "spsc", chunk, total, now_s() - start, 0U);
+}
+
+static void bench_in_peek(bool legacy, uint32_t chunk, uint64_t total)
+{
+    fifo_span_t span;
+    uint64_t done;
+    uint32_t sum = 0U;
+    double start;
+
+    fifo_init(&bench_fifo);
+    start = now_s();
+    for (done = 0U; done < total; done += chunk)
+    {
+        if (legacy)
+        {
+            (void)legacy_in(&bench_fifo, source, chunk);
+            (void)legacy_peek(&bench_fifo, chunk, &span);
+        }
+        else
+        {
+            (void)fifo_in(&bench_fifo, source, chunk);
+            (void)fifo_peek(&bench_fifo, 0U, chunk, &span);
+        }
+        /* Consommation en place : la lecture d'un octet suffit à utiliser le descripteur */
+        sum += span.data[0][0] + span.length[1];
+        if (legacy)
+        {
+            legacy_commit(&bench_fifo, chunk);
+        }
+        else
+        {
+            fifo_commit(&bench_fifo, chunk);
+        }
+    }
+    checksum = sum;
+    report("in-peek", legacy ? "legacy" : "spsc", chunk, total, now_s() - start, 0U);
+}
+
+/**
+ * @brief Paramètres du producteur de la mesure spsc.
+ */
+typedef struct
+{
+    bool legacy;
+    uint32_t chunk;
+    uint64_t total;
+} spsc_job_t;
+
+static void *spsc_producer(void *arg)
+{
+    const spsc_job_t *job = (const spsc_job_t *)arg;
+    uint8_t block[FIFO_BUFFER_SIZE];
+    uint64_t sent = 0U;
+    uint32_t length;
+    uint32_t accepted;
+    uint32_t i;
+
+    while (sent < job->total)
+    {
+        length = ((job->total - sent) < job->chunk) ? (uint32_t)(job->total - sent) : job->chunk;
+        for (i = 0U; i < length; i++)
+        {
+            block[i] = (uint8_t)((sent + i) * 7U);
+        }
+        for (i = 0U; i < length; i += accepted)
+        {
+            accepted = job->legacy ? legacy_in(&bench_fifo, &block[i], length - i)
+                                   : fifo_in(&bench_fifo, &block[i], length - i);
+            if (accepted == 0U)
+            {
+                /* FIFO plein : laisse la main au consommateur (hôte à un seul cœur) */
+                (void)sched_yield();
+            }
+        }
+        sent += length;
+    }
+    return NULL;
+}
+
+static void bench_spsc(bool legacy, uint32_t chunk, uint64_t total)
+{
+    spsc_job_t job = { legacy, chunk, total };
+    pthread_t producer;
+    uint64_t received = 0U;
+    uint32_t errors = 0U;
+    uint32_t length;
+    uint32_t i;
+    double start;
+
+    fifo_init(&bench_fifo);
+    start = now_s();
+    if (pthread_create(&producer, NULL, spsc_producer, &job) != 0)
+    {
+        return;
+    }
+    while (received < total)
+    {
+        if (legacy)
+        {
+            length = (legacy_get(&bench_fifo, &sink[0]) == FIFO_OK) ? 1U : 0U;
+        }
+        else
+        {
+            length = fifo_out(&bench_fifo, sink, chunk);
+        }
+        if (length == 0U)
+        {
+            (void)sched_yield();
+        }
+        for (i = 0U; i < length; i++)
+        {
+            if (sink[i] != (uint8_t)((received + i) * 7U))
+            {
+                errors++;
+            }
+        }
+        received += length;
+    }
+    (void)pthread_join(producer, NULL);
+    report("spsc", legacy ? "legacy" : "spsc", chunk, total, now_s() - start, errors);
+}
+
+static uint32_t parse_list(const char *text, uint32_t *values)
+{
+    uint32_t count = 0U;
+    char *end;
+
+    while ((*text != '\0') && (count < BENCH_MAX_LIST))
+    {
+        values[count] = (uint32_t)strtoul(text, &end, 10);
+        if ((end == text) || (values[count] == 0U) || (values[count] > FIFO_BUFFER_SIZE))
+        {
+            return 0U;
+        }
+        count++;
+        text = (*end == ',') ? (end + 1) : end;
+    }
+    return count;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t chunks[BENCH_MAX_LIST] = { 16U, 128U, 1024U };
+    uint32_t chunk_count = 3U;
+    uint64_t total = 64U * 1024U * 1024U;
+    uint32_t i;
+    int legacy;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:c:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': total = (uint64_t)strtoul(optarg, NULL, 10) * 1024U * 1024U; break;
+            case 'c': chunk_count = parse_list(optarg, chunks); break;
+            default: chunk_count = 0U; break;
+        }
+    }
+    if ((chunk_count == 0U) || (total == 0U))
+    {
+        fprintf(stderr, "usage: %s [-n megabytes] [-c chunk,...]\n", argv[0]);
+        return 2;
+    }
+    for (i = 0U; i < FIFO_BUFFER_SIZE; i++)
+    {
+        source[i] = (uint8_t)(i * 13U);
+    }
+
+    printf("test,impl,chunk,bytes,time_s,mbytes_per_s,errors\n");
+    for (i = 0U; i < chunk_count; i++)
+    {
+        /* L'ancienne FIFO garde une case libre : un bloc de FIFO_BUFFER_SIZE n'y tient pas */
+        for (legacy = 1; legacy >= 0; legacy--)
+        {
+            if ((legacy != 0) && (chunks[i] >= FIFO_BUFFER_SIZE))
+            {
+                continue;
+            }
+            bench_byte(legacy != 0, chunks[i], total);
+            bench_in_get(legacy != 0, chunks[i], total);
+            bench_in_out(legacy != 0, chunks[i], total);
+            bench_in_peek(legacy != 0, chunks[i], total);
+            bench_spsc(legacy != 0, chunks[i], total / 4U);
+        }
+    }
+    return 0;
+}
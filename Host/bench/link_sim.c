@@ -0,0 +1,675 @@
+#include "port.h"
+#include "link_sim.h"
+
+#include <string.h>
+
+/**
+ * @file link_sim.c
+ * @brief Horloge simulée et liaison série du banc de mesure (remplace clock_host.c et uart_pty.c).
+ *
+ * Les octets en transit sont rangés, dans chaque sens, dans une file ordonnée par
+ * date d'arrivée. L'horloge avance :
+ *   - de la durée modélisée à chaque attente du bootloader (host_wait_us() :
+ *     opérations flash, HAL_Delay(), émission par scrutation) ;
+ *   - jusqu'au prochain évènement, ou à la milliseconde suivante, à chaque lecture
+ *     de HAL_GetTick() : le bootloader ne lit le tick que dans ses boucles d'attente.
+ * Les évènements échus sont traités dans l'ordre : arrivée d'un octet chez le
+ * bootloader ou chez l'émetteur, fin d'un transfert DMA d'émission du bootloader,
+ * échéance de l'émetteur.
+ *
+ * Réception du bootloader : le DMA circulaire dépose chaque octet dans
+ * uart2_rx_dma_buffer ; les évènements de demi-tampon, de tampon complet et de
+ * ligne inactive (un octet de silence) appellent UART2_RxEvent() (rou.c), comme
+ * HAL_UARTEx_RxEventCallback() sur la cible. Pendant une opération flash, le CPU
+ * est bloqué : les évènements sont différés jusqu'à la fin du blocage et un octet
+ * qui trouve le tampon plein de données non publiées est perdu (overruns).
+ * Erreurs UART (-u) : l'octet en erreur est perdu et UART2_RxError() est appelée
+ * comme HAL_UART_ErrorCallback() ; les octets encore dans le tampon à la relance
+ * du DMA sont comptés dans lost (aucun ne doit l'être).
+ *
+ * Émission du bootloader : HAL_UART_Transmit_DMA() (file d'émission de rou.c) place
+ * les octets sur la ligne et rend la main aussitôt ; la fin du transfert est
+ * signalée à la fin d'émission du dernier octet, ou à la fin d'un blocage du CPU.
+ *
+ * Liaison USB CDC (transport_cdc) : le débit est celui des transferts bulk en full
+ * speed (LINK_CDC_BYTES_PER_S) et les paquets sont protégés par CRC et répétés par
+ * le contrôleur, d'où ni erreur ni perte. Les octets arrivés sont regroupés en
+ * paquets de LINK_CDC_PACKET_SIZE octets (un paquet court termine une écriture du
+ * PC) et déposés dans la FIFO comme par CDC_Receive_FS() : après un paquet qui ne
+ * laisse pas la place du suivant, l'endpoint reste en NAK et n'est réarmé qu'à la
+ * milliseconde suivante où la place est revenue (CDC_RxResume() au SOF). Les
+ * octets en attente sont retenus, jamais perdus. CDC_Send() dépose les octets
+ * dans la file d'émission de Rou_cdc.c et n'attend que si elle est pleine.
+ */
+
+#define LINK_QUEUE_SIZE     (32768U)     /**< Octets en transit par sens (puissance de 2) */
+#define LINK_CDC_PACKET_SIZE (64U)       /**< Taille maximale d'un paquet bulk en full speed */
+
+/**
+ * @brief Octet en transit.
+ */
+typedef struct
+{
+    uint64_t arrival_us;
+    uint8_t byte;
+} link_byte_t;
+
+/**
+ * @brief Un sens de la liaison.
+ */
+typedef struct
+{
+    link_byte_t queue[LINK_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    uint64_t line_free_us;      /**< Fin d'émission du dernier octet placé sur la ligne */
+    double line_frac_us;        /**< Fraction de microseconde reportée (octets USB de moins de 1 µs) */
+    link_dir_stats_t *stats;
+} link_dir_t;
+
+link_stats_t link_stats;
+
+static link_config_t link_config;
+static const link_host_t *link_host = NULL;
+static fifo_t *link_fifo = NULL;
+static bool link_cdc = false;               /**< Liaison USB CDC (transport_cdc) */
+static link_dir_t to_target;
+static link_dir_t to_host;
+static uint64_t now_us = 0U;
+static uint64_t timer_us = UINT64_MAX;
+static uint64_t tx_done_us = UINT64_MAX;     /**< Fin du transfert DMA d'émission en cours */
+static bool tx_done_pending = false;         /**< Fin de transfert survenue pendant un blocage du CPU */
+static double byte_us = 260.4;
+static uint64_t rng_state = 1U;
+
+/**
+ * @brief Interruptions de la réception DMA de l'USART2.
+ */
+typedef enum
+{
+    DMA_EVENT_HALF,             /**< Demi-tampon */
+    DMA_EVENT_FULL,             /**< Tampon complet, retour au début */
+    DMA_EVENT_IDLE,             /**< Ligne inactive */
+    DMA_EVENT_ERROR,            /**< Erreur UART */
+    DMA_EVENT_COUNT
+} link_dma_event_t;
+
+/* Réception DMA circulaire de l'USART2 (uart2_rx_dma_buffer) */
+static uint16_t dma_write = 0U;             /**< Position d'écriture du DMA */
+static uint32_t dma_stored = 0U;            /**< Octets déposés depuis la relance du DMA */
+static uint32_t dma_published_base = 0U;    /**< Octets publiés (v_uart2_rx_stats) à la relance */
+static bool dma_pending[DMA_EVENT_COUNT];   /**< Interruptions différées par un blocage du CPU */
+static uint64_t idle_us = UINT64_MAX;       /**< Détection de ligne inactive */
+
+/* Octets USB CDC arrivés et pas encore déposés dans la FIFO, dans l'ordre d'arrivée */
+static uint8_t cdc_held[LINK_QUEUE_SIZE];
+static uint32_t cdc_held_length = 0U;
+static bool cdc_paused = false;             /**< Endpoint OUT en NAK */
+static uint64_t cdc_paused_us = 0U;         /**< Début de la suspension */
+
+/**
+ * @brief Générateur pseudo-aléatoire (xorshift64*), reproductible d'une exécution à l'autre.
+ *
+ * @return double Valeur uniforme dans [0, 1).
+ */
+static double link_random(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (double)((rng_state * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief Place un octet sur la ligne : durée, gigue, latence, erreurs et pertes.
+ */
+static void link_emit(link_dir_t *dir, uint8_t byte, double jitter_us)
+{
+    uint64_t start = (dir->line_free_us > now_us) ? dir->line_free_us : now_us;
+    uint8_t received = byte;
+    uint32_t bit;
+
+    if (jitter_us > 0.0)
+    {
+        start += (uint64_t)(link_random() * jitter_us);
+    }
+    if (link_cdc)
+    {
+        dir->line_frac_us += byte_us;
+        dir->line_free_us = start + (uint64_t)dir->line_frac_us;
+        dir->line_frac_us -= (double)(uint64_t)dir->line_frac_us;
+    }
+    else
+    {
+        dir->line_free_us = start + (uint64_t)byte_us;
+    }
+    dir->stats->bytes++;
+
+    if (link_cdc)
+    {
+        /* Paquets USB vérifiés par CRC et répétés : ni erreur ni perte */
+    }
+    else if ((link_config.drop_rate > 0.0) && (link_random() < link_config.drop_rate))
+    {
+        dir->stats->dropped++;
+        return;
+    }
+    else if (link_config.bit_error_rate > 0.0)
+    {
+        for (bit = 0U; bit < 8U; bit++)
+        {
+            if (link_random() < link_config.bit_error_rate)
+            {
+                received ^= (uint8_t)(1U << bit);
+            }
+        }
+        if (received != byte)
+        {
+            dir->stats->corrupted++;
+        }
+    }
+    if ((dir->tail - dir->head) >= LINK_QUEUE_SIZE)
+    {
+        /* L'émetteur ne doit pas dépasser LINK_QUEUE_SIZE octets en transit */
+        dir->stats->dropped++;
+        return;
+    }
+    dir->queue[dir->tail % LINK_QUEUE_SIZE].arrival_us = dir->line_free_us + (uint64_t)link_config.latency_us;
+    dir->queue[dir->tail % LINK_QUEUE_SIZE].byte = received;
+    dir->tail++;
+}
+
+/**
+ * @brief Date du prochain évènement (UINT64_MAX s'il n'y en a pas).
+ */
+static uint64_t link_next_event(void)
+{
+    uint64_t next = (tx_done_us < timer_us) ? tx_done_us : timer_us;
+
+    if (idle_us < next)
+    {
+        next = idle_us;
+    }
+    if ((to_target.head != to_target.tail) && (to_target.queue[to_target.head % LINK_QUEUE_SIZE].arrival_us < next))
+    {
+        next = to_target.queue[to_target.head % LINK_QUEUE_SIZE].arrival_us;
+    }
+    if ((to_host.head != to_host.tail) && (to_host.queue[to_host.head % LINK_QUEUE_SIZE].arrival_us < next))
+    {
+        next = to_host.queue[to_host.head % LINK_QUEUE_SIZE].arrival_us;
+    }
+    return next;
+}
+
+/**
+ * @brief Dépose dans la FIFO les paquets USB CDC arrivés, si l'endpoint est armé
+ *        et le CPU n'est pas bloqué (CDC_Receive_FS() et CDC_RxResume()).
+ */
+static void link_cdc_release(void)
+{
+    uint32_t length;
+
+    if (cdc_paused)
+    {
+        /* Réarmement au premier SOF où la FIFO peut recevoir un paquet */
+        if (((now_us / 1000U) == (cdc_paused_us / 1000U)) || (fifo_free(link_fifo) < LINK_CDC_PACKET_SIZE))
+        {
+            return;
+        }
+        v_cdc_rx_stats.nak_frames += (uint32_t)((now_us / 1000U) - (cdc_paused_us / 1000U));
+        cdc_paused = false;
+    }
+    while ((cdc_held_length != 0U) && !cdc_paused && !host_stalled())
+    {
+        length = (cdc_held_length < LINK_CDC_PACKET_SIZE) ? cdc_held_length : LINK_CDC_PACKET_SIZE;
+        if ((length < LINK_CDC_PACKET_SIZE) && (to_target.head != to_target.tail)
+            && (to_target.queue[to_target.head % LINK_QUEUE_SIZE].arrival_us <= (now_us + 1U)))
+        {
+            /* Paquet court : la suite de l'écriture du PC arrive */
+            break;
+        }
+        if (fifo_free(link_fifo) < (length + LINK_CDC_PACKET_SIZE))
+        {
+            cdc_paused = true;
+            cdc_paused_us = now_us;
+            v_cdc_rx_stats.naks++;
+        }
+        if (v_cdc_rx_stats.packets == 0U)
+        {
+            v_cdc_rx_stats.first_ms = (uint32_t)(now_us / 1000U);
+        }
+        v_cdc_rx_stats.packets++;
+        v_cdc_rx_stats.last_ms = (uint32_t)(now_us / 1000U);
+        v_cdc_rx_stats.bytes += fifo_in(link_fifo, cdc_held, length);
+        cdc_held_length -= length;
+        (void)memmove(cdc_held, &cdc_held[length], cdc_held_length);
+    }
+}
+
+/**
+ * @brief Octets déposés par le DMA et pas encore publiés par UART2_RxEvent().
+ */
+static uint32_t link_dma_unpublished(void)
+{
+    return dma_stored - ((v_uart2_rx_stats.bytes + v_uart2_rx_stats.dropped) - dma_published_base);
+}
+
+/**
+ * @brief Sert une interruption de la réception DMA (HAL_UARTEx_RxEventCallback(),
+ *        HAL_UART_ErrorCallback()).
+ */
+static void link_dma_service(link_dma_event_t event)
+{
+    uint32_t dropped = v_uart2_rx_stats.dropped;
+
+    switch (event)
+    {
+    case DMA_EVENT_HALF:
+        UART2_RxEvent(UART2_RX_DMA_BUFFER_SIZE / 2U);
+        break;
+    case DMA_EVENT_FULL:
+        UART2_RxEvent(UART2_RX_DMA_BUFFER_SIZE);
+        break;
+    case DMA_EVENT_IDLE:
+        /* RxXferSize - NDTR */
+        UART2_RxEvent(dma_write);
+        break;
+    default:
+        UART2_RxError();
+        break;
+    }
+    /* FIFO pleine */
+    link_stats.overruns += v_uart2_rx_stats.dropped - dropped;
+}
+
+/**
+ * @brief Déclenche une interruption de la réception DMA, ou la diffère si le CPU est bloqué.
+ */
+static void link_dma_raise(link_dma_event_t event)
+{
+    if (host_stalled())
+    {
+        dma_pending[event] = true;
+    }
+    else
+    {
+        link_dma_service(event);
+    }
+}
+
+/**
+ * @brief Arrivée d'un octet au bootloader (DMA de l'USART2, ou endpoint OUT de
+ *        l'USB CDC).
+ */
+static void link_target_receive(uint8_t byte)
+{
+    if (link_cdc)
+    {
+        /* Octets retenus comptés en transit (link_host_pending()) : l'émetteur attend */
+        if (cdc_held_length < sizeof(cdc_held))
+        {
+            cdc_held[cdc_held_length++] = byte;
+        }
+        else
+        {
+            link_stats.overruns++;
+        }
+        link_cdc_release();
+        return;
+    }
+    if ((link_config.uart_error_rate > 0.0) && (link_random() < link_config.uart_error_rate))
+    {
+        /* Erreur de trame, bruit ou overrun : l'octet est perdu */
+        link_stats.uart_errors++;
+        link_dma_raise(DMA_EVENT_ERROR);
+        return;
+    }
+    if (link_dma_unpublished() >= UART2_RX_DMA_BUFFER_SIZE)
+    {
+        /* Le DMA rattrape les octets non publiés */
+        link_stats.overruns++;
+        return;
+    }
+    uart2_rx_dma_buffer[dma_write++] = byte;
+    dma_stored++;
+    idle_us = now_us + (uint64_t)byte_us;
+    if (dma_write == (UART2_RX_DMA_BUFFER_SIZE / 2U))
+    {
+        link_dma_raise(DMA_EVENT_HALF);
+    }
+    else if (dma_write == UART2_RX_DMA_BUFFER_SIZE)
+    {
+        dma_write = 0U;
+        link_dma_raise(DMA_EVENT_FULL);
+    }
+    else
+    {
+        /* Ni demi-tampon ni tampon complet */
+    }
+}
+
+/**
+ * @brief Traite les évènements jusqu'à une date donnée, puis y place l'horloge.
+ */
+static void link_run_until(uint64_t until_us)
+{
+    uint64_t next;
+    link_byte_t *event;
+
+    link_cdc_release();
+    next = link_next_event();
+    while (next <= until_us)
+    {
+        now_us = next;
+        if ((to_target.head != to_target.tail)
+            && (to_target.queue[to_target.head % LINK_QUEUE_SIZE].arrival_us == next))
+        {
+            event = &to_target.queue[to_target.head % LINK_QUEUE_SIZE];
+            to_target.head++;
+            link_target_receive(event->byte);
+        }
+        else if ((to_host.head != to_host.tail) && (to_host.queue[to_host.head % LINK_QUEUE_SIZE].arrival_us == next))
+        {
+            event = &to_host.queue[to_host.head % LINK_QUEUE_SIZE];
+            to_host.head++;
+            link_host->on_byte(event->byte);
+        }
+        else if (idle_us == next)
+        {
+            idle_us = UINT64_MAX;
+            link_dma_raise(DMA_EVENT_IDLE);
+        }
+        else if (tx_done_us == next)
+        {
+            tx_done_us = UINT64_MAX;
+            if (host_stalled())
+            {
+                tx_done_pending = true;
+            }
+            else
+            {
+                UART2_TxComplete();
+            }
+        }
+        else
+        {
+            timer_us = UINT64_MAX;
+            link_host->on_timer();
+        }
+        next = link_next_event();
+    }
+    if (until_us > now_us)
+    {
+        now_us = until_us;
+    }
+}
+
+/**
+ * @brief Prépare une mesure : horloge à zéro, liaison vide.
+ *
+ * @param[in] config Paramètres de la liaison (débit ignoré en USB CDC).
+ * @param[in] link   Liaison du bootloader (transport_uart2 ou transport_cdc).
+ * @param[in] seed   Graine des erreurs et de la gigue.
+ * @param[in] host   Émetteur côté PC.
+ */
+void link_open(const link_config_t *config, const transport_t *link, uint32_t seed, const link_host_t *host)
+{
+    link_config = *config;
+    link_fifo = link->rx;
+    link_cdc = (link == &transport_cdc);
+    link_host = host;
+    byte_us = link_cdc ? (1.0e6 / LINK_CDC_BYTES_PER_S) : (10.0e6 / (double)config->baud);
+    rng_state = 0x9E3779B97F4A7C15ULL ^ (uint64_t)seed;
+    (void)memset(&link_stats, 0, sizeof(link_stats));
+    (void)memset(&to_target, 0, sizeof(to_target));
+    (void)memset(&to_host, 0, sizeof(to_host));
+    to_target.stats = &link_stats.to_target;
+    to_host.stats = &link_stats.to_host;
+    dma_write = 0U;
+    dma_stored = 0U;
+    dma_published_base = 0U;
+    (void)memset(dma_pending, 0, sizeof(dma_pending));
+    idle_us = UINT64_MAX;
+    cdc_held_length = 0U;
+    cdc_paused = false;
+    timer_us = UINT64_MAX;
+    tx_done_us = UINT64_MAX;
+    tx_done_pending = false;
+    now_us = 0U;
+}
+
+/**
+ * @brief Émission par le PC : les octets sont placés à la suite sur la ligne.
+ */
+void link_host_send(const uint8_t *data, uint32_t length)
+{
+    uint32_t i;
+
+    for (i = 0U; i < length; i++)
+    {
+        link_emit(&to_target, data[i], link_config.jitter_us);
+    }
+}
+
+/**
+ * @brief Octets émis par le PC et pas encore arrivés au bootloader (ou retenus
+ *        par l'USB CDC).
+ */
+uint32_t link_host_pending(void)
+{
+    return (to_target.tail - to_target.head) + cdc_held_length;
+}
+
+/**
+ * @brief Date de fin d'émission du dernier octet placé sur la ligne par le PC.
+ */
+uint64_t link_host_idle_us(void)
+{
+    return (to_target.line_free_us > now_us) ? to_target.line_free_us : now_us;
+}
+
+/**
+ * @brief Programme l'échéance de l'émetteur (UINT64_MAX : aucune).
+ */
+void link_set_timer(uint64_t at_us)
+{
+    timer_us = at_us;
+}
+
+uint64_t link_now_us(void)
+{
+    return now_us;
+}
+
+/**
+ * @brief Durée d'un octet sur la ligne, en microsecondes.
+ */
+double link_byte_us(void)
+{
+    return byte_us;
+}
+
+/**
+ * @brief Fin d'un blocage du CPU : interruptions différées de la réception DMA,
+ *        octets retenus par l'USB CDC et interruption de fin d'émission.
+ */
+void host_uart_service(void)
+{
+    link_dma_event_t event;
+
+    link_cdc_release();
+    /* Erreur servie en premier : l'arrêt du DMA efface les autres évènements */
+    if (dma_pending[DMA_EVENT_ERROR])
+    {
+        dma_pending[DMA_EVENT_ERROR] = false;
+        link_dma_service(DMA_EVENT_ERROR);
+    }
+    for (event = DMA_EVENT_HALF; event < DMA_EVENT_ERROR; event++)
+    {
+        if (dma_pending[event])
+        {
+            dma_pending[event] = false;
+            link_dma_service(event);
+        }
+    }
+    if (tx_done_pending)
+    {
+        tx_done_pending = false;
+        UART2_TxComplete();
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                              Horloge simulée                              */
+/* ------------------------------------------------------------------------- */
+
+uint64_t host_time_us(void)
+{
+    return now_us;
+}
+
+void host_wait_us(double duration_us)
+{
+    link_run_until(now_us + (uint64_t)duration_us);
+}
+
+void host_clock_init(void)
+{
+}
+
+/**
+ * @brief Tick en millisecondes, lu par les boucles d'attente du bootloader.
+ *
+ * Chaque lecture représente une itération d'attente : l'horloge avance jusqu'au
+ * prochain évènement, au plus jusqu'à la milliseconde suivante.
+ */
+uint32_t HAL_GetTick(void)
+{
+    uint64_t next = link_next_event();
+    uint64_t tick_end = ((now_us / 1000U) + 1U) * 1000U;
+
+    link_run_until((next < tick_end) ? next : tick_end);
+    return (uint32_t)(now_us / 1000U);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    host_wait_us((double)Delay * 1000.0);
+}
+
+uint32_t get_time_us(void)
+{
+    return (uint32_t)now_us;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                              USART2                                       */
+/* ------------------------------------------------------------------------- */
+
+void UART2_Init(void)
+{
+    hUART2.Instance = USART2;
+    hUART2.Init.BaudRate = link_config.baud;
+    hUART2.hdmarx = &hdma_usart2_rx;
+    UART2_TxReset();
+    UART2_StartReceiveDMA();
+}
+
+/**
+ * @brief Relance du DMA au début du tampon : les octets non publiés sont perdus.
+ */
+void UART2_StartReceiveDMA(void)
+{
+    link_stats.lost += link_dma_unpublished();
+    uart2_rx_dma_position = 0U;
+    dma_write = 0U;
+    dma_stored = 0U;
+    dma_published_base = v_uart2_rx_stats.bytes + v_uart2_rx_stats.dropped;
+    hdma_usart2_rx.counter = UART2_RX_DMA_BUFFER_SIZE;
+}
+
+/**
+ * @brief Arrêt de la réception DMA : NDTR est figé, les évènements en attente effacés.
+ */
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    huart->hdmarx->counter = UART2_RX_DMA_BUFFER_SIZE - dma_write;
+    dma_pending[DMA_EVENT_HALF] = false;
+    dma_pending[DMA_EVENT_FULL] = false;
+    dma_pending[DMA_EVENT_IDLE] = false;
+    idle_us = UINT64_MAX;
+    return HAL_OK;
+}
+
+uint32_t UART2_CheckBaudRate(uint32_t baud)
+{
+    return ((baud >= UART2_BAUD_MIN) && (baud <= UART2_BAUD_MAX)) ? baud : 0U;
+}
+
+/**
+ * @brief Changement de débit : les deux sens de la liaison basculent ensemble.
+ */
+int UART2_SetBaudRate(uint32_t baud)
+{
+    if (UART2_CheckBaudRate(baud) == 0U)
+    {
+        return -1;
+    }
+    (void)UART2_TxFlush(UART2_TX_TIMEOUT_MS);
+    byte_us = 10.0e6 / (double)baud;
+    hUART2.Init.BaudRate = baud;
+    return 0;
+}
+
+void host_uart_close(void)
+{
+}
+
+/**
+ * @brief Émission DMA : les octets sont placés sur la ligne, sans attente du CPU.
+ */
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    uint16_t i;
+
+    (void)huart;
+    for (i = 0U; i < Size; i++)
+    {
+        link_emit(&to_host, pData[i], 0.0);
+    }
+    tx_done_us = to_host.line_free_us;
+    return HAL_OK;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                              USB CDC                                      */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Émission USB CDC : octets placés sur la ligne sans attente du CPU, tant
+ *        que la file d'émission (cdc_tx_fifo, FIFO_BUFFER_SIZE octets) a de la place.
+ */
+void CDC_Send(const uint8_t *data, uint32_t length)
+{
+    double backlog_us = (double)(FIFO_BUFFER_SIZE - ((length < FIFO_BUFFER_SIZE) ? length : FIFO_BUFFER_SIZE)) * byte_us;
+    uint32_t i;
+
+    if ((double)to_host.line_free_us > ((double)now_us + backlog_us))
+    {
+        v_cdc_tx_stats.waits++;
+        link_run_until(to_host.line_free_us - (uint64_t)backlog_us);
+    }
+    for (i = 0U; i < length; i++)
+    {
+        link_emit(&to_host, data[i], 0.0);
+    }
+    v_cdc_tx_stats.transfers++;
+    v_cdc_tx_stats.bytes += length;
+}
+
+int CDC_TxFlush(uint32_t timeout_ms)
+{
+    (void)timeout_ms;
+    link_run_until(to_host.line_free_us);
+    return FIFO_OK;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file    link_sim.h
+ * @brief   Liaison série simulée du banc de mesure (voir xfer_bench.c).
+ *
+ * Le temps est simulé : l'horloge du bootloader (HAL_GetTick(), get_time_us(),
+ * durées de la flash) avance d'évènement en évènement, sans attente réelle. La
+ * liaison relie le récepteur du bootloader (USART2 ou CDC) à un émetteur
+ * simulé côté PC, avec, dans chaque sens :
+ *   - la durée de chaque octet au débit choisi (10 bits par octet) ;
+ *   - une latence fixe (adaptateur USB-série, ordonnancement du PC) ;
+ *   - un taux d'erreur binaire et un taux de perte d'octets ;
+ *   - vers l'USART2, un taux d'erreurs UART (UART2_RxError()).
+ * Les octets émis par le PC sont en outre espacés d'une gigue aléatoire.
+ * Sur l'USB CDC, le débit est fixe (LINK_CDC_BYTES_PER_S), sans erreur ni perte.
+ */
+
+#ifndef HOST_LINK_SIM_H
+#define HOST_LINK_SIM_H
+
+#include <stdint.h>
+#include "inc.h"
+
+/**
+ * @brief Débit utile de l'USB CDC en full speed : 19 paquets bulk de 64 octets
+ *        par trame de 1 ms.
+ */
+#define LINK_CDC_BYTES_PER_S    (1216000.0)
+
+/**
+ * @brief Paramètres de la liaison.
+ */
+typedef struct
+{
+    uint32_t baud;              /**< Débit de la liaison. */
+    double latency_us;          /**< Latence fixe dans chaque sens. */
+    double jitter_us;           /**< Écart maximal ajouté avant chaque octet émis par le PC. */
+    double bit_error_rate;      /**< Probabilité d'inversion de chaque bit de donnée. */
+    double drop_rate;           /**< Probabilité de perte de chaque octet. */
+    double uart_error_rate;     /**< Probabilité d'une erreur UART sur chaque octet reçu par l'USART2. */
+} link_config_t;
+
+/**
+ * @brief Compteurs d'un sens de la liaison.
+ */
+typedef struct
+{
+    uint32_t bytes;             /**< Octets émis. */
+    uint32_t corrupted;         /**< Octets altérés par au moins une erreur binaire. */
+    uint32_t dropped;           /**< Octets perdus sur la ligne. */
+} link_dir_stats_t;
+
+/**
+ * @brief Compteurs de la liaison.
+ */
+typedef struct
+{
+    link_dir_stats_t to_target; /**< PC vers bootloader. */
+    link_dir_stats_t to_host;   /**< Bootloader vers PC. */
+    uint32_t overruns;          /**< Octets perdus à la réception (DMA ou FIFO pleins). */
+    uint32_t uart_errors;       /**< Erreurs UART injectées (octet perdu, UART2_RxError()). */
+    uint32_t lost;              /**< Octets reçus par le DMA et abandonnés à sa relance. */
+} link_stats_t;
+
+/**
+ * @brief Émetteur côté PC, appelé par la liaison.
+ */
+typedef struct
+{
+    void (*on_byte)(uint8_t c);     /**< Octet reçu du bootloader. */
+    void (*on_timer)(void);         /**< Échéance programmée par link_set_timer(). */
+} link_host_t;
+
+extern link_stats_t link_stats;
+
+void link_open(const link_config_t *config, const transport_t *link, uint32_t seed, const link_host_t *host);
+void link_host_send(const uint8_t *data, uint32_t length);
+uint32_t link_host_pending(void);
+uint64_t link_host_idle_us(void);
+void link_set_timer(uint64_t at_us);
+uint64_t link_now_us(void);
+double link_byte_us(void);
+
+#endif /* HOST_LINK_SIM_H */
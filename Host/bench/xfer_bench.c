@@ -0,0 +1,1310 @@
+#include "port.h"
+#include "link_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @file xfer_bench.c
+ * @brief Banc de mesure des transferts de firmware sur une liaison série simulée.
+ *
+ * Les récepteurs du bootloader (xmodem_receive_1k_blockwise(), xmodem_receive_1k_g(),
+ * YMODEM_Receive(), slwin_receive()) sont exécutés tels quels, avec le pipeline
+ * d'écriture et la flash simulée de Host/port, face à un émetteur simulé qui se
+ * comporte comme sx/sb de lrzsz (XMODEM-1K, YMODEM batch, variantes -G) ou comme
+ * l'émetteur à fenêtre glissante de Tools/prov_tool.c (slwin). Le temps est simulé
+ * (voir link_sim.c) : une mesure à 9600 bauds dure une fraction de seconde.
+ * Chaque protocole peut être mesuré sur l'USART2 et sur l'USB CDC (-T).
+ *
+ * Utilisation :
+ *     xfer_bench [-p protocoles] [-T liaisons] [-b débits] [-l latence_ms] [-j gigue_us]
+ *                [-e taux_erreur_binaire] [-d taux_perte] [-n taille] [-r répétitions]
+ *                [-t délai_ack_ms] [-s facteur_flash] [-u taux_erreur_uart] [-H] [-L]
+ *                [-R blocs] [-f écritures] [-z] [-c]
+ *
+ * Par défaut : XMODEM-1K et YMODEM à 38400 bauds, latence de 1 ms, sans gigue ni
+ * erreur, délai d'acquittement de 10 s (sx). -u injecte des erreurs UART
+ * (octet perdu, relance du DMA par UART2_RxError()). -p, -b, -e et -d acceptent des listes séparées par des virgules : toutes les
+ * combinaisons sont mesurées, -r fois chacune avec des graines différentes.
+ * Protocoles : xmodem, xmodem-g, ymodem, ymodem-g, slwin. Pour slwin, naks compte
+ * les trous réémis sur ACK et retries toutes les réémissions ; l'échéance sans
+ * progrès est fixée à SLW_TIMEOUT_MS (-t est ignoré). Liaisons (-T, liste) : uart
+ * (par défaut), cdc ; l'USB CDC n'a ni débit réglable ni erreur de ligne : une
+ * seule combinaison est mesurée, avec baud, ber et drop à 0.
+ *
+ * La taille par défaut est celle de la zone application (56 ko, 0x08010000 à
+ * 0x0801DFFF) : une image de 64 ko n'y tient pas. L'image est pseudo-aléatoire
+ * (incompressible, sans en-tête) ; elle est relue dans la flash simulée à la fin.
+ * -H fait précéder l'image d'un en-tête (image.h) : le fichier transféré mesure
+ * 32 octets de plus et rien ne doit être écrit au-delà de la taille annoncée.
+ * -L installe avant chaque mesure une application sans en-tête (page
+ * d'information vierge, comme avant l'introduction de l'en-tête), qui doit
+ * démarrer avant le transfert. -R n (XMODEM-1K, avec -H) annule une première
+ * session après n blocs acquittés, puis en ouvre une seconde : l'émetteur ignore
+ * la première réponse XMODEM_RESUME ('R' et position) au bloc 1, réémet ce bloc
+ * et reprend à la position renvoyée (image.h). Les compteurs et la durée sont
+ * ceux de la seconde session. -c termine avec le code 1 si une mesure n'est pas
+ * ok, si l'image reçue ne démarre pas, si -R n'a pas donné lieu à une reprise ou
+ * si des octets reçus par le DMA ont été abandonnés (make -C Host check).
+ * -f (liste) choisit l'écriture de la flash : pipe (par défaut, flash_pipe.c : le
+ * bloc est acquitté dès qu'il est copié, la page s'efface et se programme pendant
+ * la réception des suivants) ou sync (la page est écrite et vérifiée avant
+ * l'acquittement du bloc, comme avant le pipeline) ; -f pipe,sync compare les deux.
+ * -z transfère l'image compressée (lzss.h), décompressée au fil de la réception :
+ * l'image est alors compressible et la taille transférée plus petite que la zone
+ * écrite (efficiency peut dépasser 1). Sur l'USART2, les variantes -G ne tiennent
+ * que tant que la programmation suit le flux décompressé (jusqu'à 460800 bauds).
+ *
+ * Sortie CSV sur stdout, une ligne par mesure :
+ *     protocol,baud,latency_ms,jitter_us,ber,drop,size,seed,result,time_s,
+ *     bytes_per_s,efficiency,blocks,retries,naks,timeouts,corrupted,dropped,
+ *     overruns,flash_busy_ms,transport,usb_naks,usb_nak_ms,boot,resumed,uart_errors,lost,
+ *     flash
+ * result : ok, fail (session annulée), corrupt (contenu de la flash différent) ou
+ * legacy (application sans en-tête refusée avant le transfert, -L).
+ * bytes_per_s : débit utile (0 si le transfert a échoué) ; efficiency : débit utile
+ * rapporté au débit brut de la ligne (8 bits sur 10), ou à LINK_CDC_BYTES_PER_S
+ * sur l'USB CDC. usb_naks, usb_nak_ms : suspensions de l'endpoint OUT, FIFO pleine,
+ * et trames passées en NAK (0 sur l'USART2). boot : 1 si image_check() accepte
+ * l'application à la fin de la mesure (démarrage direct, main.c). resumed :
+ * position de reprise reçue de la seconde session (-R), 0 sinon. uart_errors :
+ * erreurs UART injectées ; lost : octets reçus par le DMA et abandonnés à sa
+ * relance après une erreur (toujours 0 attendu). flash : pipe ou sync (-f).
+ */
+
+#define BENCH_MAX_LIST      (16U)
+#define BENCH_TX_MAX_TRIES  (10U)           /**< Essais par bloc avant abandon, comme sx */
+#define BENCH_FRAME_1K      (3U + 1024U + 2U)
+#define BENCH_FRAME_128     (3U + 128U + 2U)
+
+#define X_ACK_CHAR          (0x06U)
+#define X_NAK_CHAR          (0x15U)
+#define X_CAN_CHAR          (0x18U)
+#define X_RESUME_CHAR       (0x52U)         /**< 'R' : XMODEM_RESUME suivi de 4 octets */
+
+/* Fenêtre glissante (slwin.c) : type | séquence | données | CRC16, encodé en COBS, puis 0x00 */
+#define SLW_TYPE_DATA       (0x01U)
+#define SLW_TYPE_END        (0x02U)
+#define SLW_TYPE_ABORT      (0x18U)
+#define SLW_TYPE_READY      (0x80U)
+#define SLW_TYPE_ACK        (0x81U)
+#define SLW_BLOCK           (1024U)
+#define SLW_FRAME           (2U + SLW_BLOCK + 2U)
+#define SLW_ENCODED         (SLW_FRAME + (SLW_FRAME / 254U) + 2U)   /**< Délimiteur compris */
+#define SLW_WINDOW_MAX      (8U)
+#define SLW_REPLY_MAX       (16U)           /**< Trame encodée du récepteur (READY, ACK, ABORT) */
+#define SLW_TIMEOUT_MS      (500U)          /**< Sans ACK après la dernière trame : réémission */
+
+/**
+ * @brief Protocole mesuré.
+ */
+typedef struct
+{
+    const char *name;
+    bool ymodem;        /**< Bloc 0 (nom, taille) et bloc 0 vide final */
+    bool streaming;     /**< Variante -G : pas d'acquittement par bloc */
+    bool slwin;         /**< Fenêtre glissante (slwin.c), trames COBS */
+} bench_proto_t;
+
+static const bench_proto_t bench_protos[] =
+{
+    { "xmodem",   false, false, false },
+    { "xmodem-g", false, true,  false },
+    { "ymodem",   true,  false, false },
+    { "ymodem-g", true,  true,  false },
+    { "slwin",    false, false, true  },
+};
+
+/**
+ * @brief Étape de l'émetteur.
+ */
+typedef enum
+{
+    TX_START,           /**< Attente de 'C' ou 'G' */
+    TX_HEADER,          /**< Bloc 0 YMODEM émis */
+    TX_DATA_START,      /**< Bloc 0 acquitté, attente de 'C' */
+    TX_DATA,            /**< Blocs de données */
+    TX_EOT,             /**< EOT émis */
+    TX_FIN_START,       /**< EOT acquitté, attente de 'C' ou 'G' pour le bloc 0 vide */
+    TX_FIN,             /**< Bloc 0 vide émis */
+    TX_DONE,
+    TX_FAILED
+} tx_phase_t;
+
+/**
+ * @brief Émetteur simulé (côté PC).
+ */
+static struct
+{
+    const bench_proto_t *proto;
+    const uint8_t *image;
+    uint32_t size;
+    uint32_t blocks;
+    uint32_t block;         /**< Bloc en cours (stop-and-wait) ou prochain bloc à émettre (streaming) */
+    uint32_t tries;         /**< Émissions de l'unité en cours */
+    uint64_t ack_timeout_us;
+    tx_phase_t phase;
+    uint8_t start_char;
+    uint8_t previous;
+    uint32_t base;          /**< Position dans le fichier des données du bloc 2 */
+    uint32_t resume_bytes;  /**< Octets de la position de reprise encore attendus */
+    uint32_t resume_offset;
+    uint32_t resumed;       /**< Position de reprise appliquée, 0 sinon */
+    uint32_t cancel_after;  /**< Annulation après ce nombre de blocs acquittés (-R), 0 sinon */
+    bool ignore_resume;     /**< Première réponse 'R' ignorée : le bloc 1 est réémis */
+    uint32_t blocks_sent;
+    uint32_t retries;
+    uint32_t naks;
+    uint32_t timeouts;
+} tx;
+
+static uint8_t bench_image[FLASH_APP_END_ADDRESS - APPLICATION_ADDRESS + 1U];
+
+/** Fichier transféré : en-tête éventuel (-H) suivi de l'image, compressée avec -z
+    (9 bits par octet au pire). */
+static uint8_t bench_file[IMAGE_HEADER_SIZE + LZSS_HEADER_SIZE + ((sizeof(bench_image) * 9U) / 8U) + 1U];
+static bool bench_header = false;
+static bool bench_lzss = false;         /**< Image compressée (-z, lzss.h) */
+static bool bench_legacy = false;
+static uint32_t bench_interrupt = 0U;
+static bool bench_sync = false;         /**< Écriture flash synchrone (-f sync) */
+
+/**
+ * @brief Émet une trame XMODEM/YMODEM (SOH ou STX, numéro, complément, données, CRC16).
+ */
+static void tx_send_frame(uint8_t seq, const uint8_t *data, uint32_t length, uint32_t frame_size)
+{
+    uint8_t frame[BENCH_FRAME_1K];
+    uint32_t payload = frame_size - 5U;
+    uint16_t crc;
+
+    frame[0] = (payload == 1024U) ? 0x02U : 0x01U;
+    frame[1] = seq;
+    frame[2] = (uint8_t)~seq;
+    (void)memset(&frame[3], (data != NULL) ? 0x1A : 0x00, payload);
+    if (data != NULL)
+    {
+        (void)memcpy(&frame[3], data, length);
+    }
+    crc = crc16_final(crc16_update(crc16_init(), &frame[3], payload));
+    frame[3U + payload] = (uint8_t)(crc >> 8);
+    frame[4U + payload] = (uint8_t)crc;
+    link_host_send(frame, frame_size);
+}
+
+/**
+ * @brief Émet le bloc de données n (numérotés à partir de 1).
+ */
+static void tx_send_block(uint32_t n)
+{
+    uint32_t offset = (n == 1U) ? 0U : (tx.base + ((n - 2U) * 1024U));
+    uint32_t length = ((tx.size - offset) < 1024U) ? (tx.size - offset) : 1024U;
+
+    tx_send_frame((uint8_t)n, &tx.image[offset], length, BENCH_FRAME_1K);
+    tx.blocks_sent++;
+}
+
+/**
+ * @brief Numéro du dernier bloc de données, le bloc 2 commençant à tx.base.
+ */
+static uint32_t tx_last_block(void)
+{
+    return (tx.size <= tx.base) ? 1U : (1U + ((tx.size - tx.base + 1023U) / 1024U));
+}
+
+/**
+ * @brief Émet le bloc 0 YMODEM : nom et taille du fichier, ou vide en fin de session.
+ */
+static void tx_send_header(bool empty)
+{
+    uint8_t info[128];
+    int n;
+
+    (void)memset(info, 0, sizeof(info));
+    if (!empty)
+    {
+        n = snprintf((char *)info, sizeof(info), "bench.bin");
+        (void)snprintf((char *)&info[n + 1], sizeof(info) - (size_t)n - 1U, "%u 0 100644", (unsigned int)tx.size);
+    }
+    tx_send_frame(0U, empty ? NULL : info, sizeof(info), BENCH_FRAME_128);
+}
+
+/**
+ * @brief Attend la réponse à ce qui vient d'être émis.
+ */
+static void tx_arm(void)
+{
+    link_set_timer(link_host_idle_us() + tx.ack_timeout_us);
+}
+
+/**
+ * @brief Annule la session (CAN CAN), comme l'émetteur après trop d'essais.
+ */
+static void tx_cancel(void)
+{
+    static const uint8_t cancel[] = { X_CAN_CHAR, X_CAN_CHAR };
+
+    link_host_send(cancel, sizeof(cancel));
+    tx.phase = TX_FAILED;
+    link_set_timer(UINT64_MAX);
+}
+
+/**
+ * @brief Émet l'unité de l'étape en cours (bloc 0, bloc de données, EOT).
+ *
+ * @param[in] retry true pour une réémission.
+ */
+static void tx_send_current(bool retry)
+{
+    static const uint8_t eot = 0x04U;
+
+    if (retry)
+    {
+        tx.retries++;
+        if (++tx.tries >= BENCH_TX_MAX_TRIES)
+        {
+            tx_cancel();
+            return;
+        }
+    }
+    else
+    {
+        tx.tries = 0U;
+    }
+    switch (tx.phase)
+    {
+    case TX_HEADER:
+        tx_send_header(false);
+        break;
+    case TX_FIN:
+        tx_send_header(true);
+        break;
+    case TX_DATA:
+        tx_send_block(tx.block);
+        break;
+    case TX_EOT:
+        link_host_send(&eot, 1U);
+        break;
+    default:
+        return;
+    }
+    tx_arm();
+}
+
+/**
+ * @brief Streaming : garde deux trames en transit, puis émet l'EOT.
+ */
+static void tx_pump(void)
+{
+    while ((tx.block <= tx.blocks) && (link_host_pending() < (2U * BENCH_FRAME_1K)))
+    {
+        tx_send_block(tx.block);
+        tx.block++;
+    }
+    if (tx.block > tx.blocks)
+    {
+        tx.phase = TX_EOT;
+        tx_send_current(false);
+    }
+    else
+    {
+        link_set_timer(link_now_us() + (uint64_t)(link_byte_us() * BENCH_FRAME_1K));
+    }
+}
+
+/**
+ * @brief Début des blocs de données.
+ */
+static void tx_start_data(void)
+{
+    tx.phase = TX_DATA;
+    tx.block = 1U;
+    if (tx.proto->streaming)
+    {
+        tx_pump();
+    }
+    else
+    {
+        tx_send_current(false);
+    }
+}
+
+/**
+ * @brief Octet reçu du bootloader.
+ */
+static void tx_on_byte(uint8_t c)
+{
+    bool cancelled = (c == X_CAN_CHAR) && (tx.previous == X_CAN_CHAR);
+
+    tx.previous = c;
+    if (cancelled && (tx.phase != TX_DONE))
+    {
+        tx.phase = TX_FAILED;
+        link_set_timer(UINT64_MAX);
+        return;
+    }
+    switch (tx.phase)
+    {
+    case TX_START:
+        if (c == tx.start_char)
+        {
+            if (tx.proto->ymodem)
+            {
+                tx.phase = TX_HEADER;
+                tx_send_current(false);
+            }
+            else
+            {
+                tx_start_data();
+            }
+        }
+        break;
+
+    case TX_HEADER:
+        if ((tx.proto->streaming && (c == tx.start_char)) || (!tx.proto->streaming && (c == X_ACK_CHAR)))
+        {
+            if (tx.proto->streaming)
+            {
+                tx_start_data();
+            }
+            else
+            {
+                tx.phase = TX_DATA_START;
+                tx_arm();
+            }
+        }
+        else if (c == X_NAK_CHAR)
+        {
+            tx.naks++;
+            tx_send_current(true);
+        }
+        break;
+
+    case TX_DATA_START:
+        if (c == tx.start_char)
+        {
+            tx_start_data();
+        }
+        break;
+
+    case TX_DATA:
+        if (tx.proto->streaming)
+        {
+            break;
+        }
+        if (tx.resume_bytes > 0U)
+        {
+            /* Position de reprise, petit-boutiste */
+            tx.resume_offset |= (uint32_t)c << (8U * (4U - tx.resume_bytes));
+            if (--tx.resume_bytes > 0U)
+            {
+                break;
+            }
+            if (tx.ignore_resume)
+            {
+                /* Réponse perdue pour l'émetteur : le bloc 1 est réémis */
+                tx.ignore_resume = false;
+                tx_send_current(true);
+                break;
+            }
+            tx.resumed = tx.resume_offset;
+            tx.base = tx.resume_offset;
+            tx.blocks = tx_last_block();
+            tx.block = 2U;
+            if (tx.block > tx.blocks)
+            {
+                tx.phase = TX_EOT;
+            }
+            tx_send_current(false);
+        }
+        else if ((c == X_RESUME_CHAR) && (tx.block == 1U))
+        {
+            tx.resume_bytes = 4U;
+            tx.resume_offset = 0U;
+        }
+        else if ((tx.cancel_after != 0U) && (c == X_ACK_CHAR) && (tx.block == tx.cancel_after))
+        {
+            /* Interruption de la première session (-R) */
+            tx_cancel();
+        }
+        else if (c == X_ACK_CHAR)
+        {
+            tx.block++;
+            if (tx.block > tx.blocks)
+            {
+                tx.phase = TX_EOT;
+            }
+            tx_send_current(false);
+        }
+        else if ((c == X_NAK_CHAR) || (c == tx.start_char))
+        {
+            /* xmodem.c redemande 'C' après un silence : équivalent d'un NAK pour sx */
+            tx.naks++;
+            tx_send_current(true);
+        }
+        break;
+
+    case TX_EOT:
+        if (c == X_ACK_CHAR)
+        {
+            if (tx.proto->ymodem)
+            {
+                tx.phase = TX_FIN_START;
+                tx_arm();
+            }
+            else
+            {
+                tx.phase = TX_DONE;
+                link_set_timer(UINT64_MAX);
+            }
+        }
+        else if (c == X_NAK_CHAR)
+        {
+            tx.naks++;
+            tx_send_current(true);
+        }
+        break;
+
+    case TX_FIN_START:
+        if ((c == tx.start_char) || (c == X_NAK_CHAR))
+        {
+            tx.phase = TX_FIN;
+            tx_send_current(false);
+        }
+        break;
+
+    case TX_FIN:
+        if (c == X_ACK_CHAR)
+        {
+            tx.phase = TX_DONE;
+            link_set_timer(UINT64_MAX);
+        }
+        else if (c == X_NAK_CHAR)
+        {
+            tx.naks++;
+            tx_send_current(true);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Échéance de l'émetteur : réponse attendue absente, ou streaming à alimenter.
+ */
+static void tx_on_timer(void)
+{
+    if ((tx.phase == TX_DATA) && tx.proto->streaming)
+    {
+        tx_pump();
+        return;
+    }
+    tx.timeouts++;
+    switch (tx.phase)
+    {
+    case TX_DATA_START:
+        /* 'C' perdu : les données sont émises quand même */
+        tx_start_data();
+        break;
+    case TX_FIN_START:
+        tx.phase = TX_FIN;
+        tx_send_current(false);
+        break;
+    default:
+        tx_send_current(true);
+        break;
+    }
+}
+
+static const link_host_t tx_host = { tx_on_byte, tx_on_timer };
+
+/**
+ * @brief Émetteur à fenêtre glissante (slwin.c) : numéros d'unité absolus, les
+ *        blocs de données puis la trame END ; l'état des unités en vol est rangé
+ *        modulo SLW_WINDOW_MAX.
+ */
+static struct
+{
+    uint32_t window;                    /**< Taille annoncée par READY */
+    uint32_t units;                     /**< Blocs de données + END */
+    uint32_t base;                      /**< Plus ancienne unité non acquittée */
+    uint32_t next;                      /**< Prochaine unité jamais émise */
+    bool acked[SLW_WINDOW_MAX];         /**< Reçue en avance (masque de l'ACK) */
+    bool resent[SLW_WINDOW_MAX];        /**< Déjà réémise pour combler un trou */
+    uint64_t sent_us;                   /**< Fin d'émission de la dernière trame */
+    uint8_t reply[SLW_REPLY_MAX];       /**< Trame du récepteur en cours (encodée) */
+    uint32_t reply_length;
+} slw;
+
+/**
+ * @brief Émet l'unité u : bloc de données, ou END après le dernier bloc.
+ *
+ * @param[in] retry true pour une réémission.
+ */
+static void slw_send_unit(uint32_t u, bool retry)
+{
+    uint8_t raw[SLW_FRAME];
+    uint8_t encoded[SLW_ENCODED];
+    uint32_t offset = u * SLW_BLOCK;
+    uint32_t length = 0U;
+    uint32_t n;
+    uint16_t crc;
+
+    if (u < (slw.units - 1U))
+    {
+        length = ((tx.size - offset) < SLW_BLOCK) ? (tx.size - offset) : SLW_BLOCK;
+        (void)memcpy(&raw[2], &tx.image[offset], length);
+    }
+    raw[0] = (u < (slw.units - 1U)) ? SLW_TYPE_DATA : SLW_TYPE_END;
+    raw[1] = (uint8_t)u;
+    crc = crc16_final(crc16_update(crc16_init(), raw, 2U + length));
+    raw[2U + length] = (uint8_t)(crc >> 8);
+    raw[3U + length] = (uint8_t)crc;
+    n = cobs_encode(raw, 4U + length, encoded);
+    encoded[n] = 0U;
+    link_host_send(encoded, n + 1U);
+    slw.sent_us = link_host_idle_us();
+
+    tx.blocks_sent++;
+    if (retry)
+    {
+        tx.retries++;
+    }
+    else
+    {
+        slw.acked[u % SLW_WINDOW_MAX] = false;
+    }
+    slw.resent[u % SLW_WINDOW_MAX] = retry;
+}
+
+/**
+ * @brief Complète la fenêtre et attend l'acquittement de la dernière trame émise.
+ */
+static void slw_fill(void)
+{
+    while ((slw.next < (slw.base + slw.window)) && (slw.next < slw.units))
+    {
+        slw_send_unit(slw.next, false);
+        slw.next++;
+    }
+    link_set_timer(link_host_idle_us() + ((uint64_t)SLW_TIMEOUT_MS * 1000U));
+}
+
+/**
+ * @brief Annule la session (trame ABORT).
+ */
+static void slw_cancel(void)
+{
+    uint8_t raw[5] = { SLW_TYPE_ABORT, 0U, 0U, 0U, 0U };
+    uint8_t encoded[sizeof(raw) + 2U];
+    uint16_t crc = crc16_final(crc16_update(crc16_init(), raw, 3U));
+    uint32_t n;
+
+    raw[3] = (uint8_t)(crc >> 8);
+    raw[4] = (uint8_t)crc;
+    n = cobs_encode(raw, sizeof(raw), encoded);
+    encoded[n] = 0U;
+    link_host_send(encoded, n + 1U);
+    tx.phase = TX_FAILED;
+    link_set_timer(UINT64_MAX);
+}
+
+/**
+ * @brief Traite un ACK : séquence attendue (acquittement cumulatif) et masque des
+ *        unités suivantes déjà reçues.
+ *
+ * Les trous sous la plus haute unité reçue sont réémis une fois, sans attendre
+ * l'échéance. Un ACK arrivé après SLWIN_ACK_TIMEOUT_MS de silence de l'émetteur
+ * est la répétition du récepteur : l'unité attendue est réémise (trame perdue en
+ * fin de fenêtre) et les réémissions perdues peuvent être refaites. Un ACK sans
+ * progrès ne repousse pas l'échéance.
+ */
+static void slw_on_ack(uint8_t seq, uint8_t mask)
+{
+    uint32_t expected = slw.base + (uint8_t)(seq - (uint8_t)slw.base);
+    uint32_t highest = 0U;
+    bool progress = false;
+    bool repeated = (link_now_us() >= (slw.sent_us + ((uint64_t)SLWIN_ACK_TIMEOUT_MS * 1000U)));
+    uint32_t u;
+    uint32_t i;
+
+    if (expected > slw.next)
+    {
+        return;
+    }
+    if (expected > slw.base)
+    {
+        slw.base = expected;
+        tx.tries = 0U;
+        progress = true;
+    }
+    if (slw.base >= slw.units)
+    {
+        /* END acquitté : image écrite et vérifiée */
+        tx.phase = TX_DONE;
+        link_set_timer(UINT64_MAX);
+        return;
+    }
+    if (repeated)
+    {
+        (void)memset(slw.resent, 0, sizeof(slw.resent));
+    }
+    for (i = 0U; i < (SLW_WINDOW_MAX - 1U); i++)
+    {
+        u = slw.base + 1U + i;
+        if (((mask & (1U << i)) != 0U) && (u < slw.next))
+        {
+            slw.acked[u % SLW_WINDOW_MAX] = true;
+            highest = u;
+        }
+    }
+    if ((highest == 0U) && !progress && repeated)
+    {
+        highest = slw.base + 1U;
+    }
+    for (u = slw.base; u < highest; u++)
+    {
+        if (!slw.acked[u % SLW_WINDOW_MAX] && !slw.resent[u % SLW_WINDOW_MAX])
+        {
+            tx.naks++;
+            slw_send_unit(u, true);
+            progress = true;
+        }
+    }
+    if (progress)
+    {
+        slw_fill();
+    }
+}
+
+/**
+ * @brief Octet reçu du bootloader : trames COBS READY, ACK ou ABORT.
+ */
+static void slw_on_byte(uint8_t c)
+{
+    uint8_t frame[SLW_REPLY_MAX];
+    int32_t length;
+
+    if (c != 0U)
+    {
+        if (slw.reply_length < sizeof(slw.reply))
+        {
+            slw.reply[slw.reply_length] = c;
+        }
+        slw.reply_length++;
+        return;
+    }
+    length = (slw.reply_length <= sizeof(slw.reply)) ? cobs_decode(slw.reply, slw.reply_length, frame) : -1;
+    slw.reply_length = 0U;
+    if ((length != 5) || (crc16_final(crc16_update(crc16_init(), frame, 3U)) != (((uint16_t)frame[3] << 8) | frame[4])))
+    {
+        return;
+    }
+
+    if (frame[0] == SLW_TYPE_ABORT)
+    {
+        tx.phase = TX_FAILED;
+        link_set_timer(UINT64_MAX);
+    }
+    else if ((frame[0] == SLW_TYPE_READY) && (tx.phase == TX_START))
+    {
+        slw.window = ((frame[2] == 0U) || (frame[2] > SLW_WINDOW_MAX)) ? SLW_WINDOW_MAX : frame[2];
+        tx.phase = TX_DATA;
+        slw_fill();
+    }
+    else if ((frame[0] == SLW_TYPE_ACK) && (tx.phase == TX_DATA))
+    {
+        slw_on_ack(frame[1], frame[2]);
+    }
+}
+
+/**
+ * @brief Échéance : aucun ACK n'a fait avancer la fenêtre, les unités non
+ *        acquittées sont réémises. Des trames encore en attente d'émission
+ *        (contrôle de flux de l'USB CDC) repoussent l'échéance.
+ */
+static void slw_on_timer(void)
+{
+    uint32_t u;
+
+    if (tx.phase != TX_DATA)
+    {
+        return;
+    }
+    if (link_host_pending() != 0U)
+    {
+        link_set_timer(link_now_us() + ((uint64_t)SLW_TIMEOUT_MS * 1000U));
+        return;
+    }
+    tx.timeouts++;
+    if (++tx.tries >= BENCH_TX_MAX_TRIES)
+    {
+        slw_cancel();
+        return;
+    }
+    for (u = slw.base; u < slw.next; u++)
+    {
+        if (!slw.acked[u % SLW_WINDOW_MAX])
+        {
+            slw_send_unit(u, true);
+        }
+    }
+    slw_fill();
+}
+
+static const link_host_t slw_host = { slw_on_byte, slw_on_timer };
+
+/**
+ * @brief Résultat d'une mesure.
+ */
+typedef struct
+{
+    const char *result;
+    double time_s;
+    double bytes_per_s;     /**< Débit utile, 0 si le transfert a échoué */
+    bool boot;              /**< image_check() accepte l'application à la fin de la mesure */
+} bench_result_t;
+
+/**
+ * @brief Ajoute count bits de value au flux LZSS, bit de poids fort en tête.
+ */
+static void bench_put_bits(uint8_t *out, uint32_t *bit_position, uint32_t value, uint32_t count)
+{
+    while (count > 0U)
+    {
+        count--;
+        if ((*bit_position % 8U) == 0U)
+        {
+            out[*bit_position / 8U] = 0U;
+        }
+        if (((value >> count) & 1U) != 0U)
+        {
+            out[*bit_position / 8U] |= (uint8_t)(0x80U >> (*bit_position % 8U));
+        }
+        (*bit_position)++;
+    }
+}
+
+/**
+ * @brief Compresse l'image au format de lzss.h (recherche gloutonne, comme
+ *        Tools/lzss_pack.c).
+ *
+ * @return uint32_t Taille de l'image compressée, en-tête LZSS compris.
+ */
+static uint32_t bench_compress(const uint8_t *in, uint32_t length, uint8_t *out)
+{
+    static const uint8_t magic[8] = { 'A', 'L', 'Z', '1', LZSS_WINDOW_BITS, LZSS_LOOKAHEAD_BITS, 0U, 0U };
+    uint32_t bit_position = LZSS_HEADER_SIZE * 8U;
+    uint32_t pos = 0U;
+    uint32_t best_length;
+    uint32_t best_offset;
+    uint32_t max_length;
+    uint32_t offset;
+    uint32_t n;
+
+    (void)memcpy(out, magic, sizeof(magic));
+    for (n = 0U; n < 4U; n++)
+    {
+        out[8U + n] = (uint8_t)(length >> (8U * n));
+    }
+    while (pos < length)
+    {
+        best_length = 0U;
+        best_offset = 0U;
+        max_length = ((length - pos) < LZSS_MAX_MATCH) ? (length - pos) : LZSS_MAX_MATCH;
+        for (offset = 1U; (offset <= LZSS_WINDOW_SIZE) && (offset <= pos) && (best_length < max_length); offset++)
+        {
+            for (n = 0U; (n < max_length) && (in[pos + n - offset] == in[pos + n]); n++)
+            {
+            }
+            if (n > best_length)
+            {
+                best_length = n;
+                best_offset = offset;
+            }
+        }
+        if (best_length >= 2U)
+        {
+            bench_put_bits(out, &bit_position, 0U, 1U);
+            bench_put_bits(out, &bit_position, best_offset - 1U, LZSS_WINDOW_BITS);
+            bench_put_bits(out, &bit_position, best_length - 1U, LZSS_LOOKAHEAD_BITS);
+            pos += best_length;
+        }
+        else
+        {
+            bench_put_bits(out, &bit_position, 1U, 1U);
+            bench_put_bits(out, &bit_position, in[pos], 8U);
+            pos++;
+        }
+    }
+    return (bit_position + 7U) / 8U;
+}
+
+/**
+ * @brief Construit le fichier transféré : en-tête (-H) puis image, compressée (-z).
+ *
+ * L'en-tête décrit l'image décompressée, écrite en flash.
+ *
+ * @return uint32_t Taille du fichier.
+ */
+static uint32_t bench_make_file(uint32_t size)
+{
+    image_header_t header;
+    uint32_t offset = bench_header ? IMAGE_HEADER_SIZE : 0U;
+    uint32_t length;
+
+    if (bench_lzss)
+    {
+        length = bench_compress(bench_image, size, &bench_file[offset]);
+    }
+    else
+    {
+        length = size;
+        (void)memcpy(&bench_file[offset], bench_image, size);
+    }
+    if (!bench_header)
+    {
+        return length;
+    }
+    header.magic = IMAGE_HEADER_MAGIC;
+    header.load_address = APPLICATION_ADDRESS;
+    header.length = size;
+    header.crc32 = crc32_final(crc32_update(crc32_init(), bench_image, size));
+    header.version = 0x00010000UL;
+    header.flags = (bench_interrupt != 0U) ? IMAGE_FLAG_RESUMABLE : 0U;
+    header.reserved = 0xFFFFFFFFUL;
+    header.header_crc = crc32_final(crc32_update(crc32_init(), (const uint8_t *)&header, IMAGE_HEADER_CRC_SIZE));
+    (void)memcpy(bench_file, &header, sizeof(header));
+    return IMAGE_HEADER_SIZE + length;
+}
+
+/**
+ * @brief Installe une application sans en-tête, page d'information vierge (-L).
+ *
+ * @return bool true si image_check() l'accepte.
+ */
+static bool bench_load_legacy(void)
+{
+    static const uint32_t vectors[2] = { 0x20008000UL, APPLICATION_ADDRESS + 0x1C5UL };
+    uint8_t code[FLASH_PAGE_SIZE];
+
+    (void)memset(code, 0xA5, sizeof(code));
+    (void)memcpy(code, vectors, sizeof(vectors));
+    host_flash_load(APPLICATION_ADDRESS, code, sizeof(code));
+    return image_check() == IMAGE_OK;
+}
+
+/**
+ * @brief Indique si la flash est vierge de address jusqu'à la fin de sa page.
+ */
+static bool bench_blank_to_page_end(uint32_t address)
+{
+    const uint8_t *p = (const uint8_t *)address;
+
+    while ((address % FLASH_PAGE_SIZE) != 0U)
+    {
+        if (*p++ != 0xFFU)
+        {
+            return false;
+        }
+        address++;
+    }
+    return true;
+}
+
+/**
+ * @brief Écriture synchrone (-f sync) : une page complétée par le bloc est effacée,
+ *        programmée et vérifiée avant l'acquittement, un bloc sur deux en XMODEM-1K.
+ */
+static void bench_sync_callback(const fifo_span_t *block, uint32_t block_number, uint16_t received_crc)
+{
+    flash_write_callback(block, block_number, received_crc);
+    /* La page en cours de remplissage reste ouverte ; une erreur est signalée à la fin du transfert */
+    while (flash_pipe_poll() == FLASH_PIPE_BUSY)
+    {
+    }
+}
+
+/**
+ * @brief Effectue une session de transfert, sur la flash dans son état courant.
+ *
+ * @param[in] cancel_after  Annulation par l'émetteur après ce nombre de blocs acquittés, 0 sinon.
+ * @param[in] ignore_resume true pour ignorer la première réponse XMODEM_RESUME.
+ * @return int Code de retour du récepteur.
+ */
+static int bench_session(const bench_proto_t *proto, const transport_t *link, const link_config_t *config,
+                         uint32_t size, uint32_t seed, uint32_t ack_timeout_ms,
+                         uint32_t cancel_after, bool ignore_resume)
+{
+    xmodem_block_callback_t callback = bench_sync ? bench_sync_callback : flash_write_callback;
+
+    (void)memset(&host_flash_stats, 0, sizeof(host_flash_stats));
+    (void)memset(&v_uart2_rx_stats, 0, sizeof(v_uart2_rx_stats));
+    (void)memset(&v_cdc_rx_stats, 0, sizeof(v_cdc_rx_stats));
+    (void)memset(&v_cdc_tx_stats, 0, sizeof(v_cdc_tx_stats));
+    (void)memset(&tx, 0, sizeof(tx));
+    tx.proto = proto;
+    tx.image = bench_file;
+    tx.size = bench_make_file(size);
+    tx.base = 1024U;
+    tx.blocks = tx_last_block();
+    tx.cancel_after = cancel_after;
+    tx.ignore_resume = ignore_resume;
+    tx.ack_timeout_us = (uint64_t)ack_timeout_ms * 1000U;
+    tx.start_char = proto->streaming ? (uint8_t)'G' : (uint8_t)'C';
+    tx.phase = TX_START;
+
+    fifo_init(&usart2_fifo);
+    fifo_init(&cdc_fifo);
+    (void)memset(&slw, 0, sizeof(slw));
+    slw.units = ((tx.size + SLW_BLOCK - 1U) / SLW_BLOCK) + 1U;
+    link_open(config, link, seed, proto->slwin ? &slw_host : &tx_host);
+    HAL_Init();
+    UART2_Init();
+
+    if (proto->slwin)
+    {
+        return slwin_receive(link, callback);
+    }
+    if (proto->ymodem)
+    {
+        return YMODEM_Receive(link, proto->streaming ? 1U : 0U, callback);
+    }
+    if (proto->streaming)
+    {
+        return xmodem_receive_1k_g(link, callback);
+    }
+    return xmodem_receive_1k_blockwise(link, callback);
+}
+
+/**
+ * @brief Effectue un transfert complet et contrôle le contenu de la flash.
+ */
+static bench_result_t bench_run(const bench_proto_t *proto, const transport_t *link, const link_config_t *config,
+                                uint32_t size, uint32_t seed, uint32_t ack_timeout_ms)
+{
+    bench_result_t result;
+    int status;
+
+    host_flash_format();
+    if (bench_legacy && !bench_load_legacy())
+    {
+        result.result = "legacy";
+        result.time_s = 0.0;
+        result.bytes_per_s = 0.0;
+        result.boot = false;
+        return result;
+    }
+
+    if (bench_interrupt != 0U)
+    {
+        /* Première session interrompue : les pages vérifiées restent journalisées */
+        (void)bench_session(proto, link, config, size, seed, ack_timeout_ms, bench_interrupt, false);
+        status = bench_session(proto, link, config, size, seed, ack_timeout_ms, 0U, true);
+    }
+    else
+    {
+        status = bench_session(proto, link, config, size, seed, ack_timeout_ms, 0U, false);
+    }
+
+    result.time_s = (double)link_now_us() / 1.0e6;
+    if (status != 0)
+    {
+        result.result = "fail";
+    }
+    else if ((memcmp((const void *)APPLICATION_ADDRESS, bench_image, size) != 0)
+             || (bench_header && !bench_blank_to_page_end(APPLICATION_ADDRESS + size)))
+    {
+        /* Avec en-tête, le bourrage du dernier bloc ne doit pas être écrit */
+        result.result = "corrupt";
+    }
+    else
+    {
+        result.result = "ok";
+    }
+    result.bytes_per_s = (strcmp(result.result, "ok") == 0) ? ((double)size / result.time_s) : 0.0;
+    result.boot = (image_check() == IMAGE_OK);
+    return result;
+}
+
+/**
+ * @brief Découpe une liste de nombres séparés par des virgules.
+ *
+ * @return uint32_t Nombre de valeurs lues (0 si la liste est invalide).
+ */
+static uint32_t bench_parse_list(const char *arg, double *values)
+{
+    char *end;
+    uint32_t n = 0U;
+
+    while ((*arg != '\0') && (n < BENCH_MAX_LIST))
+    {
+        values[n++] = strtod(arg, &end);
+        if ((end == arg) || ((*end != ',') && (*end != '\0')))
+        {
+            return 0U;
+        }
+        arg = (*end == ',') ? (end + 1) : end;
+    }
+    return n;
+}
+
+/**
+ * @brief Découpe la liste des protocoles.
+ *
+ * @return uint32_t Nombre de protocoles lus (0 si un nom est inconnu).
+ */
+static uint32_t bench_parse_protos(const char *arg, const bench_proto_t **protos)
+{
+    char list[128];
+    char *name;
+    char *save = NULL;
+    uint32_t n = 0U;
+    uint32_t i;
+
+    (void)snprintf(list, sizeof(list), "%s", arg);
+    for (name = strtok_r(list, ",", &save); (name != NULL) && (n < BENCH_MAX_LIST); name = strtok_r(NULL, ",", &save))
+    {
+        for (i = 0U; i < (sizeof(bench_protos) / sizeof(bench_protos[0])); i++)
+        {
+            if (strcmp(name, bench_protos[i].name) == 0)
+            {
+                protos[n++] = &bench_protos[i];
+                break;
+            }
+        }
+        if (i == (sizeof(bench_protos) / sizeof(bench_protos[0])))
+        {
+            return 0U;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Découpe la liste des liaisons (uart, cdc).
+ *
+ * @return uint32_t Nombre de liaisons lues (0 si un nom est inconnu).
+ */
+static uint32_t bench_parse_transports(const char *arg, const transport_t **links)
+{
+    char list[64];
+    char *name;
+    char *save = NULL;
+    uint32_t n = 0U;
+
+    (void)snprintf(list, sizeof(list), "%s", arg);
+    for (name = strtok_r(list, ",", &save); (name != NULL) && (n < BENCH_MAX_LIST); name = strtok_r(NULL, ",", &save))
+    {
+        if (strcmp(name, "uart") == 0)
+        {
+            links[n++] = &transport_uart2;
+        }
+        else if (strcmp(name, "cdc") == 0)
+        {
+            links[n++] = &transport_cdc;
+        }
+        else
+        {
+            return 0U;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Découpe la liste des modes d'écriture de la flash (pipe, sync).
+ *
+ * @return uint32_t Nombre de modes lus (0 si un nom est inconnu).
+ */
+static uint32_t bench_parse_flash(const char *arg, bool *syncs)
+{
+    char list[64];
+    char *name;
+    char *save = NULL;
+    uint32_t n = 0U;
+
+    (void)snprintf(list, sizeof(list), "%s", arg);
+    for (name = strtok_r(list, ",", &save); (name != NULL) && (n < BENCH_MAX_LIST); name = strtok_r(NULL, ",", &save))
+    {
+        if (strcmp(name, "pipe") == 0)
+        {
+            syncs[n++] = false;
+        }
+        else if (strcmp(name, "sync") == 0)
+        {
+            syncs[n++] = true;
+        }
+        else
+        {
+            return 0U;
+        }
+    }
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    const bench_proto_t *protos[BENCH_MAX_LIST] = { &bench_protos[0], &bench_protos[2] };
+    double bauds[BENCH_MAX_LIST] = { 38400.0 };
+    double bers[BENCH_MAX_LIST] = { 0.0 };
+    double drops[BENCH_MAX_LIST] = { 0.0 };
+    const transport_t *links[BENCH_MAX_LIST] = { &transport_uart2 };
+    bool syncs[BENCH_MAX_LIST] = { false };
+    uint32_t n_protos = 2U, n_links = 1U, n_bauds = 1U, n_bers = 1U, n_drops = 1U, n_syncs = 1U;
+    bool cdc;
+    double line_bytes_per_s;
+    uint32_t size = sizeof(bench_image);
+    uint32_t runs = 1U;
+    uint32_t ack_timeout_ms = 10000U;
+    link_config_t config = { 38400U, 1000.0, 0.0, 0.0, 0.0, 0.0 };
+    double uart_error_rate = 0.0;
+    char flash_path[] = "/tmp/xfer_bench_XXXXXX";
+    bench_result_t result;
+    uint32_t p, k, f, b, e, d, r, i;
+    uint32_t seed = 1U;
+    uint32_t failures = 0U;
+    bool check = false;
+    int fd;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:T:b:l:j:e:d:n:r:t:s:u:HLR:f:zc")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p': n_protos = bench_parse_protos(optarg, protos); break;
+            case 'T': n_links = bench_parse_transports(optarg, links); break;
+            case 'b': n_bauds = bench_parse_list(optarg, bauds); break;
+            case 'l': config.latency_us = strtod(optarg, NULL) * 1000.0; break;
+            case 'j': config.jitter_us = strtod(optarg, NULL); break;
+            case 'e': n_bers = bench_parse_list(optarg, bers); break;
+            case 'd': n_drops = bench_parse_list(optarg, drops); break;
+            case 'n': size = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'r': runs = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 't': ack_timeout_ms = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 's': host_flash_scale = strtod(optarg, NULL); break;
+            case 'u': uart_error_rate = strtod(optarg, NULL); break;
+            case 'H': bench_header = true; break;
+            case 'L': bench_legacy = true; break;
+            case 'R': bench_interrupt = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'f': n_syncs = bench_parse_flash(optarg, syncs); break;
+            case 'z': bench_lzss = true; break;
+            case 'c': check = true; break;
+            default:
+                n_protos = 0U;
+                break;
+        }
+    }
+    if ((n_protos == 0U) || (n_links == 0U) || (n_bauds == 0U) || (n_bers == 0U) || (n_drops == 0U) || (n_syncs == 0U) || (size == 0U)
+        || (size > sizeof(bench_image)) || (runs == 0U) || ((bench_interrupt != 0U) && (!bench_header || bench_lzss)))
+    {
+        fprintf(stderr, "usage: %s [-p xmodem,xmodem-g,ymodem,ymodem-g,slwin] [-T uart,cdc] [-b bauds] [-l latency_ms] [-j jitter_us]\n"
+                        "       [-e bit_error_rates] [-d drop_rates] [-n size<=%u] [-r runs] [-t ack_timeout_ms] [-s flash_scale]\n"
+                        "       [-u uart_error_rate] [-H] [-L] [-R blocks] [-f pipe,sync] [-z] [-c]\n",
+                argv[0], (unsigned int)sizeof(bench_image));
+        return 2;
+    }
+
+    /* Flash simulée dans un fichier temporaire, supprimé dès sa projection */
+    fd = mkstemp(flash_path);
+    if (fd < 0)
+    {
+        perror(flash_path);
+        return 1;
+    }
+    (void)close(fd);
+    if (host_flash_open(flash_path) != 0)
+    {
+        (void)unlink(flash_path);
+        return 1;
+    }
+    (void)unlink(flash_path);
+
+    /* Image incompressible ou, avec -z, faite pour moitié de reprises de séquences
+       de 32 octets de la fenêtre LZSS ; le pointeur de pile en tête évite les
+       signatures LZSS et patch, suivi d'un vecteur de reset Thumb dans la zone application */
+    srand(12345);
+    for (i = 0U; i < sizeof(bench_image); i++)
+    {
+        bench_image[i] = (uint8_t)(rand() >> 7);
+    }
+    for (i = LZSS_WINDOW_SIZE; bench_lzss && (i < (sizeof(bench_image) - 32U)); i += 32U)
+    {
+        if ((rand() & 1) == 0)
+        {
+            (void)memmove(&bench_image[i], &bench_image[i - 32U - ((uint32_t)rand() % (LZSS_WINDOW_SIZE - 32U))], 32U);
+        }
+    }
+    bench_image[0] = 0x00U;
+    bench_image[1] = 0x80U;
+    bench_image[2] = 0x00U;
+    bench_image[3] = 0x20U;
+    bench_image[4] = 0x01U;
+    bench_image[5] = 0x02U;
+    bench_image[6] = 0x01U;
+    bench_image[7] = 0x08U;
+
+    printf("protocol,baud,latency_ms,jitter_us,ber,drop,size,seed,result,time_s,bytes_per_s,efficiency,"
+           "blocks,retries,naks,timeouts,corrupted,dropped,overruns,flash_busy_ms,transport,usb_naks,usb_nak_ms,boot,resumed,uart_errors,lost,flash\n");
+    for (p = 0U; p < n_protos; p++)
+    {
+        for (k = 0U; k < n_links; k++)
+        {
+            /* USB CDC : débit fixe, sans erreur de ligne, une seule combinaison */
+            cdc = (links[k] == &transport_cdc);
+            for (f = 0U; f < n_syncs; f++)
+            {
+                bench_sync = syncs[f];
+                for (b = 0U; b < (cdc ? 1U : n_bauds); b++)
+                {
+                    for (e = 0U; e < (cdc ? 1U : n_bers); e++)
+                    {
+                        for (d = 0U; d < (cdc ? 1U : n_drops); d++)
+                        {
+                            for (r = 0U; r < runs; r++, seed++)
+                            {
+                                config.baud = cdc ? 0U : (uint32_t)bauds[b];
+                                config.bit_error_rate = cdc ? 0.0 : bers[e];
+                                config.drop_rate = cdc ? 0.0 : drops[d];
+                                config.uart_error_rate = cdc ? 0.0 : uart_error_rate;
+                                line_bytes_per_s = cdc ? LINK_CDC_BYTES_PER_S : ((double)config.baud / 10.0);
+                                result = bench_run(protos[p], links[k], &config, size, seed, ack_timeout_ms);
+                                printf("%s,%u,%.3f,%.1f,%g,%g,%u,%u,%s,%.3f,%.0f,%.3f,%u,%u,%u,%u,%u,%u,%u,%.1f,%s,%u,%u,%u,%u,%u,%u,%s\n",
+                                       protos[p]->name, (unsigned int)config.baud, config.latency_us / 1000.0,
+                                       config.jitter_us, config.bit_error_rate, config.drop_rate, (unsigned int)size,
+                                       (unsigned int)seed, result.result, result.time_s,
+                                       result.bytes_per_s, result.bytes_per_s / line_bytes_per_s,
+                                       (unsigned int)tx.blocks_sent, (unsigned int)tx.retries, (unsigned int)tx.naks,
+                                       (unsigned int)tx.timeouts,
+                                       (unsigned int)(link_stats.to_target.corrupted + link_stats.to_host.corrupted),
+                                       (unsigned int)(link_stats.to_target.dropped + link_stats.to_host.dropped),
+                                       (unsigned int)link_stats.overruns, (double)host_flash_stats.busy_us / 1000.0,
+                                       cdc ? "cdc" : "uart", (unsigned int)v_cdc_rx_stats.naks,
+                                       (unsigned int)v_cdc_rx_stats.nak_frames, result.boot ? 1U : 0U,
+                                       (unsigned int)tx.resumed, (unsigned int)link_stats.uart_errors,
+                                       (unsigned int)link_stats.lost, bench_sync ? "sync" : "pipe");
+                                (void)fflush(stdout);
+                                if ((strcmp(result.result, "ok") != 0) || !result.boot
+                                    || ((bench_interrupt != 0U) && (tx.resumed == 0U)) || (link_stats.lost != 0U))
+                                {
+                                    failures++;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    host_flash_close();
+    if (check && (failures != 0U))
+    {
+        fprintf(stderr, "%s: %u measurement(s) not ok, not bootable, not resumed or losing bytes\n", argv[0], (unsigned int)failures);
+        return 1;
+    }
+    return 0;
+}
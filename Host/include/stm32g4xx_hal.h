@@ -0,0 +1,347 @@
+/**
+ * @file    stm32g4xx_hal.h
+ * @brief   HAL réduite de la cible hôte (voir Host/Makefile).
+ *
+ * Remplace les en-têtes HAL et CMSIS de ST pour compiler les sources du
+ * bootloader sur PC : seuls les types, registres et fonctions utilisés par
+ * les modules de Host/Makefile sont déclarés. Les périphériques sont simulés
+ * par Host/port (flash, USART2 sur pseudo-terminal, temps monotone) ; les
+ * registres sans effet sur l'hôte (RCC, NVIC, SysTick) sont de simples
+ * variables et les macros d'horloge ne font rien.
+ *
+ * USE_HAL_DRIVER n'est pas défini : crc.c utilise le calcul logiciel.
+ */
+
+#ifndef STM32G4XX_HAL_H
+#define STM32G4XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------------------------------------------------- */
+/*                              Cœur (CMSIS)                                 */
+/* ------------------------------------------------------------------------- */
+
+#define __IO        volatile
+#define __I         volatile const
+#define __RAM_FUNC
+
+/** Les interruptions du port (réception USART2) ne sont pas masquables. */
+#define __disable_irq()     ((void)0)
+#define __enable_irq()      ((void)0)
+#define __NOP()             ((void)0)
+/**
+ * Le fil de réception du port remplit la FIFO en parallèle. Fifo.c n'a besoin
+ * d'ordonner que lecture/lecture, lecture/écriture et écriture/écriture : barrière
+ * acquisition-libération (sans instruction sur x86, dmb ish sur ARM64).
+ */
+#define __DMB()             __atomic_thread_fence(__ATOMIC_ACQ_REL)
+
+/**
+ * @brief Chargement du pointeur de pile avant le saut vers l'application.
+ *
+ * Il n'y a pas d'application à lancer sur l'hôte : le port affiche le vecteur
+ * de l'application puis termine le processus (voir host_jump_to_application()).
+ */
+void host_jump_to_application(uint32_t stack_pointer);
+#define __set_MSP(sp)       host_jump_to_application(sp)
+
+typedef int IRQn_Type;
+
+typedef struct
+{
+    __IO uint32_t CTRL;
+    __IO uint32_t LOAD;
+    __IO uint32_t VAL;
+} SysTick_Type;
+
+typedef struct
+{
+    __IO uint32_t ISER[8];
+    __IO uint32_t ICER[8];
+    __IO uint32_t ISPR[8];
+    __IO uint32_t ICPR[8];
+} NVIC_Type;
+
+extern SysTick_Type host_systick;
+extern NVIC_Type host_nvic;
+#define SysTick     (&host_systick)
+#define NVIC        (&host_nvic)
+
+/* ------------------------------------------------------------------------- */
+/*                              Types HAL                                    */
+/* ------------------------------------------------------------------------- */
+
+typedef enum
+{
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY       0xFFFFFFFFU
+#define UNUSED(X)           (void)(X)
+
+/** Périphérique simulé, identifié par son adresse dans les handles. */
+typedef struct
+{
+    uint32_t id;
+} host_peripheral_t;
+
+typedef struct
+{
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct
+{
+    host_peripheral_t *Instance;
+    uint32_t counter;           /**< NDTR : transferts restants avant la fin du tampon */
+} DMA_HandleTypeDef;
+
+typedef struct
+{
+    host_peripheral_t *Instance;
+    UART_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmarx;
+} UART_HandleTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(__HANDLE__)   ((__HANDLE__)->counter)
+
+typedef struct
+{
+    host_peripheral_t *Instance;
+} TIM_HandleTypeDef;
+
+typedef struct
+{
+    host_peripheral_t *Instance;
+} LPTIM_HandleTypeDef;
+
+typedef struct
+{
+    host_peripheral_t *Instance;
+} ADC_HandleTypeDef;
+
+typedef struct
+{
+    host_peripheral_t *Instance;
+} I2C_HandleTypeDef;
+
+typedef struct
+{
+    host_peripheral_t *Instance;
+} OPAMP_HandleTypeDef;
+
+extern host_peripheral_t host_usart2;
+#define USART2      (&host_usart2)
+
+/* ------------------------------------------------------------------------- */
+/*                              HAL générale                                 */
+/* ------------------------------------------------------------------------- */
+
+HAL_StatusTypeDef HAL_Init(void);
+HAL_StatusTypeDef HAL_DeInit(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_SuspendTick(void);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+/* ------------------------------------------------------------------------- */
+/*                              RCC et PWR                                   */
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+    __IO uint32_t CR;
+    __IO uint32_t CFGR;
+    __IO uint32_t CIER;
+    __IO uint32_t CSR;
+} RCC_TypeDef;
+
+extern RCC_TypeDef host_rcc;
+#define RCC         (&host_rcc)
+
+#define RCC_CR_HSION        (0x00000100U)
+#define RCC_CR_HSIRDY       (0x00000400U)   /**< Toujours présent sur l'hôte */
+
+#define RCC_CSR_RMVF        (0x00800000U)
+#define RCC_CSR_OBLRSTF     (0x02000000U)
+#define RCC_CSR_PINRSTF     (0x04000000U)
+#define RCC_CSR_BORRSTF     (0x08000000U)
+#define RCC_CSR_SFTRSTF     (0x10000000U)
+#define RCC_CSR_IWDGRSTF    (0x20000000U)
+#define RCC_CSR_WWDGRSTF    (0x40000000U)
+#define RCC_CSR_LPWRRSTF    (0x80000000U)
+
+HAL_StatusTypeDef HAL_RCC_DeInit(void);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+void HAL_PWR_EnableBkUpAccess(void);
+void HAL_PWR_DisableBkUpAccess(void);
+
+/* Horloges et réinitialisations des périphériques : sans effet sur l'hôte */
+#define __HAL_RCC_PWR_CLK_ENABLE()          ((void)0)
+#define __HAL_RCC_RTCAPB_CLK_ENABLE()       ((void)0)
+#define __HAL_RCC_CRC_CLK_ENABLE()          ((void)0)
+#define __HAL_RCC_GPIOA_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_GPIOB_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_GPIOC_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_GPIOD_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_GPIOE_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_GPIOF_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_GPIOG_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_USART1_CLK_DISABLE()      ((void)0)
+#define __HAL_RCC_USART2_CLK_DISABLE()      ((void)0)
+#define __HAL_RCC_USART3_CLK_DISABLE()      ((void)0)
+#define __HAL_RCC_UART4_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_SPI1_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_SPI2_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_SPI3_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_I2C1_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_I2C2_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_I2C3_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_TIM1_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_TIM2_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_TIM3_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_TIM4_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_TIM6_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_TIM7_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_TIM8_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_TIM15_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_TIM16_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_TIM17_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_DAC1_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_FDCAN_CLK_DISABLE()       ((void)0)
+#define __HAL_RCC_USB_CLK_DISABLE()         ((void)0)
+#define __HAL_RCC_RNG_CLK_DISABLE()         ((void)0)
+#define __HAL_RCC_CRC_CLK_DISABLE()         ((void)0)
+#define __HAL_RCC_DMA1_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_DMA2_CLK_DISABLE()        ((void)0)
+#define __HAL_RCC_TIM1_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_TIM2_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_TIM3_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_TIM4_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_TIM6_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_TIM7_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_TIM8_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_TIM15_FORCE_RESET()       ((void)0)
+#define __HAL_RCC_TIM16_FORCE_RESET()       ((void)0)
+#define __HAL_RCC_TIM17_FORCE_RESET()       ((void)0)
+#define __HAL_RCC_TIM1_RELEASE_RESET()      ((void)0)
+#define __HAL_RCC_TIM2_RELEASE_RESET()      ((void)0)
+#define __HAL_RCC_TIM3_RELEASE_RESET()      ((void)0)
+#define __HAL_RCC_TIM4_RELEASE_RESET()      ((void)0)
+#define __HAL_RCC_TIM6_RELEASE_RESET()      ((void)0)
+#define __HAL_RCC_TIM7_RELEASE_RESET()      ((void)0)
+#define __HAL_RCC_TIM8_RELEASE_RESET()      ((void)0)
+#define __HAL_RCC_TIM15_RELEASE_RESET()     ((void)0)
+#define __HAL_RCC_TIM16_RELEASE_RESET()     ((void)0)
+#define __HAL_RCC_TIM17_RELEASE_RESET()     ((void)0)
+#define __HAL_RCC_AHB1_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_AHB1_RELEASE_RESET()      ((void)0)
+#define __HAL_RCC_APB1_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_APB1_RELEASE_RESET()      ((void)0)
+#define __HAL_RCC_APB2_FORCE_RESET()        ((void)0)
+#define __HAL_RCC_APB2_RELEASE_RESET()      ((void)0)
+
+/* ------------------------------------------------------------------------- */
+/*                              Registres de sauvegarde                      */
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+    __IO uint32_t BKP0R;
+    __IO uint32_t BKP1R;
+    __IO uint32_t BKP2R;
+    __IO uint32_t BKP3R;
+    __IO uint32_t BKP4R;
+    __IO uint32_t BKP5R;
+    __IO uint32_t BKP6R;
+    __IO uint32_t BKP7R;
+    __IO uint32_t BKP8R;
+    __IO uint32_t BKP9R;
+    __IO uint32_t BKP10R;
+    __IO uint32_t BKP11R;
+    __IO uint32_t BKP12R;
+    __IO uint32_t BKP13R;
+    __IO uint32_t BKP14R;
+    __IO uint32_t BKP15R;
+} TAMP_TypeDef;
+
+extern TAMP_TypeDef host_tamp;
+#define TAMP        (&host_tamp)
+
+/* ------------------------------------------------------------------------- */
+/*                              GPIO                                         */
+/* ------------------------------------------------------------------------- */
+
+typedef struct
+{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+extern host_peripheral_t host_gpio;
+#define GPIOA       (&host_gpio)
+#define GPIOB       (&host_gpio)
+#define GPIOC       (&host_gpio)
+#define GPIOD       (&host_gpio)
+#define GPIOE       (&host_gpio)
+#define GPIOF       (&host_gpio)
+#define GPIOG       (&host_gpio)
+
+#define GPIO_MODE_ANALOG    (0x00000003U)
+#define GPIO_NOPULL         (0x00000000U)
+
+void HAL_GPIO_Init(host_peripheral_t *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+
+/* ------------------------------------------------------------------------- */
+/*                              Flash                                        */
+/* ------------------------------------------------------------------------- */
+
+#define FLASH_BASE                      (0x08000000UL)
+#define FLASH_SIZE                      (0x20000UL)     /**< STM32G431KB : 128 ko */
+#define FLASH_PAGE_SIZE                 (0x800U)
+#define FLASH_BANK_1                    (0x00000001U)
+#define FLASH_TYPEERASE_PAGES           (0x00U)
+#define FLASH_TYPEPROGRAM_DOUBLEWORD    (0x00U)
+
+typedef struct
+{
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uint32_t Page;
+    uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+
+/* ------------------------------------------------------------------------- */
+/*                              UART                                         */
+/* ------------------------------------------------------------------------- */
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STM32G4XX_HAL_H */
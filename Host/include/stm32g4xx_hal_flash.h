@@ -0,0 +1,6 @@
+/**
+ * @file    stm32g4xx_hal_flash.h
+ * @brief   Cible hôte : tout est déclaré dans stm32g4xx_hal.h.
+ */
+
+#include "stm32g4xx_hal.h"
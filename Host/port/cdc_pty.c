@@ -0,0 +1,188 @@
+#include "port.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * @file cdc_pty.c
+ * @brief Port USB CDC de la cible hôte sur un second pseudo-terminal (remplace Rou_cdc.c).
+ *
+ * Le côté esclave (affiché au démarrage) joue le rôle du port /dev/ttyACM de la
+ * carte : même menu, mêmes récepteurs que l'USART2 (transport_cdc, voir
+ * transport.c). Le premier octet reçu sur l'un des deux terminaux choisit la
+ * liaison active, comme sur la cible.
+ *
+ * Réception : un fil d'exécution joue le rôle de l'endpoint OUT et de
+ * CDC_Receive_FS() (usbd_cdc_if.c). Les octets sont lus par paquets de
+ * HOST_CDC_PACKET_SIZE et déposés dans cdc_fifo en une copie, sans débit imposé :
+ * l'USB est bien plus rapide que les traitements du bootloader. Comme sur la
+ * cible, l'endpoint reste en NAK après un paquet si la FIFO ne peut pas recevoir
+ * le suivant, et n'est réarmé qu'à une trame (1 ms) où la place est revenue ; un
+ * paquet attend aussi la fin d'un blocage du CPU. Aucun octet n'est perdu.
+ *
+ * Émission : CDC_Send() écrit dans le pseudo-terminal et rend la main aussitôt,
+ * comme la file d'émission de Rou_cdc.c ; les compteurs de v_cdc_tx_stats sont tenus.
+ */
+
+#define HOST_CDC_PACKET_SIZE    (64U)   /**< Taille maximale d'un paquet bulk en full speed */
+
+static int cdc_master = -1;
+static int cdc_slave = -1;
+static pthread_t cdc_thread;
+static volatile bool cdc_running = false;
+
+/**
+ * @brief Fil de réception : pseudo-terminal vers cdc_fifo, un paquet à la fois.
+ */
+static void *cdc_rx_thread(void *arg)
+{
+    struct pollfd pfd;
+    uint8_t packet[HOST_CDC_PACKET_SIZE];
+    bool paused = false;
+    uint32_t now;
+    ssize_t n;
+
+    (void)arg;
+    pfd.fd = cdc_master;
+    pfd.events = POLLIN;
+    while (cdc_running)
+    {
+        if (paused)
+        {
+            /* NAK : le PC répète le paquet à chaque trame, CDC_RxResume() au SOF */
+            host_wait_us(1000.0);
+            v_cdc_rx_stats.nak_frames++;
+            paused = (fifo_free(&cdc_fifo) < HOST_CDC_PACKET_SIZE);
+            continue;
+        }
+        if (poll(&pfd, 1, 10) <= 0)
+        {
+            continue;
+        }
+        n = read(cdc_master, packet, sizeof(packet));
+        if (n <= 0)
+        {
+            continue;
+        }
+        /* Interruption USB différée pendant une opération flash */
+        while (cdc_running && host_stalled())
+        {
+            host_wait_us(100.0);
+        }
+        if (fifo_free(&cdc_fifo) < ((unsigned int)n + HOST_CDC_PACKET_SIZE))
+        {
+            paused = true;
+            v_cdc_rx_stats.naks++;
+        }
+        now = HAL_GetTick();
+        if (v_cdc_rx_stats.packets == 0U)
+        {
+            v_cdc_rx_stats.first_ms = now;
+        }
+        v_cdc_rx_stats.packets++;
+        v_cdc_rx_stats.last_ms = now;
+        v_cdc_rx_stats.bytes += fifo_in(&cdc_fifo, packet, (unsigned long)n);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Crée le pseudo-terminal du port USB CDC et lance le fil de réception.
+ *
+ * @return int 0 en cas de succès, -1 sinon.
+ */
+int host_cdc_open(void)
+{
+    struct termios tio;
+    const char *name;
+
+    cdc_master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if ((cdc_master < 0) || (grantpt(cdc_master) != 0) || (unlockpt(cdc_master) != 0)
+        || ((name = ptsname(cdc_master)) == NULL))
+    {
+        fprintf(stderr, "pty: %s\n", strerror(errno));
+        return -1;
+    }
+    /* Côté esclave gardé ouvert et en mode brut : le client peut se reconnecter */
+    cdc_slave = open(name, O_RDWR | O_NOCTTY);
+    if ((cdc_slave >= 0) && (tcgetattr(cdc_slave, &tio) == 0))
+    {
+        cfmakeraw(&tio);
+        (void)tcsetattr(cdc_slave, TCSANOW, &tio);
+    }
+
+    cdc_running = true;
+    if (pthread_create(&cdc_thread, NULL, cdc_rx_thread, NULL) != 0)
+    {
+        fprintf(stderr, "pty: cannot start the CDC receive thread\n");
+        return -1;
+    }
+    printf("USB CDC on %s\n", name);
+    (void)fflush(stdout);
+    return 0;
+}
+
+/**
+ * @brief Arrête le fil de réception et ferme le pseudo-terminal.
+ */
+void host_cdc_close(void)
+{
+    if (cdc_running)
+    {
+        cdc_running = false;
+        (void)pthread_join(cdc_thread, NULL);
+    }
+    if (cdc_slave >= 0)
+    {
+        (void)close(cdc_slave);
+        cdc_slave = -1;
+    }
+    if (cdc_master >= 0)
+    {
+        (void)close(cdc_master);
+        cdc_master = -1;
+    }
+}
+
+void CDC_Send(const uint8_t *data, uint32_t length)
+{
+    struct pollfd pfd;
+    uint32_t sent = 0U;
+    ssize_t n;
+
+    pfd.fd = cdc_master;
+    pfd.events = POLLOUT;
+    while (sent < length)
+    {
+        n = write(cdc_master, &data[sent], length - sent);
+        if (n > 0)
+        {
+            sent += (uint32_t)n;
+            v_cdc_tx_stats.transfers++;
+            v_cdc_tx_stats.bytes += (uint32_t)n;
+        }
+        else if ((n < 0) && (errno != EAGAIN))
+        {
+            return;
+        }
+        else if (poll(&pfd, 1, 50) <= 0)
+        {
+            v_cdc_tx_stats.waits++;
+            /* Port fermé côté PC : les octets sont perdus, comme sur la cible */
+            (void)tcflush(cdc_slave, TCIFLUSH);
+        }
+    }
+}
+
+int CDC_TxFlush(uint32_t timeout_ms)
+{
+    (void)timeout_ms;
+    return FIFO_OK;
+}
@@ -0,0 +1,75 @@
+#include "port.h"
+
+#include <time.h>
+
+/**
+ * @file clock_host.c
+ * @brief Temps de la cible hôte : horloge monotone du PC.
+ *
+ * HAL_GetTick() et get_time_us() comptent depuis HAL_Init(). Le banc de mesure
+ * (bench/) remplace ce fichier par une horloge simulée.
+ */
+
+static uint64_t time_origin_us = 0U;
+
+/**
+ * @brief Temps monotone en microsecondes.
+ */
+uint64_t host_time_us(void)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000U) + ((uint64_t)now.tv_nsec / 1000U);
+}
+
+/**
+ * @brief Attend une durée donnée, au microseconde près.
+ *
+ * Sommeil jusqu'à 100 µs de l'échéance, puis attente active : les temps de
+ * programmation d'un double mot (82 µs) sont plus courts que la résolution
+ * habituelle du sommeil.
+ */
+void host_wait_us(double duration_us)
+{
+    uint64_t deadline = host_time_us() + (uint64_t)duration_us;
+    uint64_t now = host_time_us();
+    struct timespec pause;
+
+    while (now < deadline)
+    {
+        if ((deadline - now) > 100U)
+        {
+            pause.tv_sec = (time_t)((deadline - now - 100U) / 1000000U);
+            pause.tv_nsec = (long)(((deadline - now - 100U) % 1000000U) * 1000U);
+            (void)nanosleep(&pause, NULL);
+        }
+        now = host_time_us();
+    }
+}
+
+/**
+ * @brief Origine des temps de HAL_GetTick() et get_time_us() (appelée par HAL_Init()).
+ */
+void host_clock_init(void)
+{
+    time_origin_us = host_time_us();
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)((host_time_us() - time_origin_us) / 1000U);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    host_wait_us((double)Delay * 1000.0);
+}
+
+/**
+ * @brief Compteur en microsecondes (TIM2 sur la cible, voir Anemo.c).
+ */
+uint32_t get_time_us(void)
+{
+    return (uint32_t)(host_time_us() - time_origin_us);
+}
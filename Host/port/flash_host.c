@@ -0,0 +1,275 @@
+#include "port.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @file flash_host.c
+ * @brief Flash simulée de la cible hôte : fichier projeté à l'adresse de la flash.
+ *
+ * Les 128 ko du fichier sont projetés en lecture seule à FLASH_BASE, de sorte que
+ * les lectures directes du bootloader (page de configuration, en-tête d'image,
+ * vérification) fonctionnent sans modification. Seules les fonctions HAL de ce
+ * fichier écrivent, avec les règles de la flash du STM32G431 :
+ *   - effacement par pages de 2 ko (0xFF) ;
+ *   - programmation d'un double mot ou d'une ligne uniquement sur une zone effacée
+ *     (un double mot à zéro est toujours accepté), flash déverrouillée ;
+ *   - durée typique de chaque opération, pendant laquelle le CPU est bloqué.
+ * Le fichier conserve le contenu d'une exécution à l'autre.
+ *
+ * Les mots de l'identifiant unique (UID_BASE, 0x1FFF7590) sont projetés de la
+ * même manière pour Read_UniqueID().
+ */
+
+#define HOST_UID_PAGE       (0x1FFF7000UL)
+#define HOST_UID_OFFSET     (0x590U)
+#define HOST_UID_PAGE_SIZE  (0x1000U)
+
+host_flash_stats_t host_flash_stats;
+double host_flash_scale = 1.0;
+
+static uint8_t *flash_memory = NULL;
+static int flash_fd = -1;
+static bool flash_locked = true;
+
+/**
+ * @brief Autorise ou interdit l'écriture dans la projection de la flash.
+ */
+static void flash_set_writable(bool writable)
+{
+    (void)mprotect(flash_memory, FLASH_SIZE, writable ? (PROT_READ | PROT_WRITE) : PROT_READ);
+}
+
+/**
+ * @brief Vérifie qu'une plage est entièrement dans la flash.
+ */
+static bool flash_in_range(uint32_t address, uint32_t length)
+{
+    return (address >= FLASH_BASE) && (length <= FLASH_SIZE) && ((address - FLASH_BASE) <= (FLASH_SIZE - length));
+}
+
+/**
+ * @brief Vérifie qu'une plage de la flash est effacée.
+ */
+static bool flash_is_erased(uint32_t address, uint32_t length)
+{
+    const uint8_t *p = &flash_memory[address - FLASH_BASE];
+    uint32_t i;
+
+    for (i = 0U; i < length; i++)
+    {
+        if (p[i] != 0xFFU)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Projette le fichier de flash (créé effacé s'il n'existe pas).
+ *
+ * @param[in] path Chemin du fichier.
+ * @return int 0 en cas de succès, -1 sinon (message sur stderr).
+ */
+int host_flash_open(const char *path)
+{
+    static uint8_t erased[FLASH_PAGE_SIZE];
+    static const uint32_t unique_id[3] = { 0x00300031UL, 0x484E5002UL, 0x20333144UL };
+    struct stat st;
+    uint8_t *uid_page;
+    uint32_t i;
+
+    flash_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if ((flash_fd < 0) || (fstat(flash_fd, &st) != 0))
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if ((uint32_t)st.st_size < FLASH_SIZE)
+    {
+        /* Fichier neuf ou tronqué : complété avec des pages effacées */
+        (void)memset(erased, 0xFF, sizeof(erased));
+        (void)lseek(flash_fd, 0, SEEK_END);
+        for (i = (uint32_t)st.st_size; i < FLASH_SIZE; i += (uint32_t)sizeof(erased))
+        {
+            if (write(flash_fd, erased, ((FLASH_SIZE - i) < sizeof(erased)) ? (FLASH_SIZE - i) : sizeof(erased)) < 0)
+            {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                return -1;
+            }
+        }
+    }
+
+    flash_memory = mmap((void *)FLASH_BASE, FLASH_SIZE, PROT_READ, MAP_SHARED | MAP_FIXED_NOREPLACE, flash_fd, 0);
+    if (flash_memory != (uint8_t *)FLASH_BASE)
+    {
+        fprintf(stderr, "flash: cannot map %s at 0x%08lX: %s\n", path, FLASH_BASE, strerror(errno));
+        return -1;
+    }
+
+    uid_page = mmap((void *)HOST_UID_PAGE, HOST_UID_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (uid_page != (uint8_t *)HOST_UID_PAGE)
+    {
+        fprintf(stderr, "flash: cannot map the unique ID at 0x%08lX: %s\n", HOST_UID_PAGE, strerror(errno));
+        return -1;
+    }
+    (void)memcpy(&uid_page[HOST_UID_OFFSET], unique_id, sizeof(unique_id));
+    (void)mprotect(uid_page, HOST_UID_PAGE_SIZE, PROT_READ);
+    return 0;
+}
+
+/**
+ * @brief Écrit le contenu de la flash dans le fichier et libère la projection.
+ */
+void host_flash_close(void)
+{
+    if (flash_memory != NULL)
+    {
+        (void)msync(flash_memory, FLASH_SIZE, MS_SYNC);
+        (void)munmap(flash_memory, FLASH_SIZE);
+        flash_memory = NULL;
+    }
+    if (flash_fd >= 0)
+    {
+        (void)close(flash_fd);
+        flash_fd = -1;
+    }
+}
+
+/**
+ * @brief Efface toute la flash sans délai (état initial d'une mesure, voir bench/).
+ */
+void host_flash_format(void)
+{
+    flash_set_writable(true);
+    (void)memset(flash_memory, 0xFF, FLASH_SIZE);
+    flash_set_writable(false);
+}
+
+/**
+ * @brief Charge un contenu en flash sans délai, comme une programmation par SWD (voir bench/).
+ *
+ * @param[in] address Adresse de destination dans la flash.
+ * @param[in] data    Contenu à charger.
+ * @param[in] length  Nombre d'octets.
+ */
+void host_flash_load(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    flash_set_writable(true);
+    (void)memcpy(&flash_memory[address - FLASH_BASE], data, length);
+    flash_set_writable(false);
+}
+
+/**
+ * @brief Bloque le CPU pendant une opération flash de durée modélisée.
+ */
+static void flash_busy(double duration_us)
+{
+    host_flash_stats.busy_us += (uint64_t)duration_us;
+    host_stall_begin();
+    host_wait_us(duration_us * host_flash_scale);
+    host_stall_end();
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    flash_locked = false;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    flash_locked = true;
+    return HAL_OK;
+}
+
+/**
+ * @brief Programme un double mot (seul type utilisé par le bootloader).
+ */
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+    uint8_t *p;
+    uint8_t bytes[8];
+    uint32_t i;
+
+    if ((TypeProgram != FLASH_TYPEPROGRAM_DOUBLEWORD) || flash_locked || ((Address & 7U) != 0U)
+        || !flash_in_range(Address, 8U))
+    {
+        host_flash_stats.faults++;
+        return HAL_ERROR;
+    }
+    /* PROGERR : double mot déjà programmé, sauf écriture de zéros */
+    if ((Data != 0U) && !flash_is_erased(Address, 8U))
+    {
+        host_flash_stats.faults++;
+        return HAL_ERROR;
+    }
+
+    (void)memcpy(bytes, &Data, sizeof(bytes));
+    p = &flash_memory[Address - FLASH_BASE];
+    flash_set_writable(true);
+    for (i = 0U; i < 8U; i++)
+    {
+        p[i] &= bytes[i];
+    }
+    flash_set_writable(false);
+    host_flash_stats.dwords++;
+    flash_busy(HOST_FLASH_PROG_DWORD_US);
+    return HAL_OK;
+}
+
+/**
+ * @brief Efface une suite de pages de la banque 1.
+ */
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+    uint32_t address = FLASH_BASE + (pEraseInit->Page * FLASH_PAGE_SIZE);
+    uint32_t length = pEraseInit->NbPages * FLASH_PAGE_SIZE;
+
+    *PageError = 0xFFFFFFFFU;
+    if ((pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES) || flash_locked || (pEraseInit->NbPages == 0U)
+        || !flash_in_range(address, length))
+    {
+        *PageError = pEraseInit->Page;
+        host_flash_stats.faults++;
+        return HAL_ERROR;
+    }
+
+    flash_set_writable(true);
+    (void)memset(&flash_memory[address - FLASH_BASE], 0xFF, length);
+    flash_set_writable(false);
+    host_flash_stats.erases += pEraseInit->NbPages;
+    flash_busy(HOST_FLASH_ERASE_PAGE_US * (double)pEraseInit->NbPages);
+    return HAL_OK;
+}
+
+/**
+ * @brief Programme une ligne en mode rapide (remplace flash_fast.c).
+ *
+ * @param[in] address Adresse de la ligne (alignée sur FLASH_ROW_SIZE).
+ * @param[in] row     Données.
+ * @return int 0 en cas de succès, -1 si la ligne n'est pas effacée ou la flash verrouillée.
+ */
+int flash_fast_program_row(uint32_t address, const uint32_t *row)
+{
+    if (flash_locked || ((address % FLASH_ROW_SIZE) != 0U) || !flash_in_range(address, FLASH_ROW_SIZE)
+        || !flash_is_erased(address, FLASH_ROW_SIZE))
+    {
+        host_flash_stats.faults++;
+        return -1;
+    }
+
+    flash_set_writable(true);
+    (void)memcpy(&flash_memory[address - FLASH_BASE], row, FLASH_ROW_SIZE);
+    flash_set_writable(false);
+    host_flash_stats.rows++;
+    flash_busy(HOST_FLASH_PROG_ROW_US);
+    return 0;
+}
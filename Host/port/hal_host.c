@@ -0,0 +1,131 @@
+#include "port.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @file hal_host.c
+ * @brief Registres système et fonctions de la carte pour la cible hôte.
+ *
+ * Le temps est fourni par clock_host.c (horloge du PC) ou, pour le banc de
+ * mesure, par bench/link_sim.c (horloge simulée). Les registres
+ * RCC, TAMP, NVIC et SysTick sont des variables : la boîte aux lettres de
+ * handoff.c est conservée pendant l'exécution, comme après une réinitialisation
+ * système, et perdue à la fin du processus, comme à la coupure d'alimentation.
+ */
+
+SysTick_Type host_systick;
+NVIC_Type host_nvic;
+TAMP_TypeDef host_tamp;
+RCC_TypeDef host_rcc = { RCC_CR_HSIRDY, 0U, 0U, RCC_CSR_PINRSTF | RCC_CSR_BORRSTF };
+host_peripheral_t host_usart2 = { 2U };
+host_peripheral_t host_gpio = { 0U };
+
+/** Profondeur des blocages du CPU par la flash (voir host_stall_begin()). */
+static int stall_depth = 0;
+
+/**
+ * @brief Début d'une opération qui bloque le CPU (flash à une seule banque).
+ *
+ * Tant que le CPU est bloqué, les interruptions de réception de l'USART2 ne sont
+ * pas servies ; le DMA continue de remplir son tampon circulaire.
+ */
+void host_stall_begin(void)
+{
+    __atomic_add_fetch(&stall_depth, 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Fin d'une opération bloquante : les interruptions en attente sont servies.
+ */
+void host_stall_end(void)
+{
+    if (__atomic_sub_fetch(&stall_depth, 1, __ATOMIC_SEQ_CST) == 0)
+    {
+        host_uart_service();
+    }
+}
+
+/**
+ * @brief Indique si le CPU est bloqué par une opération flash.
+ */
+bool host_stalled(void)
+{
+    return __atomic_load_n(&stall_depth, __ATOMIC_SEQ_CST) != 0;
+}
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+    host_clock_init();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DeInit(void)
+{
+    return HAL_OK;
+}
+
+void HAL_SuspendTick(void)
+{
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    (void)IRQn;
+}
+
+HAL_StatusTypeDef HAL_RCC_DeInit(void)
+{
+    return HAL_OK;
+}
+
+/**
+ * @brief Fréquence de SystemClock_Config() (PLL à 170 MHz).
+ */
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+    return 170000000U;
+}
+
+void HAL_PWR_EnableBkUpAccess(void)
+{
+}
+
+void HAL_PWR_DisableBkUpAccess(void)
+{
+}
+
+void HAL_GPIO_Init(host_peripheral_t *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    (void)GPIOx;
+    (void)GPIO_Init;
+}
+
+/**
+ * @brief Température du capteur TMP1075 (valeur fixe sur l'hôte).
+ */
+float TMP1075_ReadTemperature(void)
+{
+    return 21.5f;
+}
+
+void Error_Handler(void)
+{
+    fprintf(stderr, "Error_Handler\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Saut vers l'application : affiche le vecteur de réinitialisation et termine.
+ *
+ * @param[in] stack_pointer Pointeur de pile initial lu dans la table des vecteurs.
+ */
+void host_jump_to_application(uint32_t stack_pointer)
+{
+    printf("jump to application: SP 0x%08X, Reset_Handler 0x%08X, mailbox flags 0x%04X\n",
+           (unsigned int)stack_pointer, (unsigned int)*(const uint32_t *)(APPLICATION_ADDRESS + 4U),
+           (unsigned int)(TAMP->BKP12R >> 16));
+    host_uart_close();
+    host_flash_close();
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,167 @@
+#include "port.h"
+#include "ymodem.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @file host_main.c
+ * @brief Programme principal de la cible hôte : démarrage du bootloader comme main.c.
+ *
+ * Utilisation :
+ *     bootloader_host [-f flash.bin] [-b bauds] [-s facteur] [-a] [-m] [-y] [-t uart|cdc]
+ *
+ *   -f : fichier de la flash simulée (flash.bin), conservé entre deux exécutions ;
+ *   -b : débit de l'USART2 simulée (38400, comme usart.c), rétabli en attente
+ *        d'une session ;
+ *   -s : facteur appliqué aux temps d'effacement et de programmation (1 ; 0 pour
+ *        une flash sans attente) ;
+ *   -a : pas de tension USB, lancement direct de l'application si l'image est valide ;
+ *   -m : entrée immédiate dans le menu, sans attendre l'espace (0x00 : commandes
+ *        binaires de Tools/prov_tool.c) ;
+ *   -y : réception YMODEM (ymodem.c) au lieu du menu, pour sb de lrzsz ;
+ *   -t : liaison de -m et -y (uart par défaut ; cdc : port USB CDC).
+ *
+ * Deux pseudo-terminaux sont créés : l'USART2 (uart_pty.c) et le port USB CDC
+ * (cdc_pty.c). Sans -m ni -y, la liaison qui reçoit le premier octet devient
+ * active, comme sur la cible (transport_wait_first()).
+ *
+ * Les statistiques de la flash, de la réception et du pipeline d'écriture sont
+ * affichées à la sortie (Ctrl-C ou saut vers l'application).
+ */
+
+/**
+ * @brief Affiche les compteurs de la simulation.
+ */
+static void host_report(void)
+{
+    uint32_t cdc_ms = v_cdc_rx_stats.last_ms - v_cdc_rx_stats.first_ms;
+
+    printf("\nflash: %u pages erased, %u dwords, %u fast rows, %u faults, busy %.1f ms\n",
+           (unsigned int)host_flash_stats.erases, (unsigned int)host_flash_stats.dwords,
+           (unsigned int)host_flash_stats.rows, (unsigned int)host_flash_stats.faults,
+           (double)host_flash_stats.busy_us / 1000.0);
+    printf("usart2: %u bytes, %u events, %u dropped, %u errors\n",
+           (unsigned int)v_uart2_rx_stats.bytes, (unsigned int)v_uart2_rx_stats.events,
+           (unsigned int)v_uart2_rx_stats.dropped, (unsigned int)v_uart2_rx_stats.errors);
+    printf("cdc: %u bytes, %u packets, %u naks (%u ms), %.1f kB/s sustained\n",
+           (unsigned int)v_cdc_rx_stats.bytes, (unsigned int)v_cdc_rx_stats.packets,
+           (unsigned int)v_cdc_rx_stats.naks, (unsigned int)v_cdc_rx_stats.nak_frames,
+           (cdc_ms != 0U) ? ((double)v_cdc_rx_stats.bytes / (double)cdc_ms) : 0.0);
+    printf("cdc_tx: %u bytes, %u writes, %u waits\n",
+           (unsigned int)v_cdc_tx_stats.bytes, (unsigned int)v_cdc_tx_stats.transfers,
+           (unsigned int)v_cdc_tx_stats.waits);
+    printf("flash_pipe: %u pages, erase %u ms, program %u ms, verify %u ms, stall %u ms, %u blank rows\n",
+           (unsigned int)v_flash_pipe_stats.pages, (unsigned int)(v_flash_pipe_stats.erase_us / 1000U),
+           (unsigned int)(v_flash_pipe_stats.program_us / 1000U), (unsigned int)(v_flash_pipe_stats.verify_us / 1000U),
+           (unsigned int)(v_flash_pipe_stats.stall_us / 1000U), (unsigned int)v_flash_pipe_stats.blank_rows);
+    printf("menu: %u redraws, %u lines, %u bytes (last %u, max %u per redraw)\n",
+           (unsigned int)v_menu_stats.redraws, (unsigned int)v_menu_stats.lines, (unsigned int)v_menu_stats.bytes,
+           (unsigned int)v_menu_stats.last_bytes, (unsigned int)v_menu_stats.max_bytes);
+}
+
+static void host_exit(void)
+{
+    host_report();
+    host_cdc_close();
+    host_uart_close();
+    host_flash_close();
+}
+
+static void host_signal(int sig)
+{
+    (void)sig;
+    exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char **argv)
+{
+    const char *flash_path = "flash.bin";
+    uint32_t baud = 38400U;
+    bool usb_present = true;
+    bool menu_now = false;
+    bool ymodem = false;
+    const transport_t *link;
+    uint8_t received_char;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:b:s:amyt:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f': flash_path = optarg; break;
+            case 'b': baud = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 's': host_flash_scale = strtod(optarg, NULL); break;
+            case 'a': usb_present = false; break;
+            case 'm': menu_now = true; break;
+            case 'y': ymodem = true; break;
+            case 't': v_transport = (strcmp(optarg, "cdc") == 0) ? &transport_cdc : &transport_uart2; break;
+            default:
+                fprintf(stderr, "usage: %s [-f flash.bin] [-b baud] [-s scale] [-a] [-m] [-y] [-t uart|cdc]\n", argv[0]);
+                return 2;
+        }
+    }
+    if ((baud == 0U) || (host_flash_open(flash_path) != 0))
+    {
+        return 1;
+    }
+    (void)atexit(host_exit);
+    (void)signal(SIGINT, host_signal);
+    (void)signal(SIGTERM, host_signal);
+
+    HAL_Init();
+    handoff_init();
+    kvlog_init();
+    Config_Init();
+    v_ADC1_IN10 = usb_present ? 5.0f : 0.0f;
+
+    /* Sans USB et sans demande de l'application : lancement direct, comme main.c */
+    if ((v_ADC1_IN10 < 4.5) && !handoff_bootloader_requested())
+    {
+        if (image_check() == IMAGE_OK)
+        {
+            Bootloader_JumpToApplication();
+        }
+        printf("no valid image\n");
+        return 1;
+    }
+
+    fifo_init(&usart2_fifo);
+    fifo_init(&cdc_fifo);
+    if ((host_uart_open(baud, &usart2_fifo) != 0) || (host_cdc_open() != 0))
+    {
+        return 1;
+    }
+    UART2_Init();
+    if (ymodem)
+    {
+        printf("YMODEM: %s\n", (YMODEM_Receive(v_transport, 0U, flash_write_callback) == 0) ? "complete" : "failed");
+        return 0;
+    }
+    if (menu_now)
+    {
+        Bootloader_Menu();
+    }
+    UART2_AutoBaudArm();
+    while (1)
+    {
+        link = transport_wait_first(BOOTLOADER_WAIT_TIME_MS, &received_char);
+        (void)UART2_AutoBaudResult();
+        if (link != NULL)
+        {
+            if (received_char == ' ')
+            {
+                Bootloader_Menu();
+            }
+            else if (received_char == 0x00U)
+            {
+                (void)prov_session(link);
+                UART2_AutoBaudArm();
+            }
+        }
+    }
+    return 0;
+}
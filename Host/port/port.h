@@ -0,0 +1,63 @@
+/**
+ * @file    port.h
+ * @brief   Couche de portage de la cible hôte (voir Host/Makefile).
+ *
+ * La flash est un fichier projeté à son adresse réelle (0x08000000), l'USART2 et
+ * le port USB CDC des pseudo-terminaux et le temps l'horloge monotone du PC. Les
+ * durées d'effacement et de programmation de la flash sont reproduites par attente active : pendant
+ * ces attentes, le CPU de la cible est considéré comme bloqué (flash à une seule
+ * banque) et les interruptions de réception de l'USART2 sont différées.
+ */
+
+#ifndef HOST_PORT_H
+#define HOST_PORT_H
+
+#include <stdint.h>
+#include "inc.h"
+
+/* Temps typiques de la flash du STM32G431 (DS12589), en microsecondes */
+#define HOST_FLASH_ERASE_PAGE_US    (22020.0)
+#define HOST_FLASH_PROG_DWORD_US    (81.69)
+#define HOST_FLASH_PROG_ROW_US      (1910.0)
+
+/**
+ * @brief Compteurs de la flash simulée.
+ */
+typedef struct
+{
+    uint32_t erases;        /**< Pages effacées. */
+    uint32_t dwords;        /**< Doubles mots programmés. */
+    uint32_t rows;          /**< Lignes programmées en mode rapide. */
+    uint32_t faults;        /**< Programmations refusées (zone non effacée, flash verrouillée). */
+    uint64_t busy_us;       /**< Temps modélisé d'occupation de la flash. */
+} host_flash_stats_t;
+
+extern host_flash_stats_t host_flash_stats;
+extern double host_flash_scale;     /**< Facteur appliqué aux temps de la flash (0 : sans attente) */
+
+/* clock_host.c (bench/link_sim.c pour le banc de mesure) */
+uint64_t host_time_us(void);
+void host_wait_us(double duration_us);
+void host_clock_init(void);
+
+/* hal_host.c */
+void host_stall_begin(void);
+void host_stall_end(void);
+bool host_stalled(void);
+
+/* flash_host.c */
+int host_flash_open(const char *path);
+void host_flash_close(void);
+void host_flash_format(void);
+void host_flash_load(uint32_t address, const uint8_t *data, uint32_t length);
+
+/* uart_pty.c */
+int host_uart_open(uint32_t baud, fifo_t *fifo);
+void host_uart_close(void);
+void host_uart_service(void);
+
+/* cdc_pty.c */
+int host_cdc_open(void);
+void host_cdc_close(void);
+
+#endif /* HOST_PORT_H */
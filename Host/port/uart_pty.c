@@ -0,0 +1,478 @@
+#include "port.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * @file uart_pty.c
+ * @brief USART2 de la cible hôte sur un pseudo-terminal (remplace usart.c et rou.c).
+ *
+ * Le côté esclave du pseudo-terminal (affiché au démarrage) s'utilise comme le
+ * port série de la carte : minicom pour le menu, sx/sb de lrzsz pour les transferts.
+ *
+ * Réception : un fil d'exécution joue le rôle du DMA circulaire. Il dépose les
+ * octets dans uart2_rx_dma_buffer au débit de la liaison (10 bits par octet) et
+ * publie les plages dans la FIFO sur demi-tampon, tampon complet et ligne
+ * inactive, comme HAL_UARTEx_RxEventCallback(). Si le CPU est bloqué par une
+ * opération flash, la publication attend la fin du blocage ; un octet reçu
+ * alors que le tampon DMA est plein de données non publiées est perdu et compté
+ * dans v_uart2_rx_stats.dropped (débordement du DMA sur la cible).
+ *
+ * Débit : celui du côté esclave (termios, réglé par le client) représente le PC.
+ * S'il diffère du débit de l'USART, les octets reçus sont perdus et comptés dans
+ * v_uart2_rx_stats.errors (erreur de trame). La détection automatique
+ * (UART2_AutoBaudArm()) adopte le débit du client si le premier octet est
+ * UART2_AUTOBAUD_SYNC ; tout autre premier octet est perdu, comme sur la cible.
+ *
+ * Émission : HAL_UART_Transmit_DMA() (file d'émission de rou.c) écrit dans le
+ * pseudo-terminal et termine le transfert aussitôt.
+ */
+
+static int uart_master = -1;
+static int uart_slave = -1;
+static uint32_t uart_baud = 38400U;
+static uint32_t uart_default_baud = 38400U;  /**< Débit de host_uart_open(), rétabli par UART2_AutoBaudArm() */
+static double uart_byte_us = 260.4;
+static fifo_t *uart_fifo = NULL;
+static pthread_t uart_thread;
+static pthread_mutex_t uart_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool uart_running = false;
+
+/* État du DMA simulé (protégé par uart_lock) */
+static bool dma_enabled = false;
+static uint16_t dma_write = 0U;         /**< Position d'écriture du DMA */
+static uint16_t dma_unpublished = 0U;   /**< Octets déposés non encore publiés dans la FIFO */
+static bool dma_event = false;          /**< Évènement en attente de la fin du blocage du CPU */
+
+/* Détection automatique du débit (protégée par uart_lock) */
+static bool abr_armed = false;
+static int abr_state = 0;               /**< 0 : en attente du premier octet, 1 : mesuré, -1 : échec */
+
+/** Débits termios reconnus pour le côté esclave */
+static const struct
+{
+    speed_t speed;
+    uint32_t baud;
+} uart_speeds[] = {
+    { B9600, 9600U }, { B19200, 19200U }, { B38400, 38400U }, { B57600, 57600U },
+    { B115200, 115200U }, { B230400, 230400U }, { B460800, 460800U }, { B500000, 500000U },
+    { B921600, 921600U }, { B1000000, 1000000U }, { B1500000, 1500000U }, { B2000000, 2000000U },
+    { B2500000, 2500000U }, { B3000000, 3000000U }
+};
+
+/**
+ * @brief Débit réglé par le client sur le côté esclave, 0 s'il n'est pas reconnu.
+ */
+static uint32_t uart_line_baud(void)
+{
+    struct termios tio;
+    speed_t speed;
+    size_t i;
+
+    if ((uart_slave < 0) || (tcgetattr(uart_slave, &tio) != 0))
+    {
+        return 0U;
+    }
+    speed = cfgetospeed(&tio);
+    for (i = 0U; i < (sizeof(uart_speeds) / sizeof(uart_speeds[0])); i++)
+    {
+        if (uart_speeds[i].speed == speed)
+        {
+            return uart_speeds[i].baud;
+        }
+    }
+    return 0U;
+}
+
+/**
+ * @brief Applique un débit à l'USART simulée et vide la réception.
+ */
+static void uart_apply_baud(uint32_t baud, bool autobaud)
+{
+    (void)pthread_mutex_lock(&uart_lock);
+    uart_baud = baud;
+    uart_byte_us = 10.0e6 / (double)baud;
+    hUART2.Init.BaudRate = baud;
+    abr_armed = autobaud;
+    abr_state = 0;
+    uart2_rx_dma_position = 0U;
+    dma_write = 0U;
+    dma_unpublished = 0U;
+    dma_event = false;
+    fifo_reset(uart_fifo);
+    (void)pthread_mutex_unlock(&uart_lock);
+}
+
+/**
+ * @brief Publie les octets déposés par le DMA (HAL_UARTEx_RxEventCallback()).
+ *
+ * Appelée avec uart_lock pris, par le fil de réception ou à la fin d'un blocage.
+ */
+static void uart_rx_event(void)
+{
+    uint32_t length;
+    uint32_t first;
+    unsigned int copied;
+
+    dma_event = false;
+    if (dma_unpublished == 0U)
+    {
+        return;
+    }
+    v_uart2_rx_stats.events++;
+    length = dma_unpublished;
+    first = UART2_RX_DMA_BUFFER_SIZE - uart2_rx_dma_position;
+    if (first > length)
+    {
+        first = length;
+    }
+    copied = fifo_in(uart_fifo, &uart2_rx_dma_buffer[uart2_rx_dma_position], first);
+    if (length > first)
+    {
+        copied += fifo_in(uart_fifo, &uart2_rx_dma_buffer[0], length - first);
+    }
+    v_uart2_rx_stats.bytes += copied;
+    v_uart2_rx_stats.dropped += length - copied;
+    uart2_rx_dma_position = (uint16_t)((uart2_rx_dma_position + length) % UART2_RX_DMA_BUFFER_SIZE);
+    dma_unpublished = 0U;
+}
+
+/**
+ * @brief Déclenche l'interruption de réception, ou la diffère si le CPU est bloqué.
+ */
+static void uart_raise_event(void)
+{
+    if (host_stalled())
+    {
+        dma_event = true;
+    }
+    else
+    {
+        uart_rx_event();
+    }
+}
+
+/**
+ * @brief Sert l'interruption de réception différée pendant un blocage du CPU.
+ */
+void host_uart_service(void)
+{
+    (void)pthread_mutex_lock(&uart_lock);
+    if (dma_event)
+    {
+        uart_rx_event();
+    }
+    (void)pthread_mutex_unlock(&uart_lock);
+}
+
+/**
+ * @brief Dépose un octet dans le tampon circulaire du DMA.
+ *
+ * @param[in] byte Octet reçu.
+ * @param[in] line Débit du client, 0 s'il n'est pas connu (pas de contrôle).
+ */
+static void uart_dma_store(uint8_t byte, uint32_t line)
+{
+    (void)pthread_mutex_lock(&uart_lock);
+    if (abr_armed && (abr_state == 0))
+    {
+        /* Premier octet mesuré : seul UART2_AUTOBAUD_SYNC donne un débit valide */
+        if ((byte == UART2_AUTOBAUD_SYNC) && (line >= UART2_BAUD_MIN) && (line <= UART2_BAUD_MAX))
+        {
+            uart_baud = line;
+            uart_byte_us = 10.0e6 / (double)line;
+            abr_state = 1;
+        }
+        else
+        {
+            abr_state = -1;
+            v_uart2_rx_stats.errors++;
+            (void)pthread_mutex_unlock(&uart_lock);
+            return;
+        }
+    }
+    if ((line != 0U) && (line != uart_baud))
+    {
+        /* Débits différents aux deux extrémités : erreur de trame */
+        v_uart2_rx_stats.errors++;
+    }
+    else if (dma_unpublished >= UART2_RX_DMA_BUFFER_SIZE)
+    {
+        /* Débordement : l'interruption n'a pas été servie à temps */
+        v_uart2_rx_stats.dropped++;
+    }
+    else
+    {
+        uart2_rx_dma_buffer[dma_write] = byte;
+        dma_write = (uint16_t)((dma_write + 1U) % UART2_RX_DMA_BUFFER_SIZE);
+        dma_unpublished++;
+        if ((dma_write == 0U) || (dma_write == (UART2_RX_DMA_BUFFER_SIZE / 2U)))
+        {
+            uart_raise_event();
+        }
+    }
+    (void)pthread_mutex_unlock(&uart_lock);
+}
+
+/**
+ * @brief Fil de réception : pseudo-terminal vers DMA, au débit de la liaison.
+ */
+static void *uart_rx_thread(void *arg)
+{
+    struct pollfd pfd;
+    uint8_t buf[64];
+    double due = 0.0;
+    double now;
+    ssize_t n;
+    ssize_t i;
+    uint32_t line;
+    int idle_ms = (int)((uart_byte_us * 3.0) / 1000.0) + 1;
+
+    (void)arg;
+    pfd.fd = uart_master;
+    pfd.events = POLLIN;
+    while (uart_running)
+    {
+        if (!dma_enabled || (poll(&pfd, 1, idle_ms) <= 0))
+        {
+            /* Ligne inactive */
+            (void)pthread_mutex_lock(&uart_lock);
+            if (dma_unpublished > 0U)
+            {
+                uart_raise_event();
+            }
+            (void)pthread_mutex_unlock(&uart_lock);
+            if (!dma_enabled)
+            {
+                host_wait_us(1000.0);
+            }
+            continue;
+        }
+        n = read(uart_master, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            continue;
+        }
+        line = uart_line_baud();
+        for (i = 0; i < n; i++)
+        {
+            now = (double)host_time_us();
+            if (due < now)
+            {
+                due = now;
+            }
+            due += uart_byte_us;
+            if (due > now)
+            {
+                host_wait_us(due - now);
+            }
+            uart_dma_store(buf[i], line);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Crée le pseudo-terminal de l'USART2 et lance le fil de réception.
+ *
+ * @param[in] baud Débit simulé de la liaison.
+ * @param[in] fifo FIFO alimentée par la réception (usart2_fifo).
+ * @return int 0 en cas de succès, -1 sinon.
+ */
+int host_uart_open(uint32_t baud, fifo_t *fifo)
+{
+    struct termios tio;
+    const char *name;
+    size_t i;
+
+    uart_master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if ((uart_master < 0) || (grantpt(uart_master) != 0) || (unlockpt(uart_master) != 0)
+        || ((name = ptsname(uart_master)) == NULL))
+    {
+        fprintf(stderr, "pty: %s\n", strerror(errno));
+        return -1;
+    }
+    /* Côté esclave gardé ouvert et en mode brut : le client peut se reconnecter */
+    uart_slave = open(name, O_RDWR | O_NOCTTY);
+    if ((uart_slave >= 0) && (tcgetattr(uart_slave, &tio) == 0))
+    {
+        /* Débit initial du client : celui de l'USART, pour sx/sb qui ne le règlent pas */
+        cfmakeraw(&tio);
+        for (i = 0U; i < (sizeof(uart_speeds) / sizeof(uart_speeds[0])); i++)
+        {
+            if (uart_speeds[i].baud == baud)
+            {
+                (void)cfsetspeed(&tio, uart_speeds[i].speed);
+            }
+        }
+        (void)tcsetattr(uart_slave, TCSANOW, &tio);
+    }
+
+    uart_baud = baud;
+    uart_default_baud = baud;
+    uart_byte_us = 10.0e6 / (double)baud;
+    uart_fifo = fifo;
+    uart_running = true;
+    if (pthread_create(&uart_thread, NULL, uart_rx_thread, NULL) != 0)
+    {
+        fprintf(stderr, "pty: cannot start the receive thread\n");
+        return -1;
+    }
+    printf("USART2 on %s (%u baud)\n", name, (unsigned int)baud);
+    (void)fflush(stdout);
+    return 0;
+}
+
+/**
+ * @brief Arrête le fil de réception et ferme le pseudo-terminal.
+ */
+void host_uart_close(void)
+{
+    if (uart_running)
+    {
+        uart_running = false;
+        (void)pthread_join(uart_thread, NULL);
+    }
+    if (uart_slave >= 0)
+    {
+        (void)close(uart_slave);
+        uart_slave = -1;
+    }
+    if (uart_master >= 0)
+    {
+        (void)close(uart_master);
+        uart_master = -1;
+    }
+}
+
+void UART2_Init(void)
+{
+    hUART2.Instance = USART2;
+    hUART2.Init.BaudRate = uart_baud;
+    hUART2.hdmarx = &hdma_usart2_rx;
+    UART2_TxReset();
+    UART2_StartReceiveDMA();
+}
+
+void UART2_StartReceiveDMA(void)
+{
+    (void)pthread_mutex_lock(&uart_lock);
+    uart2_rx_dma_position = 0U;
+    dma_write = 0U;
+    dma_unpublished = 0U;
+    dma_event = false;
+    dma_enabled = true;
+    (void)pthread_mutex_unlock(&uart_lock);
+}
+
+/**
+ * @brief Arrêt de la réception DMA : NDTR est figé à la position d'écriture.
+ */
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    (void)pthread_mutex_lock(&uart_lock);
+    dma_enabled = false;
+    dma_event = false;
+    huart->hdmarx->counter = UART2_RX_DMA_BUFFER_SIZE - dma_write;
+    (void)pthread_mutex_unlock(&uart_lock);
+    return HAL_OK;
+}
+
+uint32_t UART2_CheckBaudRate(uint32_t baud)
+{
+    return ((baud >= UART2_BAUD_MIN) && (baud <= UART2_BAUD_MAX)) ? baud : 0U;
+}
+
+int UART2_SetBaudRate(uint32_t baud)
+{
+    if (UART2_CheckBaudRate(baud) == 0U)
+    {
+        return -1;
+    }
+    (void)UART2_TxFlush(UART2_TX_TIMEOUT_MS);
+    uart_apply_baud(baud, false);
+    return 0;
+}
+
+void UART2_AutoBaudArm(void)
+{
+    (void)UART2_TxFlush(UART2_TX_TIMEOUT_MS);
+    uart_apply_baud(uart_default_baud, true);
+}
+
+uint32_t UART2_AutoBaudResult(void)
+{
+    uint32_t baud = 0U;
+    int state;
+
+    (void)pthread_mutex_lock(&uart_lock);
+    state = abr_armed ? abr_state : 0;
+    if (state != 0)
+    {
+        abr_armed = false;
+        hUART2.Init.BaudRate = uart_baud;
+        baud = uart_baud;
+    }
+    (void)pthread_mutex_unlock(&uart_lock);
+    if (state < 0)
+    {
+        uart_apply_baud(uart_default_baud, false);
+        baud = 0U;
+    }
+    return baud;
+}
+
+/**
+ * @brief Écrit des octets dans le pseudo-terminal.
+ */
+static HAL_StatusTypeDef uart_write(const uint8_t *pData, uint16_t Size)
+{
+    struct pollfd pfd;
+    uint16_t sent = 0U;
+    ssize_t n;
+
+    pfd.fd = uart_master;
+    pfd.events = POLLOUT;
+    while (sent < Size)
+    {
+        n = write(uart_master, &pData[sent], Size - sent);
+        if (n > 0)
+        {
+            sent += (uint16_t)n;
+        }
+        else if ((n < 0) && (errno != EAGAIN))
+        {
+            return HAL_ERROR;
+        }
+        else if (poll(&pfd, 1, 50) <= 0)
+        {
+            /* Personne ne lit le terminal : les octets sont perdus, comme sur la ligne */
+            (void)tcflush(uart_slave, TCIFLUSH);
+        }
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Émission DMA : le transfert se termine immédiatement.
+ *
+ * La durée sur la ligne n'est pas modélisée ici (voir bench/link_sim.c) ; la fin
+ * de transfert est signalée à rou.c comme par HAL_UART_TxCpltCallback().
+ */
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    (void)huart;
+    if (uart_write(pData, Size) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    UART2_TxComplete();
+    return HAL_OK;
+}
@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+  * @file    usbd_FTDI.h
+  * @brief   Emulation FT232R : en-tête de usbd_FTDI.c.
+  ******************************************************************************
+  * @attention
+  * La classe remplace le port CDC lorsque USBD_FTDI_EMULATION vaut 1 (def.h) :
+  * les outils de terrain prévus pour le câble FT232R (pilote VCP ou D2XX)
+  * dialoguent alors directement avec le bootloader par l'USB.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_FTDI_H
+#define __USBD_FTDI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdbool.h>
+#include "def.h"
+#include "usbd_ioreq.h"
+
+/* Endpoints et taille de paquet (mêmes adresses que le port CDC, voir usbd_conf.c) */
+#define FTDI_IN_EP              0x81U      /**< Endpoint Bulk IN (EP1 IN) */
+#define FTDI_OUT_EP             0x01U      /**< Endpoint Bulk OUT (EP1 OUT) */
+#define FTDI_PACKET_SIZE        64U        /**< Taille maximale des paquets en full speed */
+#define FTDI_STATUS_SIZE        2U         /**< En-tête d'état modem en tête de chaque paquet IN */
+#define FTDI_PAYLOAD_SIZE       (FTDI_PACKET_SIZE - FTDI_STATUS_SIZE)
+
+/* Requêtes constructeur du FT232R (bRequest) */
+#define FTDI_SIO_RESET              0x00U  /**< wValue : 0 réinitialisation, 1 purge OUT, 2 purge IN */
+#define FTDI_SIO_MODEM_CTRL         0x01U  /**< DTR / RTS */
+#define FTDI_SIO_SET_FLOW_CTRL      0x02U
+#define FTDI_SIO_SET_BAUD_RATE      0x03U  /**< Diviseur de 3 MHz dans wValue et wIndex */
+#define FTDI_SIO_SET_DATA           0x04U  /**< Bits de données, parité, bits d'arrêt */
+#define FTDI_SIO_GET_MODEM_STATUS   0x05U  /**< Réponse : les deux octets d'état */
+#define FTDI_SIO_SET_EVENT_CHAR     0x06U
+#define FTDI_SIO_SET_ERROR_CHAR     0x07U
+#define FTDI_SIO_SET_LATENCY_TIMER  0x09U  /**< wValue : 1 à 255 ms */
+#define FTDI_SIO_GET_LATENCY_TIMER  0x0AU  /**< Réponse : un octet */
+#define FTDI_SIO_SET_BITMODE        0x0BU
+#define FTDI_SIO_READ_PINS          0x0CU  /**< Réponse : un octet */
+#define FTDI_SIO_READ_EEPROM        0x90U  /**< Réponse : un mot de 16 bits */
+#define FTDI_SIO_WRITE_EEPROM       0x91U
+#define FTDI_SIO_ERASE_EEPROM       0x92U
+
+/* Octets d'état modem et ligne émis en tête de chaque paquet IN */
+#define FTDI_MODEM_STATUS       0x31U      /**< Bit 0 toujours à 1, CTS et DSR présents */
+#define FTDI_LINE_STATUS        0x60U      /**< THRE et TEMT : émetteur vide, aucune erreur */
+
+#define FTDI_LATENCY_MIN_MS     1U
+#define FTDI_LATENCY_MAX_MS     255U
+
+/**
+  * @brief  État de la classe (pdev->pClassData).
+  */
+typedef struct
+{
+    uint8_t TxPacket[FTDI_PACKET_SIZE];                           /**< Paquet IN en cours : en-tête + données */
+    uint8_t RxPackets[CDC_RX_PACKET_BUFFERS][FTDI_PACKET_SIZE];   /**< Tampons OUT armés à tour de rôle */
+    uint32_t RxIndex;                                             /**< Tampon OUT armé */
+    volatile bool RxPaused;                                       /**< Endpoint OUT laissé en NAK (cdc_fifo pleine) */
+    volatile bool TxBusy;                                         /**< Paquet IN en cours */
+    uint32_t TxLength;                                            /**< Octets de données du paquet IN en cours */
+    uint8_t LatencyMs;                                            /**< Délai avant émission d'un paquet incomplet */
+    uint8_t LatencyCount;                                         /**< Trames écoulées depuis le dernier paquet IN */
+    uint16_t ModemCtrl;                                           /**< Dernière requête FTDI_SIO_MODEM_CTRL */
+    uint32_t BaudRate;                                            /**< Débit demandé par le PC (aucune UART derrière) */
+} USBD_FTDI_HandleTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern USBD_ClassTypeDef USBD_FTDI;
+extern USBD_DescriptorsTypeDef FTDI_Desc;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_FTDI_H */
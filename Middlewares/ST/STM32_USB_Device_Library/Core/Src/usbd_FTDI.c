@@ -1,31 +1,49 @@
 /**
   ******************************************************************************
-  * @file    main.c
+  * @file    usbd_FTDI.c
   * @brief   Emulation FT232R sur STM32G431 en USB.
   ******************************************************************************
   * @attention
-  * Ce code est un exemple complet et fonctionnel destiné à être utilisé tel quel
-  * dans un projet STM32Cube. Adaptez la configuration (horloge, GPIO, etc.)
-  * selon votre plateforme matérielle.
+  * Classe constructeur compatible avec les pilotes FTDI (VCP et D2XX), en
+  * remplacement du port CDC lorsque USBD_FTDI_EMULATION vaut 1 (def.h). Les
+  * octets passent par les mêmes FIFO que le port CDC (cdc_fifo en réception,
+  * cdc_tx_fifo en émission) et la liaison transport_cdc (transport.c) émet par
+  * FTDI_Send() : menu et récepteurs sont inchangés.
+  *
+  * Comme sur le circuit FTDI :
+  *  - chaque paquet IN commence par deux octets d'état modem et ligne, suivis
+  *    d'au plus 62 octets de données ;
+  *  - un paquet n'est émis que plein, ou à l'échéance du timer de latence
+  *    (FTDI_LATENCY_DEFAULT_MS, réglable par FTDI_SIO_SET_LATENCY_TIMER) compté
+  *    en trames depuis le paquet précédent. À l'échéance, un paquet réduit à
+  *    l'en-tête est émis si rien n'est en attente : le PC reçoit l'état modem au
+  *    moins une fois par période.
+  * Un caractère isolé du menu ne coûte donc plus une trame USB : il part avec
+  * les suivants au plus tard après la latence, et un transfert en bloc remplit
+  * les paquets. FTDI_TxFlush() joue le rôle de la broche SI/WU du FT232R : le
+  * paquet incomplet part aussitôt.
+  *
+  * Réception : les paquets OUT sont copiés dans cdc_fifo par CDC_ReceiveCallback()
+  * (Rou_cdc.c), avec CDC_RX_PACKET_BUFFERS tampons armés à tour de rôle et la même
+  * règle de NAK que usbd_cdc_if.c. Les compteurs sont ceux du port CDC
+  * (v_cdc_rx_stats, v_cdc_tx_stats).
   ******************************************************************************
   */
 
 /* Inclusion des fichiers d'en-tête HAL et USB Device */
-#include "stm32g4xx_hal.h"   /* HAL pour STM32G4xx */
+#include "inc.h"
 #include "usbd_core.h"       /* Noyau USB Device */
 #include "usbd_ctlreq.h"     /* Gestion des requêtes USB */
-#include "usbd_def.h"        /* Définitions USB */
+#include "usbd_desc.h"       /* DEVICE_ID1 à DEVICE_ID3 (numéro de série) */
+#include "usbd_FTDI.h"
 
-/* Définitions des endpoints et taille de paquet pour l’émulation FTDI */
-#define FTDI_IN_EP        0x81U      /**< Adresse de l’endpoint Bulk IN (EP1 IN) */
-#define FTDI_OUT_EP       0x01U      /**< Adresse de l’endpoint Bulk OUT (EP1 OUT) */
-#define FTDI_PACKET_SIZE  64U        /**< Taille maximale des paquets (64 octets) */
+#if (USBD_FTDI_EMULATION == 1U)
 
 /* Déclaration globale de la poignée USB */
 extern USBD_HandleTypeDef hUsbDeviceFS;
 
-/* Tampon de réception pour l’endpoint OUT */
-static uint8_t ftRxBuffer[FTDI_PACKET_SIZE];
+/* État de la classe, pointé par hUsbDeviceFS.pClassData une fois configurée */
+static USBD_FTDI_HandleTypeDef ftdi_handle;
 
 /* ============================================================================
    DESCRIPTEURS USB pour l’émulation FT232R
@@ -34,31 +52,31 @@ static uint8_t ftRxBuffer[FTDI_PACKET_SIZE];
 /**
   * @brief  Descripteur de périphérique FTDI.
   */
-static const uint8_t USBD_FTDI_DeviceDesc[] =
+__ALIGN_BEGIN static uint8_t USBD_FTDI_DeviceDesc[USB_LEN_DEV_DESC] __ALIGN_END =
 {
     0x12U,                       /* bLength : 18 octets */
-    0x01U,                       /* bDescriptorType : DEVICE */
+    USB_DESC_TYPE_DEVICE,        /* bDescriptorType : DEVICE */
     0x00U, 0x02U,                /* bcdUSB : USB 2.00 */
     0x00U,                       /* bDeviceClass : défini par l’interface */
     0x00U,                       /* bDeviceSubClass */
     0x00U,                       /* bDeviceProtocol */
-    0x40U,                       /* bMaxPacketSize0 : 64 octets */
+    USB_MAX_EP0_SIZE,            /* bMaxPacketSize0 : 64 octets */
     0x03U, 0x04U,                /* idVendor : 0x0403 (FTDI) en little endian */
     0x01U, 0x60U,                /* idProduct : 0x6001 (FT232R) en little endian */
-    0x00U, 0x02U,                /* bcdDevice : 2.00 */
-    0x01U,                       /* iManufacturer : index de la chaîne fabricant */
-    0x02U,                       /* iProduct : index de la chaîne produit */
-    0x03U,                       /* iSerialNumber : index de la chaîne numéro de série */
-    0x01U                        /* bNumConfigurations : 1 configuration */
+    0x00U, 0x06U,                /* bcdDevice : 6.00, révision du FT232R attendue par les pilotes */
+    USBD_IDX_MFC_STR,            /* iManufacturer : index de la chaîne fabricant */
+    USBD_IDX_PRODUCT_STR,        /* iProduct : index de la chaîne produit */
+    USBD_IDX_SERIAL_STR,         /* iSerialNumber : index de la chaîne numéro de série */
+    USBD_MAX_NUM_CONFIGURATION   /* bNumConfigurations : 1 configuration */
 };
 
 /**
   * @brief  Descripteur Device Qualifier FTDI.
   */
-static const uint8_t USBD_FTDI_DeviceQualifierDesc[] =
+__ALIGN_BEGIN static uint8_t USBD_FTDI_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END =
 {
-    0x0AU,                       /* bLength : 10 octets */
-    0x06U,                       /* bDescriptorType : DEVICE_QUALIFIER */
+    USB_LEN_DEV_QUALIFIER_DESC,  /* bLength : 10 octets */
+    USB_DESC_TYPE_DEVICE_QUALIFIER,
     0x00U, 0x02U,                /* bcdUSB : USB 2.00 */
     0x00U,                       /* bDeviceClass */
     0x00U,                       /* bDeviceSubClass */
@@ -71,11 +89,11 @@ static const uint8_t USBD_FTDI_DeviceQualifierDesc[] =
 /**
   * @brief  Descripteur de configuration Full-Speed FTDI.
   */
-static const uint8_t USBD_FTDI_CfgFSDesc[] =
+__ALIGN_BEGIN static uint8_t USBD_FTDI_CfgFSDesc[] __ALIGN_END =
 {
     /* Configuration Descriptor */
     0x09U,                       /* bLength : 9 octets */
-    0x02U,                       /* bDescriptorType : CONFIGURATION */
+    USB_DESC_TYPE_CONFIGURATION, /* bDescriptorType : CONFIGURATION */
     0x20U, 0x00U,                /* wTotalLength : 32 octets (9+9+7+7) */
     0x01U,                       /* bNumInterfaces : 1 interface */
     0x01U,                       /* bConfigurationValue : 1 */
@@ -85,91 +103,306 @@ static const uint8_t USBD_FTDI_CfgFSDesc[] =
 
     /* Interface Descriptor */
     0x09U,                       /* bLength : 9 octets */
-    0x04U,                       /* bDescriptorType : INTERFACE */
+    USB_DESC_TYPE_INTERFACE,     /* bDescriptorType : INTERFACE */
     0x00U,                       /* bInterfaceNumber : 0 */
     0x00U,                       /* bAlternateSetting : 0 */
     0x02U,                       /* bNumEndpoints : 2 endpoints (Bulk IN et Bulk OUT) */
     0xFFU,                       /* bInterfaceClass : Vendor Specific */
-    0x00U,                       /* bInterfaceSubClass */
-    0x00U,                       /* bInterfaceProtocol */
-    0x00U,                       /* iInterface : aucune chaîne */
+    0xFFU,                       /* bInterfaceSubClass */
+    0xFFU,                       /* bInterfaceProtocol */
+    USBD_IDX_PRODUCT_STR,        /* iInterface : chaîne produit */
 
     /* Endpoint Descriptor - Bulk IN */
     0x07U,                       /* bLength : 7 octets */
-    0x05U,                       /* bDescriptorType : ENDPOINT */
+    USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType : ENDPOINT */
     FTDI_IN_EP,                  /* bEndpointAddress : EP1 IN (0x81) */
     0x02U,                       /* bmAttributes : Bulk */
-    0x40U, 0x00U,                /* wMaxPacketSize : 64 octets */
+    LOBYTE(FTDI_PACKET_SIZE), HIBYTE(FTDI_PACKET_SIZE), /* wMaxPacketSize : 64 octets */
     0x00U,                       /* bInterval : non utilisé pour Bulk */
 
     /* Endpoint Descriptor - Bulk OUT */
     0x07U,                       /* bLength : 7 octets */
-    0x05U,                       /* bDescriptorType : ENDPOINT */
+    USB_DESC_TYPE_ENDPOINT,      /* bDescriptorType : ENDPOINT */
     FTDI_OUT_EP,                 /* bEndpointAddress : EP1 OUT (0x01) */
     0x02U,                       /* bmAttributes : Bulk */
-    0x40U, 0x00U,                /* wMaxPacketSize : 64 octets */
+    LOBYTE(FTDI_PACKET_SIZE), HIBYTE(FTDI_PACKET_SIZE), /* wMaxPacketSize : 64 octets */
     0x00U                        /* bInterval : non utilisé pour Bulk */
 };
 
 /**
   * @brief  Descripteur de langue (anglais-US).
   */
-static const uint8_t USBD_FTDI_LangIDDesc[] = { 0x04U, 0x03U, 0x09U, 0x04U };
+__ALIGN_BEGIN static uint8_t USBD_FTDI_LangIDDesc[USB_LEN_LANGID_STR_DESC] __ALIGN_END =
+{
+    USB_LEN_LANGID_STR_DESC, USB_DESC_TYPE_STRING, 0x09U, 0x04U
+};
 
 /**
   * @brief  Chaîne fabricant FTDI.
   */
-static uint8_t USBD_FTDI_ManufacturerString[] = {
-    0x1AU, 0x03U,
-    'F', 0x00U, 'T', 0x00U, 'D', 0x00U, 'I', 0x00U,
-    ' ', 0x00U, 'C', 0x00U, 'o', 0x00U, 'm', 0x00U,
-    'p', 0x00U, 'a', 0x00U, 'n', 0x00U, 'y', 0x00U
+__ALIGN_BEGIN static uint8_t USBD_FTDI_ManufacturerString[] __ALIGN_END =
+{
+    0x0AU, USB_DESC_TYPE_STRING,
+    'F', 0x00U, 'T', 0x00U, 'D', 0x00U, 'I', 0x00U
 };
 
 /**
-  * @brief  Chaîne produit FTDI.
+  * @brief  Chaîne produit FTDI (description recherchée par les outils D2XX).
   */
-static uint8_t USBD_FTDI_ProductString[] = {
-    0x1CU, 0x03U,
+__ALIGN_BEGIN static uint8_t USBD_FTDI_ProductString[] __ALIGN_END =
+{
+    0x20U, USB_DESC_TYPE_STRING,
     'F', 0x00U, 'T', 0x00U, '2', 0x00U, '3', 0x00U,
-    '2', 0x00U, 'R', 0x00U, ' ', 0x00U, 'E', 0x00U,
-    'm', 0x00U, 'u', 0x00U, 'l', 0x00U, 'a', 0x00U,
-    't', 0x00U, 'o', 0x00U, 'r', 0x00U
+    '2', 0x00U, 'R', 0x00U, ' ', 0x00U, 'U', 0x00U,
+    'S', 0x00U, 'B', 0x00U, ' ', 0x00U, 'U', 0x00U,
+    'A', 0x00U, 'R', 0x00U, 'T', 0x00U
 };
 
 /**
-  * @brief  Chaîne numéro de série FTDI.
+  * @brief  Chaîne numéro de série FTDI : 8 chiffres hexadécimaux tirés de l'UID,
+  *         remplis par FTDI_SerialStrDescriptor().
   */
-static uint8_t USBD_FTDI_SerialString[] = {
-    0x0EU, 0x03U,
-    'F', 0x00U, 'T', 0x00U, '0', 0x00U, '0', 0x00U,
-    '0', 0x00U, '0', 0x00U, '1', 0x00U
+__ALIGN_BEGIN static uint8_t USBD_FTDI_SerialString[2U + (8U * 2U)] __ALIGN_END =
+{
+    (uint8_t)(2U + (8U * 2U)), USB_DESC_TYPE_STRING
 };
 
 /**
   * @brief  Chaîne de configuration FTDI.
   */
-static uint8_t USBD_FTDI_ConfigString[] = {
-    0x1AU, 0x03U,
+__ALIGN_BEGIN static uint8_t USBD_FTDI_ConfigString[] __ALIGN_END =
+{
+    0x1AU, USB_DESC_TYPE_STRING,
     'F', 0x00U, 'T', 0x00U, 'D', 0x00U, 'I', 0x00U,
     ' ', 0x00U, 'C', 0x00U, 'o', 0x00U, 'n', 0x00U,
     'f', 0x00U, 'i', 0x00U, 'g', 0x00U, '1', 0x00U
 };
 
+static uint8_t *FTDI_DeviceDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+    UNUSED(speed);
+    *length = (uint16_t)sizeof(USBD_FTDI_DeviceDesc);
+    return USBD_FTDI_DeviceDesc;
+}
+
+static uint8_t *FTDI_LangIDStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+    UNUSED(speed);
+    *length = (uint16_t)sizeof(USBD_FTDI_LangIDDesc);
+    return USBD_FTDI_LangIDDesc;
+}
+
+static uint8_t *FTDI_ManufacturerStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+    UNUSED(speed);
+    *length = (uint16_t)sizeof(USBD_FTDI_ManufacturerString);
+    return USBD_FTDI_ManufacturerString;
+}
+
+static uint8_t *FTDI_ProductStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+    UNUSED(speed);
+    *length = (uint16_t)sizeof(USBD_FTDI_ProductString);
+    return USBD_FTDI_ProductString;
+}
+
+/**
+  * @brief  Numéro de série propre à la carte : deux cartes branchées sur le même
+  *         PC restent distinguables par les outils FTDI.
+  */
+static uint8_t *FTDI_SerialStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    uint32_t serial = *(uint32_t *)DEVICE_ID1 + *(uint32_t *)DEVICE_ID3;
+    uint32_t i;
+
+    UNUSED(speed);
+    for (i = 0U; i < 8U; i++)
+    {
+        USBD_FTDI_SerialString[2U + (2U * i)] = (uint8_t)hex[(serial >> (28U - (4U * i))) & 0x0FU];
+        USBD_FTDI_SerialString[3U + (2U * i)] = 0x00U;
+    }
+    *length = (uint16_t)sizeof(USBD_FTDI_SerialString);
+    return USBD_FTDI_SerialString;
+}
+
+static uint8_t *FTDI_ConfigStrDescriptor(USBD_SpeedTypeDef speed, uint16_t *length)
+{
+    UNUSED(speed);
+    *length = (uint16_t)sizeof(USBD_FTDI_ConfigString);
+    return USBD_FTDI_ConfigString;
+}
+
 /**
   * @brief  Structure de descripteurs utilisée par la pile USB.
   */
 USBD_DescriptorsTypeDef FTDI_Desc =
 {
-    USBD_FTDI_DeviceDesc,
-    USBD_FTDI_LangIDDesc,
-    USBD_FTDI_ManufacturerString,
-    USBD_FTDI_ProductString,
-    USBD_FTDI_SerialString,
-    USBD_FTDI_ConfigString,
-    USBD_FTDI_DeviceQualifierDesc,
+    FTDI_DeviceDescriptor,
+    FTDI_LangIDStrDescriptor,
+    FTDI_ManufacturerStrDescriptor,
+    FTDI_ProductStrDescriptor,
+    FTDI_SerialStrDescriptor,
+    FTDI_ConfigStrDescriptor,
+    FTDI_ProductStrDescriptor,   /* Chaîne d'interface */
 };
 
+/* ============================================================================
+   CHEMIN DES DONNÉES
+   ============================================================================ */
+
+/**
+  * @brief  Lance un paquet IN si l'endpoint est libre.
+  *
+  * Appelée avec les interruptions masquées, ou depuis l'interruption USB. Les
+  * données sont retirées de cdc_tx_fifo et recopiées derrière l'en-tête d'état.
+  *
+  * @param  force: false : paquet plein seulement ; true : paquet incomplet, ou
+  *                réduit à l'en-tête si la file est vide (échéance de latence).
+  */
+static void FTDI_TxStart(bool force)
+{
+    USBD_FTDI_HandleTypeDef *hftdi = (USBD_FTDI_HandleTypeDef *)hUsbDeviceFS.pClassData;
+    uint32_t length;
+
+    if ((hftdi == NULL) || hftdi->TxBusy)
+    {
+        return;
+    }
+    length = fifo_len(&cdc_tx_fifo);
+    if ((length < FTDI_PAYLOAD_SIZE) && !force)
+    {
+        return;
+    }
+    length = fifo_out(&cdc_tx_fifo, &hftdi->TxPacket[FTDI_STATUS_SIZE], MIN(length, FTDI_PAYLOAD_SIZE));
+    hftdi->TxPacket[0] = FTDI_MODEM_STATUS;
+    hftdi->TxPacket[1] = FTDI_LINE_STATUS;
+    hftdi->TxBusy = true;
+    hftdi->TxLength = length;
+    hftdi->LatencyCount = 0U;
+    v_cdc_tx_stats.transfers++;
+    if (USBD_LL_Transmit(&hUsbDeviceFS, FTDI_IN_EP, hftdi->TxPacket, (uint32_t)(FTDI_STATUS_SIZE + length)) != USBD_OK)
+    {
+        hftdi->TxBusy = false;
+        v_cdc_tx_stats.dropped += length;
+    }
+}
+
+/**
+  * @brief  Arme le tampon OUT suivant pour la réception.
+  */
+static void FTDI_RxArmNext(USBD_HandleTypeDef *pdev, USBD_FTDI_HandleTypeDef *hftdi)
+{
+    hftdi->RxIndex = (hftdi->RxIndex + 1U) % CDC_RX_PACKET_BUFFERS;
+    (void)USBD_LL_PrepareReceive(pdev, FTDI_OUT_EP, hftdi->RxPackets[hftdi->RxIndex], FTDI_PACKET_SIZE);
+}
+
+/**
+  * @brief  Décode le diviseur de FTDI_SIO_SET_BAUD_RATE.
+  *
+  * Horloge de 3 MHz divisée par un entier de 14 bits et une fraction en
+  * huitièmes, codée sur les bits 14 et 15 de wValue et le bit 0 de wIndex.
+  *
+  * @retval Débit en bauds.
+  */
+static uint32_t FTDI_DecodeBaudRate(uint16_t value, uint16_t index)
+{
+    static const uint8_t eighths[8] = { 0U, 4U, 2U, 1U, 3U, 5U, 6U, 7U };
+    uint32_t divisor = (uint32_t)value & 0x3FFFU;
+    uint32_t fraction = ((uint32_t)value >> 14) | (((uint32_t)index & 0x0001U) << 2);
+
+    if ((divisor <= 1U) && (fraction == 0U))
+    {
+        /* Valeurs réservées : 0 pour 3 Mbauds, 1 pour 2 Mbauds */
+        return (divisor == 0U) ? 3000000U : 2000000U;
+    }
+    return (3000000U * 8U) / ((divisor * 8U) + eighths[fraction]);
+}
+
+/**
+  * @brief  Dépose des octets dans la file d'émission, sans attendre.
+  *
+  * @param  data: octets à émettre.
+  * @param  length: nombre d'octets.
+  * @retval Nombre d'octets acceptés (inférieur à length si la file est pleine).
+  */
+uint32_t FTDI_TxWrite(const uint8_t *data, uint32_t length)
+{
+    uint32_t written = fifo_in(&cdc_tx_fifo, data, length);
+    uint32_t used = fifo_len(&cdc_tx_fifo);
+
+    if (used > v_cdc_tx_stats.high_water)
+    {
+        v_cdc_tx_stats.high_water = used;
+    }
+    __disable_irq();
+    FTDI_TxStart(false);
+    __enable_irq();
+    return written;
+}
+
+/**
+  * @brief  Émet le paquet incomplet sans attendre la latence, puis attend la fin
+  *         de l'émission de la file.
+  *
+  * @param  timeout_ms: délai maximal en millisecondes.
+  * @retval FIFO_OK si tous les octets ont été émis, FIFO_ERROR en cas de timeout
+  *         ou si le port n'est pas configuré.
+  */
+int FTDI_TxFlush(uint32_t timeout_ms)
+{
+    USBD_FTDI_HandleTypeDef *hftdi = (USBD_FTDI_HandleTypeDef *)hUsbDeviceFS.pClassData;
+    uint32_t start_time = HAL_GetTick();
+
+    while ((hftdi != NULL) && (hftdi->TxBusy || (fifo_len(&cdc_tx_fifo) != 0U)))
+    {
+        if (!CDC_IsInitialized() || ((HAL_GetTick() - start_time) >= timeout_ms))
+        {
+            return FIFO_ERROR;
+        }
+        if (fifo_len(&cdc_tx_fifo) != 0U)
+        {
+            __disable_irq();
+            FTDI_TxStart(true);
+            __enable_irq();
+        }
+    }
+    return (hftdi != NULL) ? FIFO_OK : FIFO_ERROR;
+}
+
+/**
+  * @brief  Dépose des octets dans la file, en attendant de la place si elle est pleine.
+  *
+  * Fonction d'émission de transport_cdc (transport.c) en émulation FTDI. Même
+  * règle que CDC_Send() : attente bornée par CDC_TX_TIMEOUT_MS, octets perdus et
+  * comptés au-delà ou si le port n'est pas configuré.
+  *
+  * @param  data: octets à émettre.
+  * @param  length: nombre d'octets.
+  */
+void FTDI_Send(const uint8_t *data, uint32_t length)
+{
+    uint32_t start_time = HAL_GetTick();
+    uint32_t written;
+
+    if (!CDC_IsInitialized())
+    {
+        v_cdc_tx_stats.dropped += length;
+        return;
+    }
+    written = FTDI_TxWrite(data, length);
+    while (written < length)
+    {
+        if ((HAL_GetTick() - start_time) >= CDC_TX_TIMEOUT_MS)
+        {
+            v_cdc_tx_stats.dropped += length - written;
+            return;
+        }
+        v_cdc_tx_stats.waits++;
+        written += FTDI_TxWrite(&data[written], length - written);
+    }
+}
+
 /* ============================================================================
    FONCTIONS DE GESTION DE LA CLASSE FTDI (VENDOR SPECIFIC)
    ============================================================================ */
@@ -182,15 +415,26 @@ USBD_DescriptorsTypeDef FTDI_Desc =
   */
 static uint8_t FTDI_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
+    USBD_FTDI_HandleTypeDef *hftdi = &ftdi_handle;
+
+    UNUSED(cfgidx);
+    (void)memset(hftdi, 0, sizeof(*hftdi));
+    hftdi->LatencyMs = FTDI_LATENCY_DEFAULT_MS;
+    hftdi->BaudRate = 9600U;
+    fifo_init(&cdc_tx_fifo);
+    pdev->pClassData = (void *)hftdi;
+
     /* Ouvre l’endpoint Bulk IN */
-    USBD_LL_OpenEP(pdev, FTDI_IN_EP, USBD_EP_TYPE_BULK, FTDI_PACKET_SIZE);
+    (void)USBD_LL_OpenEP(pdev, FTDI_IN_EP, USBD_EP_TYPE_BULK, FTDI_PACKET_SIZE);
+    pdev->ep_in[FTDI_IN_EP & 0xFU].is_used = 1U;
     /* Ouvre l’endpoint Bulk OUT */
-    USBD_LL_OpenEP(pdev, FTDI_OUT_EP, USBD_EP_TYPE_BULK, FTDI_PACKET_SIZE);
+    (void)USBD_LL_OpenEP(pdev, FTDI_OUT_EP, USBD_EP_TYPE_BULK, FTDI_PACKET_SIZE);
+    pdev->ep_out[FTDI_OUT_EP & 0xFU].is_used = 1U;
 
     /* Prépare l’endpoint OUT pour la réception */
-    USBD_LL_PrepareReceive(pdev, FTDI_OUT_EP, ftRxBuffer, FTDI_PACKET_SIZE);
+    (void)USBD_LL_PrepareReceive(pdev, FTDI_OUT_EP, hftdi->RxPackets[0], FTDI_PACKET_SIZE);
 
-    return USBD_OK;
+    return (uint8_t)USBD_OK;
 }
 
 /**
@@ -201,81 +445,256 @@ static uint8_t FTDI_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
   */
 static uint8_t FTDI_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
-    USBD_LL_CloseEP(pdev, FTDI_IN_EP);
-    USBD_LL_CloseEP(pdev, FTDI_OUT_EP);
-    return USBD_OK;
+    UNUSED(cfgidx);
+    (void)USBD_LL_CloseEP(pdev, FTDI_IN_EP);
+    pdev->ep_in[FTDI_IN_EP & 0xFU].is_used = 0U;
+    (void)USBD_LL_CloseEP(pdev, FTDI_OUT_EP);
+    pdev->ep_out[FTDI_OUT_EP & 0xFU].is_used = 0U;
+    pdev->pClassData = NULL;
+    fifo_init(&cdc_tx_fifo);
+    return (uint8_t)USBD_OK;
 }
 
 /**
   * @brief  Gère les requêtes SETUP pour FTDI.
+  *
+  * Les requêtes de réglage de la ligne (contrôle modem, flux, format, caractères
+  * spéciaux, mode des broches, EEPROM) sont acceptées sans effet : aucune UART
+  * n'est derrière le port. Le débit est conservé pour information. La purge de la
+  * réception (FTDI_SIO_RESET, wValue 1) est ignorée : les octets déjà déposés dans
+  * cdc_fifo appartiennent aux récepteurs.
+  *
   * @param  pdev: pointeur sur la poignée du périphérique USB.
   * @param  req: pointeur sur la requête SETUP.
   * @retval USBD_StatusTypeDef.
   */
 static uint8_t FTDI_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
 {
-    uint8_t ret = USBD_OK;
+    USBD_FTDI_HandleTypeDef *hftdi = (USBD_FTDI_HandleTypeDef *)pdev->pClassData;
+    static uint8_t reply[2];
+    uint16_t reply_length = 0U;
+    uint8_t ret = (uint8_t)USBD_OK;
 
-    /* Traitement uniquement des requêtes de type VENDOR */
-    if ((req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_VENDOR)
+    if (hftdi == NULL)
     {
-        switch (req->bRequest)
-        {
-            case 0x00U:  /* Exemple : réglage du baudrate ou autres commandes FTDI */
-                /* Traitez ici les paramètres contenus dans req->wValue et req->wIndex */
-                break;
-
-            default:
-                USBD_CtlError(pdev, req);
-                ret = USBD_FAIL;
-                break;
-        }
+        USBD_CtlError(pdev, req);
+        return (uint8_t)USBD_FAIL;
     }
-    else
+
+    switch (req->bmRequest & USB_REQ_TYPE_MASK)
     {
-        USBD_CtlError(pdev, req);
-        ret = USBD_FAIL;
+        case USB_REQ_TYPE_VENDOR:
+            switch (req->bRequest)
+            {
+                case FTDI_SIO_RESET:
+                    if (req->wValue != 1U)
+                    {
+                        /* Purge des octets en attente vers le PC (consommateur : cette interruption) */
+                        fifo_commit(&cdc_tx_fifo, fifo_len(&cdc_tx_fifo));
+                    }
+                    if (req->wValue == 0U)
+                    {
+                        hftdi->ModemCtrl = 0U;
+                    }
+                    break;
+
+                case FTDI_SIO_MODEM_CTRL:
+                    hftdi->ModemCtrl = req->wValue;
+                    break;
+
+                case FTDI_SIO_SET_BAUD_RATE:
+                    hftdi->BaudRate = FTDI_DecodeBaudRate(req->wValue, req->wIndex);
+                    break;
+
+                case FTDI_SIO_SET_LATENCY_TIMER:
+                    if (LOBYTE(req->wValue) < FTDI_LATENCY_MIN_MS)
+                    {
+                        ret = (uint8_t)USBD_FAIL;
+                    }
+                    else
+                    {
+                        hftdi->LatencyMs = LOBYTE(req->wValue);
+                    }
+                    break;
+
+                case FTDI_SIO_GET_MODEM_STATUS:
+                    reply[0] = FTDI_MODEM_STATUS;
+                    reply[1] = FTDI_LINE_STATUS;
+                    reply_length = 2U;
+                    break;
+
+                case FTDI_SIO_GET_LATENCY_TIMER:
+                    reply[0] = hftdi->LatencyMs;
+                    reply_length = 1U;
+                    break;
+
+                case FTDI_SIO_READ_PINS:
+                    reply[0] = 0U;
+                    reply_length = 1U;
+                    break;
+
+                case FTDI_SIO_READ_EEPROM:
+                    /* EEPROM vierge : les pilotes gardent la configuration par défaut */
+                    reply[0] = 0xFFU;
+                    reply[1] = 0xFFU;
+                    reply_length = 2U;
+                    break;
+
+                case FTDI_SIO_SET_FLOW_CTRL:
+                case FTDI_SIO_SET_DATA:
+                case FTDI_SIO_SET_EVENT_CHAR:
+                case FTDI_SIO_SET_ERROR_CHAR:
+                case FTDI_SIO_SET_BITMODE:
+                case FTDI_SIO_WRITE_EEPROM:
+                case FTDI_SIO_ERASE_EEPROM:
+                    break;
+
+                default:
+                    ret = (uint8_t)USBD_FAIL;
+                    break;
+            }
+            break;
+
+        case USB_REQ_TYPE_STANDARD:
+            switch (req->bRequest)
+            {
+                case USB_REQ_GET_STATUS:
+                    reply[0] = 0U;
+                    reply[1] = 0U;
+                    reply_length = 2U;
+                    break;
+
+                case USB_REQ_GET_INTERFACE:
+                    reply[0] = 0U;
+                    reply_length = 1U;
+                    break;
+
+                case USB_REQ_SET_INTERFACE:
+                case USB_REQ_CLEAR_FEATURE:
+                    break;
+
+                default:
+                    ret = (uint8_t)USBD_FAIL;
+                    break;
+            }
+            break;
+
+        default:
+            ret = (uint8_t)USBD_FAIL;
+            break;
     }
 
+    if (ret != (uint8_t)USBD_OK)
+    {
+        USBD_CtlError(pdev, req);
+    }
+    else if (reply_length != 0U)
+    {
+        (void)USBD_CtlSendData(pdev, reply, MIN(reply_length, req->wLength));
+    }
+    else if ((req->bmRequest & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_DEVICE)
+    {
+        /* Requête constructeur adressée au périphérique : étape d'état à la charge de la classe */
+        (void)USBD_CtlSendStatus(pdev);
+    }
+    else
+    {
+        /* Interface ou endpoint : étape d'état envoyée par usbd_ctlreq.c */
+    }
     return ret;
 }
 
 /**
-  * @brief  Gère la fin de transmission sur l’endpoint IN.
+  * @brief  Gère la fin de transmission sur l’endpoint IN : paquet suivant s'il
+  *         est plein, sinon attente de la latence.
   * @param  pdev: pointeur sur la poignée du périphérique USB.
   * @param  epnum: numéro d’endpoint.
   * @retval USBD_StatusTypeDef.
   */
 static uint8_t FTDI_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-    /* Transmission terminée.
-       Vous pouvez ajouter ici le traitement post-transmission si nécessaire. */
-    return USBD_OK;
+    USBD_FTDI_HandleTypeDef *hftdi = (USBD_FTDI_HandleTypeDef *)pdev->pClassData;
+
+    UNUSED(epnum);
+    if (hftdi == NULL)
+    {
+        return (uint8_t)USBD_FAIL;
+    }
+    v_cdc_tx_stats.bytes += hftdi->TxLength;
+    hftdi->TxLength = 0U;
+    hftdi->TxBusy = false;
+    FTDI_TxStart(false);
+    return (uint8_t)USBD_OK;
 }
 
 /**
   * @brief  Gère la réception de données sur l’endpoint OUT.
+  *
+  * Le tampon suivant n'est armé que si cdc_fifo peut recevoir le paquet suivant ;
+  * sinon l'endpoint reste en NAK jusqu'à une trame où la place est revenue
+  * (FTDI_SOF()).
+  *
   * @param  pdev: pointeur sur la poignée du périphérique USB.
   * @param  epnum: numéro d’endpoint.
   * @retval USBD_StatusTypeDef.
   */
 static uint8_t FTDI_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
-    /* Traitement des données reçues dans ftRxBuffer.
-       Remettez ensuite l’endpoint OUT en attente de réception. */
-    USBD_LL_PrepareReceive(pdev, FTDI_OUT_EP, ftRxBuffer, FTDI_PACKET_SIZE);
-    return USBD_OK;
+    USBD_FTDI_HandleTypeDef *hftdi = (USBD_FTDI_HandleTypeDef *)pdev->pClassData;
+    uint32_t length;
+    uint8_t *packet;
+
+    if (hftdi == NULL)
+    {
+        return (uint8_t)USBD_FAIL;
+    }
+    length = USBD_LL_GetRxDataSize(pdev, epnum);
+    packet = hftdi->RxPackets[hftdi->RxIndex];
+    if (fifo_free(&cdc_fifo) >= (length + FTDI_PACKET_SIZE))
+    {
+        FTDI_RxArmNext(pdev, hftdi);
+    }
+    else
+    {
+        hftdi->RxPaused = true;
+        v_cdc_rx_stats.naks++;
+    }
+    CDC_ReceiveCallback(packet, length);
+    return (uint8_t)USBD_OK;
 }
 
 /**
-  * @brief  Gère l’événement SOF (Start Of Frame).
+  * @brief  Gère l’événement SOF (Start Of Frame) : timer de latence de l'émission
+  *         et reprise de la réception suspendue.
   * @param  pdev: pointeur sur la poignée du périphérique USB.
   * @retval USBD_StatusTypeDef.
   */
 static uint8_t FTDI_SOF(USBD_HandleTypeDef *pdev)
 {
-    /* Vous pouvez ajouter ici du code périodique si nécessaire */
-    return USBD_OK;
+    USBD_FTDI_HandleTypeDef *hftdi = (USBD_FTDI_HandleTypeDef *)pdev->pClassData;
+
+    if (hftdi == NULL)
+    {
+        return (uint8_t)USBD_FAIL;
+    }
+    if (hftdi->RxPaused)
+    {
+        v_cdc_rx_stats.nak_frames++;
+        if (fifo_free(&cdc_fifo) >= FTDI_PACKET_SIZE)
+        {
+            hftdi->RxPaused = false;
+            FTDI_RxArmNext(pdev, hftdi);
+        }
+    }
+    if (!hftdi->TxBusy)
+    {
+        hftdi->LatencyCount++;
+        if (hftdi->LatencyCount >= hftdi->LatencyMs)
+        {
+            FTDI_TxStart(true);
+        }
+    }
+    return (uint8_t)USBD_OK;
 }
 
 /**
@@ -286,7 +705,7 @@ static uint8_t FTDI_SOF(USBD_HandleTypeDef *pdev)
 static uint8_t *FTDI_GetFSCfgDesc(uint16_t *length)
 {
     *length = (uint16_t)sizeof(USBD_FTDI_CfgFSDesc);
-    return (uint8_t *)USBD_FTDI_CfgFSDesc;
+    return USBD_FTDI_CfgFSDesc;
 }
 
 /**
@@ -297,7 +716,7 @@ static uint8_t *FTDI_GetFSCfgDesc(uint16_t *length)
 static uint8_t *FTDI_GetDeviceQualifierDesc(uint16_t *length)
 {
     *length = (uint16_t)sizeof(USBD_FTDI_DeviceQualifierDesc);
-    return (uint8_t *)USBD_FTDI_DeviceQualifierDesc;
+    return USBD_FTDI_DeviceQualifierDesc;
 }
 
 /**
@@ -309,61 +728,16 @@ USBD_ClassTypeDef USBD_FTDI =
     FTDI_DeInit,
     FTDI_Setup,
     NULL,             /* EP0_TxSent : non utilisé */
-    NULL,             /* EP0_RxReady : non utilisé */
+    NULL,             /* EP0_RxReady : aucune requête avec données OUT */
     FTDI_DataIn,
     FTDI_DataOut,
     FTDI_SOF,
-    NULL,
-    NULL,
+    NULL,             /* IsoINIncomplete */
+    NULL,             /* IsoOUTIncomplete */
+    FTDI_GetFSCfgDesc,  /* GetHSConfigDescriptor : full speed seulement */
     FTDI_GetFSCfgDesc,
+    FTDI_GetFSCfgDesc,  /* GetOtherSpeedConfigDescriptor */
     FTDI_GetDeviceQualifierDesc,
 };
 
-/* ============================================================================
-   FONCTIONS D'INITIALISATION ET DE CONFIGURATION
-   ============================================================================ */
-
-/**
-  * @brief  Initialise le périphérique USB en mode FTDI.
-  */
-void MX_USB_Device_Init(void)
-{
-    /* Initialise la bibliothèque USB Device avec les descripteurs FTDI */
-    USBD_Init(&hUsbDeviceFS, &FTDI_Desc, DEVICE_FS);
-    /* Enregistre la classe FTDI */
-    USBD_RegisterClass(&hUsbDeviceFS, &USBD_FTDI);
-    /* Démarre le périphérique USB */
-    USBD_Start(&hUsbDeviceFS);
-}
-
-USBD_StatusTypeDef USBD_LL_DeInit(USBD_HandleTypeDef *pdev) {
-}
-
-///* ============================================================================
-//   FONCTION PRINCIPALE
-//   ============================================================================ */
-
-///**
-//  * @brief  Point d’entrée du programme.
-//  * @retval int
-//  */
-//int main(void)
-//{
-//    /* Initialisation de la librairie HAL */
-//    HAL_Init();
-
-//    /* Configure l’horloge système */
-//    SystemClock_Config();
-
-//    /* Initialisation minimale des GPIO */
-//    MX_GPIO_Init();
-
-//    /* Initialisation du périphérique USB FTDI */
-//    MX_USB_DEVICE_Init();
-
-//    /* Boucle principale */
-//    while (1)
-//    {
-//        /* Ajoutez ici le traitement applicatif */
-//    }
-//}
+#endif /* USBD_FTDI_EMULATION */
@@ -0,0 +1,146 @@
+/**
+ * @file crc_bench.c
+ * @brief Outil PC : contrôle et banc de mesure des moteurs CRC (Core/Src/crc.c).
+ *
+ * Vérifie les valeurs de contrôle ("123456789"), l'égalité des moteurs sur des
+ * données découpées en morceaux quelconques, puis mesure le temps par ko.
+ * Le moteur matériel ne peut être mesuré que sur la cible.
+ *
+ * Compilation :
+ *     gcc -O2 -I../Core/Inc -o crc_bench crc_bench.c ../Core/Src/crc.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crc.h"
+
+#define BENCH_SIZE  (64U * 1024U)
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static int check(void)
+{
+    static const uint8_t text[] = "123456789";
+    static uint8_t data[4099];
+    uint32_t a32 = crc32_init();
+    uint32_t b32 = crc32_init();
+    uint16_t a16 = crc16_init();
+    uint16_t b16 = crc16_init();
+    uint32_t pos = 0U;
+    uint32_t i;
+    int errors = 0;
+
+    if (crc16_final(crc16_update(crc16_init(), text, 9U)) != 0x31C3U)
+    {
+        printf("crc16 check value mismatch\n");
+        errors++;
+    }
+    if (crc32_final(crc32_update(crc32_init(), text, 9U)) != 0xCBF43926UL)
+    {
+        printf("crc32 check value mismatch\n");
+        errors++;
+    }
+
+    srand(1);
+    for (i = 0U; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t)rand();
+    }
+    a16 = crc16_update_bitwise(a16, data, sizeof(data));
+    a32 = crc32_update_bitwise(a32, data, sizeof(data));
+    while (pos < sizeof(data))
+    {
+        uint32_t n = 1U + ((uint32_t)rand() % 37U);
+        if (n > (sizeof(data) - pos))
+        {
+            n = sizeof(data) - pos;
+        }
+        b16 = crc16_update(b16, &data[pos], n);
+        b32 = crc32_update(b32, &data[pos], n);
+        pos += n;
+    }
+    if ((a16 != b16) || (a32 != b32))
+    {
+        printf("chunked update mismatch\n");
+        errors++;
+    }
+    return errors;
+}
+
+typedef struct
+{
+    const char *name;
+    uint16_t (*crc16)(uint16_t, const uint8_t *, uint32_t);
+    uint32_t (*crc32)(uint32_t, const uint8_t *, uint32_t);
+} engine_t;
+
+static double bench16(uint16_t (*fn)(uint16_t, const uint8_t *, uint32_t), const uint8_t *data)
+{
+    volatile uint16_t sink = 0U;
+    unsigned runs = 0U;
+    double start = now_s();
+    double elapsed;
+
+    do
+    {
+        sink = fn(sink, data, BENCH_SIZE);
+        runs++;
+        elapsed = now_s() - start;
+    } while (elapsed < 0.5);
+    return (elapsed * 1e6) / ((double)runs * (BENCH_SIZE / 1024U));
+}
+
+static double bench32(uint32_t (*fn)(uint32_t, const uint8_t *, uint32_t), const uint8_t *data)
+{
+    volatile uint32_t sink = 0U;
+    unsigned runs = 0U;
+    double start = now_s();
+    double elapsed;
+
+    do
+    {
+        sink = fn(sink, data, BENCH_SIZE);
+        runs++;
+        elapsed = now_s() - start;
+    } while (elapsed < 0.5);
+    return (elapsed * 1e6) / ((double)runs * (BENCH_SIZE / 1024U));
+}
+
+int main(void)
+{
+    static const engine_t engines[] = {
+        { "bitwise", crc16_update_bitwise, crc32_update_bitwise },
+#if CRC_SLICE8_BACKEND
+        { "slice-by-8", crc16_update_slice8, crc32_update_slice8 },
+#endif
+    };
+    uint8_t *data = malloc(BENCH_SIZE);
+    size_t i;
+
+    if (check() != 0)
+    {
+        return 1;
+    }
+    printf("check values OK\n");
+
+    for (i = 0U; i < BENCH_SIZE; i++)
+    {
+        data[i] = (uint8_t)rand();
+    }
+    printf("%-12s %12s %12s\n", "engine", "crc16 us/KB", "crc32 us/KB");
+    for (i = 0U; i < (sizeof(engines) / sizeof(engines[0])); i++)
+    {
+        printf("%-12s %12.3f %12.3f\n", engines[i].name,
+               bench16(engines[i].crc16, data), bench32(engines[i].crc32, data));
+    }
+    free(data);
+    return 0;
+}
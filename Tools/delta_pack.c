@@ -0,0 +1,499 @@
+/**
+ * @file delta_pack.c
+ * @brief Outil PC : génération des patchs différentiels et banc de mesure de la mise à jour.
+ *
+ * Produit le format décrit dans Core/Inc/delta.h. Le patch est vérifié en le
+ * réappliquant en place sur une copie de l'image source avec le décodeur de la
+ * cible (Core/Src/delta.c), compilé tel quel.
+ *
+ * Compilation :
+ *     gcc -O2 -I../Core/Inc -o delta_pack delta_pack.c ../Core/Src/delta.c ../Core/Src/crc.c
+ *
+ * Utilisation :
+ *     delta_pack ancienne.bin nouvelle.bin patch.adl   génération (vérifiée)
+ *     delta_pack -b ancienne.bin nouvelle.bin          taille du patch et durée de mise à jour
+ *
+ * Ordre des pages : une page cible ne peut copier que depuis des pages source pas
+ * encore réécrites. Les pages sont émises dès qu'aucune page restante ne lit leur
+ * ancien contenu ; en cas de dépendance circulaire, les lecteurs de la page la
+ * moins lue sont recodés sans elle (données littérales ou autre copie).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crc.h"
+#include "delta.h"
+
+/* Répétition minimale codée en copie : l'en-tête de copie coûte 7 octets */
+#define MIN_COPY        (12U)
+
+/* Recherche des répétitions : hachage de 4 octets, candidats examinés par position */
+#define HASH_BITS       (16U)
+#define MAX_CANDIDATES  (256U)
+
+/* Durées typiques du STM32G431 (datasheet) pour l'estimation de la mise à jour */
+#define PAGE_ERASE_S    (22e-3)
+#define DWORD_PROGRAM_S (82e-6)
+#define BAUD_RATE       (38400.0)
+
+/* Taille d'un bloc XMODEM, pour simuler la réception par morceaux */
+#define CHUNK_SIZE      (1024U)
+
+typedef struct
+{
+    uint8_t type;
+    uint32_t length;
+    uint32_t source;        /* COPY : décalage source ; DATA : position dans la nouvelle image */
+} op_t;
+
+typedef struct
+{
+    op_t *ops;
+    size_t count;
+    uint64_t reads;         /* Pages source lues, hors page elle-même */
+} page_plan_t;
+
+typedef struct
+{
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+} buffer_t;
+
+static const uint8_t *old_image;
+static size_t old_length;
+static const uint8_t *new_image;
+static size_t new_length;
+static int32_t *hash_head;
+static int32_t *hash_prev;
+
+static void put_bytes(buffer_t *b, const void *data, size_t length)
+{
+    while ((b->length + length) > b->capacity)
+    {
+        b->capacity = (b->capacity != 0U) ? (b->capacity * 2U) : 4096U;
+        b->data = realloc(b->data, b->capacity);
+        if (b->data == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    memcpy(&b->data[b->length], data, length);
+    b->length += length;
+}
+
+static void put_le(buffer_t *b, uint32_t value, size_t size)
+{
+    uint8_t bytes[4];
+    size_t i;
+
+    for (i = 0U; i < size; i++)
+    {
+        bytes[i] = (uint8_t)(value >> (8U * i));
+    }
+    put_bytes(b, bytes, size);
+}
+
+static uint32_t hash4(const uint8_t *p)
+{
+    uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    return (v * 2654435761U) >> (32U - HASH_BITS);
+}
+
+static void build_index(void)
+{
+    size_t i;
+
+    hash_head = malloc(sizeof(int32_t) << HASH_BITS);
+    hash_prev = malloc(sizeof(int32_t) * (old_length + 1U));
+    memset(hash_head, 0xFF, sizeof(int32_t) << HASH_BITS);
+    for (i = 0U; (i + 4U) <= old_length; i++)
+    {
+        uint32_t h = hash4(&old_image[i]);
+        hash_prev[i] = hash_head[h];
+        hash_head[h] = (int32_t)i;
+    }
+}
+
+/**
+ * @brief Plus longue copie autorisée depuis l'image source pour la position pos de la nouvelle image.
+ */
+static size_t find_copy(size_t pos, size_t limit, uint64_t forbidden, size_t *source)
+{
+    size_t best = 0U;
+    int32_t candidate;
+    unsigned tries = 0U;
+
+    if ((pos + 4U) > new_length)
+    {
+        return 0U;
+    }
+    for (candidate = hash_head[hash4(&new_image[pos])];
+         (candidate >= 0) && (tries < MAX_CANDIDATES);
+         candidate = hash_prev[candidate], tries++)
+    {
+        size_t s = (size_t)candidate;
+        size_t n = 0U;
+
+        while (((pos + n) < limit) && ((s + n) < old_length)
+               && (((forbidden >> ((s + n) / DELTA_PAGE_SIZE)) & 1U) == 0U)
+               && (old_image[s + n] == new_image[pos + n]))
+        {
+            n++;
+        }
+        if (n > best)
+        {
+            best = n;
+            *source = s;
+            if ((pos + n) == limit)
+            {
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+static void add_op(page_plan_t *plan, uint8_t type, uint32_t length, uint32_t source)
+{
+    if ((type == DELTA_OP_DATA) && (plan->count > 0U) && (plan->ops[plan->count - 1U].type == DELTA_OP_DATA))
+    {
+        plan->ops[plan->count - 1U].length += length;
+        return;
+    }
+    plan->ops = realloc(plan->ops, sizeof(op_t) * (plan->count + 1U));
+    plan->ops[plan->count].type = type;
+    plan->ops[plan->count].length = length;
+    plan->ops[plan->count].source = source;
+    plan->count++;
+}
+
+/**
+ * @brief Code une page de la nouvelle image sans lire les pages source interdites.
+ */
+static void encode_page(page_plan_t *plan, size_t page, uint64_t forbidden)
+{
+    size_t pos = page * DELTA_PAGE_SIZE;
+    size_t end = pos + DELTA_PAGE_SIZE;
+    size_t source = 0U;
+    size_t n;
+    size_t p;
+
+    if (end > new_length)
+    {
+        end = new_length;
+    }
+    forbidden &= ~(1ULL << page);
+    plan->count = 0U;
+    plan->reads = 0U;
+
+    while (pos < end)
+    {
+        n = find_copy(pos, end, forbidden, &source);
+        if (n >= MIN_COPY)
+        {
+            add_op(plan, DELTA_OP_COPY, (uint32_t)n, (uint32_t)source);
+            for (p = source / DELTA_PAGE_SIZE; p <= ((source + n - 1U) / DELTA_PAGE_SIZE); p++)
+            {
+                if (p != page)
+                {
+                    plan->reads |= 1ULL << p;
+                }
+            }
+            pos += n;
+        }
+        else
+        {
+            add_op(plan, DELTA_OP_DATA, 1U, (uint32_t)pos);
+            pos++;
+        }
+    }
+}
+
+/**
+ * @brief Calcule les pages à réécrire et leur ordre, puis sérialise le patch.
+ */
+static buffer_t make_patch(void)
+{
+    size_t pages = (new_length + DELTA_PAGE_SIZE - 1U) / DELTA_PAGE_SIZE;
+    page_plan_t plan[DELTA_MAX_PAGES];
+    uint64_t forbidden[DELTA_MAX_PAGES];
+    uint64_t remaining = 0U;
+    uint64_t written = 0U;
+    size_t order[DELTA_MAX_PAGES];
+    size_t order_count = 0U;
+    buffer_t patch = { NULL, 0U, 0U };
+    size_t k;
+    size_t y;
+    size_t i;
+
+    memset(plan, 0, sizeof(plan));
+    memset(forbidden, 0, sizeof(forbidden));
+    for (k = 0U; k < pages; k++)
+    {
+        size_t start = k * DELTA_PAGE_SIZE;
+        size_t n = ((new_length - start) < DELTA_PAGE_SIZE) ? (new_length - start) : DELTA_PAGE_SIZE;
+
+        /* Page inchangée : ni effacée ni réécrite */
+        if (((start + n) <= old_length) && (memcmp(&old_image[start], &new_image[start], n) == 0))
+        {
+            continue;
+        }
+        encode_page(&plan[k], k, 0U);
+        remaining |= 1ULL << k;
+    }
+
+    while (remaining != 0U)
+    {
+        size_t best = pages;
+        unsigned best_readers = ~0U;
+
+        for (k = 0U; k < pages; k++)
+        {
+            unsigned readers = 0U;
+
+            if (((remaining >> k) & 1U) == 0U)
+            {
+                continue;
+            }
+            for (y = 0U; y < pages; y++)
+            {
+                if ((y != k) && (((remaining >> y) & 1U) != 0U) && (((plan[y].reads >> k) & 1U) != 0U))
+                {
+                    readers++;
+                }
+            }
+            if (readers < best_readers)
+            {
+                best_readers = readers;
+                best = k;
+            }
+        }
+
+        /* Dépendance circulaire : les lecteurs de la page choisie sont recodés sans elle */
+        if (best_readers != 0U)
+        {
+            for (y = 0U; y < pages; y++)
+            {
+                if ((y != best) && (((remaining >> y) & 1U) != 0U) && (((plan[y].reads >> best) & 1U) != 0U))
+                {
+                    forbidden[y] |= (1ULL << best) | written;
+                    encode_page(&plan[y], y, forbidden[y]);
+                }
+            }
+        }
+        order[order_count++] = best;
+        remaining &= ~(1ULL << best);
+        written |= 1ULL << best;
+    }
+
+    put_bytes(&patch, "ADL1", 4U);
+    put_le(&patch, DELTA_PAGE_SIZE, 2U);
+    put_le(&patch, (uint32_t)order_count, 2U);
+    put_le(&patch, (uint32_t)old_length, 4U);
+    put_le(&patch, crc32_final(crc32_update(crc32_init(), old_image, (uint32_t)old_length)), 4U);
+    put_le(&patch, (uint32_t)new_length, 4U);
+    put_le(&patch, crc32_final(crc32_update(crc32_init(), new_image, (uint32_t)new_length)), 4U);
+    for (i = 0U; i < order_count; i++)
+    {
+        page_plan_t *p = &plan[order[i]];
+        size_t start = order[i] * DELTA_PAGE_SIZE;
+        size_t n = ((new_length - start) < DELTA_PAGE_SIZE) ? (new_length - start) : DELTA_PAGE_SIZE;
+
+        put_le(&patch, (uint32_t)order[i], 2U);
+        put_le(&patch, (uint32_t)n, 2U);
+        for (k = 0U; k < p->count; k++)
+        {
+            put_le(&patch, p->ops[k].type, 1U);
+            put_le(&patch, p->ops[k].length, 2U);
+            if (p->ops[k].type == DELTA_OP_COPY)
+            {
+                put_le(&patch, p->ops[k].source, 4U);
+            }
+            else
+            {
+                put_bytes(&patch, &new_image[p->ops[k].source], p->ops[k].length);
+            }
+        }
+    }
+    for (k = 0U; k < pages; k++)
+    {
+        free(plan[k].ops);
+    }
+    return patch;
+}
+
+/**
+ * @brief Flash simulée : chaque page est préparée en RAM puis écrite d'un bloc, comme sur la cible.
+ */
+typedef struct
+{
+    uint8_t *flash;
+    uint8_t page[DELTA_PAGE_SIZE];
+    uint32_t page_address;
+    uint32_t page_fill;
+    unsigned pages_written;
+} sim_flash_t;
+
+static int sink_to_flash(void *context, uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    sim_flash_t *sim = context;
+
+    if (sim->page_fill == 0U)
+    {
+        sim->page_address = offset;
+    }
+    if ((offset != (sim->page_address + sim->page_fill)) || ((sim->page_fill + length) > DELTA_PAGE_SIZE))
+    {
+        return -1;
+    }
+    memcpy(&sim->page[sim->page_fill], data, length);
+    sim->page_fill += length;
+    if (sim->page_fill == DELTA_PAGE_SIZE)
+    {
+        memcpy(&sim->flash[sim->page_address], sim->page, DELTA_PAGE_SIZE);
+        sim->page_fill = 0U;
+        sim->pages_written++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Applique le patch en place par blocs de CHUNK_SIZE octets, comme lors d'une réception XMODEM.
+ */
+static int apply(const buffer_t *patch, sim_flash_t *sim)
+{
+    static delta_decoder_t decoder;
+    size_t pos = 0U;
+    int status = DELTA_OK;
+
+    memset(sim->flash, 0xFF, DELTA_MAX_PAGES * DELTA_PAGE_SIZE);
+    memcpy(sim->flash, old_image, old_length);
+    sim->page_fill = 0U;
+    sim->pages_written = 0U;
+
+    delta_decoder_init(&decoder, sim->flash, DELTA_MAX_PAGES * DELTA_PAGE_SIZE);
+    while ((pos < patch->length) && (status == DELTA_OK))
+    {
+        size_t n = ((patch->length - pos) < CHUNK_SIZE) ? (patch->length - pos) : CHUNK_SIZE;
+        status = delta_decode(&decoder, &patch->data[pos], (uint32_t)n, sink_to_flash, sim);
+        pos += n;
+    }
+    if (status == DELTA_OK)
+    {
+        /* Patch sans page modifiée */
+        status = delta_decode(&decoder, NULL, 0U, sink_to_flash, sim);
+    }
+    return (status == DELTA_DONE) ? delta_finish(&decoder, sim->flash) : DELTA_ERROR;
+}
+
+static uint8_t *read_file(const char *path, size_t *length)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *data;
+    long size;
+
+    if (f == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc((size_t)size + 1U);
+    if ((data == NULL) || (fread(data, 1U, (size_t)size, f) != (size_t)size))
+    {
+        perror(path);
+        exit(1);
+    }
+    fclose(f);
+    *length = (size_t)size;
+    return data;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static double update_time_s(size_t transfer_bytes, unsigned pages)
+{
+    /* XMODEM-1K : 1029 octets sur la ligne par bloc de 1024, 10 bits par octet */
+    double blocks = (double)((transfer_bytes + 1023U) / 1024U);
+    double flash = (double)pages * (PAGE_ERASE_S + ((DELTA_PAGE_SIZE / 8U) * DWORD_PROGRAM_S));
+
+    return (blocks * 1029.0 * 10.0 / BAUD_RATE) + flash;
+}
+
+int main(int argc, char **argv)
+{
+    int bench = ((argc == 4) && (strcmp(argv[1], "-b") == 0));
+    buffer_t patch;
+    sim_flash_t sim;
+    unsigned full_pages;
+
+    if (argc != 4)
+    {
+        fprintf(stderr, "usage: %s old.bin new.bin patch.adl | -b old.bin new.bin\n", argv[0]);
+        return 2;
+    }
+
+    old_image = read_file(argv[bench ? 2 : 1], &old_length);
+    new_image = read_file(argv[bench ? 3 : 2], &new_length);
+    if ((old_length > (DELTA_MAX_PAGES * DELTA_PAGE_SIZE)) || (new_length == 0U)
+        || (new_length > (DELTA_MAX_PAGES * DELTA_PAGE_SIZE)))
+    {
+        fprintf(stderr, "image size out of range\n");
+        return 1;
+    }
+
+    build_index();
+    patch = make_patch();
+    sim.flash = malloc(DELTA_MAX_PAGES * DELTA_PAGE_SIZE);
+    if (apply(&patch, &sim) != DELTA_DONE)
+    {
+        fprintf(stderr, "verification failed\n");
+        return 1;
+    }
+
+    full_pages = (unsigned)((new_length + DELTA_PAGE_SIZE - 1U) / DELTA_PAGE_SIZE);
+    printf("%zu -> %zu bytes patch (%.1f %% of the new image), %u/%u pages rewritten\n",
+           new_length, patch.length, 100.0 * (double)patch.length / (double)new_length,
+           sim.pages_written, full_pages);
+
+    if (bench)
+    {
+        unsigned runs = 0U;
+        double start = now_s();
+        double elapsed;
+
+        do
+        {
+            (void)apply(&patch, &sim);
+            runs++;
+            elapsed = now_s() - start;
+        } while (elapsed < 1.0);
+        printf("apply: %.1f MB/s output (%u runs)\n",
+               ((double)new_length * runs) / (elapsed * 1e6), runs);
+        printf("update at %.0f baud (XMODEM-1K, flash included): %.1f s full image, %.1f s patch\n",
+               BAUD_RATE, update_time_s(new_length, full_pages), update_time_s(patch.length, sim.pages_written));
+    }
+    else
+    {
+        FILE *f = fopen(argv[3], "wb");
+        if ((f == NULL) || (fwrite(patch.data, 1U, patch.length, f) != patch.length))
+        {
+            perror(argv[3]);
+            return 1;
+        }
+        fclose(f);
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file flash_sim.c
+ * @brief Outil PC : simulation de l'écriture d'une image dans la flash du STM32G431.
+ *
+ * Modélise une flash à une banque (pages de 2 ko, lignes de 256 octets, écriture
+ * limitée aux transitions 1 -> 0 sur une zone effacée) avec les temps typiques de la
+ * fiche technique, et compare :
+ *   - l'ancienne méthode : effacement page par page, programmation par double mot ;
+ *   - la méthode actuelle (flash_pipe.c, flash_program_rows()) : effacement de toute
+ *     la plage en une fois, programmation rapide par ligne, lignes vierges ignorées.
+ * Le contenu final de la flash simulée est comparé à l'image.
+ *
+ * Compilation :
+ *     gcc -O2 -o flash_sim flash_sim.c
+ *
+ * Utilisation :
+ *     flash_sim image.bin [bauds]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_SIZE       (2048U)
+#define ROW_SIZE        (256U)
+#define APP_SIZE        (56U * 1024U)   /* 0x08010000 à 0x0801DFFF */
+
+/* Temps typiques (STM32G431, DS12589) en microsecondes */
+#define T_ERASE_PAGE    (22020.0)       /* Effacement d'une page */
+#define T_PROG_DWORD    (81.69)         /* Programmation d'un double mot */
+#define T_PROG_ROW_FAST (1910.0)        /* Ligne de 32 doubles mots, mode rapide */
+
+typedef struct
+{
+    uint8_t mem[APP_SIZE];
+    double time_us;
+    unsigned erases;
+    unsigned dwords;
+    unsigned rows;
+    unsigned blank_rows;
+    unsigned faults;        /* Programmation d'un bit 0 -> 1 (zone non effacée) */
+} flash_t;
+
+static void sim_erase(flash_t *f, uint32_t page, uint32_t count)
+{
+    memset(&f->mem[page * PAGE_SIZE], 0xFF, count * PAGE_SIZE);
+    f->time_us += T_ERASE_PAGE * count;
+    f->erases += count;
+}
+
+static void sim_program(flash_t *f, uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    uint32_t i;
+
+    for (i = 0U; i < length; i++)
+    {
+        if ((data[i] & ~f->mem[offset + i]) != 0U)
+        {
+            f->faults++;
+        }
+        f->mem[offset + i] &= data[i];
+    }
+}
+
+static void sim_program_dword(flash_t *f, uint32_t offset, const uint8_t *data)
+{
+    sim_program(f, offset, data, 8U);
+    f->time_us += T_PROG_DWORD;
+    f->dwords++;
+}
+
+/**
+ * @brief Ancienne méthode : page effacée puis 256 doubles mots, même vierges.
+ */
+static void write_legacy(flash_t *f, const uint8_t *image, uint32_t length)
+{
+    uint32_t page;
+    uint32_t pos;
+
+    for (page = 0U; (page * PAGE_SIZE) < length; page++)
+    {
+        sim_erase(f, page, 1U);
+        for (pos = 0U; pos < PAGE_SIZE; pos += 8U)
+        {
+            sim_program_dword(f, (page * PAGE_SIZE) + pos, &image[(page * PAGE_SIZE) + pos]);
+        }
+    }
+}
+
+/**
+ * @brief Méthode actuelle, comme flash_pipe_erase_ahead() et flash_program_rows().
+ */
+static void write_fast(flash_t *f, const uint8_t *image, uint32_t length)
+{
+    uint32_t pages = (length + PAGE_SIZE - 1U) / PAGE_SIZE;
+    uint32_t pos;
+    uint32_t i;
+    int blank;
+
+    sim_erase(f, 0U, pages);
+    for (pos = 0U; pos < (pages * PAGE_SIZE); pos += ROW_SIZE)
+    {
+        blank = 1;
+        for (i = 0U; (i < ROW_SIZE) && blank; i++)
+        {
+            blank = (image[pos + i] == 0xFFU);
+        }
+        if (blank)
+        {
+            f->blank_rows++;
+            continue;
+        }
+        sim_program(f, pos, &image[pos], ROW_SIZE);
+        f->time_us += T_PROG_ROW_FAST;
+        f->rows++;
+    }
+}
+
+static void report(const char *name, const flash_t *f, const uint8_t *image, uint32_t length)
+{
+    printf("%-8s erase %4u pages  program %5u dwords %4u rows (%u blank)  %7.1f ms  %s\n",
+           name, f->erases, f->dwords, f->rows, f->blank_rows, f->time_us / 1000.0,
+           ((f->faults == 0U) && (memcmp(f->mem, image, length) == 0)) ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char **argv)
+{
+    static uint8_t image[APP_SIZE];
+    static flash_t legacy;
+    static flash_t fast;
+    unsigned long baud = (argc > 2) ? strtoul(argv[2], NULL, 10) : 115200UL;
+    uint32_t length;
+    uint32_t padded;
+    FILE *in;
+
+    if ((argc < 2) || ((in = fopen(argv[1], "rb")) == NULL))
+    {
+        fprintf(stderr, "usage: %s image.bin [baud]\n", argv[0]);
+        return 2;
+    }
+    memset(image, 0xFF, sizeof(image));
+    length = (uint32_t)fread(image, 1U, sizeof(image), in);
+    fclose(in);
+    if (length == 0U)
+    {
+        fprintf(stderr, "%s: empty or larger than %u bytes\n", argv[1], APP_SIZE);
+        return 1;
+    }
+    padded = ((length + PAGE_SIZE - 1U) / PAGE_SIZE) * PAGE_SIZE;
+
+    memset(legacy.mem, 0x00, sizeof(legacy.mem));
+    memset(fast.mem, 0x00, sizeof(fast.mem));
+    write_legacy(&legacy, image, length);
+    write_fast(&fast, image, length);
+
+    printf("image: %u bytes, %u pages, transfer at %lu baud: %.1f ms\n",
+           length, padded / PAGE_SIZE, baud, (double)length * 10000.0 / (double)baud);
+    report("legacy", &legacy, image, padded);
+    report("fast", &fast, image, padded);
+    printf("program time: %.1f ms -> %.1f ms\n",
+           (legacy.time_us - (T_ERASE_PAGE * legacy.erases)) / 1000.0,
+           (fast.time_us - (T_ERASE_PAGE * fast.erases)) / 1000.0);
+    return 0;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file image_pack.c
+ * @brief Outil PC : ajout de l'en-tête d'image (Core/Inc/image.h) devant un fichier à transférer.
+ *
+ * L'en-tête décrit l'image finale (taille, CRC32, version) ; le contenu transféré
+ * peut être l'image elle-même, sa version compressée (lzss_pack) ou un patch
+ * (delta_pack) qui la reconstruit.
+ *
+ * Compilation :
+ *     gcc -O2 -I../Core/Inc -o image_pack image_pack.c ../Core/Src/crc.c
+ *
+ * Utilisation :
+ *     image_pack [-r] [-v majeur.mineur.révision] image.bin [contenu] sortie.img
+ *
+ *     -r : l'émetteur sait reprendre un transfert interrompu (IMAGE_FLAG_RESUMABLE,
+ *          image brute uniquement) : il doit accepter 'R' + position (4 octets,
+ *          petit-boutiste) en réponse au bloc 1, puis envoyer le bloc 2 à partir de
+ *          cette position du fichier.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crc.h"
+#include "image.h"
+
+/* Adresse de l'application (APPLICATION_ADDRESS, def.h) */
+#define LOAD_ADDRESS    (0x08010000UL)
+
+static uint8_t *read_file(const char *path, size_t *length)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *data;
+    long size;
+
+    if (f == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc((size_t)size + 1U);
+    if ((data == NULL) || (fread(data, 1U, (size_t)size, f) != (size_t)size))
+    {
+        perror(path);
+        exit(1);
+    }
+    fclose(f);
+    *length = (size_t)size;
+    return data;
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned major = 0U;
+    unsigned minor = 0U;
+    unsigned release = 0U;
+    uint8_t header[IMAGE_HEADER_SIZE];
+    const char *payload_path;
+    const char *output_path;
+    uint8_t *image;
+    uint8_t *payload;
+    size_t image_length;
+    size_t payload_length;
+    uint32_t flags = 0U;
+    int arg = 1;
+    FILE *f;
+
+    if ((argc > arg) && (strcmp(argv[arg], "-r") == 0))
+    {
+        flags |= IMAGE_FLAG_RESUMABLE;
+        arg++;
+    }
+    if (((argc - arg) > 1) && (strcmp(argv[arg], "-v") == 0))
+    {
+        if (sscanf(argv[arg + 1], "%u.%u.%u", &major, &minor, &release) < 2)
+        {
+            fprintf(stderr, "bad version: %s\n", argv[arg + 1]);
+            return 2;
+        }
+        arg += 2;
+    }
+    if (((argc - arg) != 2) && ((argc - arg) != 3))
+    {
+        fprintf(stderr, "usage: %s [-r] [-v major.minor.release] image.bin [payload] out.img\n", argv[0]);
+        return 2;
+    }
+    payload_path = ((argc - arg) == 3) ? argv[arg + 1] : argv[arg];
+    output_path = argv[argc - 1];
+
+    image = read_file(argv[arg], &image_length);
+    payload = read_file(payload_path, &payload_length);
+    if (image_length == 0U)
+    {
+        fprintf(stderr, "empty image\n");
+        return 1;
+    }
+
+    put32(&header[0], IMAGE_HEADER_MAGIC);
+    put32(&header[4], LOAD_ADDRESS);
+    put32(&header[8], (uint32_t)image_length);
+    put32(&header[12], crc32_final(crc32_update(crc32_init(), image, (uint32_t)image_length)));
+    put32(&header[16], ((major & 0xFFU) << 16) | ((minor & 0xFFU) << 8) | (release & 0xFFU));
+    put32(&header[20], flags);
+    put32(&header[24], 0xFFFFFFFFUL);
+    put32(&header[28], crc32_final(crc32_update(crc32_init(), header, IMAGE_HEADER_CRC_SIZE)));
+
+    f = fopen(output_path, "wb");
+    if ((f == NULL) || (fwrite(header, 1U, sizeof(header), f) != sizeof(header))
+        || (fwrite(payload, 1U, payload_length, f) != payload_length))
+    {
+        perror(output_path);
+        return 1;
+    }
+    fclose(f);
+    printf("%s: %zu byte image, version %u.%u.%u, %zu byte payload\n",
+           output_path, image_length, major, minor, release, payload_length);
+    return 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * @file lzss_pack.c
+ * @brief Outil PC : compression LZSS des images firmware et banc de mesure du décodeur.
+ *
+ * Produit le format décrit dans Core/Inc/lzss.h, décompressé en flux par le
+ * bootloader. Le décodeur de la cible (Core/Src/lzss.c) est compilé tel quel.
+ *
+ * Compilation :
+ *     gcc -O2 -I../Core/Inc -o lzss_pack lzss_pack.c ../Core/Src/lzss.c
+ *
+ * Utilisation :
+ *     lzss_pack image.bin image.alz     compression (vérifiée par décompression)
+ *     lzss_pack -b image.bin            taux de compression et débit du décodeur
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lzss.h"
+
+/* Taille minimale d'une répétition rentable : 17 bits contre 9 bits par littéral */
+#define MIN_MATCH   (2U)
+
+/* Taille d'un bloc XMODEM, pour simuler la réception par morceaux */
+#define CHUNK_SIZE  (1024U)
+
+typedef struct
+{
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+    uint32_t bits;
+    uint32_t bit_count;
+} bit_writer_t;
+
+static void put_byte(bit_writer_t *w, uint8_t byte)
+{
+    if (w->length == w->capacity)
+    {
+        w->capacity = (w->capacity != 0U) ? (w->capacity * 2U) : 4096U;
+        w->data = realloc(w->data, w->capacity);
+        if (w->data == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    w->data[w->length++] = byte;
+}
+
+static void put_bits(bit_writer_t *w, uint32_t value, uint32_t count)
+{
+    while (count > 0U)
+    {
+        count--;
+        w->bits = (w->bits << 1U) | ((value >> count) & 1U);
+        w->bit_count++;
+        if (w->bit_count == 8U)
+        {
+            put_byte(w, (uint8_t)w->bits);
+            w->bits = 0U;
+            w->bit_count = 0U;
+        }
+    }
+}
+
+/**
+ * @brief Compression gloutonne : plus longue répétition dans la fenêtre à chaque position.
+ */
+static bit_writer_t compress(const uint8_t *in, size_t length)
+{
+    bit_writer_t w = { NULL, 0U, 0U, 0U, 0U };
+    size_t pos = 0U;
+    size_t i;
+
+    put_byte(&w, 'A');
+    put_byte(&w, 'L');
+    put_byte(&w, 'Z');
+    put_byte(&w, '1');
+    put_byte(&w, (uint8_t)LZSS_WINDOW_BITS);
+    put_byte(&w, (uint8_t)LZSS_LOOKAHEAD_BITS);
+    put_byte(&w, 0U);
+    put_byte(&w, 0U);
+    for (i = 0U; i < 4U; i++)
+    {
+        put_byte(&w, (uint8_t)(length >> (8U * i)));
+    }
+
+    while (pos < length)
+    {
+        size_t best_length = 0U;
+        size_t best_offset = 0U;
+        size_t max_length = length - pos;
+        size_t offset;
+
+        if (max_length > LZSS_MAX_MATCH)
+        {
+            max_length = LZSS_MAX_MATCH;
+        }
+        for (offset = 1U; (offset <= LZSS_WINDOW_SIZE) && (offset <= pos); offset++)
+        {
+            size_t n = 0U;
+            while ((n < max_length) && (in[pos + n - offset] == in[pos + n]))
+            {
+                n++;
+            }
+            if (n > best_length)
+            {
+                best_length = n;
+                best_offset = offset;
+                if (n == max_length)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (best_length >= MIN_MATCH)
+        {
+            put_bits(&w, 0U, 1U);
+            put_bits(&w, (uint32_t)(best_offset - 1U), LZSS_WINDOW_BITS);
+            put_bits(&w, (uint32_t)(best_length - 1U), LZSS_LOOKAHEAD_BITS);
+            pos += best_length;
+        }
+        else
+        {
+            put_bits(&w, 1U, 1U);
+            put_bits(&w, in[pos], 8U);
+            pos++;
+        }
+    }
+    if (w.bit_count != 0U)
+    {
+        put_bits(&w, 0U, 8U - w.bit_count);
+    }
+    return w;
+}
+
+typedef struct
+{
+    uint8_t *data;
+    size_t length;
+} sink_buffer_t;
+
+static int sink_to_buffer(void *context, const uint8_t *data, uint32_t length)
+{
+    sink_buffer_t *out = context;
+
+    memcpy(&out->data[out->length], data, length);
+    out->length += length;
+    return 0;
+}
+
+/**
+ * @brief Décompresse par blocs de CHUNK_SIZE octets, comme lors d'une réception XMODEM.
+ */
+static int decompress(const uint8_t *in, size_t length, sink_buffer_t *out)
+{
+    static lzss_decoder_t decoder;
+    size_t pos = 0U;
+    int status = LZSS_OK;
+
+    lzss_decoder_init(&decoder);
+    out->length = 0U;
+    while ((pos < length) && (status == LZSS_OK))
+    {
+        size_t n = ((length - pos) < CHUNK_SIZE) ? (length - pos) : CHUNK_SIZE;
+        status = lzss_decode(&decoder, &in[pos], (uint32_t)n, sink_to_buffer, out);
+        pos += n;
+    }
+    return status;
+}
+
+static uint8_t *read_file(const char *path, size_t *length)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *data;
+    long size;
+
+    if (f == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc((size_t)size + 1U);
+    if ((data == NULL) || (fread(data, 1U, (size_t)size, f) != (size_t)size))
+    {
+        perror(path);
+        exit(1);
+    }
+    fclose(f);
+    *length = (size_t)size;
+    return data;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+int main(int argc, char **argv)
+{
+    int bench = ((argc == 3) && (strcmp(argv[1], "-b") == 0));
+    const char *input = bench ? argv[2] : argv[1];
+    size_t length;
+    uint8_t *image;
+    bit_writer_t packed;
+    sink_buffer_t check;
+
+    if ((argc != 3) || (input == NULL))
+    {
+        fprintf(stderr, "usage: %s image.bin image.alz | -b image.bin\n", argv[0]);
+        return 2;
+    }
+
+    image = read_file(input, &length);
+    packed = compress(image, length);
+    check.data = malloc(length + 1U);
+    if ((decompress(packed.data, packed.length, &check) != LZSS_DONE)
+        || (check.length != length) || (memcmp(check.data, image, length) != 0))
+    {
+        fprintf(stderr, "verification failed\n");
+        return 1;
+    }
+
+    printf("%zu -> %zu bytes (%.1f %%)\n", length, packed.length,
+           (length != 0U) ? (100.0 * (double)packed.length / (double)length) : 0.0);
+
+    if (bench)
+    {
+        unsigned runs = 0U;
+        double start = now_s();
+        double elapsed;
+
+        do
+        {
+            (void)decompress(packed.data, packed.length, &check);
+            runs++;
+            elapsed = now_s() - start;
+        } while (elapsed < 1.0);
+        printf("decode: %.1f MB/s output (%u runs)\n",
+               ((double)length * runs) / (elapsed * 1e6), runs);
+        printf("transfer at 38400 baud: %.1f s raw, %.1f s compressed\n",
+               (double)length * 10.0 / 38400.0, (double)packed.length * 10.0 / 38400.0);
+    }
+    else
+    {
+        FILE *f = fopen(argv[2], "wb");
+        if ((f == NULL) || (fwrite(packed.data, 1U, packed.length, f) != packed.length))
+        {
+            perror(argv[2]);
+            return 1;
+        }
+        fclose(f);
+    }
+    return 0;
+}
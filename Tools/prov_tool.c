@@ -0,0 +1,1031 @@
+/**
+ * @file prov_tool.c
+ * @brief Outil PC : provisionnement d'une carte par les commandes binaires du bootloader (Core/Src/prov.c).
+ *
+ * Les commandes de la ligne sont exécutées dans l'ordre, dans une même session :
+ * une carte est identifiée, configurée, vérifiée et lancée en quelques échanges,
+ * sans passer par le menu VT100.
+ *
+ * Compilation :
+ *     gcc -O2 -I../Core/Inc -o prov_tool prov_tool.c ../Core/Src/crc.c
+ *
+ * Utilisation :
+ *     prov_tool -d /dev/ttyUSB0 [-b bauds] commande...
+ *
+ *     -b : débit d'ouverture de la session (38400 par défaut), mesuré par le
+ *          bootloader sur l'octet 0x7F qui précède le 0x00 d'ouverture
+ *
+ *     baud débit                    passage au débit donné, confirmé par une trame
+ *                                   de test ; retour à 38400 en cas d'échec
+ *     info                          identifiant, versions, état de l'application
+ *     get [clé...]                  lecture des coefficients (tous par défaut)
+ *     set clé=valeur...             écriture des coefficients, en une commande
+ *     update xmodem|xmodem-g|slwin fichier
+ *                                   transfert d'une image (XMODEM 1K, 1K-G ou
+ *                                   fenêtre glissante de slwin.c)
+ *     verify                        recalcul du CRC32 de l'application
+ *     jump                          lancement de l'application
+ *     exit                          retour du bootloader à l'attente du menu
+ *
+ * Clés : anemo, pluvio, temp_a, temp_b ou numéro KVLOG_KEY_xxx.
+ *
+ * Exemple :
+ *     prov_tool -d /dev/ttyUSB0 info set anemo=1.1176 pluvio=0.2 verify jump
+ *     prov_tool -d /dev/ttyUSB0 baud 2000000 update xmodem app.bin verify jump
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "crc.h"
+
+/* Codes et statuts de prov.c */
+#define CMD_INFO            0x01U
+#define CMD_CONFIG_READ     0x02U
+#define CMD_CONFIG_WRITE    0x03U
+#define CMD_UPDATE          0x04U
+#define CMD_VERIFY          0x05U
+#define CMD_JUMP            0x06U
+#define CMD_EXIT            0x07U
+#define CMD_BAUD            0x08U
+#define CMD_PROBE           0x09U
+#define RESPONSE            0x80U
+
+#define PAYLOAD_MAX         (128U)
+#define FRAME_MAX           (PAYLOAD_MAX + 8U)
+#define REPLY_TIMEOUT_MS    (500)
+#define RETRIES             (3)
+
+/* Changement de débit (def.h) */
+#define BAUD_DEFAULT        (38400UL)
+#define AUTOBAUD_SYNC       0x7FU
+#define PROBE_TIMEOUT_MS    (1000)      /* PROV_PROBE_TIMEOUT_MS du bootloader */
+#define PROBE_REPLY_MS      (200)
+#define PROBE_RETRIES       (4)
+
+/* XMODEM (xmodem.h) */
+#define XMODEM_STX          0x02U
+#define XMODEM_EOT          0x04U
+#define XMODEM_ACK          0x06U
+#define XMODEM_NAK          0x15U
+#define XMODEM_CAN          0x18U
+#define XMODEM_BLOCK        (1024U)
+
+/* Fenêtre glissante (slwin.c) */
+#define SLWIN_TYPE_DATA     0x01U
+#define SLWIN_TYPE_END      0x02U
+#define SLWIN_TYPE_ABORT    0x18U
+#define SLWIN_TYPE_READY    0x80U
+#define SLWIN_TYPE_ACK      0x81U
+#define SLWIN_BLOCK         (1024U)
+#define SLWIN_FRAME         (2U + SLWIN_BLOCK + 2U)
+#define SLWIN_WINDOW_MAX    (8U)
+#define SLWIN_ACK_TIMEOUT_MS (200)      /* Répétition de l'ACK par le bootloader */
+#define SLWIN_TIMEOUT_MS    (500)
+#define SLWIN_TRIES         (10)
+
+static const char * const key_names[] = { "anemo", "pluvio", "temp_a", "temp_b" };
+#define KEY_COUNT   (sizeof(key_names) / sizeof(key_names[0]))
+
+static const char * const status_names[] = {
+    "ok", "unknown command", "bad length", "unknown key", "out of range", "flash error", "no valid image"
+};
+
+static int port = -1;
+static unsigned long port_baud = BAUD_DEFAULT;
+static uint8_t sequence = 0U;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec * 1000.0) + ((double)ts.tv_nsec * 1e-6);
+}
+
+static const char *status_name(uint8_t status)
+{
+    return (status < (sizeof(status_names) / sizeof(status_names[0]))) ? status_names[status] : "?";
+}
+
+static speed_t baud_constant(unsigned long baud)
+{
+    switch (baud)
+    {
+        case 9600UL:    return B9600;
+        case 19200UL:   return B19200;
+        case 38400UL:   return B38400;
+        case 57600UL:   return B57600;
+        case 115200UL:  return B115200;
+        case 230400UL:  return B230400;
+        case 460800UL:  return B460800;
+        case 921600UL:  return B921600;
+        case 500000UL:  return B500000;
+        case 1000000UL: return B1000000;
+        case 1500000UL: return B1500000;
+        case 2000000UL: return B2000000;
+        case 2500000UL: return B2500000;
+        case 3000000UL: return B3000000;
+        default:        return B0;
+    }
+}
+
+static int port_open(const char *path, unsigned long baud)
+{
+    struct termios tio;
+    speed_t speed = baud_constant(baud);
+
+    port = open(path, O_RDWR | O_NOCTTY);
+    if ((port < 0) || (speed == B0) || (tcgetattr(port, &tio) != 0))
+    {
+        fprintf(stderr, "%s: %s\n", path, (speed == B0) ? "unsupported baud rate" : strerror(errno));
+        return -1;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    (void)tcsetattr(port, TCSANOW, &tio);
+    (void)tcflush(port, TCIOFLUSH);
+    port_baud = baud;
+    return 0;
+}
+
+/**
+ * @brief Change le débit du port après l'émission des octets en attente.
+ */
+static int port_set_baud(unsigned long baud)
+{
+    struct termios tio;
+    speed_t speed = baud_constant(baud);
+
+    if ((speed == B0) || (tcdrain(port) != 0) || (tcgetattr(port, &tio) != 0))
+    {
+        return -1;
+    }
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(port, TCSANOW, &tio) != 0)
+    {
+        return -1;
+    }
+    port_baud = baud;
+    return 0;
+}
+
+static void port_write(const uint8_t *data, size_t length)
+{
+    ssize_t written;
+
+    while (length > 0U)
+    {
+        written = write(port, data, length);
+        if (written <= 0)
+        {
+            return;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+/**
+ * @brief Lit un octet, -1 après timeout_ms.
+ */
+static int port_read(int timeout_ms)
+{
+    struct pollfd pfd = { port, POLLIN, 0 };
+    uint8_t byte;
+
+    if ((poll(&pfd, 1, timeout_ms) <= 0) || (read(port, &byte, 1U) != 1))
+    {
+        return -1;
+    }
+    return byte;
+}
+
+static size_t cobs_encode(const uint8_t *src, size_t length, uint8_t *dst)
+{
+    size_t code_pos = 0U;
+    size_t out = 1U;
+    size_t i;
+    uint8_t code = 1U;
+
+    for (i = 0U; i < length; i++)
+    {
+        if (src[i] == 0U)
+        {
+            dst[code_pos] = code;
+            code_pos = out++;
+            code = 1U;
+            continue;
+        }
+        dst[out++] = src[i];
+        if (++code == 0xFFU)
+        {
+            dst[code_pos] = code;
+            code_pos = out++;
+            code = 1U;
+        }
+    }
+    dst[code_pos] = code;
+    return out;
+}
+
+static int cobs_decode(const uint8_t *src, size_t length, uint8_t *dst)
+{
+    size_t in = 0U;
+    size_t out = 0U;
+    uint8_t code;
+    uint8_t i;
+
+    while (in < length)
+    {
+        code = src[in++];
+        if ((code == 0U) || ((in + code - 1U) > length))
+        {
+            return -1;
+        }
+        for (i = 1U; i < code; i++)
+        {
+            dst[out++] = src[in++];
+        }
+        if ((code != 0xFFU) && (in < length))
+        {
+            dst[out++] = 0U;
+        }
+    }
+    return (int)out;
+}
+
+/**
+ * @brief Attend la réponse à une commande : code | 0x80, séquence, CRC valide.
+ *
+ * @return int Longueur des données de la réponse (statut compris), -1 si aucune.
+ */
+static int receive_reply(uint8_t cmd, uint8_t seq, uint8_t *reply, int timeout_ms)
+{
+    uint8_t encoded[(FRAME_MAX * 2U) + 2U];
+    uint8_t frame[sizeof(encoded)];
+    size_t length = 0U;
+    double deadline = now_ms() + timeout_ms;
+    uint16_t crc;
+    int decoded;
+    int byte;
+
+    while (now_ms() < deadline)
+    {
+        byte = port_read((int)(deadline - now_ms()) + 1);
+        if (byte < 0)
+        {
+            break;
+        }
+        if (byte != 0)
+        {
+            if (length < sizeof(encoded))
+            {
+                encoded[length++] = (uint8_t)byte;
+            }
+            continue;
+        }
+        decoded = (length > 0U) ? cobs_decode(encoded, length, frame) : -1;
+        length = 0U;
+        if ((decoded < 5) || (frame[0] != (cmd | RESPONSE)) || (frame[1] != seq))
+        {
+            continue;
+        }
+        crc = (uint16_t)((frame[decoded - 2] << 8) | frame[decoded - 1]);
+        if (crc16_final(crc16_update(crc16_init(), frame, (uint32_t)decoded - 2U)) != crc)
+        {
+            continue;
+        }
+        memcpy(reply, &frame[2], (size_t)decoded - 4U);
+        return decoded - 4;
+    }
+    return -1;
+}
+
+/**
+ * @brief Envoie une commande et attend sa réponse, avec répétition.
+ *
+ * @param[out] reply Statut suivi des données de la réponse.
+ * @return int Longueur de reply, -1 sans réponse.
+ */
+static int transact_timed(uint8_t cmd, const uint8_t *data, size_t length, uint8_t *reply,
+                          int timeout_ms, int retries)
+{
+    uint8_t raw[FRAME_MAX];
+    uint8_t encoded[FRAME_MAX + 4U];
+    size_t encoded_length;
+    uint16_t crc;
+    int attempt;
+    int received;
+
+    sequence++;
+    raw[0] = cmd;
+    raw[1] = sequence;
+    memcpy(&raw[2], data, length);
+    crc = crc16_final(crc16_update(crc16_init(), raw, (uint32_t)length + 2U));
+    raw[length + 2U] = (uint8_t)(crc >> 8);
+    raw[length + 3U] = (uint8_t)crc;
+    encoded_length = cobs_encode(raw, length + 4U, encoded);
+    encoded[encoded_length++] = 0U;
+
+    for (attempt = 0; attempt < retries; attempt++)
+    {
+        port_write(encoded, encoded_length);
+        received = receive_reply(cmd, sequence, reply, timeout_ms);
+        if (received > 0)
+        {
+            return received;
+        }
+    }
+    fprintf(stderr, "no reply to command 0x%02X\n", cmd);
+    return -1;
+}
+
+static int transact(uint8_t cmd, const uint8_t *data, size_t length, uint8_t *reply)
+{
+    return transact_timed(cmd, data, length, reply, REPLY_TIMEOUT_MS, RETRIES);
+}
+
+static uint32_t get_u32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static float get_float(const uint8_t *src)
+{
+    uint32_t raw = get_u32(src);
+    float value;
+
+    memcpy(&value, &raw, sizeof(value));
+    return value;
+}
+
+static int parse_key(const char *text, size_t length)
+{
+    size_t i;
+    char *end;
+    unsigned long key;
+
+    for (i = 0U; i < KEY_COUNT; i++)
+    {
+        if ((strlen(key_names[i]) == length) && (strncmp(text, key_names[i], length) == 0))
+        {
+            return (int)i;
+        }
+    }
+    key = strtoul(text, &end, 0);
+    return ((size_t)(end - text) == length) && (length > 0U) && (key < 256UL) ? (int)key : -1;
+}
+
+static const char *key_name(uint8_t key)
+{
+    return (key < KEY_COUNT) ? key_names[key] : "?";
+}
+
+static int do_info(void)
+{
+    uint8_t reply[FRAME_MAX];
+    int length = transact(CMD_INFO, NULL, 0U, reply);
+    uint32_t version;
+
+    if ((length < 63) || (reply[0] != 0U))
+    {
+        return -1;
+    }
+    version = get_u32(&reply[23]);
+    printf("protocol %u, payload %u\n", reply[1], (unsigned)(reply[2] | (reply[3] << 8)));
+    printf("unique id %08X%08X%08X\n", get_u32(&reply[4]), get_u32(&reply[8]), get_u32(&reply[12]));
+    printf("bootloader %u.%02u%c, config %u.%02u%c\n",
+           reply[16], reply[17], reply[18], reply[19], reply[20], reply[21]);
+    printf("application %s, version %u.%u.%u, %u bytes, \"%.32s\"\n", reply[22] ? "valid" : "absent",
+           (version >> 16) & 0xFFU, (version >> 8) & 0xFFU, version & 0xFFU, get_u32(&reply[27]), (const char *)&reply[31]);
+    return 0;
+}
+
+static int do_get(char **keys, int count)
+{
+    uint8_t data[PAYLOAD_MAX];
+    uint8_t reply[FRAME_MAX];
+    int length;
+    int key;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        key = parse_key(keys[i], strlen(keys[i]));
+        if (key < 0)
+        {
+            fprintf(stderr, "unknown key %s\n", keys[i]);
+            return -1;
+        }
+        data[i] = (uint8_t)key;
+    }
+    length = transact(CMD_CONFIG_READ, data, (size_t)count, reply);
+    if ((length < 1) || (reply[0] != 0U))
+    {
+        fprintf(stderr, "get: %s\n", (length < 1) ? "no reply" : status_name(reply[0]));
+        return -1;
+    }
+    for (i = 1; (i + 6) <= length; i += 6)
+    {
+        if (reply[i + 1] == 0U)
+        {
+            printf("%s = %.6g\n", key_name(reply[i]), (double)get_float(&reply[i + 2]));
+        }
+        else
+        {
+            printf("%u: %s\n", reply[i], status_name(reply[i + 1]));
+        }
+    }
+    return 0;
+}
+
+static int do_set(char **items, int count)
+{
+    uint8_t data[PAYLOAD_MAX];
+    uint8_t reply[FRAME_MAX];
+    const char *equal;
+    size_t length = 0U;
+    uint32_t raw;
+    float value;
+    int key;
+    int received;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        equal = strchr(items[i], '=');
+        key = (equal != NULL) ? parse_key(items[i], (size_t)(equal - items[i])) : -1;
+        if ((key < 0) || ((length + 5U) > PAYLOAD_MAX))
+        {
+            fprintf(stderr, "bad item %s\n", items[i]);
+            return -1;
+        }
+        value = strtof(equal + 1, NULL);
+        memcpy(&raw, &value, sizeof(raw));
+        data[length++] = (uint8_t)key;
+        data[length++] = (uint8_t)raw;
+        data[length++] = (uint8_t)(raw >> 8);
+        data[length++] = (uint8_t)(raw >> 16);
+        data[length++] = (uint8_t)(raw >> 24);
+    }
+    received = transact(CMD_CONFIG_WRITE, data, length, reply);
+    if (received < 1)
+    {
+        return -1;
+    }
+    for (i = 1; (i + 2) <= received; i += 2)
+    {
+        if (reply[i + 1] != 0U)
+        {
+            fprintf(stderr, "set %s: %s\n", key_name(reply[i]), status_name(reply[i + 1]));
+        }
+    }
+    printf("set: %s\n", status_name(reply[0]));
+    return (reply[0] == 0U) ? 0 : -1;
+}
+
+/**
+ * @brief Émetteur XMODEM 1K (CRC) ou 1K-G minimal.
+ */
+static int xmodem_send(const uint8_t *image, size_t size, int streaming)
+{
+    uint8_t frame[3U + XMODEM_BLOCK + 2U];
+    uint8_t block = 1U;
+    size_t offset = 0U;
+    size_t chunk;
+    uint16_t crc;
+    int retries = 0;
+    int byte;
+
+    do
+    {
+        byte = port_read(3000);
+    } while ((byte >= 0) && (byte != (streaming ? 'G' : 'C')));
+    if (byte < 0)
+    {
+        fprintf(stderr, "update: receiver not ready\n");
+        return -1;
+    }
+
+    while (offset < size)
+    {
+        chunk = ((size - offset) < XMODEM_BLOCK) ? (size - offset) : XMODEM_BLOCK;
+        frame[0] = XMODEM_STX;
+        frame[1] = block;
+        frame[2] = (uint8_t)~block;
+        memset(&frame[3], 0x1A, XMODEM_BLOCK);
+        memcpy(&frame[3], &image[offset], chunk);
+        crc = crc16_final(crc16_update(crc16_init(), &frame[3], XMODEM_BLOCK));
+        frame[3U + XMODEM_BLOCK] = (uint8_t)(crc >> 8);
+        frame[4U + XMODEM_BLOCK] = (uint8_t)crc;
+        port_write(frame, sizeof(frame));
+        if (!streaming)
+        {
+            byte = port_read(5000);
+            if ((byte != XMODEM_ACK) && (++retries < 10) && (byte != XMODEM_CAN))
+            {
+                continue;
+            }
+            if (byte != XMODEM_ACK)
+            {
+                fprintf(stderr, "update: block %u refused\n", block);
+                return -1;
+            }
+        }
+        retries = 0;
+        offset += chunk;
+        block++;
+    }
+
+    do
+    {
+        frame[0] = XMODEM_EOT;
+        port_write(frame, 1U);
+        byte = port_read(5000);
+    } while ((byte == XMODEM_NAK) && (++retries < 10));
+    return (byte == XMODEM_ACK) ? 0 : -1;
+}
+
+/**
+ * @brief Encode et envoie une trame de la fenêtre glissante.
+ *
+ * @return size_t Octets écrits sur le port.
+ */
+static size_t slwin_write(uint8_t type, uint8_t seq, const uint8_t *data, size_t length)
+{
+    uint8_t frame[SLWIN_FRAME];
+    uint8_t encoded[SLWIN_FRAME + (SLWIN_FRAME / 254U) + 2U];
+    uint16_t crc;
+    size_t n;
+
+    frame[0] = type;
+    frame[1] = seq;
+    memcpy(&frame[2], data, length);
+    crc = crc16_final(crc16_update(crc16_init(), frame, (uint32_t)length + 2U));
+    frame[2U + length] = (uint8_t)(crc >> 8);
+    frame[3U + length] = (uint8_t)crc;
+    n = cobs_encode(frame, length + 4U, encoded);
+    encoded[n] = 0U;
+    port_write(encoded, n + 1U);
+    return n + 1U;
+}
+
+/**
+ * @brief Lit une trame courte du bootloader (READY, ACK ou ABORT).
+ *
+ * @param[out] frame Type, séquence et donnée de la trame.
+ * @return int 0, ou -1 sans trame valide avant timeout_ms.
+ */
+static int slwin_read(uint8_t *frame, int timeout_ms)
+{
+    uint8_t encoded[16];
+    uint8_t decoded[sizeof(encoded)];
+    size_t length = 0U;
+    double deadline = now_ms() + timeout_ms;
+    int byte;
+
+    while (now_ms() < deadline)
+    {
+        byte = port_read((int)(deadline - now_ms()) + 1);
+        if (byte < 0)
+        {
+            break;
+        }
+        if (byte != 0)
+        {
+            if (length < sizeof(encoded))
+            {
+                encoded[length] = (uint8_t)byte;
+            }
+            length++;
+            continue;
+        }
+        if ((length <= sizeof(encoded)) && (length > 0U) && (cobs_decode(encoded, length, decoded) == 5)
+            && (crc16_final(crc16_update(crc16_init(), decoded, 3U)) == (uint16_t)((decoded[3] << 8) | decoded[4])))
+        {
+            memcpy(frame, decoded, 3U);
+            return 0;
+        }
+        length = 0U;
+    }
+    return -1;
+}
+
+/**
+ * @brief Émetteur à fenêtre glissante (slwin.c).
+ *
+ * Les blocs sont numérotés de 0 à units - 1, le dernier étant la trame END. Les
+ * trous signalés par le masque de l'ACK sont réémis une fois ; un ACK reçu après
+ * SLWIN_ACK_TIMEOUT_MS de silence de l'outil est la répétition du bootloader et
+ * autorise une nouvelle réémission. Sans progrès pendant SLWIN_TIMEOUT_MS, tous
+ * les blocs non acquittés sont réémis.
+ */
+static int slwin_send(const uint8_t *image, size_t size)
+{
+    uint8_t acked[SLWIN_WINDOW_MAX] = { 0U };
+    uint8_t resent[SLWIN_WINDOW_MAX] = { 0U };
+    uint8_t frame[3];
+    size_t units = ((size + SLWIN_BLOCK - 1U) / SLWIN_BLOCK) + 1U;
+    size_t window;
+    size_t base = 0U;
+    size_t next = 0U;
+    size_t highest;
+    size_t offset;
+    size_t u;
+    size_t i;
+    size_t bytes;
+    double sent = 0.0;
+    double deadline = 0.0;
+    int tries = 0;
+    int progress = 1;
+    int resend = 0;
+
+    do
+    {
+        if (slwin_read(frame, 3000) != 0)
+        {
+            fprintf(stderr, "update: receiver not ready\n");
+            return -1;
+        }
+    } while ((frame[0] != SLWIN_TYPE_READY) && (frame[0] != SLWIN_TYPE_ABORT));
+    if (frame[0] == SLWIN_TYPE_ABORT)
+    {
+        return -1;
+    }
+    window = ((frame[2] == 0U) || (frame[2] > SLWIN_WINDOW_MAX)) ? SLWIN_WINDOW_MAX : frame[2];
+
+    while (base < units)
+    {
+        if (progress || resend)
+        {
+            bytes = 0U;
+            /* Réémissions demandées puis blocs neufs, jusqu'à remplir la fenêtre */
+            for (u = base; u < next; u++)
+            {
+                if (acked[u % SLWIN_WINDOW_MAX] == 2U)
+                {
+                    acked[u % SLWIN_WINDOW_MAX] = 0U;
+                    resent[u % SLWIN_WINDOW_MAX] = 1U;
+                    offset = u * SLWIN_BLOCK;
+                    bytes += slwin_write((u < (units - 1U)) ? SLWIN_TYPE_DATA : SLWIN_TYPE_END, (uint8_t)u, &image[offset],
+                                (u < (units - 1U)) ? (((size - offset) < SLWIN_BLOCK) ? (size - offset) : SLWIN_BLOCK) : 0U);
+                }
+            }
+            for (; (next < (base + window)) && (next < units); next++)
+            {
+                acked[next % SLWIN_WINDOW_MAX] = 0U;
+                resent[next % SLWIN_WINDOW_MAX] = 0U;
+                offset = next * SLWIN_BLOCK;
+                bytes += slwin_write((next < (units - 1U)) ? SLWIN_TYPE_DATA : SLWIN_TYPE_END, (uint8_t)next, &image[offset],
+                            (next < (units - 1U)) ? (((size - offset) < SLWIN_BLOCK) ? (size - offset) : SLWIN_BLOCK) : 0U);
+            }
+            /* Horodatage à la fin de l'émission sur la ligne : tcdrain() rend la main
+               dès la mise en tampon sur un pseudo-terminal ou certains adaptateurs USB */
+            sent = now_ms() + (((double)bytes * 10000.0) / (double)port_baud);
+            (void)tcdrain(port);
+            if (now_ms() > sent)
+            {
+                sent = now_ms();
+            }
+            if (progress)
+            {
+                deadline = sent + SLWIN_TIMEOUT_MS;
+            }
+        }
+        progress = 0;
+        resend = 0;
+
+        if (slwin_read(frame, (int)(deadline - now_ms()) + 1) != 0)
+        {
+            if (++tries >= SLWIN_TRIES)
+            {
+                frame[0] = 0U;
+                (void)slwin_write(SLWIN_TYPE_ABORT, 0U, frame, 1U);
+                fprintf(stderr, "update: no acknowledge\n");
+                return -1;
+            }
+            /* Échéance : tous les blocs non acquittés sont réémis */
+            for (u = base; u < next; u++)
+            {
+                if (acked[u % SLWIN_WINDOW_MAX] != 1U)
+                {
+                    acked[u % SLWIN_WINDOW_MAX] = 2U;
+                }
+            }
+            progress = 1;
+            continue;
+        }
+        if (frame[0] == SLWIN_TYPE_ABORT)
+        {
+            fprintf(stderr, "update: aborted by receiver\n");
+            return -1;
+        }
+        if (frame[0] != SLWIN_TYPE_ACK)
+        {
+            continue;
+        }
+
+        u = base + (uint8_t)(frame[1] - (uint8_t)base);
+        if (u > next)
+        {
+            continue;
+        }
+        if (u > base)
+        {
+            base = u;
+            tries = 0;
+            progress = 1;
+        }
+        if (now_ms() >= (sent + SLWIN_ACK_TIMEOUT_MS))
+        {
+            /* Répétition du bootloader : les réémissions ont pu être perdues */
+            memset(resent, 0, sizeof(resent));
+            resend = 1;
+        }
+        highest = 0U;
+        for (i = 0U; i < (SLWIN_WINDOW_MAX - 1U); i++)
+        {
+            u = base + 1U + i;
+            if (((frame[2] & (1U << i)) != 0U) && (u < next))
+            {
+                acked[u % SLWIN_WINDOW_MAX] = 1U;
+                highest = u;
+            }
+        }
+        if ((highest == 0U) && !progress && resend)
+        {
+            highest = base + 1U;
+        }
+        resend = 0;
+        /* Trous sous le plus haut bloc reçu : réémis une fois */
+        for (u = base; u < highest; u++)
+        {
+            if ((acked[u % SLWIN_WINDOW_MAX] == 0U) && (resent[u % SLWIN_WINDOW_MAX] == 0U))
+            {
+                acked[u % SLWIN_WINDOW_MAX] = 2U;
+                resend = 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int do_update(const char *protocol, const char *path)
+{
+    uint8_t reply[FRAME_MAX];
+    uint8_t mode;
+    uint8_t *image;
+    size_t size;
+    long file_size;
+    double start = now_ms();
+    FILE *in;
+    int received;
+
+    if (strcmp(protocol, "xmodem") == 0)
+    {
+        mode = 0U;
+    }
+    else if (strcmp(protocol, "xmodem-g") == 0)
+    {
+        mode = 1U;
+    }
+    else if (strcmp(protocol, "slwin") == 0)
+    {
+        mode = 2U;
+    }
+    else
+    {
+        fprintf(stderr, "update: unknown protocol %s\n", protocol);
+        return -1;
+    }
+    in = fopen(path, "rb");
+    if ((in == NULL) || (fseek(in, 0L, SEEK_END) != 0) || ((file_size = ftell(in)) <= 0L))
+    {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return -1;
+    }
+    size = (size_t)file_size;
+    image = malloc(size);
+    rewind(in);
+    if ((image == NULL) || (fread(image, 1U, size, in) != size))
+    {
+        fclose(in);
+        free(image);
+        return -1;
+    }
+    fclose(in);
+
+    received = transact(CMD_UPDATE, &mode, 1U, reply);
+    if ((received < 1) || (reply[0] != 0U)
+        || (((mode == 2U) ? slwin_send(image, size) : xmodem_send(image, size, mode == 1U)) != 0))
+    {
+        free(image);
+        fprintf(stderr, "update: transfer failed\n");
+        return -1;
+    }
+    free(image);
+
+    /* Seconde réponse, après l'écriture de l'image */
+    received = receive_reply(CMD_UPDATE, sequence, reply, 5000);
+    if ((received < 13) || (reply[0] != 0U))
+    {
+        fprintf(stderr, "update: %s\n", (received < 1) ? "no result" : status_name(reply[0]));
+        return -1;
+    }
+    printf("update: %zu bytes in %.0f ms, %u pages, erase %u ms, program %u ms\n", size, now_ms() - start,
+           get_u32(&reply[1]), get_u32(&reply[5]), get_u32(&reply[9]));
+    return 0;
+}
+
+/**
+ * @brief Passage au débit donné, confirmé par l'écho d'une trame de test.
+ *
+ * Sans écho, le bootloader revient à 38400 bauds après PROBE_TIMEOUT_MS : l'outil
+ * attend ce délai et revient au même débit. La session continue dans les deux cas,
+ * ainsi que sur le port USB CDC de la carte, qui refuse la commande (unknown command).
+ */
+static int do_baud(const char *text)
+{
+    static const uint8_t pattern[] = {
+        0x55U, 0xAAU, 0x00U, 0xFFU, 0x0FU, 0xF0U, 0x7FU, 0x80U,
+        0x01U, 0xFEU, 0x33U, 0xCCU, 0x00U, 0x00U, 0xFFU, 0xFFU
+    };
+    uint8_t data[4];
+    uint8_t reply[FRAME_MAX];
+    unsigned long baud = strtoul(text, NULL, 10);
+    uint32_t actual;
+    double start;
+    int received;
+
+    if (baud_constant(baud) == B0)
+    {
+        fprintf(stderr, "baud: unsupported rate %s\n", text);
+        return -1;
+    }
+    data[0] = (uint8_t)baud;
+    data[1] = (uint8_t)(baud >> 8);
+    data[2] = (uint8_t)(baud >> 16);
+    data[3] = (uint8_t)(baud >> 24);
+    received = transact(CMD_BAUD, data, sizeof(data), reply);
+    if ((received >= 1) && (reply[0] == 1U))
+    {
+        /* Port USB CDC : pas de débit de ligne, la session continue */
+        printf("baud: not applicable on this link, ignored\n");
+        return 0;
+    }
+    if ((received < 5) || (reply[0] != 0U))
+    {
+        fprintf(stderr, "baud: %s\n", (received < 1) ? "no reply" : status_name(reply[0]));
+        return -1;
+    }
+
+    actual = get_u32(&reply[1]);
+    start = now_ms();
+    if (port_set_baud(baud) == 0)
+    {
+        received = transact_timed(CMD_PROBE, pattern, sizeof(pattern), reply, PROBE_REPLY_MS, PROBE_RETRIES);
+        if ((received == (int)(sizeof(pattern) + 1U)) && (reply[0] == 0U)
+            && (memcmp(&reply[1], pattern, sizeof(pattern)) == 0))
+        {
+            printf("baud: %lu (board %u)\n", baud, actual);
+            return 0;
+        }
+    }
+
+    /* Liaison non confirmée : retour des deux côtés au débit par défaut */
+    while ((now_ms() - start) < (PROBE_TIMEOUT_MS + 100))
+    {
+        (void)port_read(10);
+    }
+    (void)port_set_baud(BAUD_DEFAULT);
+    (void)tcflush(port, TCIOFLUSH);
+    printf("baud: probe failed at %lu, back to %lu\n", baud, BAUD_DEFAULT);
+    return 0;
+}
+
+static int do_simple(uint8_t cmd, const char *name)
+{
+    uint8_t reply[FRAME_MAX];
+    int received = transact(cmd, NULL, 0U, reply);
+
+    if (received < 1)
+    {
+        return -1;
+    }
+    printf("%s: %s\n", name, status_name(reply[0]));
+    return (reply[0] == 0U) ? 0 : -1;
+}
+
+/**
+ * @brief Nombre d'arguments de commande qui suivent (jusqu'à la commande suivante).
+ */
+static int count_arguments(char **argv, int argc, int first)
+{
+    static const char * const commands[] = { "info", "get", "set", "update", "verify", "jump", "exit", "baud" };
+    int count = 0;
+    size_t i;
+
+    for (; (first + count) < argc; count++)
+    {
+        for (i = 0U; i < (sizeof(commands) / sizeof(commands[0])); i++)
+        {
+            if (strcmp(argv[first + count], commands[i]) == 0)
+            {
+                return count;
+            }
+        }
+    }
+    return count;
+}
+
+int main(int argc, char **argv)
+{
+    const char *device = NULL;
+    unsigned long baud = 38400UL;
+    const uint8_t start[] = { AUTOBAUD_SYNC, 0U };
+    double begin;
+    int status = 0;
+    int count;
+    int i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:b:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd': device = optarg; break;
+            case 'b': baud = strtoul(optarg, NULL, 10); break;
+            default: device = NULL; optind = argc; break;
+        }
+    }
+    if ((device == NULL) || (optind >= argc))
+    {
+        fprintf(stderr, "usage: %s -d device [-b baud] info|get|set|update|verify|jump|exit|baud ...\n", argv[0]);
+        return 2;
+    }
+    if (port_open(device, baud) != 0)
+    {
+        return 1;
+    }
+
+    /* 0x7F pour la mesure du débit, puis 0x00 à la place de l'espace du menu : ouverture de la session */
+    begin = now_ms();
+    port_write(start, sizeof(start));
+
+    for (i = optind; (i < argc) && (status == 0); i += 1 + count)
+    {
+        count = count_arguments(argv, argc, i + 1);
+        if (strcmp(argv[i], "info") == 0)
+        {
+            status = do_info();
+        }
+        else if (strcmp(argv[i], "get") == 0)
+        {
+            status = do_get(&argv[i + 1], count);
+        }
+        else if (strcmp(argv[i], "set") == 0)
+        {
+            status = do_set(&argv[i + 1], count);
+        }
+        else if ((strcmp(argv[i], "update") == 0) && (count == 2))
+        {
+            status = do_update(argv[i + 1], argv[i + 2]);
+        }
+        else if (strcmp(argv[i], "verify") == 0)
+        {
+            status = do_simple(CMD_VERIFY, "verify");
+        }
+        else if (strcmp(argv[i], "jump") == 0)
+        {
+            status = do_simple(CMD_JUMP, "jump");
+        }
+        else if (strcmp(argv[i], "exit") == 0)
+        {
+            status = do_simple(CMD_EXIT, "exit");
+        }
+        else if ((strcmp(argv[i], "baud") == 0) && (count == 1))
+        {
+            status = do_baud(argv[i + 1]);
+        }
+        else
+        {
+            fprintf(stderr, "bad command %s\n", argv[i]);
+            status = -1;
+        }
+    }
+    printf("%.0f ms\n", now_ms() - begin);
+    close(port);
+    return (status == 0) ? 0 : 1;
+}
@@ -27,6 +27,7 @@
 #include "usbd_cdc_if.h"
 
 /* USER CODE BEGIN Includes */
+#include "usbd_FTDI.h"
 
 /* USER CODE END Includes */
 
@@ -109,6 +110,20 @@ void MX_USB_Device_Init(void)
   /* USER CODE BEGIN USB_Device_Init_PreTreatment */
   /* USB Clock Initialization */
    USBD_Clock_Config();
+
+#if (USBD_FTDI_EMULATION == 1U)
+  /* Émulation FT232R à la place du port CDC (usbd_FTDI.c) */
+  if (USBD_Init(&hUsbDeviceFS, &FTDI_Desc, DEVICE_FS) != USBD_OK) {
+    Error_Handler();
+  }
+  if (USBD_RegisterClass(&hUsbDeviceFS, &USBD_FTDI) != USBD_OK) {
+    Error_Handler();
+  }
+  if (USBD_Start(&hUsbDeviceFS) != USBD_OK) {
+    Error_Handler();
+  }
+  return;
+#endif
   /* USER CODE END USB_Device_Init_PreTreatment */
 
   /* Init Device Library, add supported class and start the library. */
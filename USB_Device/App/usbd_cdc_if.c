@@ -20,6 +20,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "inc.h"
+#include "usbd_cdc_if.h"
 
 /* USER CODE BEGIN INCLUDE */
 #include "main.h"
@@ -88,11 +89,7 @@
   */
 /* Create buffer for reception and transmission           */
 /* It's up to user to redefine and/or remove those define */
-/** Received data over USB are stored in this buffer      */
-uint8_t UserRxBufferFS[APP_RX_DATA_SIZE];
-
-/** Data to send over USB CDC are stored in this buffer   */
-uint8_t UserTxBufferFS[APP_TX_DATA_SIZE];
+/* Émission : en place depuis cdc_tx_fifo (Rou_cdc.c) */
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
 USBD_CDC_LineCodingTypeDef LineCoding =
@@ -102,13 +99,17 @@ USBD_CDC_LineCodingTypeDef LineCoding =
   0x00,   /* parity - none*/
   0x08    /* nb. of bits 8*/
 };
-uint32_t BuffLength;
-uint32_t UserTxBufPtrIn;/* Increment this pointer or roll it back to
-                               start address when data are received over USART */
-uint32_t UserTxBufPtrOut; /* Increment this pointer or roll it back to
-                                 start address when data are sent over USB */
 
-__IO uint32_t uwPrescalerValue;
+/**
+ * @brief Tampons de réception de l'endpoint OUT, armés à tour de rôle.
+ *
+ * Le paquet suivant est reçu dans un autre tampon pendant la copie du paquet
+ * courant dans cdc_fifo : l'endpoint n'est jamais réarmé sur un tampon en cours
+ * de lecture.
+ */
+static uint8_t cdc_rx_packets[CDC_RX_PACKET_BUFFERS][CDC_DATA_FS_OUT_PACKET_SIZE];
+static uint32_t cdc_rx_index = 0U;              /**< Tampon armé pour le prochain paquet */
+static volatile bool cdc_rx_paused = false;     /**< Endpoint en NAK, FIFO pleine */
 /* USER CODE END PRIVATE_VARIABLES */
 
 /**
@@ -123,11 +124,6 @@ __IO uint32_t uwPrescalerValue;
 extern USBD_HandleTypeDef hUsbDeviceFS;
 
 /* USER CODE BEGIN EXPORTED_VARIABLES */
-/* UART handler declaration */
-//UART_HandleTypeDef UartHandle;
-/* TIM handler declaration */
-TIM_HandleTypeDef  TimHandle;
-/* USB handler declaration */
 /* USER CODE END EXPORTED_VARIABLES */
 
 /**
@@ -146,8 +142,7 @@ static int8_t CDC_Receive_FS(uint8_t* pbuf, uint32_t *Len);
 static int8_t CDC_TransmitCplt_FS(uint8_t *pbuf, uint32_t *Len, uint8_t epnum);
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_DECLARATION */
- void TIM_Config(void);
- 
+static void CDC_RxArmNext(void);
 /* USER CODE END PRIVATE_FUNCTIONS_DECLARATION */
 
 /**
@@ -205,8 +200,12 @@ static int8_t CDC_Init_FS(void)
 //  TIM_Config();
 
   /*##-5- Set Application Buffers ############################################*/
-  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, UserTxBufferFS, 0);
-  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
+  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, NULL, 0);
+  CDC_TxReset();
+  /* Premier paquet dans le tampon 0, armé par USBD_CDC_Init() au retour */
+  cdc_rx_index = 0U;
+  cdc_rx_paused = false;
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, cdc_rx_packets[0]);
 
   return (USBD_OK);
   /* USER CODE END 3 */
@@ -219,6 +218,7 @@ static int8_t CDC_Init_FS(void)
 static int8_t CDC_DeInit_FS(void)
 {
   /* USER CODE BEGIN 4 */
+  CDC_TxReset();
   return (USBD_OK);
   /* USER CODE END 4 */
 }
@@ -294,32 +294,33 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
 
 
 /**
- * @brief Insère les données reçues dans le buffer circulaire.
- *
- * Cette fonction est appelée par CDC_Receive_FS().
- *
- * @param[in] Buf Pointeur sur les données reçues.
- * @param[in] Len Nombre d'octets reçus.
- */
-//extern volatile uint8_t CDC_RxBuffer[CDC_RX_BUFFER_SIZE];
-
-/**
- * @brief Indice d'insertion dans le buffer.
+ * @brief Arme l'endpoint OUT sur le tampon suivant.
  */
-extern volatile uint16_t CDC_RxHead;
+static void CDC_RxArmNext(void)
+{
+  cdc_rx_index = (cdc_rx_index + 1U) % CDC_RX_PACKET_BUFFERS;
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, cdc_rx_packets[cdc_rx_index]);
+  (void)USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+}
 
 /**
- * @brief Indice de lecture dans le buffer.
+ * @brief Reprise de la réception suspendue (appelée à chaque SOF, usbd_conf.c).
+ *
+ * Le PC répète le paquet refusé (NAK) à chaque trame ; l'endpoint est réarmé
+ * dès que la FIFO peut recevoir un paquet complet.
  */
-extern volatile uint16_t CDC_RxTail;
-
-//static void CDC_ReceiveCallback(uint8_t* Buf, uint32_t Len)
-//{
-//    uint32_t i;
-//    for (i = 0U; i < Len; i++) {
-//		fifo_put(&cdc_fifo, Buf[i]);
-//    }
-//}
+void CDC_RxResume(void)
+{
+  if (cdc_rx_paused)
+  {
+    v_cdc_rx_stats.nak_frames++;
+    if (fifo_free(&cdc_fifo) >= CDC_DATA_FS_OUT_PACKET_SIZE)
+    {
+      cdc_rx_paused = false;
+      CDC_RxArmNext();
+    }
+  }
+}
 
 
 /**
@@ -327,11 +328,9 @@ extern volatile uint16_t CDC_RxTail;
   *         through this function.
   *
   *         @note
-  *         This function will issue a NAK packet on any OUT packet received on
-  *         USB endpoint until exiting this function. If you exit this function
-  *         before transfer is complete on CDC interface (ie. using DMA controller)
-  *         it will result in receiving more data while previous ones are still
-  *         not sent.
+  *         L'endpoint est réarmé sur le tampon suivant avant la copie dans
+  *         cdc_fifo, si la FIFO peut recevoir ce paquet et le suivant. Sinon il
+  *         reste en NAK jusqu'à CDC_RxResume() : aucun octet n'est perdu.
   *
   * @param  Buf: Buffer of data to be received
   * @param  Len: Number of data received (in bytes)
@@ -339,10 +338,16 @@ extern volatile uint16_t CDC_RxTail;
   */
 static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len) {
   /* USER CODE BEGIN 6 */
-    USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
-    USBD_CDC_ReceivePacket(&hUsbDeviceFS);	
-    CDC_ReceiveCallback(Buf, *Len);
-
+  if (fifo_free(&cdc_fifo) >= (*Len + CDC_DATA_FS_OUT_PACKET_SIZE))
+  {
+    CDC_RxArmNext();
+  }
+  else
+  {
+    cdc_rx_paused = true;
+    v_cdc_rx_stats.naks++;
+  }
+  CDC_ReceiveCallback(Buf, *Len);
   return (USBD_OK);
   /* USER CODE END 6 */
 }
@@ -390,136 +395,12 @@ static int8_t CDC_TransmitCplt_FS(uint8_t *Buf, uint32_t *Len, uint8_t epnum) {
 	UNUSED(Buf);
 	UNUSED(Len);
 	UNUSED(epnum);
-	cdcTxComplete = true;	
+	/* Le ZLP éventuel est déjà parti : segment suivant de cdc_tx_fifo (Rou_cdc.c) */
+	CDC_TxComplete();
 	/* USER CODE END 13 */
 	return result;
 }
 
-/**
-  * @brief  TIM_Config: Configure TIMx timer
-  * @param  None.
-  * @retval None.
-  */
- void TIM_Config(void)
-{
-   /*##-1- Configure the TIM peripheral #######################################*/
-  /* -----------------------------------------------------------------------
-    In this example TIM2 input clock (TIM2CLK)  is set to APB1 clock (PCLK1),
-    since APB1 prescaler is equal to 1.
-      TIM2CLK = PCLK1
-      PCLK1 = HCLK
-      => TIM2CLK = HCLK = SystemCoreClock
-    To get TIM2 counter clock at 10 KHz, the Prescaler is computed as following:
-    Prescaler = (TIM2CLK / TIM2 counter clock) - 1
-    Prescaler = (SystemCoreClock /10 KHz) - 1
-
-    Note:
-     SystemCoreClock variable holds HCLK frequency and is defined in system_stm32g4xx.c file.
-     Each time the core clock (HCLK) changes, user had to update SystemCoreClock
-     variable value. Otherwise, any configuration based on this variable will be incorrect.
-     This variable is updated in three ways:
-      1) by calling CMSIS function SystemCoreClockUpdate()
-      2) by calling HAL API function HAL_RCC_GetSysClockFreq()
-      3) each time HAL_RCC_ClockConfig() is called to configure the system clock frequency
-  ----------------------------------------------------------------------- */
-
-  /* Compute the prescaler value to have TIMx counter clock equal to 10000 Hz */
-  uwPrescalerValue = (uint32_t)(SystemCoreClock / 10000U) - 1U;
-
-  /* Set TIMx instance */
-  TimHandle.Instance = TIMx;
-
-  /* Initialize TIMx peripheral as follows:
-       + Period = 10000 - 1
-       + Prescaler = (SystemCoreClock/10000) - 1
-       + ClockDivision = 0
-       + Counter direction = Up
-  */
-  TimHandle.Init.Period            = 10000 - 1;
-  TimHandle.Init.Prescaler         = uwPrescalerValue;
-  TimHandle.Init.ClockDivision     = 0;
-  TimHandle.Init.CounterMode       = TIM_COUNTERMODE_UP;
-  TimHandle.Init.RepetitionCounter = 0;
-  TimHandle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
-
-  if (HAL_TIM_Base_Init(&TimHandle) != HAL_OK)
-  {
-    /* Initialization Error */
-    Error_Handler();
-  }
-
-  /*##-2- Start the TIM Base generation in interrupt mode ####################*/
-  /* Start Channel1 */
-  if (HAL_TIM_Base_Start_IT(&TimHandle) != HAL_OK)
-  {
-    /* Starting Error */
-    Error_Handler();
-  }
-}
-
-
-/**
-  * @brief  TIM period elapsed callback
-  * @param  htim: TIM handle
-  * @retval None
-  */
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
-{
-  uint32_t buffptr;
-  uint32_t buffsize;
-
-    if (htim->Instance == TIM3)
-    {
-        /* Placez un breakpoint ici pour déboguer la mise à jour de TIM3 */
-	__NOP();
-    }	
-	
-  if(UserTxBufPtrOut != UserTxBufPtrIn)
-  {
-    if(UserTxBufPtrOut > UserTxBufPtrIn) /* Rollback */
-    {
-      buffsize = APP_RX_DATA_SIZE - UserTxBufPtrOut;
-    }
-    else
-    {
-      buffsize = UserTxBufPtrIn - UserTxBufPtrOut;
-    }
-
-    buffptr = UserTxBufPtrOut;
-
-    USBD_CDC_SetTxBuffer(&hUsbDeviceFS, (uint8_t*)&UserTxBufferFS[buffptr], buffsize);
-
-    if(USBD_CDC_TransmitPacket(&hUsbDeviceFS) == USBD_OK)
-    {
-      UserTxBufPtrOut += buffsize;
-      if (UserTxBufPtrOut == APP_RX_DATA_SIZE)
-      {
-        UserTxBufPtrOut = 0;
-      }
-    }
-  }
-}
-/**
-  * @brief  Rx Transfer completed callback
-  * @param  huart: UART handle
-  * @retval None
-  */
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
-{
-  /* Increment Index for buffer writing */
-  UserTxBufPtrIn++;
-
-  /* To avoid buffer overflow */
-  if(UserTxBufPtrIn == APP_RX_DATA_SIZE)
-  {
-    UserTxBufPtrIn = 0;
-  }
-
-  /* Start another reception: provide the buffer pointer with offset and the buffer size */
-  HAL_UART_Receive_IT(huart, (uint8_t *)(UserTxBufferFS + UserTxBufPtrIn), 1);
-
-
-}
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**